@@ -21,19 +21,23 @@ SUBDIRS += \
     Fundamentals \
     GAlib \
     MPIsupport \
+    SKIRTconvert \
     SKIRTcore \
     SKIRTmain \
     Voro
 
-# conditionally add GUI subproject subdirectories
+# conditionally add GUI and benchmark subproject subdirectories
 include(BuildUtils/BuildOptions.pri)
 BUILDING_GUI:SUBDIRS += SkirtMakeUp
+BUILDING_BENCHMARKS:SUBDIRS += SKIRTbench
 
 # define dependencies between subprojects
 FFTConvolution.depends = Fundamentals
 SKIRTcore.depends      = Cfitsio Voro Fundamentals MPIsupport
 Discover.depends       = Cfitsio Voro Fundamentals MPIsupport SKIRTcore
 SKIRTmain.depends      = Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover
+SKIRTconvert.depends   = Cfitsio Voro Fundamentals MPIsupport SKIRTcore
 FitSKIRTcore.depends   = FFTConvolution GAlib Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover
 FitSKIRTmain.depends   = FFTConvolution GAlib Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover FitSKIRTcore
 BUILDING_GUI:SkirtMakeUp.depends = FFTConvolution GAlib Cfitsio Voro Fundamentals MPIsupport SKIRTcore Discover FitSKIRTcore
+BUILDING_BENCHMARKS:SKIRTbench.depends = Cfitsio Voro Fundamentals MPIsupport SKIRTcore
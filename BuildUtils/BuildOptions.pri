@@ -18,3 +18,7 @@ CONFIG *= BUILDING_WITH_MPI
 # the following flag enables memory (de)allocation logging for SKIRT (which is only invoked when using the
 # "-l <limit>" flag). To disable this functionality, precede the following line with a # character
 #CONFIG *= BUILDING_MEMORY
+
+# the following flag enables building the micro-benchmarks for performance critical kernels (SKIRTbench).
+# To build the benchmarks, remove the # character at the start of the following line
+#CONFIG *= BUILDING_BENCHMARKS
@@ -17,6 +17,9 @@ TARGET = cfitsio
 QT -= core gui
 CONFIG *= staticlib create_prl thread c++11
 
+# build the library for use from multiple threads, so that different files can be accessed concurrently
+DEFINES += _REENTRANT
+
 # compile with maximum optimization and suppress all warnings
 QMAKE_CFLAGS_RELEASE -= -O2
 QMAKE_CFLAGS_RELEASE += -O3 -w
@@ -10,6 +10,7 @@
 
 #include "AdaptiveMeshAmrvacFile.hpp"
 #include "AdaptiveMeshAsciiFile.hpp"
+#include "AdaptiveMeshBinaryFile.hpp"
 #include "AdaptiveMeshDustDistribution.hpp"
 #include "AdaptiveMeshDustGrid.hpp"
 #include "AdaptiveMeshGeometry.hpp"
@@ -176,6 +177,7 @@
 #include "VoronoiDustGrid.hpp"
 #include "VoronoiGeometry.hpp"
 #include "VoronoiMeshAsciiFile.hpp"
+#include "VoronoiMeshBinaryFile.hpp"
 #include "VoronoiStellarComp.hpp"
 #include "WeingartnerDraineDustMix.hpp"
 #include "XDustCompNormalization.hpp"
@@ -330,9 +332,11 @@ void RegisterSimulationItems::registerAll()
     // mesh file representations
     add<AdaptiveMeshFile>(false);
     add<AdaptiveMeshAsciiFile>();
+    add<AdaptiveMeshBinaryFile>();
     add<AdaptiveMeshAmrvacFile>();
     add<VoronoiMeshFile>(false);
     add<VoronoiMeshAsciiFile>();
+    add<VoronoiMeshBinaryFile>();
 
     // meshes for the dust grids
     add<Mesh>(false);
@@ -0,0 +1,97 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef ALIASTABLE_HPP
+#define ALIASTABLE_HPP
+
+#include <algorithm>
+#include <vector>
+#include "Array.hpp"
+
+//////////////////////////////////////////////////////////////////////
+
+/** An AliasTable instance allows drawing random indices from a discrete probability distribution
+    over \f$N\f$ points in constant time, independent of \f$N\f$. The table is constructed with
+    Vose's variant of Walker's alias method: each of the \f$N\f$ bins of equal probability
+    \f$1/N\f$ holds a threshold \f$q_i\f$ and an alias index \f$a_i\f$. Given a uniform deviate
+    \f$X\in[0,1[\f$, the bin index is \f$i=\lfloor NX \rfloor\f$ and the fractional part \f$f=NX-i\f$
+    is compared to the threshold: the function returns \f$i\f$ if \f$f<q_i\f$ and \f$a_i\f$
+    otherwise. Constructing the table takes \f$O(N)\f$ time. Once constructed, the table is never
+    modified by sampling, so it can be shared between parallel threads. The AliasTable class is
+    fully implemented inline (in this header file). */
+class AliasTable
+{
+public:
+    /** The default constructor creates an empty table. */
+    AliasTable() { }
+
+    /** This function (re-)initializes the table for the discrete distribution with the
+        non-negative weights \f$p_i\f$ specified as an array. The weights do not need to be
+        normalized, but their sum must be positive. */
+    void initialize(const Array& pv)
+    {
+        size_t n = pv.size();
+        _qv.resize(n);
+        _av.resize(n);
+
+        // scale the probabilities so that their mean is one, and sort the bins in underfull and overfull ones
+        double norm = n / pv.sum();
+        std::vector<int> smallv, largev;
+        for (size_t i=0; i<n; i++)
+        {
+            _qv[i] = pv[i] * norm;
+            _av[i] = i;
+            if (_qv[i] < 1.) smallv.push_back(i);
+            else largev.push_back(i);
+        }
+
+        // fill each underfull bin with the excess probability of an overfull bin
+        while (!smallv.empty() && !largev.empty())
+        {
+            int s = smallv.back();
+            smallv.pop_back();
+            int l = largev.back();
+            _av[s] = l;
+            _qv[l] = (_qv[l] + _qv[s]) - 1.;
+            if (_qv[l] < 1.)
+            {
+                largev.pop_back();
+                smallv.push_back(l);
+            }
+        }
+
+        // the remaining bins are full, apart from roundoff errors
+        for (int i : largev) _qv[i] = 1.;
+        for (int i : smallv) _qv[i] = 1.;
+    }
+
+    /** This function releases the memory held by the table, leaving an empty table. */
+    void clear()
+    {
+        _qv.resize(0);
+        std::vector<int>().swap(_av);
+    }
+
+    /** This function returns the number of points in the distribution represented by the table. */
+    size_t size() const { return _qv.size(); }
+
+    /** This function returns a random index drawn from the distribution represented by the table,
+        given a uniform deviate \f$X\in[0,1[\f$. The table must not be empty. */
+    int sample(double X) const
+    {
+        size_t n = _qv.size();
+        double u = X * n;
+        size_t i = std::min(static_cast<size_t>(u), n-1);
+        return (u-i < _qv[i]) ? i : _av[i];
+    }
+
+private:
+    Array _qv;              // the threshold for each bin
+    std::vector<int> _av;   // the alias index for each bin
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif // ALIASTABLE_HPP
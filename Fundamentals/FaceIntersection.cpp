@@ -0,0 +1,284 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cfloat>
+#include "FaceIntersection.hpp"
+
+// the vectorized implementations require x86-64 intrinsics and function-level target attributes
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FACEINTERSECTION_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace FaceIntersection;
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // scans the planes with indices in the range [begin,end[ and updates the smallest positive distance
+    // and corresponding index found so far; planes with equal distance keep the lowest index
+    inline void scan(const double* nx, const double* ny, const double* nz, const double* d, int begin, int end,
+                     double rx, double ry, double rz, double kx, double ky, double kz, double& sq, int& iq)
+    {
+        for (int i=begin; i<end; i++)
+        {
+            // if the denominator is negative the intersection distance is negative, so don't calculate it
+            double ndotk = nx[i]*kx + ny[i]*ky + nz[i]*kz;
+            if (ndotk > 0)
+            {
+                double si = (d[i] - (nx[i]*rx + ny[i]*ry + nz[i]*rz)) / ndotk;
+                if (si > 0 && si < sq)
+                {
+                    sq = si;
+                    iq = i;
+                }
+            }
+        }
+    }
+
+    // combines the per-lane results of a vectorized kernel (an index < 0 indicates that nothing was found)
+    inline void reduce(const double* sv, const double* iv, int lanes, double& sq, int& iq)
+    {
+        for (int k=0; k<lanes; k++)
+        {
+            int i = static_cast<int>(iv[k]);
+            if (i >= 0 && (sv[k] < sq || (sv[k] == sq && i < iq)))
+            {
+                sq = sv[k];
+                iq = i;
+            }
+        }
+    }
+
+    // returns true if the processor supports the instructions required by the specified implementation
+    bool cpuSupports(InstructionSet set)
+    {
+        switch (set)
+        {
+        case Scalar:
+            return true;
+#ifdef FACEINTERSECTION_SIMD
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+        }
+    }
+
+    // the type of the kernel functions
+    typedef int (*Kernel)(const double*, const double*, const double*, const double*, int,
+                          double, double, double, double, double, double, double&);
+
+    // returns the kernel function for the specified implementation
+    Kernel kernel(InstructionSet set)
+    {
+        switch (set)
+        {
+        case AVX2: return nearestAVX2;
+        case AVX512: return nearestAVX512;
+        default: return nearestScalar;
+        }
+    }
+
+    // returns the best available implementation
+    InstructionSet bestInstructionSet()
+    {
+        if (cpuSupports(AVX512)) return AVX512;
+        if (cpuSupports(AVX2)) return AVX2;
+        return Scalar;
+    }
+
+    // the currently selected implementation and the corresponding kernel function
+    InstructionSet _set = bestInstructionSet();
+    Kernel _kernel = kernel(_set);
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool FaceIntersection::isAvailable(InstructionSet set)
+{
+    return cpuSupports(set);
+}
+
+////////////////////////////////////////////////////////////////////
+
+InstructionSet FaceIntersection::instructionSet()
+{
+    return _set;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool FaceIntersection::setInstructionSet(InstructionSet set)
+{
+    if (!cpuSupports(set)) return false;
+    _set = set;
+    _kernel = kernel(set);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const char* FaceIntersection::name(InstructionSet set)
+{
+    switch (set)
+    {
+    case Scalar: return "scalar";
+    case AVX2: return "AVX2";
+    case AVX512: return "AVX-512";
+    }
+    return "unknown";
+}
+
+////////////////////////////////////////////////////////////////////
+
+int FaceIntersection::nearest(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                              double rx, double ry, double rz, double kx, double ky, double kz, double& s)
+{
+    return _kernel(nx, ny, nz, d, n, rx, ry, rz, kx, ky, kz, s);
+}
+
+////////////////////////////////////////////////////////////////////
+
+int FaceIntersection::nearestScalar(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                                    double rx, double ry, double rz, double kx, double ky, double kz, double& s)
+{
+    s = DBL_MAX;    // very large, but not infinity (so that infinite si values are discarded)
+    int iq = -1;
+    scan(nx, ny, nz, d, 0, n, rx, ry, rz, kx, ky, kz, s, iq);
+    return iq;
+}
+
+////////////////////////////////////////////////////////////////////
+
+#ifdef FACEINTERSECTION_SIMD
+
+__attribute__((target("avx2,fma")))
+int FaceIntersection::nearestAVX2(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                                  double rx, double ry, double rz, double kx, double ky, double kz, double& s)
+{
+    const __m256d vrx = _mm256_set1_pd(rx);
+    const __m256d vry = _mm256_set1_pd(ry);
+    const __m256d vrz = _mm256_set1_pd(rz);
+    const __m256d vkx = _mm256_set1_pd(kx);
+    const __m256d vky = _mm256_set1_pd(ky);
+    const __m256d vkz = _mm256_set1_pd(kz);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d four = _mm256_set1_pd(4.);
+
+    // per-lane smallest distance and corresponding index (stored as a double to allow blending)
+    __m256d best = _mm256_set1_pd(DBL_MAX);
+    __m256d bestIndex = _mm256_set1_pd(-1.);
+    __m256d index = _mm256_setr_pd(0., 1., 2., 3.);
+
+    int i = 0;
+    for (; i+4<=n; i+=4)
+    {
+        __m256d vnx = _mm256_loadu_pd(nx+i);
+        __m256d vny = _mm256_loadu_pd(ny+i);
+        __m256d vnz = _mm256_loadu_pd(nz+i);
+        __m256d ndotk = _mm256_fmadd_pd(vnz, vkz, _mm256_fmadd_pd(vny, vky, _mm256_mul_pd(vnx, vkx)));
+        __m256d ndotr = _mm256_fmadd_pd(vnz, vrz, _mm256_fmadd_pd(vny, vry, _mm256_mul_pd(vnx, vrx)));
+        __m256d si = _mm256_div_pd(_mm256_sub_pd(_mm256_loadu_pd(d+i), ndotr), ndotk);
+
+        // accept lanes with ndotk > 0 and 0 < si < best (comparisons with NaN yield false)
+        __m256d mask = _mm256_and_pd(_mm256_cmp_pd(ndotk, zero, _CMP_GT_OQ),
+                                     _mm256_and_pd(_mm256_cmp_pd(si, zero, _CMP_GT_OQ),
+                                                   _mm256_cmp_pd(si, best, _CMP_LT_OQ)));
+        best = _mm256_blendv_pd(best, si, mask);
+        bestIndex = _mm256_blendv_pd(bestIndex, index, mask);
+        index = _mm256_add_pd(index, four);
+    }
+
+    // combine the lanes and handle the remaining planes
+    alignas(32) double sv[4];
+    alignas(32) double iv[4];
+    _mm256_store_pd(sv, best);
+    _mm256_store_pd(iv, bestIndex);
+    s = DBL_MAX;
+    int iq = -1;
+    reduce(sv, iv, 4, s, iq);
+    scan(nx, ny, nz, d, i, n, rx, ry, rz, kx, ky, kz, s, iq);
+    return iq;
+}
+
+////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx512f")))
+int FaceIntersection::nearestAVX512(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                                    double rx, double ry, double rz, double kx, double ky, double kz, double& s)
+{
+    const __m512d vrx = _mm512_set1_pd(rx);
+    const __m512d vry = _mm512_set1_pd(ry);
+    const __m512d vrz = _mm512_set1_pd(rz);
+    const __m512d vkx = _mm512_set1_pd(kx);
+    const __m512d vky = _mm512_set1_pd(ky);
+    const __m512d vkz = _mm512_set1_pd(kz);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d eight = _mm512_set1_pd(8.);
+
+    // per-lane smallest distance and corresponding index (stored as a double to allow masked moves)
+    __m512d best = _mm512_set1_pd(DBL_MAX);
+    __m512d bestIndex = _mm512_set1_pd(-1.);
+    __m512d index = _mm512_setr_pd(0., 1., 2., 3., 4., 5., 6., 7.);
+
+    // the last iteration uses masked loads for the remaining planes, so there is no scalar tail
+    for (int i=0; i<n; i+=8)
+    {
+        __mmask8 valid = n-i >= 8 ? 0xFF : static_cast<__mmask8>((1u << (n-i)) - 1);
+        __m512d vnx = _mm512_maskz_loadu_pd(valid, nx+i);
+        __m512d vny = _mm512_maskz_loadu_pd(valid, ny+i);
+        __m512d vnz = _mm512_maskz_loadu_pd(valid, nz+i);
+        __m512d ndotk = _mm512_fmadd_pd(vnz, vkz, _mm512_fmadd_pd(vny, vky, _mm512_mul_pd(vnx, vkx)));
+        __m512d ndotr = _mm512_fmadd_pd(vnz, vrz, _mm512_fmadd_pd(vny, vry, _mm512_mul_pd(vnx, vrx)));
+
+        // accept lanes with ndotk > 0 and 0 < si < best, only calculating the quotient where needed
+        __mmask8 mask = _mm512_mask_cmp_pd_mask(valid, ndotk, zero, _CMP_GT_OQ);
+        __m512d si = _mm512_maskz_div_pd(mask, _mm512_sub_pd(_mm512_maskz_loadu_pd(valid, d+i), ndotr), ndotk);
+        mask = _mm512_mask_cmp_pd_mask(mask, si, zero, _CMP_GT_OQ);
+        mask = _mm512_mask_cmp_pd_mask(mask, si, best, _CMP_LT_OQ);
+        best = _mm512_mask_mov_pd(best, mask, si);
+        bestIndex = _mm512_mask_mov_pd(bestIndex, mask, index);
+        index = _mm512_add_pd(index, eight);
+    }
+
+    // combine the lanes
+    alignas(64) double sv[8];
+    alignas(64) double iv[8];
+    _mm512_store_pd(sv, best);
+    _mm512_store_pd(iv, bestIndex);
+    s = DBL_MAX;
+    int iq = -1;
+    reduce(sv, iv, 8, s, iq);
+    return iq;
+}
+
+#else
+
+////////////////////////////////////////////////////////////////////
+
+// the vectorized implementations are never selected on this platform; provide them for linking only
+
+int FaceIntersection::nearestAVX2(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                                  double rx, double ry, double rz, double kx, double ky, double kz, double& s)
+{
+    return nearestScalar(nx, ny, nz, d, n, rx, ry, rz, kx, ky, kz, s);
+}
+
+int FaceIntersection::nearestAVX512(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                                    double rx, double ry, double rz, double kx, double ky, double kz, double& s)
+{
+    return nearestScalar(nx, ny, nz, d, n, rx, ry, rz, kx, ky, kz, s);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,81 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef FACEINTERSECTION_HPP
+#define FACEINTERSECTION_HPP
+
+////////////////////////////////////////////////////////////////////
+
+/** This namespace contains a kernel that determines where a ray leaves a convex cell bounded by a
+    number of planes, as needed when calculating a path through a grid. Each plane \f$i\f$ is
+    specified by its (not necessarily normalized) outward normal \f$\mathbf{n}_i\f$ and its offset
+    \f$d_i\f$, so that the points \f$\mathbf{x}\f$ on the plane satisfy
+    \f$\mathbf{n}_i\cdot\mathbf{x}=d_i\f$. For a ray with starting point \f$\mathbf{r}\f$ and
+    direction \f$\mathbf{k}\f$, the distance to the intersection with plane \f$i\f$ is
+    \f[s_i=\frac{d_i-\mathbf{n}_i\cdot\mathbf{r}}{\mathbf{n}_i\cdot\mathbf{k}}.\f] The kernel
+    returns the smallest positive distance \f$s_i\f$ among the planes with
+    \f$\mathbf{n}_i\cdot\mathbf{k}>0\f$, and the corresponding index \f$i\f$. The plane data is
+    passed as four separate arrays (structure-of-arrays layout), so that the distances for several
+    planes can be calculated in a single vector instruction.
+
+    There are three implementations of the kernel: a portable scalar version, a version using the
+    AVX2 and FMA instruction sets (4 planes per instruction), and a version using the AVX-512
+    instruction set (8 planes per instruction). The vectorized versions are compiled only on
+    x86-64 systems with a compiler supporting function-level target attributes (GCC or Clang), so
+    that the rest of the code does not need to be compiled with special instruction set flags.
+    The best implementation supported by the processor is selected at run time; the selection can
+    be overridden with setInstructionSet(), e.g. for benchmarking purposes. All implementations
+    produce the same results except for rounding differences caused by fused multiply-add
+    operations. */
+namespace FaceIntersection
+{
+    /** This enumeration lists the available kernel implementations. */
+    enum InstructionSet { Scalar, AVX2, AVX512 };
+
+    /** This function returns true if the specified kernel implementation has been compiled and is
+        supported by the processor running the code; false otherwise. The scalar implementation is
+        always available. */
+    bool isAvailable(InstructionSet set);
+
+    /** This function returns the kernel implementation currently used by the nearest() function.
+        Initially, this is the best implementation that is available. */
+    InstructionSet instructionSet();
+
+    /** This function selects the kernel implementation to be used by the nearest() function. If
+        the specified implementation is not available, the function leaves the selection unchanged
+        and returns false; otherwise it returns true. This function is not thread-safe; it should
+        be called only while no other threads are using the kernel. */
+    bool setInstructionSet(InstructionSet set);
+
+    /** This function returns a human-readable name for the specified kernel implementation. */
+    const char* name(InstructionSet set);
+
+    /** This function returns the index \f$0\le i<n\f$ of the plane with the smallest positive
+        intersection distance for the ray with starting point \f$(r_x,r_y,r_z)\f$ and direction
+        \f$(k_x,k_y,k_z)\f$, considering only planes with \f$\mathbf{n}_i\cdot\mathbf{k}>0\f$, and
+        stores that distance in \em s. If there is no such plane, the function returns -1 and sets
+        \em s to the largest representable double. The function uses the implementation selected
+        by setInstructionSet(). */
+    int nearest(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                double rx, double ry, double rz, double kx, double ky, double kz, double& s);
+
+    /** This function is the scalar implementation of the nearest() function. */
+    int nearestScalar(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                      double rx, double ry, double rz, double kx, double ky, double kz, double& s);
+
+    /** This function is the AVX2 implementation of the nearest() function. It may be called only
+        if isAvailable(AVX2) returns true. */
+    int nearestAVX2(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                    double rx, double ry, double rz, double kx, double ky, double kz, double& s);
+
+    /** This function is the AVX-512 implementation of the nearest() function. It may be called
+        only if isAvailable(AVX512) returns true. */
+    int nearestAVX512(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                      double rx, double ry, double rz, double kx, double ky, double kz, double& s);
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // FACEINTERSECTION_HPP
@@ -27,6 +27,7 @@ include(../BuildUtils/EnableMemory.pri)
 #--------------------------------------------------
 
 HEADERS += \
+    AliasTable.hpp \
     Array.hpp \
     ArrayTable.hpp \
     Box.hpp \
@@ -36,9 +37,17 @@ HEADERS += \
     Vec.hpp \
     LockFree.hpp \
     MemoryStatistics.hpp \
-    MemoryLogger.hpp
+    MemoryLogger.hpp \
+    FaceIntersection.hpp \
+    ScratchArena.hpp \
+    OpticalDepthKernel.hpp \
+    TemperatureDistributionKernel.hpp
 
 SOURCES += \
     CommandLineArguments.cpp \
     MemoryStatistics.cpp \
-    Array.cpp
+    Array.cpp \
+    FaceIntersection.cpp \
+    ScratchArena.cpp \
+    OpticalDepthKernel.cpp \
+    TemperatureDistributionKernel.cpp
@@ -287,3 +287,67 @@ QString MemoryStatistics::reportCurrent(bool showinfo)
 }
 
 ////////////////////////////////////////////////////////////////////
+
+#ifdef BUILDING_MEMORY
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // the number of heap allocations performed by the current thread
+    thread_local quint64 _allocationCount = 0;
+
+    // allocates memory and counts the allocation for the current thread
+    inline void* countedAllocation(size_t size)
+    {
+        ++_allocationCount;
+        return std::malloc(size ? size : 1);
+    }
+}
+
+// replace the global allocation and deallocation functions
+void* operator new(size_t size)
+{
+    void* ptr = countedAllocation(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](size_t size)
+{
+    void* ptr = countedAllocation(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocation(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+bool MemoryStatistics::countingAllocations()
+{
+    return true;
+}
+
+quint64 MemoryStatistics::threadAllocationCount()
+{
+    return _allocationCount;
+}
+
+#else
+
+bool MemoryStatistics::countingAllocations()
+{
+    return false;
+}
+
+quint64 MemoryStatistics::threadAllocationCount()
+{
+    return 0;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////
@@ -40,6 +40,17 @@ namespace MemoryStatistics
     /** Returns a string that reports the current memory usage in a form ready for human
         consumption. */
     QString reportCurrent(bool showinfo = false);
+
+    /** Returns true if the number of heap allocations is being counted, i.e. if the code has been
+        built with the BUILDING_MEMORY flag turned on, and false otherwise. When counting is
+        enabled, the global operator new is replaced by a version that increments a counter for the
+        calling thread before passing the request to malloc(). */
+    bool countingAllocations();
+
+    /** Returns the number of heap allocations performed so far through operator new by the
+        calling thread, or zero if allocations are not being counted. Comparing the values returned
+        before and after a section of code shows whether that section allocates memory. */
+    quint64 threadAllocationCount();
 }
 
 ////////////////////////////////////////////////////////////////////
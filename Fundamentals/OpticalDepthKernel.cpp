@@ -0,0 +1,211 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "OpticalDepthKernel.hpp"
+
+// the vectorized implementations require x86-64 intrinsics and function-level target attributes
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define OPTICALDEPTHKERNEL_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace OpticalDepthKernel;
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // returns true if the processor supports the instructions required by the specified implementation
+    bool cpuSupports(InstructionSet set)
+    {
+        switch (set)
+        {
+        case Scalar:
+            return true;
+#ifdef OPTICALDEPTHKERNEL_SIMD
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+        }
+    }
+
+    // the types of the kernel functions
+    typedef void (*GatherKernel)(const double*, double, const int*, const double*, double*, int);
+    typedef double (*CumulateKernel)(const double*, double*, int);
+
+    // returns the best available implementation
+    InstructionSet bestInstructionSet()
+    {
+        if (cpuSupports(AVX2)) return AVX2;
+        return Scalar;
+    }
+
+    // the currently selected implementation and the corresponding kernel functions
+    InstructionSet _set = bestInstructionSet();
+    GatherKernel _gather = _set==AVX2 ? gatherAVX2 : gatherScalar;
+    CumulateKernel _cumulate = _set==AVX2 ? cumulateAVX2 : cumulateScalar;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool OpticalDepthKernel::isAvailable(InstructionSet set)
+{
+    return cpuSupports(set);
+}
+
+////////////////////////////////////////////////////////////////////
+
+InstructionSet OpticalDepthKernel::instructionSet()
+{
+    return _set;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool OpticalDepthKernel::setInstructionSet(InstructionSet set)
+{
+    if (!cpuSupports(set)) return false;
+    _set = set;
+    _gather = set==AVX2 ? gatherAVX2 : gatherScalar;
+    _cumulate = set==AVX2 ? cumulateAVX2 : cumulateScalar;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const char* OpticalDepthKernel::name(InstructionSet set)
+{
+    switch (set)
+    {
+    case Scalar: return "scalar";
+    case AVX2: return "AVX2";
+    }
+    return "unknown";
+}
+
+////////////////////////////////////////////////////////////////////
+
+void OpticalDepthKernel::gather(const double* table, double factor, const int* mv, const double* dsv,
+                                double* dtauv, int n)
+{
+    _gather(table, factor, mv, dsv, dtauv, n);
+}
+
+////////////////////////////////////////////////////////////////////
+
+double OpticalDepthKernel::cumulate(const double* dtauv, double* tauv, int n)
+{
+    return _cumulate(dtauv, tauv, n);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void OpticalDepthKernel::gatherScalar(const double* table, double factor, const int* mv, const double* dsv,
+                                      double* dtauv, int n)
+{
+    for (int i=0; i<n; i++)
+    {
+        int m = mv[i];
+        dtauv[i] = m >= 0 ? factor*table[m]*dsv[i] : 0.;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+double OpticalDepthKernel::cumulateScalar(const double* dtauv, double* tauv, int n)
+{
+    double tau = 0.;
+    for (int i=0; i<n; i++)
+    {
+        tau += dtauv[i];
+        tauv[i] = tau;
+    }
+    return tau;
+}
+
+////////////////////////////////////////////////////////////////////
+
+#ifdef OPTICALDEPTHKERNEL_SIMD
+
+__attribute__((target("avx2")))
+void OpticalDepthKernel::gatherAVX2(const double* table, double factor, const int* mv, const double* dsv,
+                                    double* dtauv, int n)
+{
+    const __m256d vfactor = _mm256_set1_pd(factor);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m128i minusone = _mm_set1_epi32(-1);
+
+    int i = 0;
+    for (; i+4<=n; i+=4)
+    {
+        // mask out the segments outside of the grid, and replace their cell number by zero
+        // so that the gather instruction never reads outside of the table
+        __m128i vm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mv+i));
+        __m128i valid = _mm_cmpgt_epi32(vm, minusone);
+        __m128i index = _mm_and_si128(vm, valid);
+        __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(valid));
+
+        __m256d kapparho = _mm256_mask_i32gather_pd(zero, table, index, mask, 8);
+        __m256d dtau = _mm256_mul_pd(_mm256_mul_pd(vfactor, kapparho), _mm256_loadu_pd(dsv+i));
+        _mm256_storeu_pd(dtauv+i, dtau);
+    }
+    gatherScalar(table, factor, mv+i, dsv+i, dtauv+i, n-i);
+}
+
+////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx2")))
+double OpticalDepthKernel::cumulateAVX2(const double* dtauv, double* tauv, int n)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d carry = zero;
+
+    int i = 0;
+    for (; i+4<=n; i+=4)
+    {
+        // calculate the prefix sum [a, a+b, a+b+c, a+b+c+d] of [a, b, c, d] in two shift-and-add steps
+        __m256d x = _mm256_loadu_pd(dtauv+i);
+        x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, 0x90), zero, 0x1));
+        x = _mm256_add_pd(x, _mm256_permute2f128_pd(x, x, 0x08));
+
+        // add the total of the previous groups, and broadcast the new total to all lanes
+        x = _mm256_add_pd(x, carry);
+        _mm256_storeu_pd(tauv+i, x);
+        carry = _mm256_permute4x64_pd(x, 0xFF);
+    }
+
+    // handle the remaining segments
+    double tau = _mm256_cvtsd_f64(carry);
+    for (; i<n; i++)
+    {
+        tau += dtauv[i];
+        tauv[i] = tau;
+    }
+    return tau;
+}
+
+#else
+
+////////////////////////////////////////////////////////////////////
+
+// the vectorized implementations are never selected on this platform; provide them for linking only
+
+void OpticalDepthKernel::gatherAVX2(const double* table, double factor, const int* mv, const double* dsv,
+                                    double* dtauv, int n)
+{
+    gatherScalar(table, factor, mv, dsv, dtauv, n);
+}
+
+double OpticalDepthKernel::cumulateAVX2(const double* dtauv, double* tauv, int n)
+{
+    return cumulateScalar(dtauv, tauv, n);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////
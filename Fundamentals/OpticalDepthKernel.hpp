@@ -0,0 +1,82 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef OPTICALDEPTHKERNEL_HPP
+#define OPTICALDEPTHKERNEL_HPP
+
+////////////////////////////////////////////////////////////////////
+
+/** This namespace contains the kernels used to calculate the optical depth along a path through a
+    dust grid, given the cell numbers \f$m_i\f$ and the lengths \f$\Delta s_i\f$ of the path
+    segments in structure-of-arrays layout. The calculation proceeds in two passes. The gather()
+    kernel looks up the extinction coefficient \f$(\kappa\rho)_{m_i}\f$ for each segment in a
+    table indexed on cell number, and stores the optical depth \f$\Delta\tau_i =
+    (\kappa\rho)_{m_i}\,\Delta s_i\f$ of each segment in a contiguous array. The cumulate() kernel
+    then calculates the cumulative optical depth \f$\tau_i=\sum_{j\le i}\Delta\tau_j\f$ as a
+    prefix sum over that array.
+
+    There are two implementations of each kernel: a portable scalar version, and a version using
+    the AVX2 instruction set, which handles four segments per instruction. The AVX2 version of the
+    gather() kernel uses the hardware gather instruction to load the table values; the AVX2 version
+    of the cumulate() kernel calculates the prefix sum of four segments within a register and
+    carries the running total to the next group. As for the FaceIntersection kernels, the
+    vectorized versions are compiled only on x86-64 systems with a compiler supporting
+    function-level target attributes, and the best implementation supported by the processor is
+    selected at run time. The implementations produce the same results except for rounding
+    differences caused by the different order of the additions in the prefix sum. */
+namespace OpticalDepthKernel
+{
+    /** This enumeration lists the available kernel implementations. */
+    enum InstructionSet { Scalar, AVX2 };
+
+    /** This function returns true if the specified kernel implementation has been compiled and is
+        supported by the processor running the code; false otherwise. The scalar implementation is
+        always available. */
+    bool isAvailable(InstructionSet set);
+
+    /** This function returns the kernel implementation currently used by the gather() and
+        cumulate() functions. Initially, this is the best implementation that is available. */
+    InstructionSet instructionSet();
+
+    /** This function selects the kernel implementation to be used by the gather() and cumulate()
+        functions. If the specified implementation is not available, the function leaves the
+        selection unchanged and returns false; otherwise it returns true. This function is not
+        thread-safe; it should be called only while no other threads are using the kernels. */
+    bool setInstructionSet(InstructionSet set);
+
+    /** This function returns a human-readable name for the specified kernel implementation. */
+    const char* name(InstructionSet set);
+
+    /** This function stores \f$\Delta\tau_i = f\,t_{m_i}\,\Delta s_i\f$ in \em dtauv for
+        \f$0\le i<n\f$, where \f$f\f$ is the specified factor, \f$t\f$ is the specified table
+        indexed on cell number, and \f$m_i\f$ and \f$\Delta s_i\f$ are the cell numbers and
+        segment lengths in \em mv and \em dsv. Segments with a negative cell number (i.e. outside
+        of the grid) receive a zero optical depth. The function uses the implementation selected
+        by setInstructionSet(). */
+    void gather(const double* table, double factor, const int* mv, const double* dsv, double* dtauv, int n);
+
+    /** This function stores the cumulative optical depth \f$\tau_i=\sum_{j\le i}\Delta\tau_j\f$
+        in \em tauv for \f$0\le i<n\f$, and returns the total optical depth (or zero if \f$n=0\f$).
+        The function uses the implementation selected by setInstructionSet(). */
+    double cumulate(const double* dtauv, double* tauv, int n);
+
+    /** This function is the scalar implementation of the gather() function. */
+    void gatherScalar(const double* table, double factor, const int* mv, const double* dsv, double* dtauv, int n);
+
+    /** This function is the AVX2 implementation of the gather() function. It may be called only if
+        isAvailable(AVX2) returns true. */
+    void gatherAVX2(const double* table, double factor, const int* mv, const double* dsv, double* dtauv, int n);
+
+    /** This function is the scalar implementation of the cumulate() function. */
+    double cumulateScalar(const double* dtauv, double* tauv, int n);
+
+    /** This function is the AVX2 implementation of the cumulate() function. It may be called only
+        if isAvailable(AVX2) returns true. */
+    double cumulateAVX2(const double* dtauv, double* tauv, int n);
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // OPTICALDEPTHKERNEL_HPP
@@ -0,0 +1,26 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <vector>
+#include "ScratchArena.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the scratch arrays for the current thread, indexed on slot
+    thread_local std::vector<double> _arrays[ScratchArena::NumSlots];
+}
+
+////////////////////////////////////////////////////////////////////
+
+double* ScratchArena::doubles(Slot slot, size_t n)
+{
+    std::vector<double>& array = _arrays[slot];
+    if (array.size() < n) array.resize(n);
+    return array.data();
+}
+
+////////////////////////////////////////////////////////////////////
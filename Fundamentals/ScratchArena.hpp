@@ -0,0 +1,36 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef SCRATCHARENA_HPP
+#define SCRATCHARENA_HPP
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////
+
+/** This namespace provides per-thread scratch memory for functions that are called very
+    frequently and need a small temporary array whose size is known only at run time, such as the
+    functions in the life cycle of a photon package. Each thread has its own set of scratch
+    arrays, identified by a slot number. The memory for a slot grows as needed and is released
+    only when the thread ends, so that after a brief warm-up period, obtaining scratch memory does
+    not involve any heap allocations. Because a slot offers a single array per thread, a function
+    using a slot must not call another function that uses the same slot while it still needs the
+    contents of its scratch array. */
+namespace ScratchArena
+{
+    /** This enumeration lists the available slots. Each slot is intended for a particular purpose
+        so that nested function calls do not accidentally overwrite each other's scratch memory. */
+    enum Slot { KappaRho, ComponentKappaSca, ComponentKappaExt, ComponentWeights, TransitionMatrix, NumSlots };
+
+    /** This function returns a pointer to a scratch array of at least \em n double values for the
+        specified slot and the calling thread. The contents of the array are undefined. The
+        pointer remains valid until the next invocation of this function for the same slot in the
+        same thread. */
+    double* doubles(Slot slot, size_t n);
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // SCRATCHARENA_HPP
@@ -0,0 +1,297 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cmath>
+#include "TemperatureDistributionKernel.hpp"
+
+// the vectorized implementation requires x86-64 intrinsics and function-level target attributes
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TEMPERATUREDISTRIBUTIONKERNEL_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace TemperatureDistributionKernel;
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the number of consecutive probabilities sharing a scale factor
+    const int blockSize = 64;
+
+    // the largest probability that does not cause its block to be rescaled
+    const double rescaleLimit = 1e10;
+
+    // returns the index of the first element of row f in a packed lower triangle
+    inline size_t offset(size_t f)
+    {
+        return ((f-1)*f)>>1;
+    }
+
+    // returns true if the processor supports the instructions required by the specified implementation
+    bool cpuSupports(InstructionSet set)
+    {
+        switch (set)
+        {
+        case Scalar:
+            return true;
+#ifdef TEMPERATUREDISTRIBUTIONKERNEL_SIMD
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        default:
+            return false;
+        }
+    }
+
+    // the type of the kernel function
+    typedef void (*SolveKernel)(const double*, const short*, const double*, const double*, int, int,
+                                double*, double*);
+
+    // returns the best available implementation
+    InstructionSet bestInstructionSet()
+    {
+        if (cpuSupports(AVX2)) return AVX2;
+        return Scalar;
+    }
+
+    // the currently selected implementation and the corresponding kernel function
+    InstructionSet _set = bestInstructionSet();
+    SolveKernel _solve = _set==AVX2 ? solveAVX2 : solveScalar;
+
+    // the type of the dot product functions used by the recursion
+    typedef double (*DotKernel)(const double*, const double*, int);
+
+    // returns the dot product of the specified arrays, using independent partial sums so that
+    // consecutive iterations do not depend on each other
+    double dotScalar(const double* av, const double* pv, int n)
+    {
+        double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+        int j = 0;
+        for (; j+4<=n; j+=4)
+        {
+            s0 += av[j]*pv[j];
+            s1 += av[j+1]*pv[j+1];
+            s2 += av[j+2]*pv[j+2];
+            s3 += av[j+3]*pv[j+3];
+        }
+        for (; j<n; j++) s0 += av[j]*pv[j];
+        return (s0+s1) + (s2+s3);
+    }
+
+    // calculates the normalized probabilities from the cumulative coefficients in the packed lower
+    // triangle Am and the cooling rates CRv (both indexed relative to the start of the temperature
+    // range), keeping the base-two logarithm of the scale factor for each block in expv
+    void recurse(const double* Am, const double* CRv, int n, double* Pv, double* expv, DotKernel dot)
+    {
+        Pv[0] = 1.;
+        expv[0] = 0.;
+        for (int i=1; i<n; i++)
+        {
+            // start a new block with the scale factor of the previous block
+            int kc = i / blockSize;
+            int first = kc*blockSize;
+            if (i==first) expv[kc] = expv[kc-1];
+
+            // add the contributions of the earlier blocks, scaled to the current block, and of the current block
+            const double* Av = Am + offset(i);
+            double sum = 0.;
+            for (int k=0; k<kc; k++)
+                sum += ldexp(dot(Av+k*blockSize, Pv+k*blockSize, blockSize), static_cast<int>(expv[k]-expv[kc]));
+            sum += dot(Av+first, Pv+first, i-first);
+            Pv[i] = sum / CRv[i];
+
+            // rescale the current block if needed to keep infinities from happening
+            if (Pv[i] > rescaleLimit)
+            {
+                int shift = ilogb(Pv[i]);
+                for (int j=first; j<=i; j++) Pv[j] = ldexp(Pv[j], -shift);
+                expv[kc] += shift;
+            }
+        }
+
+        // scale all probabilities to the last block and normalize them to unity
+        int klast = (n-1) / blockSize;
+        double total = 0.;
+        for (int k=0; k<=klast; k++)
+        {
+            int shift = static_cast<int>(expv[k]-expv[klast]);
+            int end = k<klast ? (k+1)*blockSize : n;
+            for (int j=k*blockSize; j<end; j++)
+            {
+                Pv[j] = ldexp(Pv[j], shift);
+                total += Pv[j];
+            }
+        }
+        for (int j=0; j<n; j++) Pv[j] /= total;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool TemperatureDistributionKernel::isAvailable(InstructionSet set)
+{
+    return cpuSupports(set);
+}
+
+////////////////////////////////////////////////////////////////////
+
+InstructionSet TemperatureDistributionKernel::instructionSet()
+{
+    return _set;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool TemperatureDistributionKernel::setInstructionSet(InstructionSet set)
+{
+    if (!cpuSupports(set)) return false;
+    _set = set;
+    _solve = set==AVX2 ? solveAVX2 : solveScalar;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const char* TemperatureDistributionKernel::name(InstructionSet set)
+{
+    switch (set)
+    {
+    case Scalar: return "scalar";
+    case AVX2: return "AVX2";
+    }
+    return "unknown";
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t TemperatureDistributionKernel::workspaceSize(int n)
+{
+    // the packed triangle followed by the scale factor for each block
+    return offset(n) + n/blockSize + 1;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void TemperatureDistributionKernel::solve(const double* HRm, const short* ELLm, const double* CRv, const double* Jv,
+                                          int ioff, int n, double* Am, double* Pv)
+{
+    _solve(HRm, ELLm, CRv, Jv, ioff, n, Am, Pv);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void TemperatureDistributionKernel::solveScalar(const double* HRm, const short* ELLm, const double* CRv,
+                                                const double* Jv, int ioff, int n, double* Am, double* Pv)
+{
+    // calculate the cumulative matrix coefficients row by row, starting from the top
+    for (int f=n-1; f>0; f--)
+    {
+        const double* HRv = HRm + offset(f+ioff) + ioff;
+        const short* ELLv = ELLm + offset(f+ioff) + ioff;
+        double* Av = Am + offset(f);
+        if (f==n-1)
+        {
+            for (int i=0; i<f; i++) Av[i] = ELLv[i]>=0 ? HRv[i] * Jv[ELLv[i]] : 0.;
+        }
+        else
+        {
+            const double* Aprev = Am + offset(f+1);
+            for (int i=0; i<f; i++) Av[i] = (ELLv[i]>=0 ? HRv[i] * Jv[ELLv[i]] : 0.) + Aprev[i];
+        }
+    }
+
+    // calculate the probabilities
+    recurse(Am, CRv+ioff, n, Pv, Am+offset(n), dotScalar);
+}
+
+////////////////////////////////////////////////////////////////////
+
+#ifdef TEMPERATUREDISTRIBUTIONKERNEL_SIMD
+
+namespace
+{
+    __attribute__((target("avx2,fma")))
+    double dotAVX2(const double* av, const double* pv, int n)
+    {
+        __m256d s0 = _mm256_setzero_pd();
+        __m256d s1 = _mm256_setzero_pd();
+        int j = 0;
+        for (; j+8<=n; j+=8)
+        {
+            s0 = _mm256_fmadd_pd(_mm256_loadu_pd(av+j), _mm256_loadu_pd(pv+j), s0);
+            s1 = _mm256_fmadd_pd(_mm256_loadu_pd(av+j+4), _mm256_loadu_pd(pv+j+4), s1);
+        }
+        if (j+4<=n)
+        {
+            s0 = _mm256_fmadd_pd(_mm256_loadu_pd(av+j), _mm256_loadu_pd(pv+j), s0);
+            j += 4;
+        }
+
+        // add the lanes of the partial sums, and the remaining terms
+        __m256d s = _mm256_add_pd(s0, s1);
+        __m128d h = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+        double sum = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+        for (; j<n; j++) sum += av[j]*pv[j];
+        return sum;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx2,fma")))
+void TemperatureDistributionKernel::solveAVX2(const double* HRm, const short* ELLm, const double* CRv,
+                                              const double* Jv, int ioff, int n, double* Am, double* Pv)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m128i minusone = _mm_set1_epi32(-1);
+
+    // calculate the cumulative matrix coefficients row by row, starting from the top
+    for (int f=n-1; f>0; f--)
+    {
+        const double* HRv = HRm + offset(f+ioff) + ioff;
+        const short* ELLv = ELLm + offset(f+ioff) + ioff;
+        double* Av = Am + offset(f);
+        const double* Aprev = f<n-1 ? Am + offset(f+1) : 0;
+
+        int i = 0;
+        for (; i+4<=f; i+=4)
+        {
+            // mask out the transitions without heating, and replace their wavelength index by zero so that
+            // the gather instruction never reads outside of the radiation field (the corresponding heating
+            // rates are undefined, so the products are masked as well)
+            __m128i ell = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ELLv+i)));
+            __m128i valid = _mm_cmpgt_epi32(ell, minusone);
+            __m128i index = _mm_and_si128(ell, valid);
+            __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(valid));
+
+            __m256d J = _mm256_mask_i32gather_pd(zero, Jv, index, mask, 8);
+            __m256d A = _mm256_and_pd(_mm256_mul_pd(_mm256_loadu_pd(HRv+i), J), mask);
+            if (Aprev) A = _mm256_add_pd(A, _mm256_loadu_pd(Aprev+i));
+            _mm256_storeu_pd(Av+i, A);
+        }
+        for (; i<f; i++) Av[i] = (ELLv[i]>=0 ? HRv[i] * Jv[ELLv[i]] : 0.) + (Aprev ? Aprev[i] : 0.);
+    }
+
+    // calculate the probabilities
+    recurse(Am, CRv+ioff, n, Pv, Am+offset(n), dotAVX2);
+}
+
+#else
+
+////////////////////////////////////////////////////////////////////
+
+// the vectorized implementation is never selected on this platform; provide it for linking only
+
+void TemperatureDistributionKernel::solveAVX2(const double* HRm, const short* ELLm, const double* CRv,
+                                              const double* Jv, int ioff, int n, double* Am, double* Pv)
+{
+    solveScalar(HRm, ELLm, CRv, Jv, ioff, n, Am, Pv);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef TEMPERATUREDISTRIBUTIONKERNEL_HPP
+#define TEMPERATUREDISTRIBUTIONKERNEL_HPP
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////
+
+/** This namespace contains the kernel used to calculate the temperature probability distribution
+    of a transiently heated dust population on a temperature grid with \f$N\f$ points, following
+    the method of Guhathakurta & Draine (1989). The kernel is given the heating rates
+    \f$H_{f,i}\f$ for \f$f>i\f$ (barring the dependency on the radiation field), the index
+    \f$\ell_{f,i}\f$ of the radiation field wavelength corresponding to each of these
+    transitions, and the cooling rates \f$C_i\f$. It calculates the transition matrix coefficients
+    \f$A_{f,i}=H_{f,i}\,J_{\ell_{f,i}}\f$, the cumulative coefficients \f$B_{f,i}=\sum_{f'\ge
+    f}A_{f',i}\f$, and finally the probabilities through the recursion \f$P_0=1\f$ and
+    \f$P_i=\sum_{j<i}B_{i,j}P_j/C_i\f$, normalized to unity.
+
+    The heating rates and wavelength indices are stored as packed lower triangles, i.e. the
+    elements \f$(f,i)\f$ with \f$f>i\f$ of each row are stored contiguously, starting at index
+    \f$f(f-1)/2\f$. The cumulative coefficients are stored in a caller-supplied workspace with the
+    same layout, so that each row is calculated from the row above it in a single pass, and so
+    that the dot products in the recursion run over contiguous memory. The workspace holds only
+    half of the matrix, and it can be reused from call to call (e.g. through the ScratchArena).
+
+    The probabilities may grow by many orders of magnitude along the temperature grid. Rather than
+    rescaling all earlier probabilities whenever the current one becomes too large, the recursion
+    keeps a separate power-of-two scale factor for each block of consecutive probabilities. When a
+    probability becomes too large, only the current block is rescaled, and the contributions of
+    the earlier blocks are scaled to the current block when they are added. The scale factors are
+    applied and the probabilities are normalized at the end of the calculation.
+
+    There are two implementations of the kernel: a portable scalar version, and a version using
+    the AVX2 and FMA instruction sets, which uses the hardware gather instruction to load the
+    radiation field and handles eight terms of the dot products per iteration. As for the
+    FaceIntersection kernels, the vectorized version is compiled only on x86-64 systems with a
+    compiler supporting function-level target attributes, and the best implementation supported by
+    the processor is selected at run time. The implementations produce the same results except for
+    rounding differences caused by the different order of the additions in the dot products. */
+namespace TemperatureDistributionKernel
+{
+    /** This enumeration lists the available kernel implementations. */
+    enum InstructionSet { Scalar, AVX2 };
+
+    /** This function returns true if the specified kernel implementation has been compiled and is
+        supported by the processor running the code; false otherwise. The scalar implementation is
+        always available. */
+    bool isAvailable(InstructionSet set);
+
+    /** This function returns the kernel implementation currently used by the solve() function.
+        Initially, this is the best implementation that is available. */
+    InstructionSet instructionSet();
+
+    /** This function selects the kernel implementation to be used by the solve() function. If the
+        specified implementation is not available, the function leaves the selection unchanged and
+        returns false; otherwise it returns true. This function is not thread-safe; it should be
+        called only while no other threads are using the kernel. */
+    bool setInstructionSet(InstructionSet set);
+
+    /** This function returns a human-readable name for the specified kernel implementation. */
+    const char* name(InstructionSet set);
+
+    /** This function returns the number of double values needed in the workspace passed to the
+        solve() function for a temperature grid with \em n points. */
+    size_t workspaceSize(int n);
+
+    /** This function calculates the normalized temperature probability distribution on the
+        \em n consecutive points of a temperature grid starting at index \em ioff, and stores it
+        in \em Pv. The heating rates \em HRm and the wavelength indices \em ELLm are packed lower
+        triangles for the complete temperature grid (a negative wavelength index indicates a
+        transition without heating), the cooling rates \em CRv are indexed on the complete
+        temperature grid, and the radiation field \em Jv is indexed on wavelength. The workspace
+        \em Am must hold at least workspaceSize(n) values; its contents are undefined on entry and
+        on exit. The function uses the implementation selected by setInstructionSet(). */
+    void solve(const double* HRm, const short* ELLm, const double* CRv, const double* Jv, int ioff, int n,
+               double* Am, double* Pv);
+
+    /** This function is the scalar implementation of the solve() function. */
+    void solveScalar(const double* HRm, const short* ELLm, const double* CRv, const double* Jv, int ioff, int n,
+                     double* Am, double* Pv);
+
+    /** This function is the AVX2 implementation of the solve() function. It may be called only if
+        isAvailable(AVX2) returns true. */
+    void solveAVX2(const double* HRm, const short* ELLm, const double* CRv, const double* Jv, int ioff, int n,
+                   double* Am, double* Pv);
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // TEMPERATUREDISTRIBUTIONKERNEL_HPP
@@ -10,6 +10,10 @@
 #include "ProcessManager.hpp"
 
 #include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <QDataStream>
 
 ////////////////////////////////////////////////////////////////////
@@ -67,6 +71,32 @@ namespace
 
 std::atomic<int> ProcessManager::requests(0);
 
+#ifdef BUILDING_WITH_MPI
+namespace
+{
+    // The window exposing the shared counter on the root process
+    MPI_Win counterWindow = MPI_WIN_NULL;
+    uint64_t* counterBase = nullptr;
+
+    // A mutex to serialize the calls from multiple threads within this process for those functions
+    // that may be called from parallel threads (MPI is initialized with MPI_THREAD_SERIALIZED)
+    std::mutex threadMutex;
+
+    // The state of a non-blocking communication; the argument arrays and the datatypes must remain
+    // valid until the communication has completed (a point-to-point send has no arrays or datatypes)
+    struct Exchange
+    {
+        MPI_Request request;
+        std::vector<int> sendcnts, sdispls, recvcnts, rdispls;
+        std::vector<MPI_Datatype> sendtypes, recvtypes;
+    };
+
+    // The pending non-blocking communications, indexed on handle
+    std::map<int, std::unique_ptr<Exchange>> exchanges;
+    int nextExchange = 0;
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////
 
 void ProcessManager::initialize(int *argc, char ***argv)
@@ -76,7 +106,10 @@ void ProcessManager::initialize(int *argc, char ***argv)
     MPI_Initialized(&initialized);
     if (!initialized)
     {
-        MPI_Init(argc, argv);
+        // the shared counter may be accessed from any thread (see fetchAndAddSharedCounter());
+        // the level actually provided by the library is verified through isThreadSerialized()
+        int provided;
+        MPI_Init_thread(argc, argv, MPI_THREAD_SERIALIZED, &provided);
     }
 #else
     Q_UNUSED(argc) Q_UNUSED(argv)
@@ -263,6 +296,141 @@ void ProcessManager::displacedBlocksAllToAll(const double* sendBuffer, size_t se
 
 //////////////////////////////////////////////////////////////////////
 
+int ProcessManager::startDisplacedBlocksAllToAll(const double* sendBuffer, size_t sendCount, size_t sendLength,
+                                                 const std::vector<std::vector<int>>& sendDisplacements,
+                                                 size_t sendExtent, double* recvBuffer, size_t recvCount,
+                                                 size_t recvLength,
+                                                 const std::vector<std::vector<int>>& recvDisplacements,
+                                                 size_t recvExtent)
+{
+#ifdef BUILDING_WITH_MPI
+    std::unique_lock<std::mutex> lock(threadMutex);
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    std::unique_ptr<Exchange> exchange(new Exchange);
+    exchange->sendcnts.assign(size, sendCount);
+    exchange->sdispls.assign(size, 0);
+    exchange->recvcnts.assign(size, recvCount);
+    exchange->rdispls.assign(size, 0);
+    exchange->sendtypes.reserve(size);
+    exchange->recvtypes.reserve(size);
+
+    for (int r=0; r<size; r++)
+    {
+        MPI_Datatype newtype;
+        createDisplacedDoubleBlocks(sendLength, sendDisplacements[r], &newtype, sendExtent);
+        exchange->sendtypes.push_back(newtype);
+
+        createDisplacedDoubleBlocks(recvLength, recvDisplacements[r], &newtype, recvExtent);
+        exchange->recvtypes.push_back(newtype);
+    }
+
+    MPI_Ialltoallw(const_cast<double*>(sendBuffer), exchange->sendcnts.data(), exchange->sdispls.data(),
+                   exchange->sendtypes.data(), recvBuffer, exchange->recvcnts.data(), exchange->rdispls.data(),
+                   exchange->recvtypes.data(), MPI_COMM_WORLD, &exchange->request);
+
+    int handle = nextExchange++;
+    exchanges[handle] = std::move(exchange);
+    return handle;
+#else
+    Q_UNUSED(sendBuffer) Q_UNUSED(sendCount) Q_UNUSED(sendDisplacements) Q_UNUSED(sendLength) Q_UNUSED(sendExtent)
+    Q_UNUSED(recvBuffer) Q_UNUSED(recvCount) Q_UNUSED(recvDisplacements) Q_UNUSED(recvLength) Q_UNUSED(recvExtent)
+    return -1;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool ProcessManager::testExchange(int handle)
+{
+#ifdef BUILDING_WITH_MPI
+    std::unique_lock<std::mutex> lock(threadMutex);
+    auto it = exchanges.find(handle);
+    if (it == exchanges.end()) throw std::logic_error("Unknown communication handle");
+
+    int completed;
+    MPI_Test(&it->second->request, &completed, MPI_STATUS_IGNORE);
+    return completed;
+#else
+    Q_UNUSED(handle)
+    return true;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void ProcessManager::finishExchange(int handle)
+{
+#ifdef BUILDING_WITH_MPI
+    std::unique_lock<std::mutex> lock(threadMutex);
+    auto it = exchanges.find(handle);
+    if (it == exchanges.end()) throw std::logic_error("Unknown communication handle");
+
+    // waiting for a request that has already completed (and thus has been freed) returns immediately
+    Exchange* exchange = it->second.get();
+    MPI_Wait(&exchange->request, MPI_STATUS_IGNORE);
+    for (size_t r=0; r<exchange->sendtypes.size(); r++)
+    {
+        MPI_Type_free(&exchange->sendtypes[r]);
+        MPI_Type_free(&exchange->recvtypes[r]);
+    }
+    exchanges.erase(it);
+#else
+    Q_UNUSED(handle)
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int ProcessManager::startSendDoubles(const double* buffer, size_t count, int receiver, int tag)
+{
+#ifdef BUILDING_WITH_MPI
+    if (count > INT_MAX) throw std::overflow_error("number of elements larger than INT_MAX");
+
+    std::unique_lock<std::mutex> lock(threadMutex);
+    std::unique_ptr<Exchange> exchange(new Exchange);
+    MPI_Isend(const_cast<double*>(buffer), count, MPI_DOUBLE, receiver, tag, MPI_COMM_WORLD, &exchange->request);
+
+    int handle = nextExchange++;
+    exchanges[handle] = std::move(exchange);
+    return handle;
+#else
+    Q_UNUSED(buffer) Q_UNUSED(count) Q_UNUSED(receiver) Q_UNUSED(tag)
+    return -1;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool ProcessManager::receiveDoubles(std::vector<double>& buffer, int tag, bool wait)
+{
+#ifdef BUILDING_WITH_MPI
+    std::unique_lock<std::mutex> lock(threadMutex);
+
+    // probe and receive while holding the lock, so that no other thread can receive the probed message
+    MPI_Status status;
+    if (wait) MPI_Probe(MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &status);
+    else
+    {
+        int available;
+        MPI_Iprobe(MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &available, &status);
+        if (!available) return false;
+    }
+
+    int count;
+    MPI_Get_count(&status, MPI_DOUBLE, &count);
+    buffer.resize(count);
+    MPI_Recv(buffer.data(), count, MPI_DOUBLE, status.MPI_SOURCE, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return true;
+#else
+    Q_UNUSED(buffer) Q_UNUSED(tag) Q_UNUSED(wait)
+    return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void ProcessManager::sum(double* my_array, size_t nvalues, int root)
 {
 #ifdef BUILDING_WITH_MPI
@@ -373,3 +541,90 @@ bool ProcessManager::isMultiProc()
     return false;
 #endif
 }
+
+//////////////////////////////////////////////////////////////////////
+
+int ProcessManager::localRank()
+{
+#ifdef BUILDING_WITH_MPI
+    int rank, localRank;
+    MPI_Comm localComm;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &localComm);
+    MPI_Comm_rank(localComm, &localRank);
+    MPI_Comm_free(&localComm);
+    return localRank;
+#else
+    return 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool ProcessManager::isThreadSerialized()
+{
+#ifdef BUILDING_WITH_MPI
+    int provided;
+    MPI_Query_thread(&provided);
+    return provided >= MPI_THREAD_SERIALIZED;
+#else
+    return true;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void ProcessManager::createSharedCounter()
+{
+#ifdef BUILDING_WITH_MPI
+    if (counterWindow != MPI_WIN_NULL) throw std::logic_error("Shared counter already exists");
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Aint size = rank==0 ? sizeof(uint64_t) : 0;
+    MPI_Win_allocate(size, sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &counterBase, &counterWindow);
+
+    // initialize the counter in an exclusive access epoch, and make sure nobody uses it before that
+    if (rank == 0)
+    {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, counterWindow);
+        *counterBase = 0;
+        MPI_Win_unlock(0, counterWindow);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+size_t ProcessManager::fetchAndAddSharedCounter(size_t increment)
+{
+#ifdef BUILDING_WITH_MPI
+    std::unique_lock<std::mutex> lock(threadMutex);
+
+    uint64_t operand = increment;
+    uint64_t result = 0;
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, counterWindow);
+    MPI_Fetch_and_op(&operand, &result, MPI_UINT64_T, 0, 0, MPI_SUM, counterWindow);
+    MPI_Win_unlock(0, counterWindow);
+    return result;
+#else
+    Q_UNUSED(increment)
+    return 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void ProcessManager::freeSharedCounter()
+{
+#ifdef BUILDING_WITH_MPI
+    if (counterWindow != MPI_WIN_NULL)
+    {
+        MPI_Win_free(&counterWindow);
+        counterBase = nullptr;
+    }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -102,6 +102,47 @@ public:
                                         double* recvBuffer, size_t recvCount, size_t recvLength,
                                         const std::vector<std::vector<int>>& recvDisplacements, size_t recvExtent);
 
+    /** This function starts the same communication as displacedBlocksAllToAll(), but returns
+        immediately without waiting for the data to be transferred. The function returns a handle
+        that identifies the communication in subsequent calls to testExchange() and
+        finishExchange(). The contents of the buffers may not be accessed until the communication
+        has been finished. Multiple communications may be in progress at the same time, as long as
+        all processes start them in the same order. All processes must call this function for the
+        communication to proceed. */
+    static int startDisplacedBlocksAllToAll(const double* sendBuffer, size_t sendCount, size_t sendLength,
+                                            const std::vector<std::vector<int>>& sendDisplacements,
+                                            size_t sendExtent, double* recvBuffer, size_t recvCount,
+                                            size_t recvLength,
+                                            const std::vector<std::vector<int>>& recvDisplacements,
+                                            size_t recvExtent);
+
+    /** This function returns true if the communication with the specified handle, started by
+        startDisplacedBlocksAllToAll(), has completed, and false otherwise. It does not wait for
+        the communication, but it gives the MPI library the opportunity to make progress. */
+    static bool testExchange(int handle);
+
+    /** This function waits until the communication with the specified handle, started by
+        startDisplacedBlocksAllToAll(), has completed, and releases the associated resources. The
+        handle can no longer be used after this function returns. */
+    static void finishExchange(int handle);
+
+    /** This function starts sending an array of double values to the process with the specified
+        rank, using the specified message tag, and returns immediately without waiting for the
+        data to be transferred. The function returns a handle that can be passed to testExchange()
+        and finishExchange(). The contents of the buffer may not be modified until the
+        communication has been finished. In contrast to the collective communications, only the
+        receiving process needs to participate, by calling receiveDoubles(). This function may be
+        called by any thread in the process; the calls are serialized within the process. */
+    static int startSendDoubles(const double* buffer, size_t count, int receiver, int tag);
+
+    /** This function receives a message with the specified tag that was sent by any process
+        through startSendDoubles(), and replaces the contents of the specified vector by the
+        received values. If no such message has arrived yet, the function waits for one if \em
+        wait is true, and returns false immediately otherwise. The function returns true if a
+        message has been received. It may be called by any thread in the process; the calls are
+        serialized within the process. */
+    static bool receiveDoubles(std::vector<double>& buffer, int tag, bool wait);
+
     /** The purpose of this function is to sum a particular array of double values element-wise
         across the different processes. The resulting values are stored in the array passed as the
         second argument 'result_array', only on the process that is assigned as root. The rank of
@@ -147,6 +188,40 @@ public:
         resource or not. */
     static bool isMultiProc();
 
+    /** This function returns the rank of the calling process among the processes running on the
+        same computer (more precisely, the processes that can create shared memory), in the range
+        from zero to the number of such processes minus one. All processes must call this
+        function. Without MPI, the function returns zero. */
+    static int localRank();
+
+    /** This function returns true if the MPI library supports calls from any thread in the
+        process, as long as these calls are serialized (i.e. the library has been initialized with
+        at least the \c MPI_THREAD_SERIALIZED level of thread support), and false otherwise. The
+        shared counter and the point-to-point communication functions used from parallel threads
+        may be called only if this function returns true. Without MPI, the function returns true.
+        */
+    static bool isThreadSerialized();
+
+    /** This function creates a counter that is shared by all processes, and initializes it to
+        zero. The counter resides in the memory of the root process, and is exposed to the other
+        processes through an MPI one-sided communication window, so that it can be incremented by
+        any process without the participation of the root process. There can be only one shared
+        counter at a time. All processes must call this function for the communication to
+        proceed. */
+    static void createSharedCounter();
+
+    /** This function atomically adds the specified increment to the shared counter created by
+        createSharedCounter(), and returns the value of the counter before the addition. Calls from
+        different processes are handled in an unspecified order, so that each returned value is
+        unique. This function may be called by any thread in the process; the calls are serialized
+        within the process. The MPI library is initialized with the corresponding level of thread
+        support. */
+    static size_t fetchAndAddSharedCounter(size_t increment);
+
+    /** This function releases the shared counter created by createSharedCounter(). All processes
+        must call this function for the communication to proceed. */
+    static void freeSharedCounter();
+
 private:
     static std::atomic<int> requests;   // This atomic integer is used to store the number of active requests for MPI
 };
@@ -0,0 +1,468 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+// This console application runs micro-benchmarks for performance critical kernels in the SKIRT
+// libraries. Without arguments, all benchmarks are run; otherwise only the benchmarks whose names
+// are listed on the command line. Each benchmark verifies that the variants being compared
+// produce the same results, and reports the time spent by each variant.
+
+#include <cfloat>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "DustGridPath.hpp"
+#include "FaceIntersection.hpp"
+#include "TemperatureDistributionKernel.hpp"
+#include "VoronoiMesh.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // returns the number of seconds elapsed since the specified time point
+    double elapsed(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    // returns a random direction uniformly distributed on the unit sphere
+    Direction randomDirection(mt19937_64& generator)
+    {
+        uniform_real_distribution<double> uniform(0., 1.);
+        double cost = 2.*uniform(generator) - 1.;
+        double sint = sqrt(max(0., 1.-cost*cost));
+        double phi = 2.*M_PI*uniform(generator);
+        return Direction(sint*cos(phi), sint*sin(phi), cost);
+    }
+
+    // the reference implementation: the scalar loop previously used in VoronoiMesh::path()
+    int referenceLoop(const double* nx, const double* ny, const double* nz, const double* d, int n,
+                      double rx, double ry, double rz, double kx, double ky, double kz, double& sq)
+    {
+        sq = DBL_MAX;
+        int iq = -1;
+        for (int i=0; i<n; i++)
+        {
+            double ndotk = nx[i]*kx + ny[i]*ky + nz[i]*kz;
+            if (ndotk > 0)
+            {
+                double si = (d[i] - (nx[i]*rx + ny[i]*ry + nz[i]*rz)) / ndotk;
+                if (si > 0 && si < sq)
+                {
+                    sq = si;
+                    iq = i;
+                }
+            }
+        }
+        return iq;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // compares the face intersection kernels on synthetic cells: each cell has a number of faces
+    // tangent to a sphere of random radius around the origin, and rays start inside the sphere
+    void benchmarkFaceKernel()
+    {
+        printf("\n--- Face intersection kernel on synthetic cells\n");
+
+        const int Ncells = 10000;
+        const int Nrays = 200;
+        mt19937_64 generator(4357);
+        uniform_real_distribution<double> uniform(0., 1.);
+
+        for (int Nfaces : {6, 15, 32})
+        {
+            // construct the face planes in structure-of-arrays layout
+            vector<double> nx(Ncells*Nfaces), ny(Ncells*Nfaces), nz(Ncells*Nfaces), d(Ncells*Nfaces);
+            for (int i=0; i<Ncells*Nfaces; i++)
+            {
+                Direction n = randomDirection(generator);
+                double scale = 0.5 + uniform(generator);
+                nx[i] = scale*n.x();
+                ny[i] = scale*n.y();
+                nz[i] = scale*n.z();
+                d[i] = scale*(0.5 + uniform(generator));
+            }
+
+            // construct the rays
+            vector<Vec> rv(Nrays), kv(Nrays);
+            for (int j=0; j<Nrays; j++)
+            {
+                rv[j] = 0.4*uniform(generator)*randomDirection(generator);
+                kv[j] = randomDirection(generator);
+            }
+
+            // run the reference loop and each of the available kernels
+            vector<int> reference;
+            double referenceTime = 0.;
+            for (int variant=-1; variant<=FaceIntersection::AVX512; variant++)
+            {
+                auto set = static_cast<FaceIntersection::InstructionSet>(variant);
+                if (variant>=0 && !FaceIntersection::isAvailable(set)) continue;
+
+                vector<int> results;
+                results.reserve(Ncells*Nrays);
+                double checksum = 0.;
+                auto start = chrono::steady_clock::now();
+                for (int m=0; m<Ncells; m++)
+                {
+                    int first = m*Nfaces;
+                    for (int j=0; j<Nrays; j++)
+                    {
+                        double s;
+                        int i = variant<0
+                            ? referenceLoop(&nx[first], &ny[first], &nz[first], &d[first], Nfaces,
+                                            rv[j].x(), rv[j].y(), rv[j].z(), kv[j].x(), kv[j].y(), kv[j].z(), s)
+                            : variant==FaceIntersection::Scalar
+                            ? FaceIntersection::nearestScalar(&nx[first], &ny[first], &nz[first], &d[first], Nfaces,
+                                            rv[j].x(), rv[j].y(), rv[j].z(), kv[j].x(), kv[j].y(), kv[j].z(), s)
+                            : variant==FaceIntersection::AVX2
+                            ? FaceIntersection::nearestAVX2(&nx[first], &ny[first], &nz[first], &d[first], Nfaces,
+                                            rv[j].x(), rv[j].y(), rv[j].z(), kv[j].x(), kv[j].y(), kv[j].z(), s)
+                            : FaceIntersection::nearestAVX512(&nx[first], &ny[first], &nz[first], &d[first], Nfaces,
+                                            rv[j].x(), rv[j].y(), rv[j].z(), kv[j].x(), kv[j].y(), kv[j].z(), s);
+                        results.push_back(i);
+                        if (i>=0) checksum += s;
+                    }
+                }
+                double time = elapsed(start);
+
+                // compare with the reference results; ties may be resolved differently due to rounding
+                int mismatches = 0;
+                if (variant<0)
+                {
+                    reference = results;
+                    referenceTime = time;
+                }
+                else for (size_t k=0; k<results.size(); k++) if (results[k]!=reference[k]) mismatches++;
+
+                printf("%2d faces  %-10s %8.3f ns/cell  speedup %5.2f  checksum %.6e  mismatches %d\n",
+                       Nfaces, variant<0 ? "reference" : FaceIntersection::name(set),
+                       1e9*time/(Ncells*Nrays), referenceTime/time, checksum, mismatches);
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // compares the path calculation through a Voronoi mesh generated from random particles, with
+    // the face planes calculated on the fly and with precomputed face planes for each kernel
+    void benchmarkVoronoiPath()
+    {
+        printf("\n--- Path calculation through a Voronoi mesh\n");
+
+        const int Nparticles = 100000;
+        const int Nrays = 20000;
+        mt19937_64 generator(5489);
+        uniform_real_distribution<double> uniform(-1., 1.);
+
+        Box extent(-1,-1,-1, 1,1,1);
+        vector<Vec> particles(Nparticles);
+        for (auto& p : particles) p = Vec(uniform(generator), uniform(generator), uniform(generator));
+        vector<Position> rv(Nrays);
+        vector<Direction> kv(Nrays);
+        for (int j=0; j<Nrays; j++)
+        {
+            rv[j] = Position(uniform(generator), uniform(generator), uniform(generator));
+            kv[j] = randomDirection(generator);
+        }
+
+        VoronoiMesh mesh(particles, extent);
+        auto run = [&] (const char* label, double& referenceTime)
+        {
+            DustGridPath path;
+            long segments = 0;
+            double length = 0.;
+            auto start = chrono::steady_clock::now();
+            for (int j=0; j<Nrays; j++)
+            {
+                path.setPosition(rv[j]);
+                path.setDirection(kv[j]);
+                mesh.path(&path);
+                segments += path.size();
+                for (int i=0; i<path.size(); i++) length += path.ds(i);
+            }
+            double time = elapsed(start);
+            if (referenceTime==0.) referenceTime = time;
+            printf("%-22s %8.1f ns/segment  speedup %5.2f  segments %ld  total length %.6e\n",
+                   label, 1e9*time/segments, referenceTime/time, segments, length);
+        };
+
+        double referenceTime = 0.;
+        run("on-the-fly planes", referenceTime);
+        mesh.calculateFacePlanes();
+        FaceIntersection::InstructionSet original = FaceIntersection::instructionSet();
+        for (auto set : {FaceIntersection::Scalar, FaceIntersection::AVX2, FaceIntersection::AVX512})
+        {
+            if (!FaceIntersection::setInstructionSet(set)) continue;
+            string label = string("stored planes ") + FaceIntersection::name(set);
+            run(label.c_str(), referenceTime);
+        }
+        FaceIntersection::setInstructionSet(original);
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // the reference implementation: the calculation previously used in TDE_Calculator::calcprobs,
+    // operating on a full square matrix in row-major order and rescaling all earlier probabilities
+    // whenever the current one becomes too large
+    void referenceSolver(const double* HRm, const short* ELLm, const double* CRv, const double* Jv, int ioff, int n,
+                         double* Am, double* Pv)
+    {
+        auto A = [Am,n] (int f, int i) -> double& { return Am[f*n+i]; };
+        auto offset = [] (size_t f) { return ((f-1)*f)>>1; };
+
+        // copy/calculate the transition matrix coefficients
+        for (int f=1; f<n; f++)
+        {
+            const short* ELLv = ELLm + offset(f+ioff) + ioff;
+            const double* HRv = HRm + offset(f+ioff) + ioff;
+            for (int i=0; i<f; i++)
+            {
+                int ell = ELLv[i];
+                A(f,i) = ell>=0 ? HRv[i] * Jv[ell] : 0.;
+            }
+        }
+        for (int i=1; i<n; i++) A(i-1,i) = CRv[i+ioff];
+
+        // calculate the cumulative matrix coefficients, in place
+        for (int f=n-2; f>0; f--)
+            for (int i=0; i<f; i++)
+                A(f,i) += A(f+1,i);
+
+        // calculate the probabilities
+        Pv[0] = 1.;
+        for (int i=1; i<n; i++)
+        {
+            double sum = 0.;
+            for (int j=0; j<i; j++) sum += A(i,j) * Pv[j];
+            Pv[i] = sum / A(i-1,i);
+            if (Pv[i] > 1e10) for (int j=0; j<=i; j++) Pv[j]/=Pv[i];
+        }
+
+        // normalize probabilities to unity
+        double total = 0.;
+        for (int i=0; i<n; i++) total += Pv[i];
+        for (int i=0; i<n; i++) Pv[i] /= total;
+    }
+
+    // the heating and cooling rates for a dust population on a temperature grid, in the packed
+    // triangular layout expected by the TemperatureDistributionKernel functions
+    struct Population
+    {
+        vector<double> HRm;
+        vector<short> ELLm;
+        vector<double> CRv;
+    };
+
+    // constructs the heating and cooling rates for a synthetic dust population with the specified grain
+    // radius, bulk density, mass per atom and Debye-like temperature, following the TDE_Calculator
+    // constructor; the absorption efficiency is proportional to 1/lambda for wavelengths longer than
+    // the grain circumference times the specified factor, and unity for shorter wavelengths
+    Population makePopulation(double a, double rho, double matom, double theta, double qfactor,
+                              const vector<double>& lambdav, const vector<double>& dlambdav, const vector<double>& Tv)
+    {
+        const double h = 6.62606957e-34, c = 2.99792458e8, k = 1.3806488e-23;
+        int Nlambda = lambdav.size();
+        int NT = Tv.size();
+
+        // the absorption cross section
+        vector<double> sigmav(Nlambda);
+        for (int ell=0; ell<Nlambda; ell++) sigmav[ell] = M_PI*a*a * min(1., qfactor*2.*M_PI*a/lambdav[ell]);
+
+        // the enthalpy of a grain, for a heat capacity 3Nk x^2/(1+x^2) with x=T/theta
+        double Natoms = 4./3.*M_PI*a*a*a * rho / matom;
+        auto enthalpy = [=] (double T) { double x = T/theta; return 3.*Natoms*k*theta * (x - atan(x)); };
+        vector<double> Hv(NT), dHv(NT);
+        for (int i=0; i<NT; i++) Hv[i] = enthalpy(Tv[i]);
+        dHv[0] = Hv[1]-Hv[0];
+        for (int i=1; i<NT-1; i++) dHv[i] = enthalpy((Tv[i+1]+Tv[i])/2.) - enthalpy((Tv[i-1]+Tv[i])/2.);
+        dHv[NT-1] = Hv[NT-1]-Hv[NT-2];
+
+        // the heating rates, with the index of the nearest wavelength in the logarithmic grid
+        Population pop;
+        pop.HRm.resize(NT*(NT-1)/2);
+        pop.ELLm.resize(NT*(NT-1)/2);
+        double loglambdamin = log(lambdav.front());
+        double dloglambda = (log(lambdav.back()) - loglambdamin) / (Nlambda-1);
+        for (int f=1; f<NT; f++)
+        {
+            for (int i=0; i<f; i++)
+            {
+                double Hdiff = Hv[f] - Hv[i];
+                double lambda = h*c / Hdiff;
+                int ell = static_cast<int>(floor((log(lambda)-loglambdamin)/dloglambda + 0.5));
+                if (ell<0 || ell>=Nlambda) ell = -1;
+                size_t index = ((f-1)*f)/2 + i;
+                pop.HRm[index] = ell>=0 ? h*c * sigmav[ell] * dHv[f] / (Hdiff*Hdiff*Hdiff) : 0.;
+                pop.ELLm[index] = ell;
+            }
+        }
+
+        // the cooling rates
+        pop.CRv.resize(NT);
+        for (int i=1; i<NT; i++)
+        {
+            double sum = 0.;
+            for (int ell=0; ell<Nlambda; ell++)
+            {
+                double lambda = lambdav[ell];
+                double B = 2.*h*c*c / pow(lambda,5) / (exp(h*c/(lambda*k*Tv[i]))-1.);
+                sum += sigmav[ell] * B * dlambdav[ell];
+            }
+            pop.CRv[i] = sum / (Hv[i]-Hv[i-1]);
+        }
+        return pop;
+    }
+
+    // compares the temperature probability distribution solvers on synthetic dust populations with
+    // grain sizes and compositions resembling those of the DraineLi and THEMIS dust mixes, in
+    // diluted stellar radiation fields of different strengths
+    void benchmarkTemperatureDistribution()
+    {
+        printf("\n--- Temperature probability distribution of transiently heated grains\n");
+
+        const double h = 6.62606957e-34, c = 2.99792458e8, k = 1.3806488e-23, amu = 1.66053892e-27;
+        const int Nlambda = 300;
+        const int NT = 750;
+        const int Nrepeats = 10;
+
+        // a logarithmic wavelength grid from 0.01 to 1000 micron and a linear temperature grid from 2 to 1500 K
+        vector<double> lambdav(Nlambda), dlambdav(Nlambda);
+        for (int ell=0; ell<Nlambda; ell++) lambdav[ell] = 1e-8 * pow(1e5, ell/(Nlambda-1.));
+        for (int ell=0; ell<Nlambda; ell++)
+            dlambdav[ell] = (lambdav[min(ell+1,Nlambda-1)] - lambdav[max(ell-1,0)]) / (ell>0 && ell<Nlambda-1 ? 2. : 1.);
+        vector<double> Tv(NT);
+        for (int i=0; i<NT; i++) Tv[i] = 2. + (1500.-2.)*i/(NT-1.);
+
+        // the populations: graphite and silicate grains for DraineLi, amorphous hydrocarbon and silicate grains
+        // for THEMIS, each with a number of grain sizes in the range where stochastic heating is important
+        struct Composition { const char* set; const char* name; double rho, matom, theta, qfactor; };
+        const Composition compositions[] =
+        {
+            { "DraineLi", "graphite", 2.24e3, 12.*amu, 420., 1.0 },
+            { "DraineLi", "silicate", 3.5e3, 24.*amu, 500., 0.5 },
+            { "THEMIS", "a-C(:H)", 1.6e3, 8.*amu, 350., 1.0 },
+            { "THEMIS", "a-Sil", 3.0e3, 20.*amu, 480., 0.5 },
+        };
+        const double radii[] = { 0.4e-9, 1e-9, 2.5e-9, 6e-9, 15e-9 };
+
+        // the radiation fields: diluted 6000 K black bodies with strengths comparable to the local
+        // interstellar radiation field multiplied by 1, 100 and 10000
+        vector<vector<double>> Jvv;
+        for (double U : {1., 1e2, 1e4})
+        {
+            vector<double> Jv(Nlambda);
+            for (int ell=0; ell<Nlambda; ell++)
+            {
+                double lambda = lambdav[ell];
+                Jv[ell] = U * 1e-14 * 2.*h*c*c / pow(lambda,5) / (exp(h*c/(lambda*k*6000.))-1.);
+            }
+            Jvv.push_back(Jv);
+        }
+
+        for (const char* set : {"DraineLi", "THEMIS"})
+        {
+            vector<Population> populations;
+            for (const Composition& comp : compositions)
+                if (!strcmp(comp.set, set))
+                    for (double a : radii)
+                        populations.push_back(makePopulation(a, comp.rho, comp.matom, comp.theta,
+                                                             comp.qfactor, lambdav, dlambdav, Tv));
+
+            // run the reference solver and each of the available kernel implementations
+            vector<double> Am(NT*NT), Pv(NT), reference;
+            double referenceTime = 0.;
+            for (int variant=-1; variant<=TemperatureDistributionKernel::AVX2; variant++)
+            {
+                auto kernel = static_cast<TemperatureDistributionKernel::InstructionSet>(variant);
+                if (variant>=0 && !TemperatureDistributionKernel::isAvailable(kernel)) continue;
+
+                vector<double> results;
+                auto start = chrono::steady_clock::now();
+                for (const Population& pop : populations)
+                {
+                    for (const vector<double>& Jv : Jvv)
+                    {
+                        for (int r=0; r<Nrepeats; r++)
+                        {
+                            if (variant<0)
+                                referenceSolver(pop.HRm.data(), pop.ELLm.data(), pop.CRv.data(), Jv.data(), 0, NT,
+                                                Am.data(), Pv.data());
+                            else if (variant==TemperatureDistributionKernel::Scalar)
+                                TemperatureDistributionKernel::solveScalar(pop.HRm.data(), pop.ELLm.data(),
+                                                pop.CRv.data(), Jv.data(), 0, NT, Am.data(), Pv.data());
+                            else
+                                TemperatureDistributionKernel::solveAVX2(pop.HRm.data(), pop.ELLm.data(),
+                                                pop.CRv.data(), Jv.data(), 0, NT, Am.data(), Pv.data());
+                        }
+                        results.insert(results.end(), Pv.begin(), Pv.end());
+                    }
+                }
+                double time = elapsed(start);
+
+                // compare with the reference results, ignoring probabilities that are negligible
+                // compared to the largest probability in the same distribution
+                double maxerror = 0.;
+                if (variant<0)
+                {
+                    reference = results;
+                    referenceTime = time;
+                }
+                else for (size_t d=0; d<results.size(); d+=NT)
+                {
+                    double Pmax = *max_element(reference.begin()+d, reference.begin()+d+NT);
+                    for (size_t i=d; i<d+NT; i++)
+                        if (reference[i] > 1e-10*Pmax)
+                            maxerror = max(maxerror, fabs(results[i]-reference[i])/reference[i]);
+                }
+
+                int Nsolves = populations.size()*Jvv.size()*Nrepeats;
+                printf("%-8s %-10s %8.1f us/solve  speedup %5.2f  max relative difference %.2e\n",
+                       set, variant<0 ? "reference" : TemperatureDistributionKernel::name(kernel),
+                       1e6*time/Nsolves, referenceTime/time, maxerror);
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // the list of benchmarks with their names
+    struct Benchmark
+    {
+        const char* name;
+        void (*function)();
+    };
+    const Benchmark benchmarks[] =
+    {
+        { "faces", benchmarkFaceKernel },
+        { "voronoi", benchmarkVoronoiPath },
+        { "temperature", benchmarkTemperatureDistribution },
+    };
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    printf("Best available face intersection kernel: %s\n",
+           FaceIntersection::name(FaceIntersection::instructionSet()));
+
+    for (const Benchmark& benchmark : benchmarks)
+    {
+        bool selected = argc < 2;
+        for (int i=1; i<argc; i++) if (!strcmp(argv[i], benchmark.name)) selected = true;
+        if (selected) benchmark.function();
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
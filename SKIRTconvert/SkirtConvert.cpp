@@ -0,0 +1,162 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+// This console application converts a text column file, as accepted by the SKIRT classes that import
+// particle or mesh data, to the binary column format described for the BinaryInFile class. The
+// command line syntax is:
+//
+//     skirtconvert [-f] [-a] [-n name,name,...] [-u unit,unit,...] <input-text-file> <output-binary-file>
+//
+//   -f : store the values in single precision rather than double precision
+//   -a : the input file is in the adaptive mesh ASCII format (see the AdaptiveMeshAsciiFile class)
+//   -n : the comma-separated names of the columns, which are stored for reference
+//   -u : the comma-separated units of the columns, using the names listed by the Units class; an
+//        empty entry indicates a dimensionless column or a column in the default units of the reader
+//
+// Empty lines and lines starting with a crosshatch (#) are ignored. The number of columns in the
+// output file is the largest number of values on any line; missing values at the end of a line
+// are replaced by zeroes, just like the TextInFile class does for optional columns.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BinaryInFile.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // prints the command line syntax and returns the exit code for a usage error
+    int usage()
+    {
+        printf("Usage: skirtconvert [-f] [-a] [-n name,name,...] [-u unit,unit,...] <input-text-file> <output-binary-file>\n");
+        printf("  -f : store the values in single precision rather than double precision\n");
+        printf("  -a : the input file is in the adaptive mesh ASCII format\n");
+        printf("  -n : the comma-separated names of the columns\n");
+        printf("  -u : the comma-separated units of the columns\n");
+        return 1;
+    }
+
+    // splits a comma-separated list in its (possibly empty) items
+    vector<string> split(const string& list)
+    {
+        vector<string> items;
+        stringstream stream(list);
+        string item;
+        while (getline(stream, item, ',')) items.push_back(item);
+        return items;
+    }
+
+    // writes the specified value to the output stream in native byte order
+    template<typename T> void put(ofstream& out, T value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // writes the specified string to the output stream as a null-padded field of the specified size
+    void put(ofstream& out, const string& value, size_t size)
+    {
+        vector<char> field(size, 0);
+        memcpy(field.data(), value.data(), min(value.size(), size));
+        out.write(field.data(), size);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    // process the command line arguments
+    bool single = false;
+    bool adaptive = false;
+    vector<string> names, units;
+    vector<string> filenames;
+    for (int i=1; i<argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-f") single = true;
+        else if (arg == "-a") adaptive = true;
+        else if (arg == "-n" && i+1<argc) names = split(argv[++i]);
+        else if (arg == "-u" && i+1<argc) units = split(argv[++i]);
+        else if (arg.size() && arg[0] == '-') return usage();
+        else filenames.push_back(arg);
+    }
+    if (filenames.size() != 2) return usage();
+
+    // read the rows from the text file; nonleaf lines in adaptive mesh format get a leading 1,
+    // and leaf lines a leading 0
+    ifstream in(filenames[0]);
+    if (!in) { printf("Error: could not open input file %s\n", filenames[0].c_str()); return 1; }
+    vector<vector<double>> rows;
+    size_t ncols = adaptive ? 4 : 0;
+    string line;
+    while (getline(in, line))
+    {
+        auto pos = line.find_first_not_of(" \t\r");
+        if (pos==string::npos || line[pos]=='#') continue;
+
+        vector<double> row;
+        if (adaptive)
+        {
+            bool nonleaf = line[pos]=='!';
+            if (nonleaf) line[pos] = ' ';
+            row.push_back(nonleaf ? 1. : 0.);
+        }
+        stringstream linestream(line);
+        double value;
+        while (linestream >> value) row.push_back(value);
+        if (!linestream.eof())
+        {
+            printf("Error: improperly formatted number on line %zu of the data\n", rows.size()+1);
+            return 1;
+        }
+        ncols = max(ncols, row.size());
+        rows.push_back(row);
+    }
+    size_t nrows = rows.size();
+    if (names.size() > ncols || units.size() > ncols)
+    {
+        printf("Error: more column names or units than columns (%zu)\n", ncols);
+        return 1;
+    }
+
+    // write the header
+    ofstream out(filenames[1], ios::binary);
+    if (!out) { printf("Error: could not open output file %s\n", filenames[1].c_str()); return 1; }
+    out.write(BinaryInFile::SIGNATURE, sizeof(BinaryInFile::SIGNATURE));
+    put<uint32_t>(out, BinaryInFile::VERSION);
+    put<uint32_t>(out, single ? 4 : 8);
+    put<uint64_t>(out, ncols);
+    put<uint64_t>(out, nrows);
+    for (size_t col=0; col<ncols; col++)
+    {
+        put(out, col<names.size() ? names[col] : string(), BinaryInFile::NAMESIZE);
+        put(out, col<units.size() ? units[col] : string(), BinaryInFile::UNITSIZE);
+    }
+
+    // write the values column by column, replacing missing values by zeroes
+    for (size_t col=0; col<ncols; col++)
+    {
+        for (const vector<double>& row : rows)
+        {
+            double value = col<row.size() ? row[col] : 0.;
+            if (single) put<float>(out, value);
+            else put<double>(out, value);
+        }
+    }
+    out.close();
+    if (!out) { printf("Error: could not write output file %s\n", filenames[1].c_str()); return 1; }
+
+    printf("Converted %zu rows with %zu columns to %s\n", nrows, ncols, filenames[1].c_str());
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
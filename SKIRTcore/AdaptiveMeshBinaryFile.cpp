@@ -0,0 +1,80 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "AdaptiveMeshBinaryFile.hpp"
+#include "BinaryInFile.hpp"
+#include "FatalError.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+AdaptiveMeshBinaryFile::AdaptiveMeshBinaryFile()
+    : _row(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////
+
+AdaptiveMeshBinaryFile::~AdaptiveMeshBinaryFile()
+{
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void AdaptiveMeshBinaryFile::open()
+{
+    _infile.reset(new BinaryInFile(this, _filename, "adaptive mesh data"));
+    _infile->requireColumns(4);
+    _row = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void AdaptiveMeshBinaryFile::close()
+{
+    _infile.reset();
+    _row = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool AdaptiveMeshBinaryFile::read()
+{
+    if (!_infile || _row >= _infile->rows()) return false;
+    _row++;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool AdaptiveMeshBinaryFile::isNonLeaf() const
+{
+    return _infile->value(_row-1, 0) != 0.;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void AdaptiveMeshBinaryFile::numChildNodes(int &nx, int &ny, int &nz) const
+{
+    nx = static_cast<int>(_infile->value(_row-1, 1));
+    ny = static_cast<int>(_infile->value(_row-1, 2));
+    nz = static_cast<int>(_infile->value(_row-1, 3));
+
+    // we expect three positive integers
+    if (nx<1 || ny<1 || nz<1) throw FATALERROR("Invalid nonleaf record in mesh data");
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double AdaptiveMeshBinaryFile::value(int g) const
+{
+    // verify index range
+    if (g < 0) throw FATALERROR("Field index out of range");
+    if (static_cast<size_t>(g+1) >= _infile->columns())
+        throw FATALERROR("Insufficient number of field values in mesh data");
+
+    return _infile->value(_row-1, g+1);
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,86 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef ADAPTIVEMESHBINARYFILE_HPP
+#define ADAPTIVEMESHBINARYFILE_HPP
+
+#include <memory>
+#include "AdaptiveMeshFile.hpp"
+class BinaryInFile;
+
+////////////////////////////////////////////////////////////////////
+
+/** The AdaptiveMeshBinaryFile class can read the relevant information on a cartesian
+    three-dimensional (3D) Adaptive Mesh Refinement (AMR) grid from a file in the binary column
+    format described for the BinaryInFile class. The file is memory-mapped, so that large meshes
+    can be imported without parsing text.
+
+    Each row in the file represents a tree node record, and the rows are given in Morton order as
+    described for the AdaptiveMeshFile class. Because all rows in a binary column file have the
+    same number of columns, the first column indicates the node type. For a nonleaf node, the
+    first column holds a nonzero value, and the next three columns hold the number of child nodes
+    \f$N_x,N_y,N_z\f$ in each spatial direction. For a leaf node, the first column holds zero, and
+    the subsequent columns hold the \f$N_{fields}\f$ values of the fields, i.e. the second column
+    provides the value for field \f$F_0\f$, the third for \f$F_1\f$, and so on. Unused columns are
+    ignored. Thus the file has \f$\max(3,N_{fields})+1\f$ columns. A binary file can be produced
+    from a file in the format described for the AdaptiveMeshAsciiFile class with the \c
+    skirtconvert utility. */
+class AdaptiveMeshBinaryFile : public AdaptiveMeshFile
+{
+    Q_OBJECT
+    Q_CLASSINFO("Title", "an adaptive mesh data file in binary column format")
+
+    //================= Construction - Destruction =================
+
+public:
+    /** The default constructor. */
+    Q_INVOKABLE AdaptiveMeshBinaryFile();
+
+    /** The destructor closes the file, if it is still open. */
+    ~AdaptiveMeshBinaryFile();
+
+    //======================== Other Functions =======================
+
+public:
+    /** This function opens and memory-maps the adaptive mesh data file, or throws a fatal error if
+        the file can't be opened or is not in binary column format. It does not yet read any
+        records. */
+    void open();
+
+    /** This function closes the adaptive mesh data file. */
+    void close();
+
+    /** This function advances to the next record in the file, and holds its information ready for
+        inspection through the other functions of this class. The function returns true if there
+        is a next record, or false if the end of the file was reached. */
+    bool read();
+
+    /** This function returns true if the current record represents a nonleaf node, or false if
+        the current record represents a leaf node. If there is no current record, the result is
+        undefined. */
+    bool isNonLeaf() const;
+
+    /** If the current record represents a nonleaf node, this function returns \f$N_x,N_y,N_z\f$,
+        i.e. the number of child nodes carried by the node in each spatial direction. If the
+        current record represents a leaf node or if there is no current record, the result is
+        undefined. */
+    void numChildNodes(int& nx, int& ny, int& nz) const;
+
+    /** If the current record represents a leaf node, this function returns the value \f$F_g\f$ of
+        the field with given zero-based index \f$0\le g \le N_{fields}-1\f$. If the index is out of
+        range, a fatal error is thrown. If the current record represents a nonleaf node or if there
+        is no current record, the result is undefined. */
+    double value(int g) const;
+
+    //========================= Data members =======================
+
+private:
+    std::unique_ptr<BinaryInFile> _infile;  // the input file, or null if the file is not open
+    size_t _row;                            // the index of the next record
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // ADAPTIVEMESHBINARYFILE_HPP
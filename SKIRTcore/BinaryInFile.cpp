@@ -0,0 +1,146 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cstring>
+#include "BinaryInFile.hpp"
+#include "FatalError.hpp"
+#include "FilePaths.hpp"
+#include "Log.hpp"
+#include "Units.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+const char BinaryInFile::SIGNATURE[8] = { 'S', 'K', 'I', 'R', 'T', 'C', 'O', 'L' };
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // returns the value of the specified type stored at the specified address, which may be unaligned
+    template<typename T> T extract(const uchar* address)
+    {
+        T value;
+        memcpy(&value, address, sizeof(T));
+        return value;
+    }
+
+    // returns the string stored in the null-padded field with the specified address and size
+    QString extractString(const uchar* address, size_t size)
+    {
+        const char* begin = reinterpret_cast<const char*>(address);
+        return QString::fromLatin1(begin, strnlen(begin, size)).trimmed();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+BinaryInFile::BinaryInFile(const SimulationItem* item, QString filename, QString description)
+    : _data(0), _dtype(0), _ncols(0), _nrows(0)
+{
+    // open the file
+    QString filepath = item->find<FilePaths>()->input(filename);
+    _file.setFileName(filepath);
+    if (!_file.open(QIODevice::ReadOnly))
+        throw FATALERROR("Could not open the " + description + " data file " + filepath);
+
+    // map the complete file into memory
+    qint64 filesize = _file.size();
+    if (filesize < static_cast<qint64>(HEADERSIZE))
+        throw FATALERROR("The " + description + " data file is too short to be in binary column format");
+    const uchar* map = _file.map(0, filesize);
+    if (!map) throw FATALERROR("Could not memory-map the " + description + " data file " + filepath);
+
+    // verify and interpret the fixed part of the header
+    if (memcmp(map, SIGNATURE, sizeof(SIGNATURE)))
+        throw FATALERROR("The " + description + " data file is not in binary column format");
+    uint32_t version = extract<uint32_t>(map+8);
+    if (version != VERSION)
+    {
+        if (version == (VERSION << 24))
+            throw FATALERROR("The " + description + " data file has been written with the wrong byte order");
+        throw FATALERROR("The " + description + " data file has unsupported binary format version "
+                         + QString::number(version));
+    }
+    _dtype = extract<uint32_t>(map+12);
+    if (_dtype != 4 && _dtype != 8)
+        throw FATALERROR("The " + description + " data file has unsupported data type " + QString::number(_dtype));
+    _ncols = extract<uint64_t>(map+16);
+    _nrows = extract<uint64_t>(map+24);
+
+    // verify the file size against the header information
+    size_t datastart = HEADERSIZE + _ncols*(NAMESIZE+UNITSIZE);
+    if (static_cast<size_t>(filesize) != datastart + _ncols*_nrows*_dtype)
+        throw FATALERROR("The size of the " + description + " data file does not match its header");
+
+    // get the column names and units
+    for (size_t col=0; col<_ncols; col++)
+    {
+        const uchar* column = map + HEADERSIZE + col*(NAMESIZE+UNITSIZE);
+        _names << extractString(column, NAMESIZE);
+        _units << extractString(column+NAMESIZE, UNITSIZE);
+    }
+    _data = map + datastart;
+
+    item->find<Log>()->info("Reading " + description + " from binary file " + filepath + "...");
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool BinaryInFile::isBinary(const SimulationItem* item, QString filename)
+{
+    QFile file(item->find<FilePaths>()->input(filename));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    char signature[sizeof(SIGNATURE)];
+    return file.read(signature, sizeof(signature)) == sizeof(signature)
+            && !memcmp(signature, SIGNATURE, sizeof(SIGNATURE));
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t BinaryInFile::rows() const
+{
+    return _nrows;
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t BinaryInFile::columns() const
+{
+    return _ncols;
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString BinaryInFile::name(size_t col) const
+{
+    return _names.value(col);
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString BinaryInFile::unit(size_t col) const
+{
+    return _units.value(col);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void BinaryInFile::requireColumns(size_t ncols, size_t noptcols) const
+{
+    if (_ncols < ncols-noptcols)
+        throw FATALERROR("The binary data file has " + QString::number(_ncols) + " columns rather than "
+                         + QString::number(ncols-noptcols) + " or more");
+}
+
+////////////////////////////////////////////////////////////////////
+
+double BinaryInFile::factor(size_t col, QString qty, QString unit) const
+{
+    QString colunit = _units.value(col);
+    if (colunit.isEmpty() || colunit == unit) return 1.;
+    return Units::in(qty, colunit) / Units::in(qty, unit);
+}
+
+////////////////////////////////////////////////////////////////////
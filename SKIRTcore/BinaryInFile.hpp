@@ -0,0 +1,143 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef BINARYINFILE_HPP
+#define BINARYINFILE_HPP
+
+#include <cstdint>
+#include <QFile>
+#include <QStringList>
+class SimulationItem;
+
+////////////////////////////////////////////////////////////////////
+
+/** This class provides access to the values in an input file in the SKIRT binary column format,
+    specified in the constructor. The file is memory-mapped rather than read, so that opening a
+    file takes almost no time regardless of its size, and the values are retrieved directly from
+    the mapped file contents without intermediate copies. The file can be produced from a text
+    column file with the \c skirtconvert utility.
+
+    A binary column file represents a table with a given number of rows and columns, in the form
+    of a fixed-size header followed by the values for each column. All integers and floating point
+    values are stored in the native (little-endian) byte order. The header consists of:
+      - the 8-byte signature \c SKIRTCOL;
+      - a 4-byte unsigned integer holding the format version, currently 1;
+      - a 4-byte unsigned integer holding the data type of the values, i.e. the number of bytes
+        per value, which is 4 for single precision and 8 for double precision floating point;
+      - an 8-byte unsigned integer holding the number of columns \f$N_c\f$;
+      - an 8-byte unsigned integer holding the number of rows \f$N_r\f$;
+      - for each column, a 32-byte name followed by a 16-byte unit string, both in ASCII and
+        padded with null characters. An empty unit string indicates that the column is
+        dimensionless, or that the values are given in the default units for the column as
+        documented by the class reading the file.
+
+    The header is followed by the \f$N_r\f$ values of the first column, then the \f$N_r\f$ values
+    of the second column, and so on. Because the header size is a multiple of eight bytes, all
+    values are properly aligned in memory. Storing the values column by column allows the reading
+    class to process a particular quantity for all rows in a single sequential sweep.
+
+    An informational message is logged when the file is opened, and the file is automatically
+    unmapped and closed when the object is destructed. */
+class BinaryInFile
+{
+    //=============== Construction - Destruction  ==================
+
+public:
+    /** The constructor opens and memory-maps the specified file, verifies its header, and logs a
+        message when successful. If the file can't be opened or mapped, or if it is not a valid
+        binary column file, a FatalError is thrown. The arguments have the same meaning as for the
+        TextInFile constructor: (1) \em item specifies a simulation item in the hierarchy of the
+        caller (usually the caller itself) used to retrieve the input file path and an appropriate
+        logger; (2) \em filename specifies the name of the file, including filename extension but
+        excluding path and simulation prefix; (3) \em description specifies a description used in
+        the log message issued after the file is successfully opened. */
+    BinaryInFile(const SimulationItem* item, QString filename, QString description);
+
+    /** The copy constructor is deleted because the object owns the file mapping. */
+    BinaryInFile(const BinaryInFile&) = delete;
+
+    /** The assignment operator is deleted because the object owns the file mapping. */
+    BinaryInFile& operator=(const BinaryInFile&) = delete;
+
+    /** This static function returns true if the specified file exists and starts with the
+        signature of the binary column format, and false otherwise. It allows classes that accept
+        both text and binary column files to select the appropriate reader. The arguments have the
+        same meaning as for the constructor. */
+    static bool isBinary(const SimulationItem* item, QString filename);
+
+    //====================== Other functions =======================
+
+public:
+    /** This function returns the number of rows in the file. */
+    size_t rows() const;
+
+    /** This function returns the number of columns in the file. */
+    size_t columns() const;
+
+    /** This function returns the name of the column with the specified zero-based index. */
+    QString name(size_t col) const;
+
+    /** This function returns the unit string of the column with the specified zero-based index. */
+    QString unit(size_t col) const;
+
+    /** This function throws a FatalError if the file has less than \em ncols - \em noptcols
+        columns. Missing optional columns at the end of each row are read as zeroes by the value()
+        function. */
+    void requireColumns(size_t ncols, size_t noptcols = 0) const;
+
+    /** This function returns the factor that converts the values in the column with the specified
+        zero-based index to the specified \em unit of the specified physical quantity \em qty,
+        using the names listed by the Units class. If the unit string of the column is empty, the
+        values are assumed to be given in the requested units and the function returns one. If the
+        column is missing, the function returns one as well. If the unit string of the column is
+        not a known unit for the quantity, a FatalError is thrown. */
+    double factor(size_t col, QString qty, QString unit) const;
+
+    /** This function returns the value in the specified row and column (both zero-based indices),
+        converted to double precision. If the column index is beyond the number of columns in the
+        file, the function returns zero. The row index is not checked. */
+    double value(size_t row, size_t col) const;
+
+    //======================== Data Members ========================
+
+public:
+    /** The signature at the start of every binary column file. */
+    static const char SIGNATURE[8];
+
+    /** The current version of the binary column format. */
+    static const uint32_t VERSION = 1;
+
+    /** The number of bytes of the fixed part of the header. */
+    static const size_t HEADERSIZE = 32;
+
+    /** The number of bytes of the column name in the header. */
+    static const size_t NAMESIZE = 32;
+
+    /** The number of bytes of the column unit string in the header. */
+    static const size_t UNITSIZE = 16;
+
+private:
+    QFile _file;            // the input file, which owns the memory mapping
+    const uchar* _data;     // pointer to the values of the first column
+    uint32_t _dtype;        // the number of bytes per value
+    size_t _ncols;          // the number of columns
+    size_t _nrows;          // the number of rows
+    QStringList _names;     // the column names
+    QStringList _units;     // the column unit strings
+};
+
+////////////////////////////////////////////////////////////////////
+
+inline double BinaryInFile::value(size_t row, size_t col) const
+{
+    if (col >= _ncols) return 0.;
+    size_t index = col*_nrows + row;
+    if (_dtype == 8) return reinterpret_cast<const double*>(_data)[index];
+    return reinterpret_cast<const float*>(_data)[index];
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // BINARYINFILE_HPP
@@ -0,0 +1,40 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "ChunkDispatcher.hpp"
+#include "PeerToPeerCommunicator.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+ChunkDispatcher::ChunkDispatcher(PeerToPeerCommunicator* comm, size_t count)
+    : _comm(comm), _count(count), _shared(comm->isMultiProc()), _local(0)
+{
+    if (_shared) _comm->createSharedCounter();
+}
+
+////////////////////////////////////////////////////////////////////
+
+ChunkDispatcher::~ChunkDispatcher()
+{
+    if (_shared) _comm->freeSharedCounter();
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t ChunkDispatcher::count() const
+{
+    return _count;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool ChunkDispatcher::next(size_t& index)
+{
+    // once the counter has passed the end of the range, it keeps increasing harmlessly
+    index = _shared ? _comm->fetchAndAddSharedCounter(1) : _local++;
+    return index < _count;
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,77 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef CHUNKDISPATCHER_HPP
+#define CHUNKDISPATCHER_HPP
+
+#include <atomic>
+#include <cstddef>
+class PeerToPeerCommunicator;
+
+////////////////////////////////////////////////////////////////////
+
+/** A ChunkDispatcher object hands out the indices of a parallelized loop to the processes and
+    threads of a simulation on demand. In contrast to a ProcessAssigner, which determines up front
+    which indices will be handled by each process, a ChunkDispatcher lets each thread of each
+    process ask for the next index whenever it is ready for more work. As a result, a process that
+    runs on faster hardware, or that happens to get a number of inexpensive indices, automatically
+    handles a larger portion of the loop, and all processes finish at approximately the same time.
+
+    With multiple processes, the next index is obtained from a counter that is shared by all
+    processes and that is incremented through MPI one-sided communication (see the
+    PeerToPeerCommunicator::fetchAndAddSharedCounter() function), so that no process needs to
+    serve as a master. With a single process, the counter is simply an atomic integer.
+
+    Which process and which thread executes a particular index is unpredictable. Therefore the
+    loop body should depend only on the index, and not on the process or thread executing it. For
+    example, the random streams used for a chunk of photon packages should be determined by the
+    global index of the chunk (which is the case for reproducible random generators).
+
+    The constructor and destructor involve collective communication, so that all processes in the
+    communicator must construct and destruct a ChunkDispatcher object at the same point in the
+    program. A ChunkDispatcher is used by passing it to the Parallel::call() function. */
+class ChunkDispatcher
+{
+    //============= Construction - Setup - Destruction =============
+
+public:
+    /** The constructor creates a dispatcher for the indices from 0 to \em count-1, using the
+        specified communicator. All processes in the communicator must call the constructor with
+        the same count. */
+    ChunkDispatcher(PeerToPeerCommunicator* comm, size_t count);
+
+    /** The destructor releases the shared counter. All processes in the communicator must call
+        the destructor. */
+    ~ChunkDispatcher();
+
+    /** The copy constructor is deleted because a dispatcher owns the shared counter. */
+    ChunkDispatcher(const ChunkDispatcher&) = delete;
+
+    /** The assignment operator is deleted because a dispatcher owns the shared counter. */
+    ChunkDispatcher& operator=(const ChunkDispatcher&) = delete;
+
+    //======================== Other Functions =======================
+
+public:
+    /** This function returns the total number of indices handed out by the dispatcher. */
+    size_t count() const;
+
+    /** This function takes the next index that has not yet been handed out to any thread in any
+        process, and stores it in \em index. It returns false if all indices have been handed out.
+        The function may be called concurrently from multiple threads. */
+    bool next(size_t& index);
+
+    //======================== Data Members ========================
+
+private:
+    PeerToPeerCommunicator* _comm;  // the communicator
+    size_t _count;                  // the number of indices
+    bool _shared;                   // true if the counter is shared between multiple processes
+    std::atomic<size_t> _local;     // the counter used for a single process
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // CHUNKDISPATCHER_HPP
@@ -0,0 +1,158 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "Array.hpp"
+#include "DataCubeExchange.hpp"
+#include "FatalError.hpp"
+#include "ParallelDataCube.hpp"
+#include "ParallelFactory.hpp"
+#include "PeerToPeerCommunicator.hpp"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // the message tag used for the contribution buffers
+    const int CONTRIBUTION_TAG = 41;
+
+    // the number of contributions in a buffer before it is sent
+    const size_t BUFFER_SIZE = 4096;
+
+    // the encoding of the cube index and the position in a double value, which is exact up to 2^53
+    const double POSITION_RANGE = 1099511627776.;   // 2^40
+    const int MAX_CUBES = 8192;                     // 2^13
+}
+
+////////////////////////////////////////////////////////////////////
+
+DataCubeExchange::DataCubeExchange(PeerToPeerCommunicator* comm, ParallelFactory* parfac)
+    : _comm(comm), _parfac(parfac), _Nprocs(comm->size()), _Nthreads(parfac->maxThreadCount()),
+      _bufferv(_Nthreads*_Nprocs), _transitvv(_Nthreads), _sentv(_Nthreads*_Nprocs), _received(0), _shipped(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////
+
+int DataCubeExchange::registerCube(ParallelDataCube* cube, size_t size)
+{
+    if (_cubes.size() >= static_cast<size_t>(MAX_CUBES))
+        throw FATALERROR("Too many distributed data cubes");
+    if (size >= POSITION_RANGE)
+        throw FATALERROR("Distributed data cube is too large");
+
+    _cubes.push_back(cube);
+    return _cubes.size()-1;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DataCubeExchange::ship(int rank, int cube, size_t position, double value)
+{
+    int thread = _parfac->currentThreadIndex();
+    vector<double>& buffer = _bufferv[thread*_Nprocs + rank];
+    if (buffer.empty()) buffer.reserve(2*BUFFER_SIZE);
+
+    buffer.push_back(cube*POSITION_RANGE + position);
+    buffer.push_back(value);
+    if (buffer.size() >= 2*BUFFER_SIZE)
+    {
+        send(thread, rank);
+
+        // give the other processes the opportunity to proceed
+        receive(false);
+        complete(thread, false);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DataCubeExchange::finish()
+{
+    // send the remaining contributions
+    for (int thread=0; thread<_Nthreads; thread++)
+        for (int rank=0; rank<_Nprocs; rank++)
+            if (!_bufferv[thread*_Nprocs + rank].empty()) send(thread, rank);
+
+    // determine the number of buffers sent to each process by all processes
+    Array sentv(_Nprocs);
+    for (int thread=0; thread<_Nthreads; thread++)
+        for (int rank=0; rank<_Nprocs; rank++)
+            sentv[rank] += _sentv[thread*_Nprocs + rank];
+    _comm->sum_all(sentv);
+
+    // receive the buffers that have not yet arrived; this also lets our own buffers proceed
+    size_t expected = static_cast<size_t>(sentv[_comm->rank()]);
+    while (_received < expected) receive(true);
+
+    // wait for the buffers sent by this process to be received
+    for (int thread=0; thread<_Nthreads; thread++) complete(thread, true);
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t DataCubeExchange::shipped() const
+{
+    return _shipped;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DataCubeExchange::send(int thread, int rank)
+{
+    // move the buffer into the transit list, so that its memory remains valid during the communication
+    vector<double>& buffer = _bufferv[thread*_Nprocs + rank];
+    _transitvv[thread].push_back(Transit());
+    Transit& transit = _transitvv[thread].back();
+    transit.buffer.swap(buffer);
+    transit.handle = _comm->startSend(transit.buffer.data(), transit.buffer.size(), rank, CONTRIBUTION_TAG);
+
+    _sentv[thread*_Nprocs + rank]++;
+    _shipped += transit.buffer.size()/2;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int DataCubeExchange::receive(bool wait)
+{
+    int count = 0;
+    vector<double> buffer;
+    while (_comm->receive(buffer, CONTRIBUTION_TAG, wait && !count))
+    {
+        for (size_t i=0; i<buffer.size(); i+=2)
+        {
+            int cube = static_cast<int>(buffer[i] / POSITION_RANGE);
+            size_t position = static_cast<size_t>(buffer[i] - cube*POSITION_RANGE);
+            _cubes[cube]->addReceived(position, buffer[i+1]);
+        }
+        _received++;
+        count++;
+    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DataCubeExchange::complete(int thread, bool wait)
+{
+    vector<Transit>& transitv = _transitvv[thread];
+    size_t remaining = 0;
+    for (size_t i=0; i<transitv.size(); i++)
+    {
+        if (wait || _comm->testExchange(transitv[i].handle))
+        {
+            _comm->finishExchange(transitv[i].handle);
+        }
+        else
+        {
+            if (remaining != i) swap(transitv[remaining], transitv[i]);
+            remaining++;
+        }
+    }
+    transitv.resize(remaining);
+}
+
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,121 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef DATACUBEEXCHANGE_HPP
+#define DATACUBEEXCHANGE_HPP
+
+#include <atomic>
+#include <vector>
+class ParallelDataCube;
+class ParallelFactory;
+class PeerToPeerCommunicator;
+
+////////////////////////////////////////////////////////////////////
+
+/** A DataCubeExchange object ships the contributions to distributed instrument data cubes that
+    are detected by a process other than the one storing the corresponding wavelength slice. In
+    task parallelization mode, each process launches photon packages at all wavelengths. When the
+    instrument data cubes are nevertheless distributed across the processes (see the
+    ParallelDataCube class), a peel off photon package detected at a foreign wavelength can not be
+    recorded locally. Instead, the contribution is handed to the DataCubeExchange, which collects
+    it in a buffer for the destination process.
+
+    Each thread has a private buffer for each destination process, so that no locking is needed to
+    add a contribution. When a buffer is full, it is sent to the destination process through a
+    non-blocking point-to-point communication, and the thread checks for incoming buffers from
+    other processes, adding their contents to the local slices of the data cubes. Thus the memory
+    used for communication is bounded by the number of threads times the number of processes times
+    the buffer size, plus the buffers that are in transit. At the end of the simulation, all
+    processes call the finish() function, which sends the remaining contributions and waits until
+    every process has received all contributions destined for it.
+
+    The data cubes register themselves with the exchange during setup (see registerCube()). A
+    contribution is identified by the index of the cube in the list of registered cubes and by the
+    position in the complete cube (i.e. the position that would be used if the cube was not
+    distributed), which are encoded together in a single double value. */
+class DataCubeExchange
+{
+    //============= Construction - Setup - Destruction =============
+
+public:
+    /** The constructor creates an exchange for the processes in the specified communicator, with
+        buffers for the maximum number of threads offered by the specified parallel factory. */
+    DataCubeExchange(PeerToPeerCommunicator* comm, ParallelFactory* parfac);
+
+    /** The copy constructor is deleted because the exchange owns the buffers in transit. */
+    DataCubeExchange(const DataCubeExchange&) = delete;
+
+    /** The assignment operator is deleted because the exchange owns the buffers in transit. */
+    DataCubeExchange& operator=(const DataCubeExchange&) = delete;
+
+    //======================== Other Functions =======================
+
+public:
+    /** This function adds the specified data cube to the list of cubes handled by the exchange,
+        and returns its index in the list. All processes must register the same cubes in the same
+        order. The function must be called during setup, before any contributions are shipped. */
+    int registerCube(ParallelDataCube* cube, size_t size);
+
+    /** This function ships the specified value to the process with the specified rank, to be added
+        to the cube with the specified index at the specified position in the complete cube. The
+        function may be called concurrently from multiple threads. */
+    void ship(int rank, int cube, size_t position, double value);
+
+    /** This function sends all contributions remaining in the buffers, and waits until the
+        contributions sent by all other processes to this process have been received and added to
+        the data cubes. It must be called by all processes, outside of any parallel execution,
+        after all photon packages have been detected and before the data cubes are gathered. */
+    void finish();
+
+    /** This function returns the number of contributions shipped by this process to other
+        processes since the exchange was created. */
+    size_t shipped() const;
+
+private:
+    /** This function sends the buffer of the specified thread for the specified destination
+        process. */
+    void send(int thread, int rank);
+
+    /** This function receives any buffers sent to this process and adds their contents to the
+        data cubes. If \em wait is true, it waits until at least one buffer has been received. It
+        returns the number of buffers received. */
+    int receive(bool wait);
+
+    /** This function releases the resources of the buffers sent by the specified thread for which
+        the communication has completed. If \em wait is true, it waits for all communications. */
+    void complete(int thread, bool wait);
+
+    //======================== Data Members ========================
+
+private:
+    // the environment
+    PeerToPeerCommunicator* _comm;
+    ParallelFactory* _parfac;
+    int _Nprocs;
+    int _Nthreads;
+
+    // the registered cubes
+    std::vector<ParallelDataCube*> _cubes;
+
+    // the buffers being filled, indexed on thread and destination process
+    std::vector<std::vector<double>> _bufferv;
+
+    // the buffers in transit for each thread, with the corresponding communication handles
+    struct Transit
+    {
+        int handle;
+        std::vector<double> buffer;
+    };
+    std::vector<std::vector<Transit>> _transitvv;
+
+    // the statistics
+    std::vector<size_t> _sentv;         // the number of buffers sent, indexed on thread and destination process
+    std::atomic<size_t> _received;      // the number of buffers received by this process
+    std::atomic<size_t> _shipped;       // the number of contributions shipped by this process
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // DATACUBEEXCHANGE_HPP
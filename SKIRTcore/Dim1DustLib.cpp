@@ -9,6 +9,7 @@
 #include "ISRF.hpp"
 #include "Log.hpp"
 #include "PanDustSystem.hpp"
+#include "PeerToPeerCommunicator.hpp"
 #include "WavelengthGrid.hpp"
 
 using namespace std;
@@ -27,6 +28,8 @@ void Dim1DustLib::setupSelfBefore()
     DustLib::setupSelfBefore();
 
     if (_NU < 10) throw FATALERROR("there must be at least 10 libary entries");
+    if (find<PeerToPeerCommunicator>()->dataParallel())
+        throw FATALERROR("A one-dimensional dust library cannot be used in data parallelization mode");
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -39,7 +39,9 @@ public:
     Q_INVOKABLE Dim1DustLib();
 
 protected:
-    /** This function verifies the number of library entries. */
+    /** This function verifies the number of library entries, and verifies that data
+        parallelization mode is not enabled, because the library entries are not tied to the dust
+        cells assigned to a process. */
     void setupSelfBefore();
 
     //======== Setters & Getters for Discoverable Attributes =======
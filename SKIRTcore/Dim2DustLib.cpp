@@ -4,11 +4,16 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <cfloat>
+#include "ArrayTable.hpp"
 #include "Dim2DustLib.hpp"
 #include "DustMix.hpp"
 #include "FatalError.hpp"
 #include "Log.hpp"
 #include "PanDustSystem.hpp"
+#include "Parallel.hpp"
+#include "ParallelFactory.hpp"
+#include "ParallelTarget.hpp"
+#include "PeerToPeerCommunicator.hpp"
 #include "Units.hpp"
 #include "WavelengthGrid.hpp"
 
@@ -28,6 +33,8 @@ void Dim2DustLib::setupSelfBefore()
     DustLib::setupSelfBefore();
 
     if (_NT < 3 || _NW < 3) throw FATALERROR("there must be at least 3 library grid points in each dimension");
+    if (find<PeerToPeerCommunicator>()->dataParallel())
+        throw FATALERROR("A two-dimensional dust library cannot be used in data parallelization mode");
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -67,56 +74,190 @@ int Dim2DustLib::entries() const
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the number of dust cells handled by a single invocation of the parallel loop body
+    const int cellsPerBlock = 1024;
+
+    // a parallel target that calculates the mean temperature and the mean wavelength of the radiation
+    // field in each dust cell, for the blocks of dust cells assigned to this process, and the smallest
+    // and largest values encountered by each thread
+    class SignatureCalculator : public ParallelTarget
+    {
+    private:
+        // data members initialized in constructor
+        const PanDustSystem* _ds;
+        const ParallelFactory* _parfac;
+        int _Ncells;
+        int _Ncomp;
+        int _Nlambda;
+        int _rank;              // the rank of this process
+        int _Nprocs;            // the number of processes
+        ArrayTable<2> _w0vv;    // the weights sigmaabs*dlambda, indexed on h and ell
+        ArrayTable<2> _w1vv;    // the weights sigmaabs*lambda*dlambda, indexed on h and ell
+        ArrayTable<2> _extremavv;   // Tmin, Tmax, lambdamin and lambdamax, indexed on thread
+
+        // output arrays (writable references)
+        Array& _Tmeanv;         // mean temperature, indexed on m
+        Array& _lambdameanv;    // mean wavelength, indexed on m
+
+    public:
+        // constructor
+        SignatureCalculator(const PanDustSystem* ds, Array& Tmeanv, Array& lambdameanv)
+            : _ds(ds), _Tmeanv(Tmeanv), _lambdameanv(lambdameanv)
+        {
+            WavelengthGrid* lambdagrid = ds->find<WavelengthGrid>();
+            PeerToPeerCommunicator* comm = ds->find<PeerToPeerCommunicator>();
+            _parfac = ds->find<ParallelFactory>();
+            _Ncells = ds->Ncells();
+            _Ncomp = ds->Ncomp();
+            _Nlambda = lambdagrid->Nlambda();
+            _rank = comm->rank();
+            _Nprocs = comm->size();
+
+            // precalculate the weights for the integrals over the radiation field for each dust mix
+            _w0vv.resize(_Ncomp,_Nlambda);
+            _w1vv.resize(_Ncomp,_Nlambda);
+            for (int h=0; h<_Ncomp; h++)
+            {
+                for (int ell=0; ell<_Nlambda; ell++)
+                {
+                    double sigmadlambda = ds->mix(h)->sigmaabs(ell) * lambdagrid->dlambda(ell);
+                    _w0vv(h,ell) = sigmadlambda;
+                    _w1vv(h,ell) = sigmadlambda * lambdagrid->lambda(ell);
+                }
+            }
+
+            // initialize the extremes for each thread
+            int Nthreads = _parfac->maxThreadCount();
+            _extremavv.resize(Nthreads,4);
+            for (int t=0; t<Nthreads; t++)
+            {
+                _extremavv(t,0) = DBL_MAX;
+                _extremavv(t,2) = DBL_MAX;
+            }
+        }
+
+        // returns the number of blocks assigned to this process;
+        // the blocks are assigned to the processes in a staggered manner
+        size_t blocks() const
+        {
+            int Nblocks = (_Ncells + cellsPerBlock - 1) / cellsPerBlock;
+            return _rank < Nblocks ? (Nblocks - _rank + _Nprocs - 1) / _Nprocs : 0;
+        }
+
+        // the parallized loop body; calculates the signatures for a block of dust cells
+        void body(size_t index)
+        {
+            int block = _rank + static_cast<int>(index)*_Nprocs;
+            int mbegin = block*cellsPerBlock;
+            int mend = min(_Ncells, mbegin+cellsPerBlock);
+
+            double Tmin = DBL_MAX;
+            double Tmax = 0.0;
+            double lambdamin = DBL_MAX;
+            double lambdamax = 0.0;
+            Array Jv(_Nlambda);
+            for (int m=mbegin; m<mend; m++)
+            {
+                if (_ds->Labs(m) > 0.0)
+                {
+                    _ds->meanintensityv(Jv, m);
+                    double Tmean = 0.;
+                    double lambdamean = 0.;
+                    double sumrho = 0.;
+                    for (int h=0; h<_Ncomp; h++)
+                    {
+                        const Array& w0v = _w0vv[h];
+                        const Array& w1v = _w1vv[h];
+                        double sum0 = 0.0;
+                        double sum1 = 0.0;
+                        for (int ell=0; ell<_Nlambda; ell++)
+                        {
+                            sum0 += w0v[ell] * Jv[ell];
+                            sum1 += w1v[ell] * Jv[ell];
+                        }
+                        double rho = _ds->density(m,h);
+                        Tmean += rho * _ds->mix(h)->invplanckabs(sum0);
+                        lambdamean += rho * (sum1/sum0);
+                        sumrho += rho;
+                    }
+                    Tmean /= sumrho;
+                    lambdamean /= sumrho;
+                    _Tmeanv[m] = Tmean;
+                    _lambdameanv[m] = lambdamean;
+
+                    Tmin = min(Tmin,Tmean);
+                    Tmax = max(Tmax,Tmean);
+                    lambdamin = min(lambdamin,lambdamean);
+                    lambdamax = max(lambdamax,lambdamean);
+                }
+            }
+
+            // each thread only updates its own extremes, so no locking is needed
+            Array& extremav = _extremavv[_parfac->currentThreadIndex()];
+            extremav[0] = min(extremav[0],Tmin);
+            extremav[1] = max(extremav[1],Tmax);
+            extremav[2] = min(extremav[2],lambdamin);
+            extremav[3] = max(extremav[3],lambdamax);
+        }
+
+        // stores the extremes over all threads in the four elements of the specified array starting at
+        // index 4*rank, where rank is the rank of this process; the other elements remain untouched
+        void extremes(Array& extremav) const
+        {
+            extremav[4*_rank] = DBL_MAX;
+            extremav[4*_rank+1] = 0.0;
+            extremav[4*_rank+2] = DBL_MAX;
+            extremav[4*_rank+3] = 0.0;
+            for (size_t t=0; t<_extremavv.size(0); t++)
+            {
+                extremav[4*_rank] = min(extremav[4*_rank],_extremavv(t,0));
+                extremav[4*_rank+1] = max(extremav[4*_rank+1],_extremavv(t,1));
+                extremav[4*_rank+2] = min(extremav[4*_rank+2],_extremavv(t,2));
+                extremav[4*_rank+3] = max(extremav[4*_rank+3],_extremavv(t,3));
+            }
+        }
+    };
+}
+
+////////////////////////////////////////////////////////////////////
+
 std::vector<int> Dim2DustLib::mapping() const
 {
-    // get basic information about the wavelength grid and the dust system
-    WavelengthGrid* lambdagrid = find<WavelengthGrid>();
+    // get basic information about the dust system
     PanDustSystem* ds = find<PanDustSystem>();
-    int Nlambda = lambdagrid->Nlambda();
     int Ncells = ds->Ncells();
-    int Ncomp = ds->Ncomp();
     Log* log = find<Log>();
     Units* units = find<Units>();
 
-    // calculate the properties of the ISRF in all cells of the dust system;
+    // calculate the properties of the ISRF in all cells of the dust system, distributing blocks of cells
+    // over the threads and the processes; the blocks not handled by this process remain zero
+    PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
+    int Nprocs = comm->size();
+    Array Tmeanv(Ncells);
+    Array lambdameanv(Ncells);
+    Array extremav(4*Nprocs);
+    SignatureCalculator calc(ds, Tmeanv, lambdameanv);
+    find<ParallelFactory>()->parallel()->call(&calc, calc.blocks());
+    calc.extremes(extremav);
+
+    // combine the results of all processes; each block, and each set of extremes, is handled by exactly one process
+    comm->sum_all(Tmeanv);
+    comm->sum_all(lambdameanv);
+    comm->sum_all(extremav);
+
     // determine the minimum and maximum values of the mean temperature and mean wavelength
     double Tmin = DBL_MAX;
     double Tmax = 0.0;
     double lambdamin = DBL_MAX;
     double lambdamax = 0.0;
-    Array Tmeanv(Ncells);
-    Array lambdameanv(Ncells);
-    for (int m=0; m<Ncells; m++)
+    for (int rank=0; rank<Nprocs; rank++)
     {
-        if (ds->Labs(m) > 0.0)
-        {
-            const Array& Jv = ds->meanintensityv(m);
-            double sumrho = 0.;
-            for (int h=0; h<Ncomp; h++)
-            {
-                double sum0 = 0.0;
-                double sum1 = 0.0;
-                for (int ell=0; ell<Nlambda; ell++)
-                {
-                    double lambda = lambdagrid->lambda(ell);
-                    double dlambda = lambdagrid->dlambda(ell);
-                    double sigmaJ = ds->mix(h)->sigmaabs(ell) * Jv[ell];
-                    sum0 += sigmaJ * dlambda;
-                    sum1 += sigmaJ * lambda * dlambda;
-                }
-                double rho = ds->density(m,h);
-                Tmeanv[m] += rho * ds->mix(h)->invplanckabs(sum0);
-                lambdameanv[m] += rho * (sum1/sum0);
-                sumrho += rho;
-            }
-            Tmeanv[m] /= sumrho;
-            lambdameanv[m] /= sumrho;
-
-            Tmin = min(Tmin,Tmeanv[m]);
-            Tmax = max(Tmax,Tmeanv[m]);
-            lambdamin = min(lambdamin,lambdameanv[m]);
-            lambdamax = max(lambdamax,lambdameanv[m]);
-        }
+        Tmin = min(Tmin,extremav[4*rank]);
+        Tmax = max(Tmax,extremav[4*rank+1]);
+        lambdamin = min(lambdamin,extremav[4*rank+2]);
+        lambdamax = max(lambdamax,extremav[4*rank+3]);
     }
     log->info("Temperatures vary"
               " from T = " + QString::number(units->otemperature(Tmin)) + " " + units->utemperature() +
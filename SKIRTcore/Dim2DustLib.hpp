@@ -54,7 +54,9 @@ public:
     Q_INVOKABLE Dim2DustLib();
 
 protected:
-    /** This function verifies the number of grid points for each dimension. */
+    /** This function verifies the number of grid points for each dimension, and verifies that
+        data parallelization mode is not enabled, because the library entries are not tied to the
+        dust cells assigned to a process. */
     void setupSelfBefore();
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -93,7 +95,13 @@ protected:
         {\bar{\lambda}}_{\text{min}} \left( \frac{ {\bar{\lambda}}_{\text{max}} }{
         {\bar{\lambda}}_{\text{min}} } \right)^{j/N_{\bar{\lambda}}} \qquad
         j=0,\ldots,N_{\bar{\lambda}}. \f] The function then calculates for each cell \f$m\f$ its
-        library entry \f$n \equiv (i,j)\f$. */
+        library entry \f$n \equiv (i,j)\f$.
+
+        The calculation of \f${\bar{T}}_m\f$ and \f${\bar{\lambda}}_m\f$ is performed for blocks
+        of dust cells, which are distributed over the parallel threads and over the processes. The
+        integrals over the radiation field use precalculated weights for each dust component. The
+        smallest and largest values are determined by each thread, and the results of all
+        processes are then combined, so that each process obtains the complete mapping. */
     std::vector<int> mapping() const;
 
     //======================== Data Members ========================
@@ -19,3 +19,9 @@ int DustEmissivity::logfrequency() const
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void DustEmissivity::libraryCalculated()
+{
+}
+
+////////////////////////////////////////////////////////////////////
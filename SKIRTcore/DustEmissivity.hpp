@@ -44,6 +44,12 @@ public:
         frequency. The function's implementation in this class returns zero, which means no logging
         is needed. */
     virtual int logfrequency() const;
+
+    /** This function is invoked by the dust library each time it has finished (re-)calculating the
+        emissivities for all of its library entries. It allows a subclass that keeps information
+        across invocations of emissivity() to report statistics or to store this information. The
+        implementation in this class does nothing. */
+    virtual void libraryCalculated();
 };
 
 ////////////////////////////////////////////////////////////////////
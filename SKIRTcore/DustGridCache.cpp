@@ -0,0 +1,301 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cstring>
+#include <QFileInfo>
+#include <QMetaMethod>
+#include <QTemporaryFile>
+#include "Array.hpp"
+#include "DustGridCache.hpp"
+#include "FatalError.hpp"
+#include "FilePaths.hpp"
+#include "Log.hpp"
+#include "PeerToPeerCommunicator.hpp"
+#include "SimulationItem.hpp"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////
+
+const char DustGridCache::SIGNATURE[8] = { 'S', 'K', 'I', 'R', 'T', 'G', 'R', 'D' };
+
+////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // returns the value of the specified type stored at the specified address, which may be unaligned
+    template<typename T> T extract(const uchar* address)
+    {
+        T value;
+        memcpy(&value, address, sizeof(T));
+        return value;
+    }
+
+    // returns the specified size rounded up to a multiple of eight bytes
+    size_t padded(size_t size)
+    {
+        return (size+7) & ~static_cast<size_t>(7);
+    }
+
+    // returns the type name of the getter for the specified property, or the empty string if there is no getter
+    QByteArray getterType(const QMetaObject* meta, const char* property)
+    {
+        QByteArray signature = QByteArray(property) + "()";
+        for (int index = 0; index < meta->methodCount(); index++)
+        {
+            QMetaMethod method = meta->method(index);
+            if (!strcmp(method.methodSignature().constData(), signature.constData())) return method.typeName();
+        }
+        return QByteArray();
+    }
+
+    // adds the specified string to the hash, terminated by a null character to separate it from what follows
+    void addString(QCryptographicHash& hash, QByteArray value)
+    {
+        hash.addData(value.constData(), value.size()+1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+DustGridCache::DustGridCache(const SimulationItem* item)
+    : _item(item), _hash(QCryptographicHash::Sha1), _map(0), _Ncomp(0), _Ncells(0),
+      _structureSize(0), _volumesOffset(0)
+{
+    addString(_hash, QByteArray(SIGNATURE, sizeof(SIGNATURE)));
+    addString(_hash, QByteArray::number(VERSION));
+}
+
+////////////////////////////////////////////////////////////////////
+
+DustGridCache::~DustGridCache()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DustGridCache::addItem(const SimulationItem* item)
+{
+    if (!item)
+    {
+        addString(_hash, "null");
+        return;
+    }
+
+    // the getters are invoked through the meta-object system, which requires a non-const object
+    SimulationItem* target = const_cast<SimulationItem*>(item);
+    const QMetaObject* meta = item->metaObject();
+    addString(_hash, meta->className());
+
+    for (int index = 0; index < meta->classInfoCount(); index++)
+    {
+        QMetaClassInfo info = meta->classInfo(index);
+        if (strcmp(info.name(), "Property")) continue;
+        const char* property = info.value();
+        QByteArray type = getterType(meta, property);
+        addString(_hash, property);
+
+        if (type == "bool")
+        {
+            bool value = false;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument("bool", &value));
+            addString(_hash, value ? "true" : "false");
+        }
+        else if (type == "double")
+        {
+            double value = 0;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument("double", &value));
+            addString(_hash, QByteArray::number(value, 'g', 17));
+        }
+        else if (type == "QList<double>")
+        {
+            QList<double> value;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument("QList<double>", &value));
+            foreach (double element, value) addString(_hash, QByteArray::number(element, 'g', 17));
+        }
+        else if (type == "QString")
+        {
+            QString value;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument("QString", &value));
+            addString(_hash, value.toUtf8());
+
+            // if the string names an input file, include the contents of the file
+            QFile file(item->find<FilePaths>()->input(value));
+            if (!value.isEmpty() && QFileInfo(file.fileName()).isFile() && file.open(QIODevice::ReadOnly))
+                _hash.addData(&file);
+        }
+        else if (type.endsWith("*>"))
+        {
+            QList<SimulationItem*> value;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument(type.constData(), &value));
+            foreach (SimulationItem* element, value) addItem(element);
+        }
+        else if (type.endsWith("*"))
+        {
+            SimulationItem* value = 0;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument(type.constData(), &value));
+            addItem(value);
+        }
+        else if (!type.isEmpty())   // int or enumeration
+        {
+            int value = 0;
+            QMetaObject::invokeMethod(target, property, QGenericReturnArgument(type.constData(), &value));
+            addString(_hash, QByteArray::number(value));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DustGridCache::addValue(QString name, double value)
+{
+    addString(_hash, name.toUtf8());
+    addString(_hash, QByteArray::number(value, 'g', 17));
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool DustGridCache::open()
+{
+    close();
+    Log* log = _item->find<Log>();
+    _filepath = _item->find<FilePaths>()->cache(QString::fromLatin1(_hash.result().toHex()) + ".grid");
+    _file.setFileName(_filepath);
+
+    if (!_file.exists())
+    {
+        log->info("Dust grid cache miss: there is no cache file " + _filepath);
+        return false;
+    }
+
+    // map the complete file into memory and verify the header
+    qint64 filesize = _file.size();
+    if (_file.open(QIODevice::ReadOnly) && filesize >= static_cast<qint64>(HEADERSIZE))
+        _map = _file.map(0, filesize);
+    if (_map && !memcmp(_map, SIGNATURE, sizeof(SIGNATURE)) && extract<uint32_t>(_map+8) == VERSION)
+    {
+        _Ncomp = extract<uint32_t>(_map+12);
+        _Ncells = extract<uint64_t>(_map+16);
+        _structureSize = extract<uint64_t>(_map+24);
+        _volumesOffset = HEADERSIZE + padded(_structureSize);
+        if (static_cast<size_t>(filesize) == _volumesOffset + _Ncells*(_Ncomp+1)*sizeof(double))
+        {
+            log->info("Dust grid cache hit: reading the dust grid from cache file " + _filepath);
+            return true;
+        }
+    }
+
+    log->warning("Dust grid cache miss: ignoring invalid cache file " + _filepath);
+    close();
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool DustGridCache::hit() const
+{
+    return _map != 0;
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t DustGridCache::numCells() const
+{
+    return _Ncells;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int DustGridCache::numComponents() const
+{
+    return _Ncomp;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const char* DustGridCache::structure() const
+{
+    return reinterpret_cast<const char*>(_map + HEADERSIZE);
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t DustGridCache::structureSize() const
+{
+    return _structureSize;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const double* DustGridCache::volumes() const
+{
+    return reinterpret_cast<const double*>(_map + _volumesOffset);
+}
+
+////////////////////////////////////////////////////////////////////
+
+const double* DustGridCache::densities() const
+{
+    return volumes() + _Ncells;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DustGridCache::write(const vector<char>& structure, const Array& volumev, const Array& rhov, int Ncomp)
+{
+    close();
+    if (!_item->find<PeerToPeerCommunicator>()->isRoot()) return;
+    _item->find<Log>()->info("Writing dust grid cache file " + _filepath + "...");
+
+    // assemble the header
+    char header[HEADERSIZE];
+    uint32_t version = VERSION;
+    uint32_t ncomp = Ncomp;
+    uint64_t ncells = volumev.size();
+    uint64_t structuresize = structure.size();
+    memcpy(header, SIGNATURE, sizeof(SIGNATURE));
+    memcpy(header+8, &version, sizeof(uint32_t));
+    memcpy(header+12, &ncomp, sizeof(uint32_t));
+    memcpy(header+16, &ncells, sizeof(uint64_t));
+    memcpy(header+24, &structuresize, sizeof(uint64_t));
+
+    // write the file under a temporary name in the cache directory
+    QTemporaryFile file(_filepath + ".XXXXXX");
+    file.setAutoRemove(false);
+    vector<char> padding(padded(structure.size()) - structure.size(), 0);
+    bool success = file.open()
+            && file.write(header, HEADERSIZE) == static_cast<qint64>(HEADERSIZE)
+            && file.write(structure.data(), structure.size()) == static_cast<qint64>(structure.size())
+            && file.write(padding.data(), padding.size()) == static_cast<qint64>(padding.size())
+            && file.write(reinterpret_cast<const char*>(&volumev[0]), ncells*sizeof(double))
+                                                        == static_cast<qint64>(ncells*sizeof(double))
+            && file.write(reinterpret_cast<const char*>(&rhov[0]), rhov.size()*sizeof(double))
+                                                        == static_cast<qint64>(rhov.size()*sizeof(double));
+    file.close();
+
+    // replace any existing file with the same name (which has the same contents) by the new file
+    QFile::remove(_filepath);
+    if (!success || !file.rename(_filepath))
+    {
+        QFile::remove(file.fileName());
+        _item->find<Log>()->warning("Could not write dust grid cache file " + _filepath);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void DustGridCache::close()
+{
+    if (_map) _file.unmap(const_cast<uchar*>(_map));
+    _file.close();
+    _map = 0;
+    _Ncomp = 0;
+    _Ncells = 0;
+    _structureSize = 0;
+    _volumesOffset = 0;
+}
+
+////////////////////////////////////////////////////////////////////
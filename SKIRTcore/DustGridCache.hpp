@@ -0,0 +1,147 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef DUSTGRIDCACHE_HPP
+#define DUSTGRIDCACHE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <QCryptographicHash>
+#include <QFile>
+class Array;
+class SimulationItem;
+
+////////////////////////////////////////////////////////////////////
+
+/** This class manages a single file in the dust grid cache, a directory with binary files that
+    hold the constructed dust grid structure, the cell volumes and the cell densities of earlier
+    simulation runs. The cache is enabled by specifying a cache directory (see
+    FilePaths::setCachePath()); the DustSystem class then uses a DustGridCache object to avoid
+    repeating the dust grid setup when only other aspects of the simulation (such as the
+    instruments, the wavelength grid or the stellar components) have changed.
+
+    The name of the cache file is derived from a SHA-1 hash of a key. The key includes the class
+    names and property values of the complete simulation item subtrees added with the addItem()
+    function, and any additional values added with the addValue() function. If a string property
+    names an existing input file, the contents of that file are included in the key as well, so
+    that a changed input file leads to a different cache file. The cache file is never updated;
+    a new file is created for each new key, and stale files must be removed by the user.
+
+    A cache file consists of a 32-byte header followed by three data sections. All integers and
+    floating point values are stored in the native byte order and memory layout, so that a cache
+    file can be reused only on a compatible computer. The header consists of:
+      - the 8-byte signature \c SKIRTGRD;
+      - a 4-byte unsigned integer holding the format version, currently 1;
+      - a 4-byte unsigned integer holding the number of dust components \f$N_\text{comp}\f$;
+      - an 8-byte unsigned integer holding the number of dust cells \f$N_\text{cells}\f$;
+      - an 8-byte unsigned integer holding the size in bytes of the grid structure data.
+
+    The header is followed by the grid structure data as produced by the dust grid (see the
+    DustGridStructureInterface class), padded with null bytes to a multiple of eight bytes, then
+    by the \f$N_\text{cells}\f$ cell volumes, and finally by the \f$N_\text{cells}\times
+    N_\text{comp}\f$ cell densities, indexed on cell and then on component. The file is
+    memory-mapped while it is being read, and it is automatically unmapped and closed when the
+    object is destructed. */
+class DustGridCache
+{
+    //=============== Construction - Destruction  ==================
+
+public:
+    /** The constructor initializes the key for a new cache file. The \em item argument specifies a
+        simulation item in the hierarchy of the caller (usually the caller itself) used to retrieve
+        the input and cache file paths, an appropriate logger, and the process communicator. */
+    explicit DustGridCache(const SimulationItem* item);
+
+    /** The destructor unmaps and closes the cache file, if it is open. */
+    ~DustGridCache();
+
+    /** The copy constructor is deleted because the object owns the file mapping. */
+    DustGridCache(const DustGridCache&) = delete;
+
+    /** The assignment operator is deleted because the object owns the file mapping. */
+    DustGridCache& operator=(const DustGridCache&) = delete;
+
+    //====================== Other functions =======================
+
+public:
+    /** This function adds the class name and the values of all discoverable properties of the
+        specified simulation item to the key, and recursively does the same for all simulation items
+        referred to by these properties. */
+    void addItem(const SimulationItem* item);
+
+    /** This function adds the specified named value to the key. */
+    void addValue(QString name, double value);
+
+    /** This function determines the name of the cache file from the key constructed so far, and
+        then opens and memory-maps the file if it exists. If the file is present and valid, the
+        function logs a cache hit and returns true. Otherwise, the function logs a cache miss and
+        returns false. */
+    bool open();
+
+    /** This function returns true if open() has found a valid cache file, and false otherwise. */
+    bool hit() const;
+
+    /** This function returns the number of dust cells in the cache file. */
+    size_t numCells() const;
+
+    /** This function returns the number of dust components in the cache file. */
+    int numComponents() const;
+
+    /** This function returns a pointer to the grid structure data in the cache file. */
+    const char* structure() const;
+
+    /** This function returns the size in bytes of the grid structure data in the cache file, or
+        zero if the dust grid did not provide its structure. */
+    size_t structureSize() const;
+
+    /** This function returns a pointer to the \f$N_\text{cells}\f$ cell volumes in the cache file.
+        */
+    const double* volumes() const;
+
+    /** This function returns a pointer to the \f$N_\text{cells}\times N_\text{comp}\f$ cell
+        densities in the cache file, indexed on cell and then on component. */
+    const double* densities() const;
+
+    /** This function writes a new cache file with the specified contents, using the file name
+        determined by open(). The \em structure vector holds the grid structure data (it may be
+        empty), the \em volumev array holds the cell volumes, and the \em rhov array holds the
+        cell densities indexed on cell and then on component. To avoid conflicts between processes
+        or between simulations running concurrently, the file is written only by the root process,
+        and it is first written under a temporary name and then renamed. */
+    void write(const std::vector<char>& structure, const Array& volumev, const Array& rhov, int Ncomp);
+
+    /** This function unmaps and closes the cache file, if it is open. The pointers returned by
+        structure(), volumes() and densities() are invalidated. */
+    void close();
+
+    //========================= Constants ==========================
+
+public:
+    /** The signature at the start of every cache file. */
+    static const char SIGNATURE[8];
+
+    /** The current version of the cache file format. */
+    static const uint32_t VERSION = 1;
+
+    /** The size of the header in bytes. */
+    static const size_t HEADERSIZE = 32;
+
+    //======================== Data members ========================
+
+private:
+    const SimulationItem* _item;
+    QCryptographicHash _hash;
+    QString _filepath;
+    QFile _file;
+    const uchar* _map;
+    int _Ncomp;
+    size_t _Ncells;
+    size_t _structureSize;
+    size_t _volumesOffset;
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // DUSTGRIDCACHE_HPP
@@ -6,6 +6,7 @@
 #include "DustGridPath.hpp"
 #include "Box.hpp"
 #include "NR.hpp"
+#include <algorithm>
 #include <limits>
 
 using namespace std;
@@ -19,18 +20,29 @@ namespace
 
 //////////////////////////////////////////////////////////////////////
 
+void DustGridPath::reserve(int capacity)
+{
+    _mv.reserve(capacity);
+    _dsv.reserve(capacity);
+    _sv.reserve(capacity);
+    _dtauv.reserve(capacity);
+    _tauv.reserve(capacity);
+}
+
+//////////////////////////////////////////////////////////////////////
+
 DustGridPath::DustGridPath(const Position& bfr, const Direction& bfk)
-    : _bfr(bfr), _bfk(bfk), _s(0)
+    : _bfr(bfr), _bfk(bfk), _mr(-1), _s(0)
 {
-    _v.reserve(INITIAL_CAPACITY);
+    reserve(INITIAL_CAPACITY);
 }
 
 //////////////////////////////////////////////////////////////////////
 
 DustGridPath::DustGridPath()
-    : _s(0)
+    : _mr(-1), _s(0)
 {
-    _v.reserve(INITIAL_CAPACITY);
+    reserve(INITIAL_CAPACITY);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -38,7 +50,21 @@ DustGridPath::DustGridPath()
 void DustGridPath::clear()
 {
     _s = 0;
-    _v.clear();
+    _mv.clear();
+    _dsv.clear();
+    _sv.clear();
+    _dtauv.clear();
+    _tauv.clear();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void DustGridPath::propagate(double s)
+{
+    // locate the first segment that ends at or beyond the new position
+    auto segment = std::lower_bound(_sv.begin(), _sv.end(), s);
+    _mr = segment != _sv.end() ? _mv[segment - _sv.begin()] : -1;
+    _bfr += s*_bfk;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -48,7 +74,11 @@ void DustGridPath::addSegment(int m, double ds)
     if (ds>0)
     {
         _s += ds;
-        _v.push_back(Segment{m,ds,_s,0,0});
+        _mv.push_back(m);
+        _dsv.push_back(ds);
+        _sv.push_back(_s);
+        _dtauv.push_back(0);
+        _tauv.push_back(0);
     }
 }
 
@@ -151,23 +181,32 @@ Position DustGridPath::moveInside(const Box& box, double eps)
 
 //////////////////////////////////////////////////////////////////////
 
+void DustGridPath::fillOpticalDepthFromTable(const double* table, double factor)
+{
+    int N = _mv.size();
+    OpticalDepthKernel::gather(table, factor, _mv.data(), _dsv.data(), _dtauv.data(), N);
+    OpticalDepthKernel::cumulate(_dtauv.data(), _tauv.data(), N);
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double DustGridPath::tau() const
 {
-    int N = _v.size();
-    return N ? _v[N-1].tau : 0;
+    int N = _mv.size();
+    return N ? _tauv[N-1] : 0;
 }
 
 //////////////////////////////////////////////////////////////////////
 
 double DustGridPath::pathlength(double tau) const
 {
-    int N = _v.size();
+    int N = _mv.size();
     if (N>0 && tau>0)
     {
-        int i = NR::locate(_v,Segment{0,0,0,0,tau});
-        if (i<0) return NR::interpolate_linlin(tau, 0, _v[0].tau, 0, _v[0].s);
-        if (i<N-1) return NR::interpolate_linlin(tau, _v[i].tau, _v[i+1].tau, _v[i].s, _v[i+1].s);
-        return _v[N-1].s;
+        int i = NR::locate(_tauv,tau);
+        if (i<0) return NR::interpolate_linlin(tau, 0, _tauv[0], 0, _sv[0]);
+        if (i<N-1) return NR::interpolate_linlin(tau, _tauv[i], _tauv[i+1], _sv[i], _sv[i+1]);
+        return _sv[N-1];
     }
     return 0;
 }
@@ -9,6 +9,7 @@
 #include <cfloat>
 #include <vector>
 #include "Direction.hpp"
+#include "OpticalDepthKernel.hpp"
 #include "Position.hpp"
 class Box;
 
@@ -23,7 +24,18 @@ class Box;
     properties in each cell (at a particular wavelength), one can also calculate optical depth
     information for the path. A DustGridPath object keeps record of the optical depth
     \f$\Delta\tau\f$ along the path segment within each cell, and the optical depth \f$\tau\f$
-    along the entire path up to the end of the cell. */
+    along the entire path up to the end of the cell.
+
+    A DustGridPath object also remembers the number of the cell containing its initial position,
+    if known. This information is established by the propagate() function, which moves the initial
+    position along the path that has already been calculated, and thus knows the cell in which the
+    new position lies. Dust grids that support it (TreeDustGrid and VoronoiDustGrid) use this
+    information as a hint to avoid a full cell search when calculating the next path from the new
+    position.
+
+    The information for the path segments is stored in structure-of-arrays layout, i.e. in a
+    separate contiguous array for each quantity, so that the optical depth calculations can be
+    performed by the vectorized kernels offered by the OpticalDepthKernel namespace. */
 class DustGridPath
 {
 public:
@@ -39,8 +51,13 @@ public:
         setDirection() functions to set these properties to appropriate values. */
     DustGridPath();
 
-    /** This function sets the initial position of the path to a new value. */
-    void setPosition(const Position& bfr) { _bfr = bfr; }
+    /** This function sets the initial position of the path to a new value. The cell containing
+        the new position is marked as unknown. */
+    void setPosition(const Position& bfr) { _bfr = bfr; _mr = -1; }
+
+    /** This function sets the initial position of the path to a new value, and specifies the
+        number of the cell containing the new position (or -1 if it is unknown). */
+    void setPosition(const Position& bfr, int m) { _bfr = bfr; _mr = m; }
 
     /** This function sets the propagation direction along the path to a new value. */
     void setDirection(const Direction& bfk) { _bfk = bfk; }
@@ -51,6 +68,19 @@ public:
     /** This function returns the propagation direction along the path. */
     Direction direction() const { return _bfk; }
 
+    /** This function returns the number of the cell containing the initial position of the path,
+        or -1 if this cell is unknown. The value is just a hint; a dust grid using it should verify
+        that the cell indeed contains the initial position. */
+    int initialCell() const { return _mr; }
+
+    /** This function moves the initial position of the path over a physical distance \f$s\f$
+        along the propagation direction, from \f${\bf{r}}\f$ to \f${\bf{r}}+s\,{\bf{k}}\f$. It
+        assumes that the path segments are still valid for the old initial position. The function
+        determines the segment containing the new position, and remembers the corresponding cell
+        number as the cell containing the new initial position (see initialCell()). The path
+        segments themselves are not updated, and thus become invalid. */
+    void propagate(double s);
+
     // ------- Handling geometric data on path segments -------
 
     /** This function removes all path segments, resulting in an empty path with the original
@@ -72,18 +102,18 @@ public:
     Position moveInside(const Box &box, double eps);
 
     /** This function returns the number of cells crossed along the path. */
-    int size() const { return _v.size(); }
+    int size() const { return _mv.size(); }
 
     /** This function returns the cell number \f$m\f$ for segment \f$i\f$ in the path. */
-    int m(int i) const { return _v[i].m; }
+    int m(int i) const { return _mv[i]; }
 
     /** This function returns the path length covered within the cell in segment \f$i\f$ in the
         path. */
-    double ds(int i) const { return _v[i].ds; }
+    double ds(int i) const { return _dsv[i]; }
 
     /** This function returns the path length covered from the initial position of the path until
         the end point of the cell in segment \f$i\f$ in the path. */
-    double s(int i) const { return _v[i].s; }
+    double s(int i) const { return _sv[i]; }
 
     // ------- Handling data on optical depth -------
 
@@ -96,13 +126,12 @@ public:
         information in the path is neither used nor stored. */
     template<typename Functor> double opticalDepth(Functor kapparho, double distance=DBL_MAX) const
     {
-        int N = _v.size();
+        int N = _mv.size();
         double tau = 0;
         for (int i=0; i<N; i++)
         {
-            const Segment& segment = _v[i];
-            tau += kapparho(segment.m) * segment.ds;
-            if (segment.s > distance) break;
+            tau += kapparho(_mv[i]) * _dsv[i];
+            if (_sv[i] > distance) break;
         }
         return tau;
     }
@@ -113,29 +142,32 @@ public:
         the path object, and the multiplication factors \f$(\kappa\rho)_{m_i}\f$ provided by the
         caller through a call-back function, where \f$m_i\f$ is the number of the dust cell being
         crossed in path segment \f$i\f$. The call-back function must have the signature "double
-        kapparho(int m)". */
+        kapparho(int m)". The calculation proceeds in two passes: the first pass stores the
+        optical depth of each segment in a contiguous array, and the second pass calculates the
+        cumulative optical depths using the OpticalDepthKernel::cumulate() kernel. */
     template<typename Functor> inline void fillOpticalDepth(Functor kapparho)
     {
-        int N = _v.size();
-        double tau = 0;
-        for (int i=0; i<N; i++)
-        {
-            Segment& segment = _v[i];
-            double dtau = kapparho(segment.m) * segment.ds;
-            tau += dtau;
-            segment.dtau = dtau;
-            segment.tau = tau;
-        }
+        int N = _mv.size();
+        for (int i=0; i<N; i++) _dtauv[i] = kapparho(_mv[i]) * _dsv[i];
+        OpticalDepthKernel::cumulate(_dtauv.data(), _tauv.data(), N);
     }
 
+    /** This function calculates and stores the optical depth details for the path as described
+        for the fillOpticalDepth() function, except that the multiplication factors
+        \f$(\kappa\rho)_{m}\f$ are obtained as \f$f\,t_m\f$, where \f$t\f$ is the specified table
+        indexed on cell number and \f$f\f$ is the specified factor. This allows the first pass to
+        load the table values for all segments with the OpticalDepthKernel::gather() kernel, which
+        uses hardware gather instructions where available. */
+    void fillOpticalDepthFromTable(const double* table, double factor = 1.);
+
     /** This function returns the optical depth covered within the cell in segment $i$ in the path.
         It assumes that the fillOpticalDepth() function was previously invoked for the path. */
-    double dtau(int i) const { return _v[i].dtau; }
+    double dtau(int i) const { return _dtauv[i]; }
 
     /** This function returns the optical depth covered from the initial position of the path until
         the end point of the cell in segment $i$ in the path. It assumes that the
         fillOpticalDepth() function was previously invoked for the path. */
-    double tau(int i) const { return _v[i].tau; }
+    double tau(int i) const { return _tauv[i]; }
 
     /** This function returns the total optical depth along the entire path. It assumes that the
         fillOpticalDepth() function was previously invoked for the path. */
@@ -151,20 +183,28 @@ public:
         linear interpolation within this cell. */
     double pathlength(double tau) const;
 
+    /** This function reserves memory for the specified number of segments in each of the arrays
+        holding segment information, so that adding up to that number of segments to the path does
+        not cause any heap allocations. */
+    void reserve(int capacity);
+
+    /** This function returns the number of segments for which memory has been reserved in the
+        arrays holding segment information. */
+    int capacity() const { return _mv.capacity(); }
+
     // ------- Data members -------
 
 protected:
     Position _bfr;
     Direction _bfk;
 private:
+    int _mr;        // the cell containing the initial position, or -1 if unknown
     double _s;
-    struct Segment
-    {
-        int m;
-        double ds, s, dtau, tau;
-        bool operator<(Segment other) const { return tau < other.tau; }
-    };
-    std::vector<Segment> _v;
+    std::vector<int> _mv;           // the cell number for each segment
+    std::vector<double> _dsv;       // the path length covered within the cell for each segment
+    std::vector<double> _sv;        // the path length covered up to the end of each segment
+    std::vector<double> _dtauv;     // the optical depth covered within the cell for each segment
+    std::vector<double> _tauv;      // the optical depth covered up to the end of each segment
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -0,0 +1,40 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef DUSTGRIDSTRUCTUREINTERFACE_HPP
+#define DUSTGRIDSTRUCTUREINTERFACE_HPP
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////
+
+/** DustGridStructureInterface is a pure interface. It is implemented by dust grids that can save
+    their constructed cell structure in a binary representation, and restore it later on instead
+    of constructing it again. The DustSystem class uses this interface to store the grid structure
+    in its dust grid cache (see the DustGridCache class), so that a grid with an expensive
+    construction phase can be reused by subsequent runs of the same (or a similar) simulation. */
+class DustGridStructureInterface
+{
+protected:
+    /** The empty constructor for the interface. */
+    DustGridStructureInterface() { }
+
+public:
+    /** The empty destructor for the interface. */
+    virtual ~DustGridStructureInterface() { }
+
+    /** This function appends a binary representation of the constructed grid structure to the
+        specified vector. It should be called only after the dust grid has been setup. */
+    virtual void saveStructure(std::vector<char>& data) const = 0;
+
+    /** This function restores the grid structure from the specified binary representation, as
+        produced by the saveStructure() function. It must be called \em before the dust grid is
+        setup; the setup then uses the restored structure instead of constructing a new one. */
+    virtual void loadStructure(const char* data, size_t size) = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+#endif // DUSTGRIDSTRUCTUREINTERFACE_HPP
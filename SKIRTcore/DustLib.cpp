@@ -40,6 +40,25 @@ void DustLib::setupSelfBefore()
 
 namespace
 {
+    // the number of blocks of dust cells used to overlap the calculation of the emission spectra
+    // with the communication of the absorption and emission tables in data parallelization mode
+    const size_t pipelineBlocks = 8;
+
+    // a parallel target that invokes another target for a range of the indices assigned to this process
+    class BlockTarget : public ParallelTarget
+    {
+    public:
+        BlockTarget(ParallelTarget* target, const ProcessAssigner* assigner, size_t begin)
+            : _target(target), _assigner(assigner), _begin(begin) { }
+
+        void body(size_t index) { _target->body(_assigner->absoluteIndex(_begin+index)); }
+
+    private:
+        ParallelTarget* _target;
+        const ProcessAssigner* _assigner;
+        size_t _begin;
+    };
+
     class EmissionCalculator : public ParallelTarget
     {
     private:
@@ -193,9 +212,24 @@ void DustLib::calculate()
     if (dataParallel)
     {
         // Each process only has data for a subset of dust cells. The available dust cells are indicated by the
-        // cell assigner. The call below calculates the emission for those cells.
+        // cell assigner. The loop below calculates the emission for those cells.
         // ONLY WORKS FOR ALLCELLSDUSTLIB AND THIS IS INTENDED
-        parallel->call(&calc, ds->assigner());
+        // The cells are handled in blocks: the calculation for a block starts as soon as the absorption data for
+        // its cells has arrived, and the emission spectra for a block are sent while the next block is calculated.
+        // The absorption and emission tables use the same cell assigner, so that their blocks coincide.
+        ds->startSumResults(pipelineBlocks);
+        _Lvv.startSwitchScheme(pipelineBlocks);
+        for (size_t block=0; block<pipelineBlocks; block++)
+        {
+            size_t begin, end;
+            _Lvv.blockRows(block, begin, end);
+            ds->waitForResults(block);
+            BlockTarget target(&calc, ds->assigner(), begin);
+            parallel->call(&target, end-begin);
+            _Lvv.switchBlock(block);
+        }
+        ds->finishSumResults();
+        _Lvv.finishSwitchScheme();
     }
     else
     {
@@ -203,11 +237,14 @@ void DustLib::calculate()
         // Divide the work over the processes per library entry, using an auxiliary assigner.
         if (!_libAssigner) _libAssigner = new StaggeredAssigner(Nlib, this);
         parallel->call(&calc, _libAssigner);
+
+        // Wait for the other processes to reach this point
+        comm->wait("the emission spectra calculation");
+        _Lvv.switchScheme();
     }
 
-    // Wait for the other processes to reach this point
-    comm->wait("the emission spectra calculation");
-    _Lvv.switchScheme();
+    // Notify the dust emissivity object that the library has been calculated
+    find<DustEmissivity>()->libraryCalculated();
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -73,7 +73,15 @@ public:
         to luminosities, yielding an emission spectrum or emission SED. After each process has
         calculated these SEDs for the library entries (and mapped dust cells) it was assigned to, the
         necessary communications are performed by calling the sync function on the table containing the
-        results.*/
+        results. In data parallelization mode, each process only holds the radiation field for the
+        dust cells assigned to it, and the results are stored per dust cell, so that only a library
+        with an entry for each dust cell (i.e. the AllCellsDustLib subclass) can be used; the
+        Dim1DustLib and Dim2DustLib subclasses refuse to operate in this mode. The dust cells
+        assigned to each process are handled in a number of consecutive blocks. The calculation for
+        a block starts as soon as the absorbed luminosities for its cells have been received (see
+        PanDustSystem::startSumResults()), and the emission spectra for a block are communicated
+        while the next block is being calculated. When all library entries have been handled, the
+        function notifies the DustEmissivity object by calling its libraryCalculated() function. */
     void calculate();
 
     /** This function returns the luminosity fraction \f$L_\ell\f$ at the wavelength index
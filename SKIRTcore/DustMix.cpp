@@ -122,20 +122,16 @@ void DustMix::setupSelfAfter()
             _pfnormv[ell] = 2.0/sum;
         }
 
-        // create tables listing phi, phi/(2 pi), sin(2 phi) and 1-cos(2 phi) for a number of phi indices
-        _phiv.resize(_Nphi);
-        _phi1v.resize(_Nphi);
-        _phisv.resize(_Nphi);
-        _phicv.resize(_Nphi);
-        _phiXv.resize(_Nphi);
-        double df = 2*M_PI/(_Nphi-1);
-        for (int f=0; f<_Nphi; f++)
+        // create a table with the ratio S12/S11, i.e. the degree of linear polarization produced
+        // by scattering unpolarized light, for each wavelength and theta index
+        _S12S11vv.resize(_Nlambda,_Ntheta);
+        for (int ell=0; ell<_Nlambda; ell++)
         {
-            double phi = f * df;
-            _phiv[f] = phi;
-            _phi1v[f] = phi/(2*M_PI);
-            _phisv[f] = sin(2*phi);
-            _phicv[f] = 1-cos(2*phi);
+            for (int t=0; t<_Ntheta; t++)
+            {
+                double S11 = _S11vv(ell,t);
+                _S12S11vv(ell,t) = S11>0 ? _S12vv(ell,t)/S11 : 0.;
+            }
         }
     }
 
@@ -707,12 +703,32 @@ double DustMix::sampleTheta(int ell) const
 
 double DustMix::samplePhi(int ell, double theta, double polDegree, double polAngle) const
 {
+    // The normalized distribution of phi is p(phi) = (1 + P cos 2(phi-gamma)) / (2 pi) with
+    // P = polDegree * S12/S11 and gamma = polAngle, so that the cumulative distribution is given by
+    // 2 pi X(phi) = phi + P/2 (sin 2(phi-gamma) + sin 2gamma). We invert this relation by Newton's
+    // method, falling back to bisection if a Newton step would leave the current bracket.
     int t = indexForTheta(theta, _Ntheta);
-    double PF = polDegree * _S12vv(ell,t)/_S11vv(ell,t) / (4*M_PI);
-    double cos2polAngle = cos(2*polAngle) * PF;
-    double sin2polAngle = sin(2*polAngle) * PF;
-    const_cast<DustMix*>(this)->_phiXv = _phi1v + cos2polAngle*_phisv + sin2polAngle*_phicv;
-    return _random->cdf(_phiv, _phiXv);
+    double P = polDegree * _S12S11vv(ell,t);
+    double target = 2*M_PI * _random->uniform();
+    if (fabs(P) < 1e-12) return target;
+
+    double a = 0.5*P;
+    double offset = a*sin(2*polAngle);
+    double lo = 0.;
+    double hi = 2*M_PI;
+    double phi = target;
+    for (int i=0; i<50; i++)
+    {
+        double f = phi + a*sin(2*(phi-polAngle)) + offset - target;
+        if (f < 0) lo = phi;
+        else hi = phi;
+        double df = 1. + P*cos(2*(phi-polAngle));
+        double next = df>0 ? phi - f/df : lo-1.;
+        if (next <= lo || next >= hi) next = 0.5*(lo+hi);
+        if (fabs(next-phi) < 1e-12) return next;
+        phi = next;
+    }
+    return phi;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -368,7 +368,9 @@ private:
 
     /** This function returns a random scattering angle \f$\phi\f$ sampled from the phase function
         according to the scattering angle \f$\theta\f$ and the incident linear polarization degree
-        and polarization angle, at wavelength index \f$\ell\f$. */
+        and polarization angle, at wavelength index \f$\ell\f$. The cumulative distribution is
+        inverted numerically for each call, using the precalculated ratio \f$S_{12}/S_{11}\f$;
+        hence the function is thread-safe and does not allocate memory. */
     double samplePhi(int ell, double theta, double polDegree, double polAngle) const;
 
     //======================== Data Members ========================
@@ -406,7 +408,6 @@ private:
     // polarization-related data members
     bool _polarization;
     int _Ntheta;                    // index t
-    const int _Nphi = 361;          // index f
     Table<2> _S11vv;                // indexed on ell and t
     Table<2> _S12vv;                // indexed on ell and t
     Table<2> _S33vv;                // indexed on ell and t
@@ -414,11 +415,7 @@ private:
     Array _thetav;                  // indexed on t
     ArrayTable<2> _thetaXvv;        // indexed on ell and t
     Array _pfnormv;                 // indexed on ell
-    Array _phiv;                    // indexed on f
-    Array _phi1v;                   // indexed on f
-    Array _phisv;                   // indexed on f
-    Array _phicv;                   // indexed on f
-    Array _phiXv;                   // indexed on f
+    Table<2> _S12S11vv;             // indexed on ell and t
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -4,11 +4,14 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include "DustDistribution.hpp"
 #include "DustGridDensityInterface.hpp"
 #include "DustGridPath.hpp"
 #include "DustGrid.hpp"
+#include "DustGridCache.hpp"
+#include "DustGridStructureInterface.hpp"
 #include "DustMix.hpp"
 #include "DustSystem.hpp"
 #include "DustSystemDensityCalculator.hpp"
@@ -24,10 +27,12 @@
 #include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
 #include "Random.hpp"
+#include "ScratchArena.hpp"
 #include "StaggeredAssigner.hpp"
 #include "TextOutFile.hpp"
 #include "TimeLogger.hpp"
 #include "Units.hpp"
+#include "WavelengthBundle.hpp"
 #include "WavelengthGrid.hpp"
 #include <QVarLengthArray>
 
@@ -38,12 +43,20 @@ using namespace std;
 DustSystem::DustSystem()
     : _dd(0), _grid(0), _gdi(0), _Nrandom(100),
       _writeConvergence(true), _writeDensity(true), _writeDepthMap(false),
-      _writeQuality(false), _writeCellProperties(false), _writeCellsCrossed(false), _setupAssigner(0)
+      _writeQuality(false), _writeCellProperties(false), _writeCellsCrossed(false), _opacityTables(false),
+      _cache(0), _setupAssigner(0), _hasOpacityTables(false), _random(0)
 {
 }
 
 ////////////////////////////////////////////////////////////////////
 
+DustSystem::~DustSystem()
+{
+    delete _cache;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void DustSystem::setupSelfBefore()
 {
     SimulationItem::setupSelfBefore();
@@ -52,6 +65,24 @@ void DustSystem::setupSelfBefore()
     if (!_dd) throw FATALERROR("Dust distribution was not set");
     if (!_grid) throw FATALERROR("Dust grid was not set");
 
+    // cache the random generator
+    _random = find<Random>();
+
+    // if the dust grid cache is enabled, look for a cache file with a key covering all information
+    // that determines the grid structure and the volume and density of the cells
+    if (!find<FilePaths>()->cachePath().isEmpty())
+    {
+        _cache = new DustGridCache(this);
+        _cache->addItem(_dd);
+        _cache->addItem(_grid);
+        _cache->addItem(_random);
+        _cache->addValue("sampleCount", _Nrandom);
+
+        // if the cache file is present, restore the grid structure before the dust grid is setup
+        DustGridStructureInterface* gsi = _grid->interface<DustGridStructureInterface>();
+        if (_cache->open() && _cache->structureSize() && gsi)
+            gsi->loadStructure(_cache->structure(), _cache->structureSize());
+    }
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -64,6 +95,10 @@ void DustSystem::setupSelfAfter()
     _Ncomp = _dd->Ncomp();
     _Ncells = _grid->numCells();
 
+    // Cache the dust mixes so that they can be retrieved without calling into the dust distribution
+    _mixv.clear();
+    for (int h=0; h<_Ncomp; h++) _mixv.push_back(_dd->mix(h));
+
     // Make sure that all dust mixes support polarization, or none of them do
     for (int h=1; h<_Ncomp; h++)
     {
@@ -75,36 +110,71 @@ void DustSystem::setupSelfAfter()
     _volumev.resize(_Ncells);
     _rhovv.resize(_Ncells,_Ncomp);
 
-    // Set the volume of the cells (parallelized over different threads, except when multiprocessing is enabled)
-    find<Log>()->info("Calculating the volume of the cells...");
-    PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
-    ParallelFactory* pfactory = find<ParallelFactory>();
-    size_t nthreads = comm->isMultiProc() ? 1 : pfactory->maxThreadCount();
-    pfactory->parallel(nthreads)->call(this, &DustSystem::setVolumeBody, _Ncells);
-
-    // use a StaggeredAssigner to calculate the densities
-    _setupAssigner = new StaggeredAssigner(_Ncells, this);
+    // Verify that the dust grid cache file, if any, matches the dust grid
+    Log* log = find<Log>();
+    bool cached = _cache && _cache->hit();
+    if (cached && (_cache->numCells() != static_cast<size_t>(_Ncells) || _cache->numComponents() != _Ncomp))
+    {
+        log->warning("The dust grid cache file does not match the dust grid; recalculating the cell densities");
+        cached = false;
+    }
 
-    // Calculate and set the density of the cells that are assigned to this process
-    _gdi = _grid->interface<DustGridDensityInterface>();
-    if (_gdi)
+    if (cached)
     {
-        // if the dust grid offers a special interface, use it
-        find<Log>()->info("Setting the value of the density in the cells using grid interface...");
-        find<ParallelFactory>()->parallel()->call(this, &DustSystem::setGridDensityBody, _setupAssigner);
+        // Copy the volume and density of the cells from the dust grid cache
+        log->info("Copying the volume and density of the cells from the dust grid cache...");
+        memcpy(&_volumev[0], _cache->volumes(), _Ncells*sizeof(double));
+        memcpy(&_rhovv.getArray()[0], _cache->densities(), _Ncells*_Ncomp*sizeof(double));
     }
     else
     {
-        // otherwise take an average of the density in 100 random positions in the cell (parallelized)
-        find<Log>()->info("Setting the value of the density in the cells...");
-        find<ParallelFactory>()->parallel()->call(this, &DustSystem::setSampleDensityBody, _setupAssigner);
+        // Set the volume of the cells (parallelized over different threads, except when multiprocessing is enabled)
+        find<Log>()->info("Calculating the volume of the cells...");
+        PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
+        ParallelFactory* pfactory = find<ParallelFactory>();
+        size_t nthreads = comm->isMultiProc() ? 1 : pfactory->maxThreadCount();
+        pfactory->parallel(nthreads)->call(this, &DustSystem::setVolumeBody, _Ncells);
+
+        // use a StaggeredAssigner to calculate the densities
+        _setupAssigner = new StaggeredAssigner(_Ncells, this);
+
+        // Calculate and set the density of the cells that are assigned to this process
+        _gdi = _grid->interface<DustGridDensityInterface>();
+        if (_gdi)
+        {
+            // if the dust grid offers a special interface, use it
+            find<Log>()->info("Setting the value of the density in the cells using grid interface...");
+            find<ParallelFactory>()->parallel()->call(this, &DustSystem::setGridDensityBody, _setupAssigner);
+        }
+        else
+        {
+            // otherwise take an average of the density in 100 random positions in the cell (parallelized)
+            find<Log>()->info("Setting the value of the density in the cells...");
+            find<ParallelFactory>()->parallel()->call(this, &DustSystem::setSampleDensityBody, _setupAssigner);
+        }
+
+        // Wait for the other processes to reach this point
+        comm->wait("the calculation of the dust cell densities");
+
+        // Obtain the densities in all dust cells, if the calculation has been performed by parallel processes
+        if (comm->isMultiProc()) assemble();
+
+        // Store the grid structure and the volume and density of the cells in the dust grid cache
+        if (_cache)
+        {
+            vector<char> structure;
+            DustGridStructureInterface* gsi = _grid->interface<DustGridStructureInterface>();
+            if (gsi) gsi->saveStructure(structure);
+            _cache->write(structure, _volumev, _rhovv.getArray(), _Ncomp);
+        }
     }
 
-    // Wait for the other processes to reach this point
-    comm->wait("the calculation of the dust cell densities");
+    // Release the dust grid cache, which is no longer needed
+    delete _cache;
+    _cache = 0;
 
-    // Obtain the densities in all dust cells, if the calculation has been performed by parallel processes
-    if (comm->isMultiProc()) assemble();
+    // Precalculate the extinction coefficient and albedo in each cell for all wavelengths, if so requested
+    if (_opacityTables) calculateopacities();
 
     // Perform a convergence check on the grid.
     if (_writeConvergence) writeconvergence();
@@ -187,6 +257,58 @@ void DustSystem::assemble()
 
 ////////////////////////////////////////////////////////////////////
 
+void DustSystem::calculateopacities()
+{
+    Log* log = find<Log>();
+    if (_Ncomp < 2)
+    {
+        log->info("Opacity tables are not needed for a dust system with a single dust component");
+        return;
+    }
+
+    int Nlambda = find<WavelengthGrid>()->Nlambda();
+    double GB = 2. * Nlambda * _Ncells * sizeof(double) / (1024.*1024.*1024.);
+    log->info("Calculating opacity tables for " + QString::number(_Ncells) + " cells and "
+              + QString::number(Nlambda) + " wavelengths (" + QString::number(GB, 'f', 2) + " GB)...");
+    _kextvv.resize(Nlambda, _Ncells);
+    _albedovv.resize(Nlambda, _Ncells);
+    find<ParallelFactory>()->parallel()->call(this, &DustSystem::setOpacityBody, Nlambda);
+    _hasOpacityTables = true;
+}
+
+////////////////////////////////////////////////////////////////////
+
+// parallelized body used above
+void DustSystem::setOpacityBody(size_t index)
+{
+    int ell = index;
+    Array kappaextv(_Ncomp);
+    Array kappascav(_Ncomp);
+    for (int h=0; h<_Ncomp; h++)
+    {
+        kappaextv[h] = _mixv[h]->kappaext(ell);
+        kappascav[h] = _mixv[h]->kappasca(ell);
+    }
+
+    Array& kextv = _kextvv[ell];
+    Array& albedov = _albedovv[ell];
+    for (int m=0; m<_Ncells; m++)
+    {
+        double kext = 0.;
+        double ksca = 0.;
+        for (int h=0; h<_Ncomp; h++)
+        {
+            double rho = _rhovv(m,h);
+            kext += rho*kappaextv[h];
+            ksca += rho*kappascav[h];
+        }
+        kextv[m] = kext;
+        albedov[m] = kext>0. ? ksca/kext : 0.;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void DustSystem::writeconvergence() const
 {
     // Perform a convergence check on the grid. First calculate the total
@@ -462,21 +584,33 @@ namespace
         // data members initialized in constructor
         const DustSystem* _ds;
         int _Ncomp;
-        QVarLengthArray<double,8> _kappaextv;
+        double* _kappaextv;     // per-thread scratch memory, so that no heap allocation is needed
+        const double* _kextv;   // the opacity table row for the wavelength, if available
 
     public:
         // constructor
         // stores the extinction coefficients at the specified wavelength for all dust mixes
-        KappaRho(const DustSystem* ds, int ell) : _ds(ds), _Ncomp(ds->Ncomp()), _kappaextv(_Ncomp)
+        // or, if the dust system offers opacity tables, the table row for the specified wavelength
+        KappaRho(const DustSystem* ds, int ell)
+            : _ds(ds), _Ncomp(ds->Ncomp()), _kappaextv(0), _kextv(0)
         {
-            for (int h=0; h<_Ncomp; h++)
-                _kappaextv[h] = _ds->mix(h)->kappaext(ell);
+            if (_ds->hasOpacityTables())
+            {
+                _kextv = &_ds->extinctionv(ell)[0];
+            }
+            else
+            {
+                _kappaextv = ScratchArena::doubles(ScratchArena::KappaRho, _Ncomp);
+                for (int h=0; h<_Ncomp; h++)
+                    _kappaextv[h] = _ds->mix(h)->kappaext(ell);
+            }
         }
 
         // call-back function
         // returns kappa*rho for the specified cell number (and for the wavelength-index bound in the constructor)
         double operator() (int m)
         {
+            if (_kextv) return m >= 0 ? _kextv[m] : 0.;
             double result = 0;
             for (int h=0; h<_Ncomp; h++)
                 result += _kappaextv[h] * _ds->density(m,h);
@@ -815,6 +949,20 @@ bool DustSystem::writeCellsCrossed() const
     return _writeCellsCrossed;
 }
 
+//////////////////////////////////////////////////////////////////////
+
+void DustSystem::setOpacityTables(bool value)
+{
+    _opacityTables = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool DustSystem::opacityTables() const
+{
+    return _opacityTables;
+}
+
 ////////////////////////////////////////////////////////////////////
 
 int DustSystem::dimension() const
@@ -847,7 +995,7 @@ bool DustSystem::polarization() const
 
 DustMix* DustSystem::mix(int h) const
 {
-    return _dd->mix(h);
+    return h < static_cast<int>(_mixv.size()) ? _mixv[h] : _dd->mix(h);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -860,9 +1008,20 @@ DustMix* DustSystem::randomMixForPosition(Position bfr, int ell) const
         int m = whichcell(bfr);
         if (m>=0)
         {
-            Array Xv;
-            NR::cdf(Xv, _Ncomp, [this,ell,m](int h){return mix(h)->kappasca(ell)*density(m,h);} );
-            hmix = NR::locate_clip(Xv, find<Random>()->uniform());
+            // select a component with probability proportional to kappasca*rho without allocating a
+            // cumulative distribution, i.e. by subtracting the weights from a scaled uniform deviate
+            double sum = 0.;
+            if (_hasOpacityTables) sum = _albedovv(ell,m) * _kextvv(ell,m);
+            else for (int h=0; h<_Ncomp; h++) sum += _mixv[h]->kappasca(ell) * _rhovv(m,h);
+            if (sum > 0.)
+            {
+                double X = _random->uniform() * sum;
+                for (; hmix<_Ncomp-1; hmix++)
+                {
+                    X -= _mixv[hmix]->kappasca(ell) * _rhovv(m,hmix);
+                    if (X < 0.) break;
+                }
+            }
         }
     }
     return mix(hmix);
@@ -908,11 +1067,46 @@ double DustSystem::density(int m) const
 
 //////////////////////////////////////////////////////////////////////
 
+double DustSystem::extinction(int m, int ell) const
+{
+    if (m < 0) return 0.;
+    if (_hasOpacityTables) return _kextvv(ell,m);
+    double kext = 0.;
+    for (int h=0; h<_Ncomp; h++) kext += mix(h)->kappaext(ell) * _rhovv(m,h);
+    return kext;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double DustSystem::albedo(int m, int ell) const
+{
+    if (m < 0) return 0.;
+    if (_hasOpacityTables) return _albedovv(ell,m);
+    double kext = 0.;
+    double ksca = 0.;
+    for (int h=0; h<_Ncomp; h++)
+    {
+        kext += mix(h)->kappaext(ell) * _rhovv(m,h);
+        ksca += mix(h)->kappasca(ell) * _rhovv(m,h);
+    }
+    return kext>0. ? ksca/kext : 0.;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 Array DustSystem::meanintensityv(int m) const
+{
+    Array Jv(find<WavelengthGrid>()->Nlambda());
+    meanintensityv(Jv, m);
+    return Jv;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void DustSystem::meanintensityv(Array& Jv, int m) const
 {
     WavelengthGrid* lambdagrid = find<WavelengthGrid>();
     int Nlambda = lambdagrid->Nlambda();
-    Array Jv(Nlambda);
     double fac = 4.0*M_PI*volume(m);
     for (int ell=0; ell<Nlambda; ell++)
     {
@@ -927,12 +1121,11 @@ Array DustSystem::meanintensityv(int m) const
         // guard against (rare) situations where both Labs and kappa*fac are zero
         Jv[ell] = std::isfinite(J) ? J : 0.0;
     }
-    return Jv;
 }
 
 //////////////////////////////////////////////////////////////////////
 
-void DustSystem::fillOpticalDepth(PhotonPackage* pp)
+void DustSystem::calculatepath(PhotonPackage* pp)
 {
     // determine the path and store the geometric details in the photon package
     _grid->path(pp);
@@ -945,9 +1138,22 @@ void DustSystem::fillOpticalDepth(PhotonPackage* pp)
         if (index >= _crossed.size()) _crossed.resize(index+1);
         _crossed[index] += 1;
     }
+}
 
-    // calculate and store the optical depth details in the photon package
-    pp->fillOpticalDepth(KappaRho(this, pp->ell()));
+//////////////////////////////////////////////////////////////////////
+
+void DustSystem::fillOpticalDepth(PhotonPackage* pp)
+{
+    // determine the path and store the geometric details in the photon package
+    calculatepath(pp);
+
+    // calculate and store the optical depth details in the photon package; if the extinction
+    // coefficients are available in a table indexed on cell number (i.e. the opacity tables, or the
+    // densities for a single dust component), let the path gather the table values directly
+    int ell = pp->ell();
+    if (_hasOpacityTables) pp->fillOpticalDepthFromTable(&_kextvv[ell][0]);
+    else if (_Ncomp==1 && _Ncells>0) pp->fillOpticalDepthFromTable(&_rhovv(0,0), mix(0)->kappaext(ell));
+    else pp->fillOpticalDepth(KappaRho(this, ell));
 
     // verify that the result makes sense
     double tau = pp->tau();
@@ -960,19 +1166,40 @@ void DustSystem::fillOpticalDepth(PhotonPackage* pp)
 double DustSystem::opticaldepth(PhotonPackage* pp, double distance)
 {
     // determine the path and store the geometric details in the photon package
-    _grid->path(pp);
+    calculatepath(pp);
 
-    // if such statistics are requested, keep track of the number of cells crossed
-    if (_writeCellsCrossed)
+    // calculate and return the optical depth at the specified distance
+    return pp->opticalDepth(KappaRho(this, pp->ell()), distance);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void DustSystem::fillOpticalDepth(PhotonPackage* pp, WavelengthBundle* bundle)
+{
+    // determine the path and store the geometric details in the photon package
+    calculatepath(pp);
+
+    // calculate and store the optical depth details for all wavelengths in the bundle
+    bundle->fillOpticalDepth(pp);
+
+    // verify that the results make sense
+    for (int k=0; k<bundle->size(); k++)
     {
-        std::unique_lock<std::mutex> lock(_crossedMutex);
-        unsigned int index = pp->size();
-        if (index >= _crossed.size()) _crossed.resize(index+1);
-        _crossed[index] += 1;
+        double tau = bundle->tau(k);
+        if (tau<0.0 || std::isnan(tau) || std::isinf(tau))
+            throw FATALERROR("The optical depth along the path is not a positive number: tau = " + QString::number(tau));
     }
+}
 
-    // calculate and return the optical depth at the specified distance
-    return pp->opticalDepth(KappaRho(this, pp->ell()), distance);
+//////////////////////////////////////////////////////////////////////
+
+void DustSystem::opticaldepth(PhotonPackage* pp, const WavelengthBundle* bundle, Array& tauv)
+{
+    // determine the path and store the geometric details in the photon package
+    calculatepath(pp);
+
+    // calculate the optical depth along the complete path for all wavelengths in the bundle
+    bundle->opticalDepth(pp, tauv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -9,16 +9,20 @@
 #include <mutex>
 #include <vector>
 #include "Array.hpp"
+#include "ArrayTable.hpp"
 #include "Position.hpp"
 #include "SimulationItem.hpp"
 #include "Table.hpp"
 
 class DustDistribution;
 class DustGrid;
+class DustGridCache;
 class DustGridDensityInterface;
 class DustMix;
 class PhotonPackage;
 class ProcessAssigner;
+class Random;
+class WavelengthBundle;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -76,13 +80,29 @@ class DustSystem : public SimulationItem
     Q_CLASSINFO("Default", "no")
     Q_CLASSINFO("Silent", "true")
 
+    Q_CLASSINFO("Property", "opacityTables")
+    Q_CLASSINFO("Title", "precalculate the extinction and albedo in each cell for all wavelengths")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 protected:
     /** The default constructor; it is protected since this is an abstract class. */
     DustSystem();
 
-    /** This function verifies that all attribute values have been appropriately set. */
+public:
+    /** The destructor releases the dust grid cache, if it is still open. */
+    ~DustSystem();
+
+protected:
+    /** This function verifies that all attribute values have been appropriately set. If a dust
+        grid cache has been configured (see FilePaths::setCachePath()), the function also looks
+        for a cache file with a key derived from the dust distribution, the dust grid, the random
+        generator and the number of random density samples (see the DustGridCache class). If such
+        a file is found, and the dust grid offers the DustGridStructureInterface, the grid
+        structure is restored from the cache before the dust grid is setup, so that the grid
+        doesn't need to be constructed again. */
     void setupSelfBefore();
 
     /** This function performs setup for the dust system, which includes several tasks. First, the
@@ -94,8 +114,13 @@ protected:
         positions are generated within the cell (see sampleCount()). The density in the cell is
         calculated as the mean of the density values (found using a call to the corresponding
         function of the dust distribution) in these points. The calculation of both volume and
-        density is parallellized. Finally, the function optionally invokes various writeXXX()
-        functions depending on the state of the corresponding write flags. */
+        density is parallellized. If the opacityTables flag is set, the function then calculates
+        the opacity tables (see calculateopacities()). Finally, the function optionally invokes
+        various writeXXX() functions depending on the state of the corresponding write flags. If
+        the dust grid cache provided a matching cache file, the volume and density of the cells
+        are copied from that file instead of being calculated. Otherwise, when the dust grid cache
+        is enabled, the grid structure and the calculated cell volumes and densities are written
+        to a new cache file for use by later runs. */
     void setupSelfAfter();
 
 private:
@@ -126,6 +151,20 @@ private:
         of the densities, where each process stores the density over the entire dust grid. */
     void assemble();
 
+    /** This function calculates the total extinction coefficient \f$k_{\ell,m}^\text{ext} =
+        \sum_h \kappa_{\ell,h}^\text{ext}\,\rho_{m,h}\f$ and the albedo
+        \f$k_{\ell,m}^\text{sca}/k_{\ell,m}^\text{ext}\f$ for each cell and each wavelength, and
+        stores the results in tables indexed on wavelength and cell, so that these quantities can
+        be retrieved during the photon life cycle without looping over the dust components. The
+        tables are constructed only if there are multiple dust components; for a single component,
+        they would not offer any speed benefit. The memory consumption is \f$16\,N_\lambda
+        N_\text{cells}\f$ bytes. */
+    void calculateopacities();
+
+    /** This function serves as the parallelization body for calculating the opacity tables for
+        the wavelength with the specified index \f$\ell\f$. */
+    void setOpacityBody(size_t index);
+
     /** This function writes out a simple text file, named <tt>prefix_ds_convergence.dat</tt>,
         providing a convergence check on the dust system. The function calculates the total dust
         mass, the face-on surface density and the edge-on surface density by directly integrating
@@ -253,6 +292,16 @@ public:
         number of dust grid cells crossed per path calculated through the grid. */
     Q_INVOKABLE bool writeCellsCrossed() const;
 
+    /** Sets the flag that indicates whether the total extinction coefficient and albedo in each
+        dust cell are precalculated for all wavelengths. For dust systems with multiple dust
+        components, this speeds up the life cycle of a photon package at the cost of \f$16\,
+        N_\lambda N_\text{cells}\f$ bytes of memory. The default value is false. */
+    Q_INVOKABLE void setOpacityTables(bool value);
+
+    /** Returns the flag that indicates whether the total extinction coefficient and albedo in each
+        dust cell are precalculated for all wavelengths. */
+    Q_INVOKABLE bool opacityTables() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -305,6 +354,27 @@ public:
         the value zero is returned. */
     double density(int m) const;
 
+    /** This function returns true if the opacity tables have been calculated during setup, i.e.
+        if the opacityTables flag is set and there are multiple dust components. */
+    bool hasOpacityTables() const { return _hasOpacityTables; }
+
+    /** This function returns the total extinction coefficient \f$k_{\ell,m}^\text{ext} = \sum_h
+        \kappa_{\ell,h}^\text{ext}\,\rho_{m,h}\f$ at wavelength index \f$\ell\f$ in the dust cell
+        with cell number \f$m\f$. The value is retrieved from the opacity tables if these are
+        available, and calculated otherwise. */
+    double extinction(int m, int ell) const;
+
+    /** This function returns the albedo \f$k_{\ell,m}^\text{sca}/k_{\ell,m}^\text{ext}\f$ at
+        wavelength index \f$\ell\f$ in the dust cell with cell number \f$m\f$, or zero if the
+        cell contains no dust. The value is retrieved from the opacity tables if these are
+        available, and calculated otherwise. */
+    double albedo(int m, int ell) const;
+
+    /** This function returns the row of the extinction coefficient opacity table for the
+        wavelength index \f$\ell\f$, indexed on cell number. It may be called only if
+        hasOpacityTables() returns true. */
+    const Array& extinctionv(int ell) const { return _kextvv[ell]; }
+
     /** This function calculates the optical depth
         \f$\tau_{\ell,{\text{path}}}({\boldsymbol{r}},{\boldsymbol{k}})\f$ at wavelength index
         \f$\ell\f$ along a path through the dust system starting at the position
@@ -344,6 +414,20 @@ public:
         */
     double opticaldepth(PhotonPackage* pp, double distance);
 
+    /** This function calculates the path through the dust system for the specified photon
+        package, which carries the specified wavelength bundle, and stores the geometric details
+        in the photon package, as described for the other version of this function. It then
+        calculates the optical depth details for all wavelengths in the bundle in a single pass
+        over the path segments (see WavelengthBundle::fillOpticalDepth()), and stores them in the
+        wavelength bundle rather than in the photon package. */
+    void fillOpticalDepth(PhotonPackage* pp, WavelengthBundle* bundle);
+
+    /** This function calculates the path through the dust system for the specified peel off
+        photon package, storing the geometric details in the photon package, and stores the total
+        optical depth along the path for each of the wavelengths in the specified bundle in the
+        array \em tauv. */
+    void opticaldepth(PhotonPackage* pp, const WavelengthBundle* bundle, Array& tauv);
+
     /** If the writeCellsCrossed attribute is true, this function writes out a data file (named
         <tt>prefix_ds_crossed.dat</tt>) with statistics on the number of dust grid cells crossed
         per path calculated through the grid. The first column on each line specifies a particular
@@ -388,6 +472,18 @@ public:
         corresponding to the \f$h\f$'th dust component, and \f$V_m\f$ the volume of the cell. */
     Array meanintensityv(int m) const;
 
+    /** This function stores the mean radiation field \f$J_{\ell,m}\f$ at all wavelength indices in
+        the dust cell with cell number \f$m\f$ in the specified array, which must already have the
+        appropriate size. It is equivalent to the function above, but it allows the caller to
+        reuse the same array for many cells. */
+    void meanintensityv(Array& Jv, int m) const;
+
+private:
+    /** This function determines the path through the dust grid for the specified photon package,
+        stores the geometric details in the photon package, and if requested, updates the
+        statistics on the number of cells crossed. */
+    void calculatepath(PhotonPackage* pp);
+
     //======================== Data Members ========================
 
 protected:
@@ -402,8 +498,10 @@ protected:
     bool _writeQuality;
     bool _writeCellProperties;
     bool _writeCellsCrossed;
+    bool _opacityTables;
 
     // data members initialized during setup
+    DustGridCache* _cache;            // the dust grid cache, or null if it is disabled or no longer needed
     ProcessAssigner* _setupAssigner;  // determines which dust cells are assigned to this process
                                       // for various calculations during setup
     int _Ncomp;
@@ -412,6 +510,13 @@ protected:
     Table<2> _rhovv;    // density for each cell and each dust component (indexed on m,h)
     std::vector<qint64> _crossed;
     std::mutex _crossedMutex;
+    bool _hasOpacityTables;
+    ArrayTable<2> _kextvv;      // total extinction coefficient for each wavelength and cell (indexed on ell,m)
+    ArrayTable<2> _albedovv;    // albedo for each wavelength and cell (indexed on ell,m)
+
+    // data members cached during setup so that they can be used without searching the simulation hierarchy
+    Random* _random;
+    std::vector<DustMix*> _mixv;    // the dust mix for each dust component (indexed on h)
 };
 
 //////////////////////////////////////////////////////////////////////
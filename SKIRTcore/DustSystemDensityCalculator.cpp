@@ -28,10 +28,12 @@ DustSystemDensityCalculator::DustSystemDensityCalculator(const DustSystem *ds, i
 
 void DustSystemDensityCalculator::body(size_t n)
 {
-    int k = _numSamplesPerBody;
-    while (k--)
+    // generate all random positions for this body in a single batch
+    vector<Position> posv(_numSamplesPerBody);
+    _random->position(_extent, posv);
+
+    for (const Position& pos : posv)
     {
-        Position pos = _random->position(_extent);
         double rhot = _dd->density(pos);
         double rhog = _ds->density(_grid->whichcell(pos));
         double drho = fabs(rhog-rhot);
@@ -15,7 +15,7 @@ using namespace std;
 
 namespace
 {
-    // mutex to guard the FITS input/output operations
+    // mutex to guard the FITS input/output operations in case the cfitsio library is not reentrant
     std::mutex _mutex;
 
     // function to report cfitsio errors
@@ -25,6 +25,63 @@ namespace
         ffgerr(status, message);
         throw FATALERROR("Error while " + action + " FITS file " + filepath + "\n" + QString(message));
     }
+
+    // function to create a FITS file with an empty primary image and the relevant keywords;
+    // if requested, the image is losslessly tile compressed
+    fitsfile* create(QString filepath, int nx, int ny, int nz, double incx, double incy, double xc, double yc,
+                     QString dataUnits, QString xyUnits, bool compress)
+    {
+        long naxes[3] = {nx, ny, nz};
+
+        // Generate time stamp and temporaries
+        std::string stamp = QDateTime::currentDateTime().toUTC().toString("yyyy-MM-ddThh:mm:ss").toStdString();
+        std::string localpath = filepath.toLocal8Bit().constData();
+        std::string dataunits = dataUnits.toStdString();
+        std::string xyunits = xyUnits.toStdString();
+        double zero = 0.;
+        double one = 1.;
+        double xref = (nx+1.0)/2.0;
+        double yref = (ny+1.0)/2.0;
+
+        // Remove any existing file with the same name
+        remove(localpath.c_str());
+
+        // Create the fits file
+        int status = 0;
+        fitsfile *fptr;
+        ffdkinit(&fptr, localpath.c_str(), &status);
+        if (status) report_error(filepath, "creating", status);
+
+        // Request lossless compression (without quantization of the floating point values)
+        if (compress)
+        {
+            fits_set_compression_type(fptr, GZIP_2, &status);
+            fits_set_quantize_level(fptr, 0., &status);
+            if (status) report_error(filepath, "creating", status);
+        }
+
+        // Create the primary image (32-bit floating point pixels)
+        ffcrim(fptr, FLOAT_IMG, (nz==1 ? 2 : 3), naxes, &status);
+        if (status) report_error(filepath, "creating", status);
+
+        // Add the relevant keywords
+        ffpky(fptr, TDOUBLE, "BSCALE", &one, "", &status);
+        ffpky(fptr, TDOUBLE, "BZERO", &zero, "", &status);
+        ffpkys(fptr, "DATE"  , const_cast<char*>(stamp.c_str()), "Date and time of creation (UTC)", &status);
+        ffpkys(fptr, "ORIGIN", const_cast<char*>("SKIRT simulation"), "Astronomical Observatory, Ghent University", &status);
+        ffpkys(fptr, "BUNIT" , const_cast<char*>(dataunits.c_str()), "Physical unit of the array values", &status);
+        ffpky(fptr, TDOUBLE, "CRPIX1", &xref, "X-axis coordinate system reference pixel", &status);
+        ffpky(fptr, TDOUBLE, "CRVAL1", &xc, "Coordinate system value at X-axis reference pixel", &status);
+        ffpky(fptr, TDOUBLE, "CDELT1", &incx, "Coordinate increment along X-axis", &status);
+        ffpkys(fptr, "CTYPE1", const_cast<char*>(xyunits.c_str()), "Physical units of the X-axis increment", &status);
+        ffpky(fptr, TDOUBLE, "CRPIX2", &yref, "Y-axis coordinate system reference pixel", &status);
+        ffpky(fptr, TDOUBLE, "CRVAL2", &yc, "Coordinate system value at Y-axis reference pixel", &status);
+        ffpky(fptr, TDOUBLE, "CDELT2", &incy, "Coordinate increment along Y-axis", &status);
+        ffpkys(fptr, "CTYPE2", const_cast<char*>(xyunits.c_str()), "Physical units of the Y-axis increment", &status);
+        if (status) report_error(filepath, "writing", status);
+
+        return fptr;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -36,52 +93,16 @@ void FITSInOut::write(QString filepath, const Array& data, int nx, int ny, int n
     size_t nelements = data.size();
     if (nelements != static_cast<size_t>(nx)*static_cast<size_t>(ny)*static_cast<size_t>(nz))
         throw FATALERROR("Inconsistent data size when creating FITS file " + filepath);
-    long naxes[3] = {nx, ny, nz};
-
-    // Acquire a global lock since the cfitsio library is not guaranteed to be reentrant
-    // (only when it is built with ./configure --enable-reentrant; make)
-    std::unique_lock<std::mutex> lock(_mutex);
-
-    // Generate time stamp and temporaries
-    std::string stamp = QDateTime::currentDateTime().toUTC().toString("yyyy-MM-ddThh:mm:ss").toStdString();
-    std::string localpath = filepath.toLocal8Bit().constData();
-    std::string dataunits = dataUnits.toStdString();
-    std::string xyunits = xyUnits.toStdString();
-    double zero = 0.;
-    double one = 1.;
-    double xref = (nx+1.0)/2.0;
-    double yref = (ny+1.0)/2.0;
-
-    // Remove any existing file with the same name
-    remove(localpath.c_str());
-
-    // Create the fits file
-    int status = 0;
-    fitsfile *fptr;
-    ffdkinit(&fptr, localpath.c_str(), &status);
-    if (status) report_error(filepath, "creating", status);
-
-    // Create the primary image (32-bit floating point pixels)
-    ffcrim(fptr, FLOAT_IMG, (nz==1 ? 2 : 3), naxes, &status);
-    if (status) report_error(filepath, "creating", status);
-
-    // Add the relevant keywords
-    ffpky(fptr, TDOUBLE, "BSCALE", &one, "", &status);
-    ffpky(fptr, TDOUBLE, "BZERO", &zero, "", &status);
-    ffpkys(fptr, "DATE"  , const_cast<char*>(stamp.c_str()), "Date and time of creation (UTC)", &status);
-    ffpkys(fptr, "ORIGIN", const_cast<char*>("SKIRT simulation"), "Astronomical Observatory, Ghent University", &status);
-    ffpkys(fptr, "BUNIT" , const_cast<char*>(dataunits.c_str()), "Physical unit of the array values", &status);
-    ffpky(fptr, TDOUBLE, "CRPIX1", &xref, "X-axis coordinate system reference pixel", &status);
-    ffpky(fptr, TDOUBLE, "CRVAL1", &xc, "Coordinate system value at X-axis reference pixel", &status);
-    ffpky(fptr, TDOUBLE, "CDELT1", &incx, "Coordinate increment along X-axis", &status);
-    ffpkys(fptr, "CTYPE1", const_cast<char*>(xyunits.c_str()), "Physical units of the X-axis increment", &status);
-    ffpky(fptr, TDOUBLE, "CRPIX2", &yref, "Y-axis coordinate system reference pixel", &status);
-    ffpky(fptr, TDOUBLE, "CRVAL2", &yc, "Coordinate system value at Y-axis reference pixel", &status);
-    ffpky(fptr, TDOUBLE, "CDELT2", &incy, "Coordinate increment along Y-axis", &status);
-    ffpkys(fptr, "CTYPE2", const_cast<char*>(xyunits.c_str()), "Physical units of the Y-axis increment", &status);
-    if (status) report_error(filepath, "writing", status);
+
+    // Acquire a global lock if the cfitsio library has not been built to be reentrant
+    std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
+    if (!fits_is_reentrant()) lock.lock();
+
+    // Create the file
+    fitsfile* fptr = create(filepath, nx, ny, nz, incx, incy, xc, yc, dataUnits, xyUnits, false);
 
     // Write the array of pixels to the image
+    int status = 0;
     ffpprd(fptr, 0, 1, nelements, const_cast<double*>(&data[0]), &status);
     if (status) report_error(filepath, "writing", status);
 
@@ -92,10 +113,45 @@ void FITSInOut::write(QString filepath, const Array& data, int nx, int ny, int n
 
 ////////////////////////////////////////////////////////////////////
 
+void FITSInOut::write(QString filepath, std::function<void(int z, Array& plane)> plane, int nx, int ny, int nz,
+                      double incx, double incy, double xc, double yc, QString dataUnits, QString xyUnits,
+                      bool compress)
+{
+    // Acquire a global lock if the cfitsio library has not been built to be reentrant
+    std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
+    if (!fits_is_reentrant()) lock.lock();
+
+    // Create the file
+    fitsfile* fptr = create(filepath, nx, ny, nz, incx, incy, xc, yc, dataUnits, xyUnits, compress);
+
+    // Obtain the values for each plane in turn, and append them to the image
+    size_t nelements = static_cast<size_t>(nx)*static_cast<size_t>(ny);
+    Array values(nelements);
+    for (int z=0; z<nz; z++)
+    {
+        plane(z, values);
+        if (values.size() != nelements)
+            throw FATALERROR("Inconsistent plane size when writing FITS file " + filepath);
+
+        int status = 0;
+        long firstpix[3] = {1, 1, z+1};
+        ffppx(fptr, TDOUBLE, firstpix, nelements, &values[0], &status);
+        if (status) report_error(filepath, "writing", status);
+    }
+
+    // Close the file
+    int status = 0;
+    ffclos(fptr, &status);
+    if (status) report_error(filepath, "writing", status);
+}
+
+////////////////////////////////////////////////////////////////////
+
 void FITSInOut::read(QString filepath, Array& data, int& nx, int& ny, int& nz)
 {
-    // Acquire a global lock since the cfitsio library is not guaranteed to be reentrant
-    std::unique_lock<std::mutex> lock(_mutex);
+    // Acquire a global lock if the cfitsio library has not been built to be reentrant
+    std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
+    if (!fits_is_reentrant()) lock.lock();
 
     // Open the FITS file
     int status = 0;
@@ -6,13 +6,15 @@
 #ifndef FITINSOUT_HPP
 #define FITINSOUT_HPP
 
+#include <functional>
 #include <QString>
 #include "Array.hpp"
 
 ////////////////////////////////////////////////////////////////////
 
 /** This namespace supports writing a 2D or 3D data stream to a standard FITS file, including a
-    basic set of metadata in the header. */
+    basic set of metadata in the header. The cfitsio library is built to be reentrant, so that
+    different files can be written concurrently from multiple threads. */
 namespace FITSInOut
 {
     /** This function writes a FITS file containing one or more data planes (i.e. a 2D or 3D data
@@ -29,6 +31,19 @@ namespace FITSInOut
     void write(QString filepath, const Array& data, int nx, int ny, int nz,
                double incx, double incy, double xc, double yc, QString dataUnits, QString xyUnits);
 
+    /** This function writes a FITS file containing one or more data planes, just like the other
+        write() function, except that the data values are not passed as a single array. Instead,
+        the function calls the specified \em plane function for each of the \em nz planes in
+        turn, with the index of the plane and an array of \em nx times \em ny values that should be
+        filled with the values in that plane, and appends the values to the file. As a result, the
+        data cube never needs to be present in memory as a whole, and the values can be calibrated
+        or otherwise transformed while they are written. If \em compress is true, the image is
+        losslessly compressed using the FITS tiled image compression convention; in that case the
+        image is stored in the first extension of the file rather than in the primary array. */
+    void write(QString filepath, std::function<void(int z, Array& plane)> plane, int nx, int ny, int nz,
+               double incx, double incy, double xc, double yc, QString dataUnits, QString xyUnits,
+               bool compress = false);
+
     /** This function reads from a FITS file containing one or more data planes (i.e. a 2D or 3D
         data cube). The first argument specifies a relative or absolute file path; a file with that
         name should exist. The subsequent arguments serve to store data read from the file: \em
@@ -120,6 +120,26 @@ QString FilePaths::outputPrefix() const
 
 ////////////////////////////////////////////////////////////////////
 
+void FilePaths::setCachePath(QString value)
+{
+    if (value.isEmpty()) _cachePath = "";
+    else
+    {
+        QFileInfo test(value);
+        if (!test.isDir()) throw FATALERROR("Cache path does not exist or is not a directory: " + value);
+        _cachePath = test.canonicalFilePath() + "/";
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString FilePaths::cachePath() const
+{
+    return _cachePath;
+}
+
+////////////////////////////////////////////////////////////////////
+
 QString FilePaths::input(QString name) const
 {
     return _inputPath + name;
@@ -134,6 +154,13 @@ QString FilePaths::output(QString name) const
 
 ////////////////////////////////////////////////////////////////////
 
+QString FilePaths::cache(QString name) const
+{
+    return _cachePath + name;
+}
+
+////////////////////////////////////////////////////////////////////
+
 QString FilePaths::application(QString name)
 {
     // initialize the static paths if needed
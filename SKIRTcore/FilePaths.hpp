@@ -45,6 +45,15 @@ public:
     /** Returns the prefix for output file names. */
     QString outputPrefix() const;
 
+    /** Sets the (absolute or relative) path for the files in the dust grid cache (see the
+        DustGridCache class). An empty string (the default value) means that the dust grid cache
+        is disabled. */
+    void setCachePath(QString value);
+
+    /** Returns the (absolute or relative) path for the files in the dust grid cache, or the empty
+        string if the dust grid cache is disabled. */
+    QString cachePath() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -58,6 +67,10 @@ public:
         by an underscore. */
     QString output(QString name) const;
 
+    /** This function returns the complete path for a dust grid cache file with the specified name,
+        relative to the cache path returned by cachePath(). */
+    QString cache(QString name) const;
+
     /** This function returns the complete path for an executable with the specified name residing
         in the same directory as the SKIRT executable. */
     static QString application(QString name);
@@ -90,6 +103,7 @@ private:
     QString _inputPath;
     QString _outputPath;
     QString _outputPrefix;
+    QString _cachePath;
 };
 
 ////////////////////////////////////////////////////////////////////
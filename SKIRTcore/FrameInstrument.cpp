@@ -7,7 +7,6 @@
 
 #include "FatalError.hpp"
 #include "FrameInstrument.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "WavelengthGrid.hpp"
 
@@ -26,6 +25,8 @@ void FrameInstrument::setupSelfBefore()
     SingleFrameInstrument::setupSelfBefore();
 
     _distftotv.initialize(_Nframep, this);
+
+    _distftotd = addDetector(_distftotv.partialCube());
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -42,7 +43,7 @@ FrameInstrument::detect(PhotonPackage* pp)
         double extf = exp(-taupath);
         double Lextf = L*extf;
 
-        LockFree::add(_distftotv(ell,l), Lextf);
+        record(_distftotd, _distftotv, ell, l, Lextf);
     }
 }
 
@@ -45,6 +45,7 @@ protected:
 
 private:
     ParallelDataCube _distftotv;
+    int _distftotd;     // detector handle
 };
 
 ////////////////////////////////////////////////////////////////////
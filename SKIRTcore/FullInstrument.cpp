@@ -6,7 +6,6 @@
 #include "DustEmissivity.hpp"
 #include "FatalError.hpp"
 #include "FullInstrument.hpp"
-#include "LockFree.hpp"
 #include "PanDustSystem.hpp"
 #include "PhotonPackage.hpp"
 #include "WavelengthGrid.hpp"
@@ -88,6 +87,29 @@ void FullInstrument::setupSelfBefore()
             _FtotVv.resize(Nlambda);
         }
     }
+
+    // register the detector arrays (arrays that remained empty are ignored)
+    _Ftravd = addDetector(_Ftrav);
+    _ftravd = addDetector(_ftrav.partialCube());
+    _Fstrdirvd = addDetector(_Fstrdirv);
+    _fstrdirvd = addDetector(_fstrdirv.partialCube());
+    _Fstrscavd = addDetector(_Fstrscav);
+    _fstrscavd = addDetector(_fstrscav.partialCube());
+    _Fdusdirvd = addDetector(_Fdusdirv);
+    _fdusdirvd = addDetector(_fdusdirv.partialCube());
+    _Fdusscavd = addDetector(_Fdusscav);
+    _fdusscavd = addDetector(_fdusscav.partialCube());
+    _FtotQvd = addDetector(_FtotQv);
+    _ftotQvd = addDetector(_ftotQv.partialCube());
+    _FtotUvd = addDetector(_FtotUv);
+    _ftotUvd = addDetector(_ftotUv.partialCube());
+    _FtotVvd = addDetector(_FtotVv);
+    _ftotVvd = addDetector(_ftotVv.partialCube());
+    for (size_t nscatt=0; nscatt<_fstrscavv.size(); nscatt++)
+    {
+        _Fstrscavvd.push_back(addDetector(_Fstrscavv[nscatt]));
+        _fstrscavvd.push_back(addDetector(_fstrscavv[nscatt].partialCube()));
+    }
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -121,25 +143,25 @@ void FullInstrument::detect(PhotonPackage* pp)
     {
         if (nscatt==0)
         {
-            LockFree::add(_Ftrav[ell], L);
-            if (_dustsystem) LockFree::add(_Fstrdirv[ell], Lextf);
+            record(_Ftravd, _Ftrav[ell], L);
+            if (_dustsystem) record(_Fstrdirvd, _Fstrdirv[ell], Lextf);
         }
         else
         {
-            LockFree::add(_Fstrscav[ell], Lextf);
-            if (nscatt<=_Nscatt) LockFree::add(_Fstrscavv[nscatt-1][ell], Lextf);
+            record(_Fstrscavd, _Fstrscav[ell], Lextf);
+            if (nscatt<=_Nscatt) record(_Fstrscavvd[nscatt-1], _Fstrscavv[nscatt-1][ell], Lextf);
         }
     }
     else
     {
-        if (nscatt==0) LockFree::add(_Fdusdirv[ell], Lextf);
-        else LockFree::add(_Fdusscav[ell], Lextf);
+        if (nscatt==0) record(_Fdusdirvd, _Fdusdirv[ell], Lextf);
+        else record(_Fdusscavd, _Fdusscav[ell], Lextf);
     }
     if (_polarization)
     {
-        LockFree::add(_FtotQv[ell], Lextf*pp->stokesQ());
-        LockFree::add(_FtotUv[ell], Lextf*pp->stokesU());
-        LockFree::add(_FtotVv[ell], Lextf*pp->stokesV());
+        record(_FtotQvd, _FtotQv[ell], Lextf*pp->stokesQ());
+        record(_FtotUvd, _FtotUv[ell], Lextf*pp->stokesU());
+        record(_FtotVvd, _FtotVv[ell], Lextf*pp->stokesV());
     }
 
     // frames
@@ -149,29 +171,29 @@ void FullInstrument::detect(PhotonPackage* pp)
         {
             if (nscatt==0)
             {
-                LockFree::add(_ftrav(ell,l), L);
+                record(_ftravd, _ftrav, ell, l, L);
                 if (_dustsystem)
-                    LockFree::add(_fstrdirv(ell,l), Lextf);
+                    record(_fstrdirvd, _fstrdirv, ell, l, Lextf);
             }
             else
             {
-                LockFree::add(_fstrscav(ell,l), Lextf);
+                record(_fstrscavd, _fstrscav, ell, l, Lextf);
                 if (nscatt<=_Nscatt)
-                    LockFree::add(_fstrscavv[nscatt-1](ell,l), Lextf);
+                    record(_fstrscavvd[nscatt-1], _fstrscavv[nscatt-1], ell, l, Lextf);
             }
         }
         else
         {
             if (nscatt==0)
-                LockFree::add(_fdusdirv(ell,l), Lextf);
+                record(_fdusdirvd, _fdusdirv, ell, l, Lextf);
             else
-                LockFree::add(_fdusscav(ell,l), Lextf);
+                record(_fdusscavd, _fdusscav, ell, l, Lextf);
         }
         if (_polarization)
         {
-            LockFree::add(_ftotQv(ell,l), Lextf*pp->stokesQ());
-            LockFree::add(_ftotUv(ell,l), Lextf*pp->stokesU());
-            LockFree::add(_ftotVv(ell,l), Lextf*pp->stokesV());
+            record(_ftotQvd, _ftotQv, ell, l, Lextf*pp->stokesQ());
+            record(_ftotUvd, _ftotUv, ell, l, Lextf*pp->stokesU());
+            record(_ftotVvd, _ftotVv, ell, l, Lextf*pp->stokesV());
         }
     }
 }
@@ -213,35 +235,39 @@ void FullInstrument::write()
         }
     }
 
-    // compute the total flux and the total dust flux in temporary arrays
-    Array ftotv;
+    // compute the total flux and the total dust flux SEDs in temporary arrays; the corresponding
+    // frames are written as sums of the component cubes, avoiding temporary copies of the cubes
+    QList<Array*> ftotv;
+    QList<Array*> ftravv;
+    QList<Array*> ftotdusv;
     Array Ftotv;
-    Array ftotdusv;
     Array Ftotdusv;
+    ftravv << ftravComp.get();
     if (_dustemission)
     {
-        ftotv = *fstrdirvComp + *fstrscavComp + *fdusdirvComp + *fdusscavComp;
+        ftotv << fstrdirvComp.get() << fstrscavComp.get() << fdusdirvComp.get() << fdusscavComp.get();
         Ftotv = _Fstrdirv + _Fstrscav + _Fdusdirv + _Fdusscav;
-        ftotdusv = *fdusdirvComp + *fdusscavComp;
+        ftotdusv << fdusdirvComp.get() << fdusscavComp.get();
         Ftotdusv = _Fdusdirv + _Fdusscav;
     }
     else if (_dustsystem)
     {
-        ftotv = *fstrdirvComp + *fstrscavComp;
+        ftotv << fstrdirvComp.get() << fstrscavComp.get();
         Ftotv = _Fstrdirv + _Fstrscav;
     }
     else
     {
         // don't output transparent frame separately because it is identical to the total frame
-        ftotv = *ftravComp;
-        ftravComp->resize(0);
+        ftotv << ftravComp.get();
+        ftravv.clear();
         // do output integrated fluxes to avoid confusing zeros
         Ftotv = _Ftrav;
         _Fstrdirv = _Ftrav;
     }
 
     // lists of f-array and F-array pointers, and the corresponding file and column names
-    QList<Array*> farrays, Farrays;
+    QList< QList<Array*> > farrays;
+    QList<Array*> Farrays;
     QStringList fnames, Fnames;
 
     // SEDs
@@ -266,33 +292,33 @@ void FullInstrument::write()
     sumResults(Farrays);
 
     // Frames
-    farrays << &ftotv << ftravComp.get();
+    farrays << ftotv << ftravv;
     fnames << "total" << "transparent";
     if (_dustsystem)
     {
-        farrays << fstrdirvComp.get() << fstrscavComp.get();
+        farrays << (QList<Array*>() << fstrdirvComp.get()) << (QList<Array*>() << fstrscavComp.get());
         fnames << "direct" << "scattered";
         if (_dustemission)
         {
-            farrays << &ftotdusv << fdusscavComp.get();
+            farrays << ftotdusv << (QList<Array*>() << fdusscavComp.get());
             fnames << "dust" << "dustscattered";
         }
     }
     if (_polarization)
     {
-        farrays << ftotQvComp.get() << ftotUvComp.get() << ftotVvComp.get();
+        farrays << (QList<Array*>() << ftotQvComp.get()) << (QList<Array*>() << ftotUvComp.get())
+                << (QList<Array*>() << ftotVvComp.get());
         fnames << "stokesQ" << "stokesU" << "stokesV";
     }
     if (_dustsystem)
     {
         for (int nscatt=0; nscatt<_Nscatt; nscatt++)
         {
-            farrays << fstrscavvComp[nscatt].get();
+            farrays << (QList<Array*>() << fstrscavvComp[nscatt].get());
             fnames << ("scatteringlevel" + QString::number(nscatt+1));
         }
     }
 
-
     // calibrate and output the arrays
     calibrateAndWriteDataCubes(farrays, fnames);
     calibrateAndWriteSEDs(Farrays, Fnames);
@@ -147,6 +147,12 @@ private:
     Array _FtotQv;
     Array _FtotUv;
     Array _FtotVv;
+
+    // detector handles corresponding to the detector arrays
+    int _ftravd, _fstrdirvd, _fstrscavd, _fdusdirvd, _fdusscavd, _ftotQvd, _ftotUvd, _ftotVvd;
+    int _Ftravd, _Fstrdirvd, _Fstrscavd, _Fdusdirvd, _Fdusscavd, _FtotQvd, _FtotUvd, _FtotVvd;
+    std::vector<int> _fstrscavvd;
+    std::vector<int> _Fstrscavvd;
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -303,3 +303,28 @@ void Image::saveto(const SimulationItem* item, const Array& data, QString filena
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void Image::saveto(const SimulationItem* item, std::function<void(int frame, Array& values)> frame,
+                   QString filename, QString description, bool compress)
+{
+    // Cache a pointer to the logger
+    Log* log = item->find<Log>();
+
+    // Determine the path of the output FITS file
+    QString filepath = item->find<FilePaths>()->output(filename.endsWith(".fits") ? filename : filename + ".fits");
+
+    // Try to find a PeerToPeerCommunicator object
+    PeerToPeerCommunicator* comm = 0;
+    try {comm = item->find<PeerToPeerCommunicator>();}
+    catch (FatalError) {}
+
+    // Only write the FITS file if this process is the root or no PeerToPeerCommunicator was found
+    if (!comm || comm->isRoot())
+    {
+        log->info("Writing " + description + " to " + filepath + "...");
+        FITSInOut::write(filepath, frame, _xsize, _ysize, _nframes, _incx, _incy, _xc, _yc, _dataunits, _xyunits,
+                         compress);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
@@ -6,6 +6,7 @@
 #ifndef IMAGE_HPP
 #define IMAGE_HPP
 
+#include <functional>
 #include <QString>
 #include "Array.hpp"
 class SimulationItem;
@@ -126,6 +127,16 @@ public:
         FITS file. */
     void saveto(const SimulationItem* item, const Array& data, QString filename, QString description);
 
+    /** This function saves a FITS file with the header information contained in this Image
+        instance, obtaining the data one frame at a time from the specified function, which is
+        called with the index of the frame and an Array that should be filled with the values of
+        the frame (see FITSInOut::write()). This allows a large data cube to be calibrated and
+        written without a second copy of the complete cube in memory. If \em compress is true, the
+        FITS file is losslessly tile compressed. Different files may be saved concurrently from
+        multiple threads. */
+    void saveto(const SimulationItem* item, std::function<void(int frame, Array& values)> frame,
+                QString filename, QString description, bool compress = false);
+
     //=================== Numerical operations =====================
 
     //========================= Operators ==========================
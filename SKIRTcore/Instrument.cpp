@@ -6,7 +6,11 @@
 #include "Instrument.hpp"
 #include "DustSystem.hpp"
 #include "FatalError.hpp"
+#include "InstrumentSystem.hpp"
+#include "LockFree.hpp"
 #include "Log.hpp"
+#include "ParallelDataCube.hpp"
+#include "ParallelFactory.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
 #include "TimeLogger.hpp"
@@ -16,7 +20,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 Instrument::Instrument()
-    : _ds(0)
+    : _ds(0), _parfac(0), _private(false)
 {
 }
 
@@ -40,6 +44,39 @@ void Instrument::setupSelfBefore()
 
 ////////////////////////////////////////////////////////////////////
 
+void Instrument::setupSelfAfter()
+{
+    SimulationItem::setupSelfAfter();
+
+    _parfac = find<ParallelFactory>();
+    int Nthreads = _parfac->maxThreadCount();
+    if (Nthreads < 2 || _detectors.empty()) return;
+
+    // determine the memory needed for private copies of all detector arrays for all threads
+    size_t Ndetector = 0;
+    for (Array* detector : _detectors) Ndetector += detector->size();
+    size_t bytes = Nthreads * Ndetector * sizeof(double);
+
+    // ask the instrument system whether we can afford the private copies
+    InstrumentSystem* is = find<InstrumentSystem>();
+    if (is->reservePrivateDetectorMemory(bytes))
+    {
+        _private = true;
+        _privatevv.resize(Nthreads);
+        find<Log>()->info("Instrument " + _instrumentname + " uses private detector arrays for "
+                          + QString::number(Nthreads) + " threads ("
+                          + QString::number(bytes/1e9) + " GB)");
+    }
+    else if (is->privateDetectors())
+    {
+        find<Log>()->warning("Private detector arrays for instrument " + _instrumentname + " would need "
+                             + QString::number(bytes/1e9) + " GB, which exceeds the memory budget;"
+                             + " using atomic updates instead");
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void Instrument::setInstrumentName(QString value)
 {
     _instrumentname = value;
@@ -54,6 +91,58 @@ QString Instrument::instrumentName() const
 
 ////////////////////////////////////////////////////////////////////
 
+int Instrument::addDetector(Array& detector)
+{
+    if (!detector.size()) return -1;
+    _detectors.push_back(&detector);
+    return _detectors.size()-1;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::record(int detector, double& target, double value)
+{
+    if (_private && detector >= 0)
+    {
+        // get the private copies for this thread, allocating them if this is the first contribution
+        std::vector<Array>& privatev = _privatevv[_parfac->currentThreadIndex()];
+        if (privatev.empty())
+        {
+            privatev.resize(_detectors.size());
+            for (size_t d=0; d<_detectors.size(); d++) privatev[d].resize(_detectors[d]->size());
+        }
+
+        // update the private location corresponding to the target
+        privatev[detector][&target - begin(*_detectors[detector])] += value;
+        return;
+    }
+    LockFree::add(target, value);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::record(int detector, ParallelDataCube& cube, int ell, int pixel, double value)
+{
+    if (cube.isLocal(ell)) record(detector, cube(ell,pixel), value);
+    else cube.ship(ell, pixel, value);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Instrument::sumPrivateDetectors()
+{
+    if (!_private) return;
+
+    for (std::vector<Array>& privatev : _privatevv)
+    {
+        for (size_t d=0; d<privatev.size(); d++) *_detectors[d] += privatev[d];
+        privatev.clear();
+    }
+    _private = false;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void Instrument::sumResults(QList<Array*> arrays)
 {
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
@@ -68,7 +157,17 @@ void Instrument::sumResults(QList<Array*> arrays)
 
 double Instrument::opticalDepth(PhotonPackage* pp, double distance) const
 {
-    return _ds ? _ds->opticaldepth(pp,distance) : 0;
+    if (!_ds) return 0;
+    if (distance < DBL_MAX) return _ds->opticaldepth(pp,distance);
+
+    // reuse the optical depth over the complete path if it was already calculated for this peel off
+    double tau = pp->instrumentOpticalDepth();
+    if (tau < 0)
+    {
+        tau = _ds->opticaldepth(pp,distance);
+        pp->setInstrumentOpticalDepth(tau);
+    }
+    return tau;
 }
 
 ////////////////////////////////////////////////////////////////////
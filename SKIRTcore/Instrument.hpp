@@ -8,11 +8,13 @@
 
 #include <cfloat>
 #include <vector>
+#include "Array.hpp"
 #include "Direction.hpp"
 #include "Position.hpp"
 #include "SimulationItem.hpp"
-class Array;
 class DustSystem;
+class ParallelDataCube;
+class ParallelFactory;
 class PhotonPackage;
 
 ////////////////////////////////////////////////////////////////////
@@ -23,7 +25,13 @@ class PhotonPackage;
     responsible for the transformation from world coordinates to instrument coordinates, allowing
     various perspective schemes in different subclasses. This top-level abstract class offers a
     generic interface for receiving photon packages from the simulation, and for appropriately
-    locking the instrument's data structure when photon packages may arrive in parallel. */
+    locking the instrument's data structure when photon packages may arrive in parallel.
+
+    By default, the detector arrays are shared by all parallel threads and each contribution is
+    added through an atomic operation. If so requested in the instrument system, and if the memory
+    budget allows it, the instrument instead gives each thread a private copy of its detector
+    arrays. The private copies are summed into the shared detector arrays once, at the end of the
+    simulation, before the results are combined across processes. */
 class Instrument : public SimulationItem
 {
     friend class InstrumentFrame;
@@ -43,6 +51,14 @@ protected:
     /** This function performs setup for the instrument. */
     void setupSelfBefore();
 
+    /** This function decides whether the detector arrays registered by the subclass during setup
+        (see addDetector()) will be shadowed by per-thread private copies. This is the case if the
+        instrument system allows private detector arrays, if the simulation uses more than one
+        thread, and if the memory required for the private copies fits within the budget offered
+        by the instrument system. The private copies are allocated by each thread when it first
+        records a contribution. */
+    void setupSelfAfter();
+
     //======== Setters & Getters for Discoverable Attributes =======
 
 public:
@@ -56,6 +72,31 @@ public:
     //======================== Other Functions =======================
 
 protected:
+    /** This function registers the specified array as a detector array for this instrument, i.e.
+        an array that is updated from the detect() function through the record() function. It
+        should be called from the setupSelfBefore() function of a subclass (or of a child item)
+        after the array has been given its final size. The function returns a handle that must be
+        passed to the record() function for each contribution to the array. Empty arrays are
+        ignored; in that case the function returns -1. */
+    int addDetector(Array& detector);
+
+    /** This function adds the specified value to the specified target location in one of the
+        instrument's detector arrays, in a thread-safe manner. The target location must lie in the
+        detector array with the specified handle, as returned by addDetector(), or the handle must
+        be -1 if the array has not been registered. If the instrument uses private detector arrays
+        and the array has been registered, the value is added to the corresponding location in the
+        private copy of the calling thread. Otherwise, the value is added to the target location
+        through an atomic operation. */
+    void record(int detector, double& target, double value);
+
+    /** This function adds the specified value to the specified wavelength and pixel of the
+        specified data cube, in a thread-safe manner. If the data cube stores the wavelength at
+        this process, the value is recorded as described for the other version of this function.
+        Otherwise, i.e. for a data cube that is distributed across the processes in task
+        parallelization mode, the value is shipped to the process storing the wavelength. The
+        handle is the one returned by addDetector() for the partial cube of the data cube. */
+    void record(int detector, ParallelDataCube& cube, int ell, int pixel, double value);
+
     /** This function is used to sum a list of flux arrays element-wise across the different
         processes. The resulting arrays with the total fluxes are stored in the memory of the root
         process, replacing the original fluxes. This function can be called a different number of
@@ -82,6 +123,13 @@ public:
         can be provided. */
     virtual void detect(PhotonPackage* pp) = 0;
 
+    /** If the instrument uses private detector arrays, this function adds the contents of the
+        private copies for all threads to the corresponding shared detector arrays, and releases
+        the memory held by the private copies. Otherwise the function does nothing. It must be
+        called after all photon packages have been detected and before the write() function is
+        invoked, outside of any parallel execution. */
+    void sumPrivateDetectors();
+
     /** This function calibrates the instrument and writes down the entire contents to a set of
         files. Its implementation must be provided in a subclass. */
     virtual void write() = 0;
@@ -89,7 +137,10 @@ public:
     /** This function is provided for use in subclasses. It calculates and returns the optical
         depth over the specified distance along the current path of the specified photon package,
         at the photon package's wavelength. If the distance is not specified, the complete path is
-        taken into account. */
+        taken into account. In that case, the optical depth is stored in the photon package (see
+        PhotonPackage::setInstrumentOpticalDepth()), and subsequent calls for the same photon
+        package, e.g. from other instruments observing from the same direction, return the stored
+        value without recalculating the path. */
     double opticalDepth(PhotonPackage* pp, double distance=DBL_MAX) const;
 
     //======================== Data Members ========================
@@ -101,6 +152,10 @@ protected:
 private:
     // other data members
     DustSystem* _ds;   // cached pointer to dust system to call opticalDepth() function
+    ParallelFactory* _parfac;                 // cached pointer to the parallel factory to obtain thread indices
+    std::vector<Array*> _detectors;           // the registered detector arrays
+    bool _private;                            // true if the detector arrays are shadowed by private copies
+    std::vector<std::vector<Array>> _privatevv; // private copies, indexed on thread and detector
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -9,7 +9,6 @@
 #include "Image.hpp"
 #include "InstrumentFrame.hpp"
 #include "Log.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "MultiFrameInstrument.hpp"
 #include "StellarSystem.hpp"
@@ -62,6 +61,10 @@ void InstrumentFrame::setupSelfBefore()
     // initialize pixel frame(s)
     if (_writeTotal) _ftotv.resize(_Nframep);
     if (_writeStellarComps) _fcompvv.resize(find<StellarSystem>()->Ncomp(), _Nframep);
+
+    // register the pixel frame(s) as detector arrays of the parent instrument
+    _ftotd = _instrument->addDetector(_ftotv);
+    for (size_t k=0; k<_fcompvv.size(0); k++) _fcompdv.push_back(_instrument->addDetector(_fcompvv[k]));
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -181,8 +184,12 @@ void InstrumentFrame::detect(PhotonPackage* pp)
         double extf = exp(-taupath);
         double Lextf = L*extf;
 
-        if (_writeTotal) LockFree::add(_ftotv[l], Lextf);
-        if (_writeStellarComps && pp->isStellar()) LockFree::add(_fcompvv(pp->stellarCompIndex(),l), Lextf);
+        if (_writeTotal) _instrument->record(_ftotd, _ftotv[l], Lextf);
+        if (_writeStellarComps && pp->isStellar())
+        {
+            int k = pp->stellarCompIndex();
+            _instrument->record(_fcompdv[k], _fcompvv(k,l), Lextf);
+        }
     }
 }
 
@@ -170,6 +170,10 @@ private:
     // total flux per pixel
     Array _ftotv;
     ArrayTable<2> _fcompvv;
+
+    // handles of the pixel frames registered as detector arrays of the parent instrument
+    int _ftotd;
+    std::vector<int> _fcompdv;
 };
 
 ////////////////////////////////////////////////////////////////////
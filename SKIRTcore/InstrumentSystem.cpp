@@ -3,20 +3,92 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include "DataCubeExchange.hpp"
+#include "DistantInstrument.hpp"
 #include "FatalError.hpp"
 #include "Instrument.hpp"
 #include "InstrumentSystem.hpp"
+#include "Log.hpp"
+#include "ParallelFactory.hpp"
+#include "PeerToPeerCommunicator.hpp"
+#include "StaggeredAssigner.hpp"
+#include "TimeLogger.hpp"
+#include "WavelengthGrid.hpp"
 
 using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 
 InstrumentSystem::InstrumentSystem()
+    : _privateDetectors(false), _privateDetectorMemory(1), _compressDataCubes(false), _privateDetectorBudget(0),
+      _cubeAssigner(0)
 {
 }
 
 //////////////////////////////////////////////////////////////////////
 
+InstrumentSystem::~InstrumentSystem()
+{
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::setupSelfBefore()
+{
+    SimulationItem::setupSelfBefore();
+
+    // the instruments are set up after this function returns, and each of them consumes part of the budget
+    _privateDetectorBudget = _privateDetectors ? static_cast<size_t>(_privateDetectorMemory * 1e9) : 0;
+
+    // the data cubes of the instruments register with the exchange during their setup
+    PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
+    if (comm->distributedCubes() && comm->isMultiProc() && !comm->dataParallel() && !_cubeExchange)
+    {
+        _cubeAssigner = new StaggeredAssigner(find<WavelengthGrid>()->Nlambda(), this);
+        _cubeExchange.reset(new DataCubeExchange(comm, find<ParallelFactory>()));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::setupSelfAfter()
+{
+    SimulationItem::setupSelfAfter();
+
+    // group the distant instruments by direction towards the observer;
+    // the direction doesn't depend on the launch position so we can use any position
+    _groups.clear();
+    foreach (Instrument* instrument, _instruments)
+    {
+        DistantInstrument* distant = dynamic_cast<DistantInstrument*>(instrument);
+        bool added = false;
+        if (distant)
+        {
+            Direction bfkobs = distant->bfkobs(Position());
+            for (auto& group : _groups)
+            {
+                DistantInstrument* first = dynamic_cast<DistantInstrument*>(group[0]);
+                if (!first) continue;
+                Direction other = first->bfkobs(Position());
+                if (other.x() == bfkobs.x() && other.y() == bfkobs.y() && other.z() == bfkobs.z())
+                {
+                    group.push_back(instrument);
+                    added = true;
+                    break;
+                }
+            }
+        }
+        if (!added) _groups.push_back(vector<Instrument*>(1, instrument));
+    }
+
+    if (_groups.size() < static_cast<size_t>(_instruments.size()))
+        find<Log>()->info("Instruments with the same viewing direction share peel off paths: "
+                          + QString::number(_instruments.size()) + " instruments in "
+                          + QString::number(_groups.size()) + " groups");
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void InstrumentSystem::insertInstrument(int index, Instrument* value)
 {
     if (!value) throw FATALERROR("Instrument pointer shouldn't be null");
@@ -40,9 +112,94 @@ QList<Instrument*> InstrumentSystem::instruments() const
 
 //////////////////////////////////////////////////////////////////////
 
+void InstrumentSystem::setPrivateDetectors(bool value)
+{
+    _privateDetectors = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool InstrumentSystem::privateDetectors() const
+{
+    return _privateDetectors;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::setPrivateDetectorMemory(double value)
+{
+    _privateDetectorMemory = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double InstrumentSystem::privateDetectorMemory() const
+{
+    return _privateDetectorMemory;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void InstrumentSystem::setCompressDataCubes(bool value)
+{
+    _compressDataCubes = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool InstrumentSystem::compressDataCubes() const
+{
+    return _compressDataCubes;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool InstrumentSystem::reservePrivateDetectorMemory(size_t bytes)
+{
+    if (!_privateDetectors || bytes > _privateDetectorBudget) return false;
+    _privateDetectorBudget -= bytes;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+const vector<vector<Instrument*>>& InstrumentSystem::instrumentGroups() const
+{
+    return _groups;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+const ProcessAssigner* InstrumentSystem::cubeAssigner() const
+{
+    return _cubeAssigner;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+DataCubeExchange* InstrumentSystem::cubeExchange() const
+{
+    return _cubeExchange.get();
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void InstrumentSystem::write()
 {
-    foreach (Instrument* instrument, _instruments) instrument->write();
+    if (_cubeExchange)
+    {
+        Log* log = find<Log>();
+        TimeLogger logger(log->verbose() ? log : 0, "exchange of the contributions to distributed data cubes");
+        _cubeExchange->finish();
+        log->info("Shipped " + QString::number(_cubeExchange->shipped())
+                  + " detected contributions for foreign wavelengths to other processes");
+    }
+
+    foreach (Instrument* instrument, _instruments)
+    {
+        instrument->sumPrivateDetectors();
+        instrument->write();
+    }
 }
 
 //////////////////////////////////////////////////////////////////////
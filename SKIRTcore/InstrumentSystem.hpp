@@ -6,11 +6,14 @@
 #ifndef INSTRUMENTSYSTEM_HPP
 #define INSTRUMENTSYSTEM_HPP
 
+#include <memory>
 #include <vector>
 #include <QPair>
 #include "SimulationItem.hpp"
+class DataCubeExchange;
 class Instrument;
 class ParallelFactory;
+class ProcessAssigner;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -27,12 +30,49 @@ class InstrumentSystem : public SimulationItem
     Q_CLASSINFO("Optional", "true")
     Q_CLASSINFO("Default", "SimpleInstrument")
 
+    Q_CLASSINFO("Property", "privateDetectors")
+    Q_CLASSINFO("Title", "accumulate detected fluxes in per-thread private detector arrays")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
+    Q_CLASSINFO("Property", "privateDetectorMemory")
+    Q_CLASSINFO("Title", "the maximum memory (in GB) to be used for private detector arrays")
+    Q_CLASSINFO("MinValue", "0")
+    Q_CLASSINFO("Default", "1")
+    Q_CLASSINFO("Silent", "true")
+    Q_CLASSINFO("RelevantIf", "privateDetectors")
+
+    Q_CLASSINFO("Property", "compressDataCubes")
+    Q_CLASSINFO("Title", "losslessly compress the FITS files holding the instrument data cubes")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
     /** The default constructor; creates an empty instrument system. */
     Q_INVOKABLE InstrumentSystem();
 
+    /** Destructs the instrument system, including the exchange for distributed data cubes. */
+    ~InstrumentSystem();
+
+protected:
+    /** This function resets the memory budget for private detector arrays, which is consumed by
+        the instruments during their setup (see reservePrivateDetectorMemory()). If the data cubes
+        of the instruments should be distributed across multiple processes in task
+        parallelization mode (see PeerToPeerCommunicator::distributedCubes()), the function also
+        creates the wavelength assigner and the exchange used by the distributed data cubes (see
+        cubeAssigner() and cubeExchange()). */
+    void setupSelfBefore();
+
+    /** This function groups the instruments that observe the system from the same direction, so
+        that peel off photon packages can be shared between them (see instrumentGroups()). Each
+        DistantInstrument is added to the group of the first preceding DistantInstrument with the
+        same direction towards the observer, if any. Other instruments, for which the direction
+        towards the observer depends on the launch position, each form a group of their own. The
+        groups and their members are listed in the same order as the instruments. */
+    void setupSelfAfter();
+
     //======== Setters & Getters for Discoverable Attributes =======
 
 public:
@@ -45,11 +85,70 @@ public:
     /** This function returns the list of instruments in the instrument system. */
     Q_INVOKABLE QList<Instrument*> instruments() const;
 
+    /** Sets the flag indicating whether the instruments should accumulate detected fluxes in
+        private copies of their detector arrays, one for each parallel thread, rather than
+        updating the shared detector arrays through atomic operations. Private detector arrays
+        avoid contention between threads for popular pixels and for the integrated SEDs, at the
+        cost of extra memory. The private copies are summed into the shared detector arrays before
+        the instrument data is written. The default value is false. */
+    Q_INVOKABLE void setPrivateDetectors(bool value);
+
+    /** Returns the flag indicating whether the instruments should accumulate detected fluxes in
+        per-thread private detector arrays. */
+    Q_INVOKABLE bool privateDetectors() const;
+
+    /** Sets the maximum amount of memory, in GB, that may be allocated for private detector arrays
+        summed over all instruments and threads. Instruments for which the private detector arrays
+        would exceed the remaining budget fall back to updating their shared detector arrays through
+        atomic operations. The default value is 1 GB. */
+    Q_INVOKABLE void setPrivateDetectorMemory(double value);
+
+    /** Returns the maximum amount of memory, in GB, that may be allocated for private detector
+        arrays. */
+    Q_INVOKABLE double privateDetectorMemory() const;
+
+    /** Sets the flag indicating whether the FITS files holding the data cubes of the instruments
+        should be losslessly compressed using the FITS tiled image compression convention. This
+        reduces the size of the files, in particular for data cubes with many empty pixels, at the
+        cost of some extra time for writing and reading. The default value is false. */
+    Q_INVOKABLE void setCompressDataCubes(bool value);
+
+    /** Returns the flag indicating whether the FITS files holding the instrument data cubes should
+        be compressed. */
+    Q_INVOKABLE bool compressDataCubes() const;
+
     //======================== Other Functions =======================
 
 public:
-    /** This function writes down the results of the instrument system. It calls the write()
-        function for each of the instruments. */
+    /** This function is called by an instrument during its setup to request the specified amount
+        of memory (in bytes) for its private detector arrays. If private detector arrays are
+        enabled and the request fits in the remaining budget, the function deducts the request from
+        the budget and returns true. Otherwise the function returns false, and the instrument
+        should update its shared detector arrays directly. */
+    bool reservePrivateDetectorMemory(size_t bytes);
+
+    /** This function returns the instruments in the instrument system, grouped by direction
+        towards the observer as determined during setup. Since all instruments in a group see a
+        given launch position along the same direction, they can detect the same peel off photon
+        package, which allows the path through the dust grid and the corresponding optical depth
+        to be calculated just once per group. */
+    const std::vector<std::vector<Instrument*>>& instrumentGroups() const;
+
+    /** This function returns the wavelength assigner that determines which process stores the
+        values for each wavelength of the data cubes distributed in task parallelization mode, or
+        null if the data cubes are not distributed in this way. */
+    const ProcessAssigner* cubeAssigner() const;
+
+    /** This function returns the exchange that ships contributions for foreign wavelengths
+        between the processes for the data cubes distributed in task parallelization mode, or null
+        if the data cubes are not distributed in this way. */
+    DataCubeExchange* cubeExchange() const;
+
+    /** This function writes down the results of the instrument system. If the data cubes are
+        distributed in task parallelization mode, it first completes the exchange of contributions
+        for foreign wavelengths between the processes. Then, for each of the instruments, it sums
+        any private detector arrays into the shared detector arrays, and calls the instrument's
+        write() function. */
     void write();
 
     //======================== Data Members ========================
@@ -57,6 +156,15 @@ public:
 private:
     // discoverable attributes
     QList<Instrument*> _instruments;
+    bool _privateDetectors;
+    double _privateDetectorMemory;
+    bool _compressDataCubes;
+
+    // data members initialized during setup
+    size_t _privateDetectorBudget;  // remaining memory budget for private detector arrays, in bytes
+    std::vector<std::vector<Instrument*>> _groups;  // the instruments grouped by direction towards the observer
+    const ProcessAssigner* _cubeAssigner;           // the wavelength assigner for distributed data cubes, or null
+    std::unique_ptr<DataCubeExchange> _cubeExchange; // the exchange for distributed data cubes, or null
 };
 
 ////////////////////////////////////////////////////////////////////
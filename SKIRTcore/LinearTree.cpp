@@ -0,0 +1,274 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include <cstdint>
+#include <cstring>
+#include "FatalError.hpp"
+#include "LinearTree.hpp"
+#include "TreeNode.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // returns the minimum coordinate of a box along the specified axis
+    inline double lower(const Box& box, int axis)
+    {
+        return axis==0 ? box.xmin() : (axis==1 ? box.ymin() : box.zmin());
+    }
+
+    // returns the maximum coordinate of a box along the specified axis
+    inline double upper(const Box& box, int axis)
+    {
+        return axis==0 ? box.xmax() : (axis==1 ? box.ymax() : box.zmax());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+LinearTree::LinearTree(const TreeNode* root, const vector<int>& cellnumberv)
+{
+    // count the cells
+    int Ncells = 0;
+    for (int m : cellnumberv) if (m >= 0) Ncells++;
+
+    // store the node records in depth-first order, keeping the children of each node together;
+    // reserve the final size so that the records don't move during construction
+    _nodev.reserve(cellnumberv.size());
+    _leafv.resize(Ncells, -1);
+    _nodev.resize(1);
+    addnode(root, 0, cellnumberv);
+    if (_nodev.size() != cellnumberv.size()) throw FATALERROR("Tree node count mismatch");
+
+    // calculate the ropes in order of increasing node index, so that the ropes of a node are
+    // always available before those of its children are calculated
+    int Nnodes = _nodev.size();
+    _ropev.resize(6*Nnodes, -1);
+    for (int n=0; n<Nnodes; n++) addropes(n);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+LinearTree::LinearTree(const char* data, size_t size)
+{
+    // get the number of nodes and cells from the start of the data
+    uint64_t Nnodes = 0, Ncells = 0;
+    if (size >= 2*sizeof(uint64_t))
+    {
+        memcpy(&Nnodes, data, sizeof(uint64_t));
+        memcpy(&Ncells, data+sizeof(uint64_t), sizeof(uint64_t));
+    }
+    size_t nodesize = Nnodes*sizeof(Node);
+    size_t ropesize = 6*Nnodes*sizeof(int);
+    size_t leafsize = Ncells*sizeof(int);
+    if (!Nnodes || Ncells > Nnodes || size != 2*sizeof(uint64_t) + nodesize + ropesize + leafsize)
+        throw FATALERROR("Linear tree data is inconsistent");
+
+    // copy the node records, ropes and leaf indices
+    data += 2*sizeof(uint64_t);
+    _nodev.resize(Nnodes);
+    memcpy(&_nodev[0], data, nodesize);
+    data += nodesize;
+    _ropev.resize(6*Nnodes);
+    memcpy(&_ropev[0], data, ropesize);
+    data += ropesize;
+    _leafv.resize(Ncells);
+    if (Ncells) memcpy(&_leafv[0], data, leafsize);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void LinearTree::addnode(const TreeNode* node, int index, const vector<int>& cellnumberv)
+{
+    Node& record = _nodev[index];
+    record.extent = node->extent();
+    record.level = node->level();
+    record.cell = cellnumberv[node->id()];
+    record.child = -1;
+    record.split = -1;
+
+    // a leaf node corresponds to a cell
+    if (node->ynchildless())
+    {
+        if (record.cell < 0 || record.cell >= static_cast<int>(_leafv.size()))
+            throw FATALERROR("Invalid cell number for tree leaf node");
+        _leafv[record.cell] = index;
+        return;
+    }
+
+    // determine the subdivision type
+    const vector<TreeNode*>& children = node->children();
+    int Nchildren = children.size();
+    if (Nchildren == 8) record.split = 3;
+    else if (Nchildren == 2)
+    {
+        const Box& box = children[0]->extent();
+        for (int axis=0; axis<3; axis++)
+            if (upper(box, axis) < upper(node->extent(), axis)) record.split = axis;
+        if (record.split < 0) throw FATALERROR("Cannot determine subdivision direction for tree node");
+    }
+    else throw FATALERROR("Unsupported number of children for tree node: " + QString::number(Nchildren));
+
+    // allocate consecutive records for the children, and then recursively add each child;
+    // the reference to the current record remains valid because enough memory has been reserved
+    int first = _nodev.size();
+    record.child = first;
+    _nodev.resize(first + Nchildren);
+    for (int i=0; i<Nchildren; i++) addnode(children[i], first+i, cellnumberv);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void LinearTree::addropes(int index)
+{
+    const Node& node = _nodev[index];
+    if (node.child < 0) return;
+    int Nchildren = node.split==3 ? 8 : 2;
+
+    for (int k=0; k<Nchildren; k++)
+    {
+        int n = node.child + k;
+        for (int wall=0; wall<6; wall++)
+        {
+            int axis = wall/2;
+            bool up = wall%2;
+
+            // walls between siblings lead directly to the sibling on the other side
+            int sibling = -1;
+            if (node.split == 3)
+            {
+                int bit = 1 << axis;
+                if (up && !(k&bit)) sibling = n + bit;
+                if (!up && (k&bit)) sibling = n - bit;
+            }
+            else if (node.split == axis)
+            {
+                if (up && k==0) sibling = n + 1;
+                if (!up && k==1) sibling = n - 1;
+            }
+
+            // other walls coincide with a wall of the father, so start from the father's rope
+            int target = _ropev[6*index+wall];
+            _ropev[6*n+wall] = sibling >= 0 ? sibling : (target >= 0 ? tightenrope(n, wall, target) : -1);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int LinearTree::tightenrope(int n, int wall, int target) const
+{
+    const Box& box = _nodev[n].extent;
+    int axis = wall/2;
+    bool up = wall%2;
+    double plane = up ? upper(box, axis) : lower(box, axis);
+
+    while (_nodev[target].child >= 0)
+    {
+        const Node& node = _nodev[target];
+        int Nchildren = node.split==3 ? 8 : 2;
+
+        // look for a child that touches the wall and covers it completely
+        int next = -1;
+        for (int k=0; k<Nchildren && next<0; k++)
+        {
+            const Box& child = _nodev[node.child+k].extent;
+            bool covers = up ? lower(child, axis) <= plane : upper(child, axis) >= plane;
+            for (int other=0; other<3 && covers; other++)
+            {
+                if (other != axis)
+                    covers = lower(child, other) <= lower(box, other) && upper(child, other) >= upper(box, other);
+            }
+            if (covers) next = node.child + k;
+        }
+        if (next < 0) break;
+        target = next;
+    }
+    return target;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int LinearTree::numNodes() const
+{
+    return _nodev.size();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int LinearTree::numCells() const
+{
+    return _leafv.size();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int LinearTree::cellIndex(Vec r) const
+{
+    if (!_nodev[0].extent.contains(r)) return -1;
+    return _nodev[descend(0, r)].cell;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int LinearTree::neighborCellIndex(int m, int wall, Vec r) const
+{
+    int target = _ropev[6*_leafv[m]+wall];
+    if (target >= 0 && _nodev[target].extent.contains(r)) return _nodev[descend(target, r)].cell;
+    return cellIndex(r);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+size_t LinearTree::memoryUsage() const
+{
+    return _nodev.capacity()*sizeof(Node) + (_ropev.capacity() + _leafv.capacity())*sizeof(int);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int LinearTree::descend(int n, Vec r) const
+{
+    while (true)
+    {
+        const Node& node = _nodev[n];
+        if (node.child < 0) return n;
+
+        // the maximum corner of the first child is the division point of the node
+        const Box& first = _nodev[node.child].extent;
+        switch (node.split)
+        {
+        case 0:  n = node.child + (r.x()<first.xmax() ? 0 : 1); break;
+        case 1:  n = node.child + (r.y()<first.ymax() ? 0 : 1); break;
+        case 2:  n = node.child + (r.z()<first.zmax() ? 0 : 1); break;
+        default: n = node.child + (r.x()<first.xmax() ? 0 : 1)
+                                + (r.y()<first.ymax() ? 0 : 2)
+                                + (r.z()<first.zmax() ? 0 : 4); break;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void LinearTree::serialize(vector<char>& data) const
+{
+    auto append = [&data] (const void* begin, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(begin);
+        data.insert(data.end(), bytes, bytes+size);
+    };
+
+    uint64_t Nnodes = _nodev.size();
+    uint64_t Ncells = _leafv.size();
+    append(&Nnodes, sizeof(uint64_t));
+    append(&Ncells, sizeof(uint64_t));
+    append(_nodev.data(), _nodev.size()*sizeof(Node));
+    append(_ropev.data(), _ropev.size()*sizeof(int));
+    append(_leafv.data(), _leafv.size()*sizeof(int));
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,139 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef LINEARTREE_HPP
+#define LINEARTREE_HPP
+
+#include <vector>
+#include "Box.hpp"
+class TreeNode;
+
+//////////////////////////////////////////////////////////////////////
+
+/** LinearTree is a compact, read-only representation of a finished tree of cuboidal nodes, as
+    constructed by a TreeDustGrid through a hierarchy of TreeNode objects. The TreeNode objects
+    each occupy a separate heap allocation and hold vectors of child and neighbor pointers, so that
+    traversing the tree involves a lot of pointer chasing. In contrast, a LinearTree stores all
+    nodes in a single array of fixed-size records (64 bytes each, i.e. one cache line). Each record
+    holds the extent of the node, the index of its first child (the children of a node are always
+    stored contiguously), the cell number of the node if it is a leaf, the subdivision type, and
+    the level of the node in the tree. The node records are arranged in depth-first order, with the
+    sibling groups of an octree in Morton (z-order) sequence, so that nodes that are close in space
+    tend to be close in memory.
+
+    In addition, the tree stores a "rope" for each of the six walls of each node, i.e. the index of
+    the smallest node that fully covers the region just beyond that wall, or -1 if the wall is on
+    the border of the domain. When a path leaves a leaf node through a given wall, the next leaf
+    node is found by following the rope for that wall and descending from the rope's target node
+    to the leaf containing the new position. This replaces a search from the root node or through
+    a list of neighbors, and requires neither recursion nor a stack.
+
+    Once a LinearTree has been constructed, the original TreeNode hierarchy is no longer needed
+    and can be deleted. The LinearTree is never modified after construction, so it can be safely
+    shared between parallel threads. */
+class LinearTree
+{
+    //================= Construction - Destruction =================
+
+public:
+    /** The constructor converts the tree with the specified root node into the linear
+        representation. The \em cellnumberv argument provides the cell number for each node in the
+        tree, indexed on the node identifier, with a value of -1 for nodes that are not a leaf. The
+        cell numbers of the leaf nodes must form the range \f$0\le m<N_\text{cells}\f$. The
+        children of each node must be octree children (eight nodes ordered with the x coordinate
+        varying fastest) or binary tree children (two nodes split along a single coordinate axis).
+        */
+    LinearTree(const TreeNode* root, const std::vector<int>& cellnumberv);
+
+    /** This constructor restores a tree from the binary representation produced by the
+        serialize() function, for example after it has been read back from a file. The constructor
+        throws a fatal error if the size of the data is inconsistent with the number of nodes and
+        cells recorded in it. */
+    LinearTree(const char* data, size_t size);
+
+private:
+    /** This function, only to be called from the constructor, stores the record for the specified
+        node at the specified index in the array of node records, and then recursively adds the
+        children of the node at the end of the array. */
+    void addnode(const TreeNode* node, int index, const std::vector<int>& cellnumberv);
+
+    /** This function, only to be called from the constructor, calculates the ropes for the
+        children of the node with the specified index, given that the ropes of the node itself
+        have already been calculated. */
+    void addropes(int index);
+
+    /** This function, only to be called from the constructor, returns the smallest node that
+        fully covers the region beyond the specified wall of the node with index \em n, starting
+        from the node with index \em target which is known to cover that region. It descends into
+        the children of the target as long as one of these children covers the complete wall. */
+    int tightenrope(int n, int wall, int target) const;
+
+    //======================== Other Functions =======================
+
+public:
+    /** This function returns the number of nodes in the tree. */
+    int numNodes() const;
+
+    /** This function returns the number of cells (i.e. leaf nodes) in the tree. */
+    int numCells() const;
+
+    /** This function returns the extent of the cell with number \f$m\f$. */
+    const Box& cellExtent(int m) const { return _nodev[_leafv[m]].extent; }
+
+    /** This function returns the level in the tree of the cell with number \f$m\f$, where the
+        root node has level zero. */
+    int cellLevel(int m) const { return _nodev[_leafv[m]].level; }
+
+    /** This function returns the number of the cell that contains the specified position, or -1 if
+        the position is outside the tree. The search starts at the root node and descends to the
+        leaf node containing the position. */
+    int cellIndex(Vec r) const;
+
+    /** This function returns the number of the cell that contains the specified position, which
+        should be located just beyond the specified wall of the cell with number \f$m\f$. The wall
+        is indicated by an index with the same meaning as the TreeNode::Wall enumeration. The
+        search follows the rope for the wall and descends from the rope's target to the leaf node
+        containing the position. If the position is not inside the rope's target, for example
+        because of rounding errors near a corner of the cell, the function falls back to a search
+        starting at the root node. The function returns -1 if the position is outside the tree. */
+    int neighborCellIndex(int m, int wall, Vec r) const;
+
+    /** This function returns the number of bytes of memory used by the tree. */
+    size_t memoryUsage() const;
+
+    /** This function appends a binary representation of the tree to the specified vector, so that
+        the tree can later be restored with the corresponding constructor. The representation
+        copies the node records, ropes and leaf indices as they are stored in memory, so it can be
+        read back only by a build of the code with the same memory layout and byte order. */
+    void serialize(std::vector<char>& data) const;
+
+private:
+    /** This function returns the index of the leaf node in the subtree of the node with index
+        \em n that contains the specified position, assuming that this position is inside node
+        \em n. */
+    int descend(int n, Vec r) const;
+
+    //======================== Data Members ========================
+
+private:
+    // the record for a single node; the split field is 0, 1 or 2 for a binary tree node divided
+    // along the x, y or z axis, respectively, 3 for an octree node, and -1 for a leaf node
+    struct Node
+    {
+        Box extent;     // the spatial extent of the node
+        int child;      // the index of the first child, or -1 for a leaf node
+        int cell;       // the cell number for a leaf node, or -1 for other nodes
+        short split;    // the subdivision type (see above)
+        short level;    // the level of the node in the tree
+    };
+
+    std::vector<Node> _nodev;   // the node records, in depth-first order
+    std::vector<int> _ropev;    // the ropes for each of the six walls of each node (-1 for the domain border)
+    std::vector<int> _leafv;    // the index of the leaf node for each cell number
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif // LINEARTREE_HPP
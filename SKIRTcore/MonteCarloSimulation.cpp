@@ -3,6 +3,8 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include "ChunkDispatcher.hpp"
+#include "DistantInstrument.hpp"
 #include "DustDistribution.hpp"
 #include "DustMix.hpp"
 #include "DustSystem.hpp"
@@ -10,6 +12,7 @@
 #include "Instrument.hpp"
 #include "InstrumentSystem.hpp"
 #include "Log.hpp"
+#include "MemoryStatistics.hpp"
 #include "MonteCarloSimulation.hpp"
 #include "NR.hpp"
 #include "Parallel.hpp"
@@ -18,20 +21,38 @@
 #include "PhotonPackage.hpp"
 #include "ProcessAssigner.hpp"
 #include "Random.hpp"
+#include "ScratchArena.hpp"
 #include "StellarSystem.hpp"
 #include "TextOutFile.hpp"
 #include "TimeLogger.hpp"
 #include "Units.hpp"
+#include "WavelengthBundle.hpp"
 #include "WavelengthGrid.hpp"
 
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the number of photon packages handled by each thread in each phase before heap allocations are counted
+    const quint64 warmupPackages = 2000;
+
+    // the number of photon shooting phases started so far by all simulations in this process
+    std::atomic<quint64> _allocationPhases(0);
+
+    // the phase for which the calling thread is tracking its warm-up, and the number of warm-up packages
+    // handled by the thread in that phase
+    thread_local quint64 _warmupPhase = 0;
+    thread_local quint64 _warmupDone = 0;
+}
+
+////////////////////////////////////////////////////////////////////
+
 MonteCarloSimulation::MonteCarloSimulation()
     : _is(0), _packages(0), _minWeightReduction(1e4),
-      _minfs(0), _xi(0.5), _continuousScattering(false),
-      _lambdagrid(0), _ss(0), _ds(0)
+      _minfs(0), _xi(0.5), _continuousScattering(false), _wavelengthBundleSize(1),
+      _lambdagrid(0), _ss(0), _ds(0), _Nphases(0), _allocationPhase(0)
 {
 }
 
@@ -54,6 +75,8 @@ void MonteCarloSimulation::setupSelfBefore()
         throw FATALERROR("The minimum number of scattering events should be smaller than 1000");
     if (_xi < 0 || _xi > 1)
         throw FATALERROR("The scattering bias should be between 0 and 1");
+    if (_wavelengthBundleSize < 1)
+        throw FATALERROR("The wavelength bundle size should be at least 1");
     if (!_lambdagrid)
         throw FATALERROR("Wavelength grid was not set");
     if (!_ss)
@@ -65,10 +88,11 @@ void MonteCarloSimulation::setupSelfBefore()
 
 ////////////////////////////////////////////////////////////////////
 
-void MonteCarloSimulation::setChunkParams(double packages)
+void MonteCarloSimulation::setChunkParams(double packages, int bundlesize, bool ondemand)
 {
-    // Cache the number of wavelengths
+    // Cache the number of wavelengths and the number of wavelengths per photon package
     _Nlambda = _lambdagrid->Nlambda();
+    _bundlesize = bundlesize;
 
     // Determine the number of chunks and the corresponding chunk size
     if (packages <= 0)
@@ -76,6 +100,7 @@ void MonteCarloSimulation::setChunkParams(double packages)
         _Nchunks = 0;
         _chunksize = 0;
         _Npp = 0;
+        _firstchunk = 0;
     }
     else
     {
@@ -84,9 +109,11 @@ void MonteCarloSimulation::setChunkParams(double packages)
         int Nthreads = _parfac->maxThreadCount();
 
         // Step 1: consider threading and determine the total number of chunks
+        // (for reproducible random streams, the chunk structure may not depend on the parallelization)
         int totalChunks = 0;
-        if (Nthreads == 1) totalChunks = 1;
-        else totalChunks = ceil( std::max({(10.*double(Nthreads*Nprocs)/_Nlambda), packages/1e7}) );
+        if (_random->reproducible()) totalChunks = ceil(packages/1e5);
+        else if (Nthreads == 1) totalChunks = 1;
+        else totalChunks = ceil( std::max({(10.*double(Nthreads*Nprocs)*_bundlesize/_Nlambda), packages/1e7}) );
 
         // Step 2: consider the work division and determine the number of chunks per process (_Nchunks)
         if (_comm->dataParallel())  // Do some wavelengths for all chunks
@@ -94,6 +121,14 @@ void MonteCarloSimulation::setChunkParams(double packages)
             _chunksize = ceil(packages/totalChunks);
             _Nchunks = totalChunks;
             _myTotalNpp = _lambdagrid->assigner()->assigned() * _Nchunks * _chunksize;
+            _firstchunk = 0;
+        }
+        else if (ondemand)          // Do all wavelengths for the chunks handed out by a dispatcher
+        {
+            _chunksize = ceil(packages/totalChunks);
+            _Nchunks = totalChunks;
+            _myTotalNpp = _Nlambda * _Nchunks * _chunksize / Nprocs;
+            _firstchunk = 0;
         }
         else                        // Do all wavelengths for some chunks
         {
@@ -101,6 +136,7 @@ void MonteCarloSimulation::setChunkParams(double packages)
             _chunksize = ceil(packages/totalChunks);
             _Nchunks = totalChunks/Nprocs;
             _myTotalNpp = _Nlambda * _Nchunks * _chunksize;
+            _firstchunk = _comm->rank() * _Nchunks;
         }
 
         // Calculate the the definitive number of photon packages per wavelength
@@ -201,6 +237,20 @@ bool MonteCarloSimulation::continuousScattering() const
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::setWavelengthBundleSize(int value)
+{
+    _wavelengthBundleSize = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int MonteCarloSimulation::wavelengthBundleSize() const
+{
+    return _wavelengthBundleSize;
+}
+
+////////////////////////////////////////////////////////////////////
+
 int MonteCarloSimulation::dimension() const
 {
     return qMax(_ss->dimension(), _ds ? _ds->dimension() : 1);
@@ -212,6 +262,11 @@ void MonteCarloSimulation::initprogress(QString phase)
 {
     _phase = phase;
     _Ndone = 0;
+    _Nallocations = 0;
+    _Nmeasured = 0;
+    _allocationPhase = ++_allocationPhases;
+    _pathcapacityv.assign(_parfac->maxThreadCount(), 0);
+    _Nphases++;
 
     _log->info(QString::number(_Npp) + " photon packages for "
                + (_Nlambda==1 ? QString("a single wavelength") : QString("each of %1 wavelengths").arg(_Nlambda)));
@@ -221,6 +276,13 @@ void MonteCarloSimulation::initprogress(QString phase)
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::startphotonstream(int ell, quint64 j, quint64 i)
+{
+    _random->setStream(_Nphases, ell, (_firstchunk + j) * _chunksize + i);
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::logprogress(quint64 extraDone)
 {
     // accumulate the work already done
@@ -231,24 +293,98 @@ void MonteCarloSimulation::logprogress(quint64 extraDone)
     if (_timer.elapsed() > 3000)
     {
         _timer.restart();
-        double completed = _Ndone * 100. / (_myTotalNpp);
+        double completed = qMin(100., _Ndone * 100. / (_myTotalNpp));
         _log->info("Launched " + _phase + " photon packages: " + QString::number(completed,'f',1) + "%");
     }
 }
 
 ////////////////////////////////////////////////////////////////////
 
+quint64 MonteCarloSimulation::batchsize(quint64 remaining)
+{
+    quint64 count = qMin(remaining, _logchunksize);
+    if (MemoryStatistics::countingAllocations())
+    {
+        if (_warmupPhase != _allocationPhase)
+        {
+            _warmupPhase = _allocationPhase;
+            _warmupDone = 0;
+        }
+        if (_warmupDone < warmupPackages) count = qMin(count, warmupPackages - _warmupDone);
+    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::countallocations(quint64 before, quint64 count)
+{
+    if (!MemoryStatistics::countingAllocations()) return;
+    if (_warmupDone < warmupPackages)
+    {
+        _warmupDone += count;
+        return;
+    }
+    quint64 allocations = MemoryStatistics::threadAllocationCount() - before;
+    if (allocations) _Nallocations.fetch_add(allocations);
+    _Nmeasured.fetch_add(count);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::reservepathcapacity(PhotonPackage* pp)
+{
+    int capacity = _pathcapacityv[_parfac->currentThreadIndex()];
+    if (capacity) pp->reserve(capacity);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::recordpathcapacity(const PhotonPackage* pp)
+{
+    int& capacity = _pathcapacityv[_parfac->currentThreadIndex()];
+    capacity = qMax(capacity, pp->capacity());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::logallocations()
+{
+    if (MemoryStatistics::countingAllocations())
+    {
+        QString message = "Heap allocations in the " + _phase + " photon life cycles after warm-up: ";
+        if (_Nmeasured)
+            _log->info(message + QString::number(_Nallocations) + " in "
+                       + QString::number(_Nmeasured) + " photon packages");
+        else
+            _log->info(message + "not measured (all photon packages were handled during warm-up)");
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::runstellaremission()
 {
-    TimeLogger logger(_log, "the stellar emission phase");
-    setChunkParams(_packages);
-    initprogress("stellar emission");
     Parallel* parallel = find<ParallelFactory>()->parallel();
+    TimeLogger logger(_log, "the stellar emission phase", parallel);
+    bool ondemand = _comm->dynamicChunks() && !_comm->dataParallel() && _comm->isMultiProc();
+    setChunkParams(_packages, stellarbundlesize(), ondemand);
+    initprogress("stellar emission");
 
-    if (_lambdagrid->assigner())
-        parallel->call(this, &MonteCarloSimulation::dostellaremissionchunk, _lambdagrid->assigner(), _Nchunks);
-    else
-        parallel->call(this, &MonteCarloSimulation::dostellaremissionchunk, _Nlambda, _Nchunks);
+    size_t Nwavelengths = _lambdagrid->assigner() ? _lambdagrid->assigner()->assigned() : _Nlambda;
+    size_t Nunits = _bundlesize > 1 ? (Nwavelengths + _bundlesize - 1) / _bundlesize : Nwavelengths;
+    void (MonteCarloSimulation::*body)(size_t) = _bundlesize > 1 ? &MonteCarloSimulation::dostellaremissionbundle
+                                                                  : &MonteCarloSimulation::dostellaremissionchunk;
+    if (_bundlesize > 1)
+        _log->info("Using photon packages carrying bundles of " + QString::number(_bundlesize) + " wavelengths");
+    if (ondemand)
+    {
+        _log->info("Assigning chunks to processes on demand");
+        ChunkDispatcher dispatcher(_comm, Nunits * _Nchunks);
+        parallel->call(this, body, &dispatcher);
+    }
+    else parallel->call(this, body, Nunits * _Nchunks);
+    logallocations();
 
     // Wait for the other processes to reach this point
     _comm->wait("the stellar emission phase");
@@ -258,19 +394,28 @@ void MonteCarloSimulation::runstellaremission()
 
 void MonteCarloSimulation::dostellaremissionchunk(size_t index)
 {
-    int ell = index % _Nlambda;
+    // Determine the wavelength index and the chunk index (the wavelengths vary fastest)
+    const ProcessAssigner* assigner = _lambdagrid->assigner();
+    size_t Nwavelengths = assigner ? assigner->assigned() : _Nlambda;
+    int ell = assigner ? assigner->absoluteIndex(index % Nwavelengths) : index % Nwavelengths;
+    quint64 j = index / Nwavelengths;
+
     double L = _ss->luminosity(ell)/_Npp;
     if (L > 0)
     {
         double Lthreshold = L / minWeightReduction();
         PhotonPackage pp,ppp;
+        reservepathcapacity(&pp);
+        reservepathcapacity(&ppp);
 
         quint64 remaining = _chunksize;
         while (remaining > 0)
         {
-            quint64 count = qMin(remaining, _logchunksize);
+            quint64 count = batchsize(remaining);
+            quint64 allocations = MemoryStatistics::threadAllocationCount();
             for (quint64 i=0; i<count; i++)
             {
+                startphotonstream(ell, j, _chunksize-remaining+i);
                 _ss->launch(&pp,ell,L);
                 if (pp.luminosity()>0)
                 {
@@ -287,24 +432,153 @@ void MonteCarloSimulation::dostellaremissionchunk(size_t index)
                     }
                 }
             }
+            countallocations(allocations, count);
             logprogress(count);
             remaining -= count;
         }
+        recordpathcapacity(&pp);
+        recordpathcapacity(&ppp);
+        _random->endStream();
     }
     else logprogress(_chunksize);
 }
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::dostellaremissionbundle(size_t index)
+{
+    // Determine the wavelength bundle and the chunk index (the bundles vary fastest)
+    const ProcessAssigner* assigner = _lambdagrid->assigner();
+    size_t Nwavelengths = assigner ? assigner->assigned() : _Nlambda;
+    size_t Nbundles = (Nwavelengths + _bundlesize - 1) / _bundlesize;
+    size_t first = (index % Nbundles) * _bundlesize;
+    size_t last = qMin(Nwavelengths, first + static_cast<size_t>(_bundlesize));
+    quint64 j = index / Nbundles;
+
+    std::vector<int> ellv;
+    for (size_t i=first; i<last; i++) ellv.push_back(assigner ? assigner->absoluteIndex(i) : i);
+    int K = ellv.size();
+
+    // Determine the initial luminosities and the corresponding thresholds
+    Array Lv(K), Lthresholdv(K);
+    for (int k=0; k<K; k++)
+    {
+        Lv[k] = _ss->luminosity(ellv[k])/_Npp;
+        Lthresholdv[k] = Lv[k] / minWeightReduction();
+    }
+
+    if (Lv.max() > 0)
+    {
+        WavelengthBundle bundle(_ds, ellv);
+        PhotonPackage pp,ppp;
+        reservepathcapacity(&pp);
+        reservepathcapacity(&ppp);
+        Array tauv(K);
+
+        quint64 remaining = _chunksize;
+        while (remaining > 0)
+        {
+            quint64 count = batchsize(remaining);
+            quint64 allocations = MemoryStatistics::threadAllocationCount();
+            for (quint64 i=0; i<count; i++)
+            {
+                startphotonstream(ellv[0], j, _chunksize-remaining+i);
+                for (int k=0; k<K; k++) bundle.setLuminosity(k, Lv[k]);
+                bundle.selectReference();
+                _ss->launch(&pp,&bundle);
+                if (bundle.selectReference())
+                {
+                    peeloffemission(&pp,&ppp,&bundle,tauv);
+                    if (_ds) while (true)
+                    {
+                        _ds->fillOpticalDepth(&pp,&bundle);
+                        simulateescapeandabsorption(&pp,&bundle,_ds->storeabsorptionrates());
+
+                        // continue as long as one of the wavelengths has a significant luminosity
+                        bool alive = false;
+                        for (int k=0; k<K && !alive; k++)
+                        {
+                            double L = bundle.luminosity(k);
+                            alive = L>0 && (L>Lthresholdv[k] || pp.nScatt()<_minfs);
+                        }
+                        if (!alive || !bundle.selectReference()) break;
+
+                        if (!simulatepropagation(&pp,&bundle)) break;
+                        peeloffscattering(&pp,&ppp,&bundle,tauv);
+                        simulatescattering(&pp,&bundle);
+                    }
+                }
+            }
+            countallocations(allocations, count);
+            logprogress(K*count);
+            remaining -= count;
+        }
+        recordpathcapacity(&pp);
+        recordpathcapacity(&ppp);
+        _random->endStream();
+    }
+    else logprogress(K*_chunksize);
+}
+
+////////////////////////////////////////////////////////////////////
+
+int MonteCarloSimulation::stellarbundlesize() const
+{
+    if (_wavelengthBundleSize <= 1) return 1;
+
+    QString reason;
+    if (!_ss->supportsWavelengthBundles()) reason = "the stellar system has wavelength-dependent spatial distributions";
+    else if (_continuousScattering) reason = "continuous scattering is turned on";
+    else if (_ds && _ds->polarization()) reason = "the dust mix supports polarization";
+    if (!reason.isEmpty())
+    {
+        _log->warning("Not using wavelength bundles because " + reason);
+        return 1;
+    }
+    return _wavelengthBundleSize;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::peeloffemission(const PhotonPackage* pp, PhotonPackage* ppp)
 {
     Position bfr = pp->position();
 
-    foreach (Instrument* instr, _is->instruments())
+    // the instruments in a group share the peel off photon package, including its path and optical depth
+    for (const auto& group : _is->instrumentGroups())
     {
-        Direction bfknew = instr->bfkobs(bfr);
+        Direction bfknew = group[0]->bfkobs(bfr);
         ppp->launchEmissionPeelOff(pp, bfknew);
-        instr->detect(ppp);
+        for (Instrument* instr : group) instr->detect(ppp);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::peeloffemission(PhotonPackage* pp, PhotonPackage* ppp,
+                                           const WavelengthBundle* bundle, Array& tauv)
+{
+    Position bfr = pp->position();
+
+    // the instruments in a group share the peel off path, and distant instruments also share the optical depths
+    for (const auto& group : _is->instrumentGroups())
+    {
+        Direction bfknew = group[0]->bfkobs(bfr);
+        bool distant = _ds && dynamic_cast<DistantInstrument*>(group[0]);
+        bool traced = false;
+        for (int k=0; k<bundle->size(); k++)
+        {
+            if (bundle->luminosity(k) <= 0) continue;
+            pp->setWavelength(bundle->ell(k), bundle->luminosity(k));
+            ppp->launchEmissionPeelOff(pp, bfknew);
+            if (distant)
+            {
+                if (!traced) _ds->opticaldepth(ppp, bundle, tauv);
+                traced = true;
+                ppp->setInstrumentOpticalDepth(tauv[k]);
+            }
+            for (Instrument* instr : group) instr->detect(ppp);
+        }
     }
 }
 
@@ -318,7 +592,7 @@ void MonteCarloSimulation::peeloffscattering(const PhotonPackage* pp, PhotonPack
 
     // Determine the weighting factors of the phase functions corresponding to
     // the different dust components: each component h is weighted by kappasca(h)*rho(m,h)
-    QVarLengthArray<double,4> wv(Ncomp);
+    double* wv = ScratchArena::doubles(ScratchArena::ComponentWeights, Ncomp);
     if (Ncomp==1)
         wv[0] = 1.0;
     else
@@ -332,27 +606,72 @@ void MonteCarloSimulation::peeloffscattering(const PhotonPackage* pp, PhotonPack
         for (int h=0; h<Ncomp; h++) wv[h] /= sum;
     }
 
-    // Now do the actual peel-off
-    foreach (Instrument* instr, _is->instruments())
+    // Now do the actual peel-off; the instruments in a group share the peel off photon package, including
+    // its path and optical depth, but each instrument has its own polarization reference frame
+    for (const auto& group : _is->instrumentGroups())
     {
-        Direction bfkobs = instr->bfkobs(bfr);
-        Direction bfkx = instr->bfkx();
-        Direction bfky = instr->bfky();
-        double I = 0, Q = 0, U = 0, V = 0;
-        for (int h=0; h<Ncomp; h++)
+        Direction bfkobs = group[0]->bfkobs(bfr);
+        for (size_t i=0; i<group.size(); i++)
         {
-            DustMix* mix = _ds->mix(h);
-            double w = wv[h] * mix->phaseFunctionValue(pp, bfkobs);
-            StokesVector sv;
-            mix->scatteringPeelOffPolarization(&sv, pp, bfkobs, bfkx, bfky);
-            I += w * sv.stokesI();
-            Q += w * sv.stokesQ();
-            U += w * sv.stokesU();
-            V += w * sv.stokesV();
+            Instrument* instr = group[i];
+            Direction bfkx = instr->bfkx();
+            Direction bfky = instr->bfky();
+            double I = 0, Q = 0, U = 0, V = 0;
+            for (int h=0; h<Ncomp; h++)
+            {
+                DustMix* mix = _ds->mix(h);
+                double w = wv[h] * mix->phaseFunctionValue(pp, bfkobs);
+                StokesVector sv;
+                mix->scatteringPeelOffPolarization(&sv, pp, bfkobs, bfkx, bfky);
+                I += w * sv.stokesI();
+                Q += w * sv.stokesQ();
+                U += w * sv.stokesU();
+                V += w * sv.stokesV();
+            }
+            if (i==0) ppp->launchScatteringPeelOff(pp, bfkobs, I);
+            else ppp->setLuminosity(pp->luminosity() * I);
+            ppp->setPolarized(I, Q, U, V, pp->normal());
+            instr->detect(ppp);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void MonteCarloSimulation::peeloffscattering(PhotonPackage* pp, PhotonPackage* ppp,
+                                             const WavelengthBundle* bundle, Array& tauv)
+{
+    Position bfr = pp->position();
+
+    // with multiple dust components, the phase functions are weighted according to the densities in the cell
+    int m = -1;
+    if (_ds->Ncomp() > 1)
+    {
+        m = _ds->whichcell(bfr);
+        if (m==-1) return; // abort peel-off
+    }
+
+    // the instruments in a group share the peel off path, and distant instruments also share the optical depths
+    for (const auto& group : _is->instrumentGroups())
+    {
+        Direction bfkobs = group[0]->bfkobs(bfr);
+        bool distant = dynamic_cast<DistantInstrument*>(group[0]) != 0;
+        bool traced = false;
+        for (int k=0; k<bundle->size(); k++)
+        {
+            if (bundle->luminosity(k) <= 0) continue;
+            pp->setWavelength(bundle->ell(k), bundle->luminosity(k));
+            double I = phasefunctionvalue(pp, bfkobs, m);
+            if (I <= 0) continue;
+            ppp->launchScatteringPeelOff(pp, bfkobs, I);
+            if (distant)
+            {
+                if (!traced) _ds->opticaldepth(ppp, bundle, tauv);
+                traced = true;
+                ppp->setInstrumentOpticalDepth(tauv[k]);
+            }
+            for (Instrument* instr : group) instr->detect(ppp);
         }
-        ppp->launchScatteringPeelOff(pp, bfkobs, I);
-        ppp->setPolarized(I, Q, U, V, pp->normal());
-        instr->detect(ppp);
     }
 }
 
@@ -365,8 +684,9 @@ void MonteCarloSimulation::continuouspeeloffscattering(const PhotonPackage *pp,
     Direction bfk = pp->direction();
 
     int Ncomp = _ds->Ncomp();
-    QVarLengthArray<double,4> kappascav(Ncomp);
-    QVarLengthArray<double,4> kappaextv(Ncomp);
+    double* kappascav = ScratchArena::doubles(ScratchArena::ComponentKappaSca, Ncomp);
+    double* kappaextv = ScratchArena::doubles(ScratchArena::ComponentKappaExt, Ncomp);
+    double* wv = ScratchArena::doubles(ScratchArena::ComponentWeights, Ncomp);
     for (int h=0; h<Ncomp; h++)
     {
         DustMix* mix = _ds->mix(h);
@@ -380,7 +700,6 @@ void MonteCarloSimulation::continuouspeeloffscattering(const PhotonPackage *pp,
         int m = pp->m(n);
         if (m!=-1)
         {
-            QVarLengthArray<double,4> wv(Ncomp);
             double ksca = 0.0;
             double kext = 0.0;
             for (int h=0; h<Ncomp; h++)
@@ -401,26 +720,31 @@ void MonteCarloSimulation::continuouspeeloffscattering(const PhotonPackage *pp,
                 double factorm = albedo * exp(-tau0) * (-expm1(-dtau));
                 double s = s0 + _random->uniform()*ds;
                 Position bfrnew(bfr+s*bfk);
-                foreach (Instrument* instr, _is->instruments())
+                for (const auto& group : _is->instrumentGroups())
                 {
-                    Direction bfkobs = instr->bfkobs(bfrnew);
-                    Direction bfkx = instr->bfkx();
-                    Direction bfky = instr->bfky();
-                    double I = 0, Q = 0, U = 0, V = 0;
-                    for (int h=0; h<Ncomp; h++)
+                    Direction bfkobs = group[0]->bfkobs(bfrnew);
+                    for (size_t i=0; i<group.size(); i++)
                     {
-                        DustMix* mix = _ds->mix(h);
-                        double w = wv[h] * mix->phaseFunctionValue(pp, bfkobs);
-                        StokesVector sv;
-                        mix->scatteringPeelOffPolarization(&sv, pp, bfkobs, bfkx, bfky);
-                        I += w * sv.stokesI();
-                        Q += w * sv.stokesQ();
-                        U += w * sv.stokesU();
-                        V += w * sv.stokesV();
+                        Instrument* instr = group[i];
+                        Direction bfkx = instr->bfkx();
+                        Direction bfky = instr->bfky();
+                        double I = 0, Q = 0, U = 0, V = 0;
+                        for (int h=0; h<Ncomp; h++)
+                        {
+                            DustMix* mix = _ds->mix(h);
+                            double w = wv[h] * mix->phaseFunctionValue(pp, bfkobs);
+                            StokesVector sv;
+                            mix->scatteringPeelOffPolarization(&sv, pp, bfkobs, bfkx, bfky);
+                            I += w * sv.stokesI();
+                            Q += w * sv.stokesQ();
+                            U += w * sv.stokesU();
+                            V += w * sv.stokesV();
+                        }
+                        if (i==0) ppp->launchScatteringPeelOff(pp, bfrnew, bfkobs, factorm*I);
+                        else ppp->setLuminosity(pp->luminosity() * (factorm*I));
+                        ppp->setPolarized(I, Q, U, V, pp->normal());
+                        instr->detect(ppp);
                     }
-                    ppp->launchScatteringPeelOff(pp, bfrnew, bfkobs, factorm*I);
-                    ppp->setPolarized(I, Q, U, V, pp->normal());
-                    instr->detect(ppp);
                 }
             }
         }
@@ -465,15 +789,20 @@ void MonteCarloSimulation::simulateescapeandabsorption(PhotonPackage* pp, bool s
 
     // Difficult case: there are different dust components.
     // The absorption/scattering in each cell is weighted by the density contribution of the component.
+    // If the dust system offers opacity tables, the albedo in each cell is obtained from these tables.
     else
     {
-        Array kappascav(Ncomp);
-        Array kappaextv(Ncomp);
-        for (int h=0; h<Ncomp; h++)
+        bool tables = _ds->hasOpacityTables();
+        double* kappascav = ScratchArena::doubles(ScratchArena::ComponentKappaSca, Ncomp);
+        double* kappaextv = ScratchArena::doubles(ScratchArena::ComponentKappaExt, Ncomp);
+        if (!tables)
         {
-            DustMix* mix = _ds->mix(h);
-            kappascav[h] = mix->kappasca(ell);
-            kappaextv[h] = mix->kappaext(ell);
+            for (int h=0; h<Ncomp; h++)
+            {
+                DustMix* mix = _ds->mix(h);
+                kappascav[h] = mix->kappasca(ell);
+                kappaextv[h] = mix->kappaext(ell);
+            }
         }
         int Ncells = pp->size();
         double Lsca = 0.0;
@@ -482,15 +811,20 @@ void MonteCarloSimulation::simulateescapeandabsorption(PhotonPackage* pp, bool s
             int m = pp->m(n);
             if (m!=-1)
             {
-                double ksca = 0.0;
-                double kext = 0.0;
-                for (int h=0; h<Ncomp; h++)
+                double albedo = 0.0;
+                if (tables) albedo = _ds->albedo(m,ell);
+                else
                 {
-                    double rho = _ds->density(m,h);
-                    ksca += rho*kappascav[h];
-                    kext += rho*kappaextv[h];
+                    double ksca = 0.0;
+                    double kext = 0.0;
+                    for (int h=0; h<Ncomp; h++)
+                    {
+                        double rho = _ds->density(m,h);
+                        ksca += rho*kappascav[h];
+                        kext += rho*kappaextv[h];
+                    }
+                    albedo = (kext>0.0) ? ksca/kext : 0.0;
                 }
-                double albedo = (kext>0.0) ? ksca/kext : 0.0;
                 double taustart = (n==0) ? 0.0 : pp->tau(n-1);
                 double dtau = pp->dtau(n);
                 double expfactorm = -expm1(-dtau);
@@ -510,6 +844,41 @@ void MonteCarloSimulation::simulateescapeandabsorption(PhotonPackage* pp, bool s
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::simulateescapeandabsorption(PhotonPackage* pp, WavelengthBundle* bundle,
+                                                       bool storeabsorptionrates)
+{
+    bool ynstellar = pp->isStellar();
+    int Ncells = pp->size();
+    for (int k=0; k<bundle->size(); k++)
+    {
+        double L = bundle->luminosity(k);
+        if (L <= 0) continue;
+        int ell = bundle->ell(k);
+        double Lsca = 0.0;
+        for (int n=0; n<Ncells; n++)
+        {
+            int m = pp->m(n);
+            if (m!=-1)
+            {
+                double albedo = bundle->albedo(n,k);
+                double taustart = (n==0) ? 0.0 : bundle->tau(n-1,k);
+                double dtau = bundle->dtau(n,k);
+                double expfactorm = -expm1(-dtau);
+                double Lintm = L * exp(-taustart) * expfactorm;
+                Lsca += albedo * Lintm;
+                if (storeabsorptionrates)
+                {
+                    double Labsm = (1.0-albedo) * Lintm;
+                    _ds->absorb(m,ell,Labsm,ynstellar);
+                }
+            }
+        }
+        bundle->setLuminosity(k, Lsca);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::simulatepropagation(PhotonPackage* pp)
 {
     double taupath = pp->tau();
@@ -532,6 +901,45 @@ void MonteCarloSimulation::simulatepropagation(PhotonPackage* pp)
 
 ////////////////////////////////////////////////////////////////////
 
+bool MonteCarloSimulation::simulatepropagation(PhotonPackage* pp, WavelengthBundle* bundle)
+{
+    // generate the optical depth at the reference wavelength from the biased distribution
+    int kref = bundle->reference();
+    double taupath = bundle->tau(kref);
+    if (taupath<=0.0) return false;
+    double X = _random->uniform();
+    double tau = (X<_xi) ? _random->uniform()*taupath : _random->exponcutoff(taupath);
+    double q = (1.0-_xi)*(-exp(-tau)/expm1(-taupath)) + _xi/taupath;
+
+    // determine the corresponding path length and the fraction of the segment covered
+    double s = 0.0;
+    int n = bundle->locate(pp, kref, tau, s);
+    double dtauref = bundle->dtau(n,kref);
+    if (dtauref<=0.0) return false;
+    double fraction = (s - ((n==0) ? 0.0 : pp->s(n-1))) / pp->ds(n);
+
+    // weight the luminosity at each wavelength by the ratio of the probability densities for the path length
+    for (int k=0; k<bundle->size(); k++)
+    {
+        double L = bundle->luminosity(k);
+        if (L <= 0) continue;
+        double taupathk = bundle->tau(k);
+        double weight = 0.0;
+        if (taupathk>0.0)
+        {
+            double dtau = bundle->dtau(n,k);
+            double tauk = ((n==0) ? 0.0 : bundle->tau(n-1,k)) + fraction*dtau;
+            double p = -exp(-tauk)/expm1(-taupathk);
+            weight = (dtau/dtauref) * p/q;
+        }
+        bundle->setLuminosity(k, L*weight);
+    }
+    pp->propagate(s);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::simulatescattering(PhotonPackage* pp)
 {
     // Randomly select a dust mix; the probability of each dust component h is weighted by kappasca(h)*rho(m,h)
@@ -544,6 +952,53 @@ void MonteCarloSimulation::simulatescattering(PhotonPackage* pp)
 
 ////////////////////////////////////////////////////////////////////
 
+void MonteCarloSimulation::simulatescattering(PhotonPackage* pp, WavelengthBundle* bundle)
+{
+    // generate the new direction at the reference wavelength
+    int kref = bundle->reference();
+    pp->setWavelength(bundle->ell(kref), bundle->luminosity(kref));
+    DustMix* mix = _ds->randomMixForPosition(pp->position(), pp->ell());
+    Direction bfknew = mix->scatteringDirectionAndPolarization(pp, pp);
+
+    // weight the luminosity at each wavelength by the ratio of the phase functions for this direction
+    int m = _ds->Ncomp() > 1 ? _ds->whichcell(pp->position()) : -1;
+    double Phiref = phasefunctionvalue(pp, bfknew, m);
+    for (int k=0; k<bundle->size(); k++)
+    {
+        double L = bundle->luminosity(k);
+        if (L <= 0 || k == kref) continue;
+        pp->setWavelength(bundle->ell(k), L);
+        bundle->setLuminosity(k, Phiref>0 ? L * phasefunctionvalue(pp, bfknew, m) / Phiref : 0.);
+    }
+    pp->setWavelength(bundle->ell(kref), bundle->luminosity(kref));
+    pp->scatter(bfknew);
+}
+
+////////////////////////////////////////////////////////////////////
+
+double MonteCarloSimulation::phasefunctionvalue(const PhotonPackage* pp, Direction bfk, int m) const
+{
+    int Ncomp = _ds->Ncomp();
+    if (Ncomp==1) return _ds->mix(0)->phaseFunctionValue(pp, bfk);
+
+    int ell = pp->ell();
+    double sum = 0.0;
+    double value = 0.0;
+    for (int h=0; h<Ncomp; h++)
+    {
+        DustMix* mix = _ds->mix(h);
+        double w = mix->kappasca(ell) * _ds->density(m,h);
+        if (w>0)
+        {
+            sum += w;
+            value += w * mix->phaseFunctionValue(pp, bfk);
+        }
+    }
+    return sum>0 ? value/sum : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void MonteCarloSimulation::write()
 {
     TimeLogger logger(_log, "writing results");
@@ -9,11 +9,14 @@
 #include "Simulation.hpp"
 #include <QTime>
 #include <atomic>
+class Array;
+class Direction;
 class DustSystem;
 class InstrumentSystem;
 class PhotonPackage;
 class ProcessAssigner;
 class StellarSystem;
+class WavelengthBundle;
 class WavelengthGrid;
 
 //////////////////////////////////////////////////////////////////////
@@ -65,6 +68,13 @@ class MonteCarloSimulation : public Simulation
     Q_CLASSINFO("Default", "no")
     Q_CLASSINFO("Silent", "true")
 
+    Q_CLASSINFO("Property", "wavelengthBundleSize")
+    Q_CLASSINFO("Title", "the number of wavelengths carried by a stellar photon package")
+    Q_CLASSINFO("MinValue", "1")
+    Q_CLASSINFO("MaxValue", "1000")
+    Q_CLASSINFO("Default", "1")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 protected:
@@ -118,8 +128,23 @@ protected:
             one to shoot the photons for those specific wavelengths. Therefore, the processes need
             to do all the chunks for their own wavelengths, and the number of chunks per wavelength
             per process is set equal to the total number of chunks per wavelength.
-            \f[\boxed{N_\text{chunks, per proc} = N_\text{chunks}}\f] */
-    void setChunkParams(double packages);
+            \f[\boxed{N_\text{chunks, per proc} = N_\text{chunks}}\f]
+
+            -# When the third argument is true, the chunks are not assigned to the processes in
+            advance, but handed out on demand by a ChunkDispatcher. The number of chunks per
+            wavelength is not rounded, and each process may handle any of the chunks for each
+            wavelength, so the number of chunks per wavelength per process is set equal to the
+            total number of chunks per wavelength. The number of photon packages to be launched
+            by this process, which is used for logging the progress, is estimated as
+            \f$1/N_\text{procs}\f$ of the total.
+
+        If the photon packages in the phase carry a bundle of wavelengths (see the
+        setWavelengthBundleSize() function), the number of work units per chunk is the number of
+        wavelength bundles rather than the number of wavelengths, and \f$N_\lambda\f$ in the
+        expressions above is replaced accordingly. The second argument specifies the number of
+        wavelengths in a bundle; the default value of one indicates monochromatic photon
+        packages. */
+    void setChunkParams(double packages, int bundlesize = 1, bool ondemand = false);
 
     //======== Setters & Getters for Discoverable Attributes =======
 
@@ -178,6 +203,22 @@ public:
     /** Returns the flag that indicates whether continuous scattering should be used. */
     Q_INVOKABLE bool continuousScattering() const;
 
+    /** Sets the number of consecutive wavelengths carried by a single photon package during the
+        stellar emission phase. The default value of one indicates monochromatic photon packages.
+        With a larger value, each photon package carries a bundle of wavelengths that share the
+        launch position and direction, the scattering positions and directions, and thus the paths
+        through the dust grid (see dostellaremissionbundle()). This reduces the time spent in path
+        calculations by up to the bundle size, at the cost of some extra noise at the wavelengths
+        far from the reference wavelength of each bundle. Wavelength bundles are used only if all
+        stellar components have a wavelength-independent spatial distribution, the dust does not
+        support polarization, and continuous scattering is turned off; otherwise the simulation
+        falls back to monochromatic photon packages. */
+    Q_INVOKABLE void setWavelengthBundleSize(int value);
+
+    /** Returns the number of consecutive wavelengths carried by a single photon package during
+        the stellar emission phase. */
+    Q_INVOKABLE int wavelengthBundleSize() const;
+
 
     //======================== Other Functions =======================
 
@@ -200,6 +241,59 @@ protected:
         number of photon packages processed since the most recent invocation in the same thread. */
     void logprogress(quint64 extraDone);
 
+    /** This function returns the number of photon packages to be processed in the next batch by
+        the calling thread, given the number of packages remaining in the current chunk. A batch
+        normally holds \f$\min(N_\text{remaining}, N_\text{log})\f$ packages, where
+        \f$N_\text{log}\f$ is the number of packages between logprogress() invocations. If heap
+        allocations are being counted, the first few thousand packages handled by each thread in
+        the current phase serve as a warm-up during which scratch memory and path vectors reach
+        their steady-state size; a batch is then limited so that it does not extend beyond the
+        end of the warm-up period. */
+    quint64 batchsize(quint64 remaining);
+
+    /** This function must be called after each batch of photon packages, with the count obtained
+        from MemoryStatistics::threadAllocationCount() just before the batch, and the number of
+        photon packages in the batch as returned by batchsize(). If the calling thread has finished
+        its warm-up period in the current phase, the function adds the number of heap allocations
+        performed by the thread during the batch to the number of allocations for the current
+        phase, and the number of packages to the number of measured packages. Otherwise, the
+        packages are added to the warm-up period of the thread. The function does nothing unless
+        the code has been built with the BUILDING_MEMORY flag turned on. */
+    void countallocations(quint64 before, quint64 count);
+
+    /** This function reserves room in the path of the specified photon package for the largest
+        number of path segments reached so far in the current phase by the photon packages of the
+        calling thread, as remembered by recordpathcapacity(). It should be invoked for the photon
+        packages of a chunk before any of them is launched, so that the paths of the photon
+        packages in a new chunk do not need to grow again during the life cycles. */
+    void reservepathcapacity(PhotonPackage* pp);
+
+    /** This function remembers the path capacity of the specified photon package for the calling
+        thread, if it is larger than the capacity remembered so far in the current phase. It
+        should be invoked for the photon packages of a chunk after all of them have been handled.
+        */
+    void recordpathcapacity(const PhotonPackage* pp);
+
+    /** If heap allocations are being counted (see MemoryStatistics::countingAllocations()), this
+        function logs the number of allocations counted for the current phase by the
+        countallocations() function, and the number of photon packages over which they were
+        counted. In steady state, the life cycle of a photon package should not allocate any
+        memory, so the number of allocations is expected to be zero. If all photon packages were
+        handled during the warm-up periods of the threads, the function logs that the allocations
+        were not measured. */
+    void logallocations();
+
+    /** This function starts the random stream for the photon package with index \f$i\f$ in the
+        chunk with index \f$j\f$ (counting from zero within this process) at wavelength index
+        \f$\ell\f$, for the current photon shooting phase. The stream is identified by the phase
+        counter maintained by initprogress(), the wavelength index, and the number of the photon
+        package among all packages launched at that wavelength by all processes. If the random
+        generator is configured to be reproducible, the random numbers used for the photon package
+        thus depend neither on the thread nor on the process that happens to handle the chunk,
+        which also holds when the chunks are handed out on demand by a ChunkDispatcher.
+        Otherwise the function has no effect. */
+    void startphotonstream(int ell, quint64 j, quint64 i);
+
     /** This function drives the stellar emission phase in a Monte Carlo simulation. It consists of
         a parallelized loop that iterates over \f$N_{\text{pp}}\times N_\lambda\f$ monochromatic
         photons packages. Within this loop, the function simulates the life cycle of a single
@@ -214,12 +308,40 @@ protected:
         towards each instrument, and the actual scattering is simulated. Then again, the details of
         the path of photon package through the dust system are calculated and stored, and the loop
         repeats itself. It is terminated only when the photon package has lost a very substantial
-        part of its original luminosity (and hence becomes irrelevant). */
+        part of its original luminosity (and hence becomes irrelevant).
+
+        If so requested on the command line, and if data parallelization is not active, the
+        chunks are handed out to multiple processes on demand by a ChunkDispatcher, so that faster
+        processes handle more chunks. The dust emission phases always use a static assignment,
+        because the dust emission spectra are released for each wavelength only after a process
+        has handled all of its chunks for that wavelength. */
     void runstellaremission();
 
-    /** This function implements the loop body for runstellaremission(). */
+    /** This function implements the loop body for runstellaremission(). The index runs over all
+        combinations of a chunk and a wavelength assigned to this process, iterating over the
+        wavelengths for each chunk. */
     void dostellaremissionchunk(size_t index);
 
+    /** This function implements the loop body for runstellaremission() when photon packages carry
+        a bundle of wavelengths. The index runs over all combinations of a chunk and a bundle of
+        consecutive wavelengths assigned to this process, iterating over the bundles for each
+        chunk. The life cycle of a photon package is the same as the one described for
+        runstellaremission(), except that it is simulated for all wavelengths in the bundle at the
+        same time. The path through the dust grid is calculated only once for each step in the
+        life cycle, and the optical depths for all wavelengths are calculated from the same path
+        segments. Random interaction locations and scattering directions are generated at the
+        reference wavelength of the bundle, and the luminosities at the other wavelengths are
+        multiplied by the ratio of the probability densities at that wavelength and at the
+        reference wavelength. The reference wavelength is reselected before each propagation
+        step so that it always carries a nonzero luminosity. */
+    void dostellaremissionbundle(size_t index);
+
+    /** This function returns the number of wavelengths to be carried by a photon package in the
+        stellar emission phase, taking into account the restrictions listed for the
+        setWavelengthBundleSize() function. If wavelength bundles were requested but cannot be
+        used, a warning message is logged. */
+    int stellarbundlesize() const;
+
     /** This function simulates the peel-off of a photon package after an emission event. This
         means that we create peel-off or shadow photon packages, one for every instrument in the
         instrument system, that we force to propagate in the direction of the observer(s) instead
@@ -229,12 +351,23 @@ protected:
         \f${\bf{k}}_{\text{obs}}\f$ of the observer. For anistropic emission, a weight factor is
         applied to the luminosity to compensate for the fact that the probability that a photon
         package would have been emitted towards the observer is not the same as the probability
-        that it is emitted in any other direction. For each instrument in the instrument system,
-        the function creates such a peel-off photon package and feeds it to the instrument. The
-        first argument specifies the photon package that was just emitted; the second argument
+        that it is emitted in any other direction. For each group of instruments sharing the same
+        viewing direction (see InstrumentSystem::instrumentGroups()), the function creates such a
+        peel-off photon package and feeds it to each instrument in the group, so that the path
+        and optical depth towards the observer are calculated only once per group. The first
+        argument specifies the photon package that was just emitted; the second argument
         provides a placeholder peel off photon package for use by the function. */
     void peeloffemission(const PhotonPackage* pp, PhotonPackage* ppp);
 
+    /** This function simulates the peel-off of a photon package carrying a bundle of wavelengths
+        after an emission event, as described for the other version of this function. For each
+        group of instruments, the photon package is relabeled to each of the wavelengths in the
+        bundle in turn, and a monochromatic peel-off photon package is fed to the instruments. If
+        the group consists of distant instruments, the path towards the observer is calculated only
+        once, and the optical depths for all wavelengths are calculated from its segments. The last
+        argument provides a placeholder array for these optical depths. */
+    void peeloffemission(PhotonPackage* pp, PhotonPackage* ppp, const WavelengthBundle* bundle, Array& tauv);
+
     /** This function simulates the peel-off of a photon package before a scattering event. This
         means that, just before a scattering event, we create peel-off or shadow photon packages,
         one for every instrument in the instrument system, that we force to propagate in the
@@ -263,12 +396,22 @@ protected:
         of the photon package). The third difference is that the polarization state of the peel off
         photon package is adjusted. If there are multiple dust components, the weight factors
         described above are used not just for the luminosity but also for the components of the
-        Stokes vector. For each instrument in the instrument system, the function creates such a
-        peel-off photon package and feeds it to the instrument. The first argument specifies the
+        Stokes vector. For each group of instruments sharing the same viewing direction, the
+        function creates such a peel-off photon package and feeds it to each instrument in the
+        group, adjusting only the polarization state to the reference frame of each instrument, so
+        that the path and optical depth towards the observer are calculated only once per group.
+        The first argument specifies the
         photon package that was just emitted; the second argument provides a placeholder peel off
         photon package for use by the function. */
     void peeloffscattering(const PhotonPackage* pp, PhotonPackage* ppp);
 
+    /** This function simulates the peel-off of a photon package carrying a bundle of wavelengths
+        before a scattering event, as described for the other version of this function. The
+        peel-off photon packages are handled as described for the corresponding version of the
+        peeloffemission() function. Because wavelength bundles are not used with dust mixes that
+        support polarization, the peel-off photon packages are unpolarized. */
+    void peeloffscattering(PhotonPackage* pp, PhotonPackage* ppp, const WavelengthBundle* bundle, Array& tauv);
+
     /** This function simulates the continuous peel-off of a series of photon packages along the
         path of the original photon package. It should be called before the
         simulateescapeandabsorption() function, because it assumes that the photon package still
@@ -341,6 +484,12 @@ protected:
         L_{\ell,n}^{\text{abs}} = L_\ell. \f] */
     void simulateescapeandabsorption(PhotonPackage* pp, bool storeabsorptionrates);
 
+    /** This function simulates the escape from the system and the absorption by dust for all
+        wavelengths carried by a photon package, as described for the other version of this
+        function, using the optical depths and albedos stored in the specified wavelength bundle.
+        The luminosity at each wavelength in the bundle is replaced by its scattered part. */
+    void simulateescapeandabsorption(PhotonPackage* pp, WavelengthBundle* bundle, bool storeabsorptionrates);
+
     /** This function determines the next scattering location of a photon package and the simulates
         the propagation to this position. Given the total optical depth along the path of the
         photon package \f$\tau_{\ell,\text{path}}\f$ (this quantity is stored in the PhotonPackage
@@ -364,6 +513,19 @@ protected:
         propagated over this distance. */
     void simulatepropagation(PhotonPackage* pp);
 
+    /** This function determines the next scattering location of a photon package carrying a
+        bundle of wavelengths and simulates the propagation to this position. The optical depth
+        \f$\tau\f$ is generated at the reference wavelength \f$\ell_\text{ref}\f$ of the bundle
+        from the biased distribution \f$q(\tau)\f$ described for the other version of this
+        function. Because all wavelengths share the same interaction location, the luminosity at
+        each wavelength \f$\ell\f$ in the bundle is multiplied by the ratio of the probability
+        densities for the corresponding path length \f$s\f$, \f[ w_\ell =
+        \frac{\kappa_\ell\rho}{\kappa_{\ell_\text{ref}}\rho}\,
+        \frac{p(\tau_\ell(s))}{q(\tau_{\ell_\text{ref}}(s))}, \f] where \f$\kappa_\ell\rho\f$ is
+        the extinction coefficient in the cell containing the interaction location. The function
+        returns false if no interaction location can be generated, and true otherwise. */
+    bool simulatepropagation(PhotonPackage* pp, WavelengthBundle* bundle);
+
     /** This function simulates a scattering event of a photon package. Most of the properties of
         the photon package remain unaltered, including the position and the luminosity. The
         properties that change are the number of scattering events experienced by the photon
@@ -381,6 +543,20 @@ protected:
         phase function. */
     void simulatescattering(PhotonPackage* pp);
 
+    /** This function simulates a scattering event of a photon package carrying a bundle of
+        wavelengths. The new propagation direction is generated at the reference wavelength of the
+        bundle as described for the other version of this function, and the luminosity at each
+        wavelength \f$\ell\f$ in the bundle is multiplied by the ratio
+        \f$\Phi_\ell/\Phi_{\ell_\text{ref}}\f$ of the (density-weighted) phase functions for the
+        actual scattering angle at that wavelength and at the reference wavelength. */
+    void simulatescattering(PhotonPackage* pp, WavelengthBundle* bundle);
+
+    /** This function returns the value of the scattering phase function for scattering the
+        specified photon package into the direction \f${\bf{k}}\f$ at its current wavelength. If
+        there are multiple dust components, the phase functions of the components are weighted by
+        \f$\kappa_{\ell,h}^{\text{sca}}\,\rho_{m,h}\f$ in the dust cell with number \f$m\f$. */
+    double phasefunctionvalue(const PhotonPackage* pp, Direction bfk, int m) const;
+
     /** This function performs the final step in a Monte Carlo simulation. It writes out the useful
         information in the instrument system and in the dust system so that the results of the
         simulation can be analyzed. */
@@ -396,6 +572,7 @@ private:
     int _minfs;                 // the minimum number of scattering events
     double _xi;                 // the scattering bias
     bool _continuousScattering; // true if continuous scattering should be used
+    int _wavelengthBundleSize;  // the requested number of wavelengths per stellar photon package
 
 protected:
     // *** discoverable attributes to be setup by a subclass ***
@@ -411,11 +588,18 @@ protected:
     quint64 _Npp;           // the precise number of photon packages to be launched per wavelength
     quint64 _myTotalNpp;    // the total number of photon packages to be launched by this process
     quint64 _logchunksize;  // the number of photon packages to be processed between logprogress() invocations
+    quint64 _firstchunk;    // the index of the first chunk launched by this process among the chunks of all processes
+    quint64 _bundlesize;    // the number of wavelengths carried by a photon package in the current phase
 
 private:
     // *** data members used by the XXXprogress() functions in this class ***
     QString _phase;         // a string identifying the photon shooting phase for use in the log message
+    quint32 _Nphases;       // the number of photon shooting phases started so far (used to key random streams)
     std::atomic<quint64> _Ndone;  // the number of photon packages processed so far (for all wavelengths)
+    std::atomic<quint64> _Nallocations;  // the number of heap allocations counted after warm-up in this phase
+    std::atomic<quint64> _Nmeasured;     // the number of photon packages over which allocations were counted
+    quint64 _allocationPhase;            // a process-wide unique identifier for the current phase
+    std::vector<int> _pathcapacityv;     // the largest photon package path capacity for each thread in this phase
     QTime _timer;           // measures the time elapsed since the most recent log message
 };
 
@@ -407,7 +407,9 @@ void PanDustSystem::calculatedustemission()
 {
     if (_dustemissivity)
     {
-        sumResults();
+        // with data parallelization, the dust library overlaps the communication of the absorption tables
+        // with its own calculations
+        if (!_assigner) sumResults();
         _dustlib->calculate();
     }
 }
@@ -422,6 +424,30 @@ void PanDustSystem::sumResults()
 
 ////////////////////////////////////////////////////////////////////
 
+void PanDustSystem::startSumResults(size_t Nblocks)
+{
+    if (_haveLabsStel) _LabsStelvv.startSwitchScheme(Nblocks);
+    if (_haveLabsDust) _LabsDustvv.startSwitchScheme(Nblocks);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::waitForResults(size_t block)
+{
+    if (_haveLabsStel) _LabsStelvv.waitForBlock(block);
+    if (_haveLabsDust) _LabsDustvv.waitForBlock(block);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanDustSystem::finishSumResults()
+{
+    if (_haveLabsStel) _LabsStelvv.finishSwitchScheme();
+    if (_haveLabsDust) _LabsDustvv.finishSwitchScheme();
+}
+
+////////////////////////////////////////////////////////////////////
+
 double PanDustSystem::dustluminosity(int m, int ell) const
 {
     // Only callable on wavelengths assigned to this process.
@@ -230,6 +230,19 @@ public:
         absorption tables. **/
     void sumResults();
 
+    /** This function starts a pipelined version of sumResults(), in which the absorption tables
+        are communicated in the specified number of blocks of dust cells (see
+        ParallelTable::startSwitchScheme()). It is used by the dust library to overlap the
+        communication with the calculation of the dust emission spectra. */
+    void startSumResults(size_t Nblocks);
+
+    /** This function waits until the absorption data for the specified block of dust cells has
+        been received, after which the absorbed luminosities for these cells are available. */
+    void waitForResults(size_t block);
+
+    /** This function completes the pipelined communication started by startSumResults(). */
+    void finishSumResults();
+
     /** This function returns the luminosity \f$L_\ell\f$ at the wavelength index \f$\ell\f$ in the
         normalized dust emission SED corresponding to the dust cell with dust cell number \f$m\f$.
         It just looks up the appropriate value in the cached results produced by calculate(). If
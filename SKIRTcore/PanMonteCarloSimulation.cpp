@@ -4,7 +4,7 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "Log.hpp"
-#include "NR.hpp"
+#include "MemoryStatistics.hpp"
 #include "PanDustSystem.hpp"
 #include "PanMonteCarloSimulation.hpp"
 #include "PanWavelengthGrid.hpp"
@@ -12,6 +12,7 @@
 #include "ParallelFactory.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "PhotonPackage.hpp"
+#include "ProcessAssigner.hpp"
 #include "Random.hpp"
 #include "SED.hpp"
 #include "StellarSystem.hpp"
@@ -123,8 +124,9 @@ void PanMonteCarloSimulation::rundustselfabsorption()
         int cycle = 1;
         while (cycle<=Ncyclesmax && (!convergence || fixedNcycles))
         {
+            Parallel* parallel = find<ParallelFactory>()->parallel();
             TimeLogger logger(_log, "the " + QString(stage_name[stage]) + " dust self-absorption cycle "
-                              + QString::number(cycle));
+                              + QString::number(cycle), parallel);
 
             // Construct the dust emission spectra
             _log->info("Calculating dust emission spectra...");
@@ -140,15 +142,12 @@ void PanMonteCarloSimulation::rundustselfabsorption()
             setChunkParams(packages()*stage_factor[stage]);
             initprogress(QString(stage_name[stage]) + " dust self-absorption cycle " + QString::number(cycle));
 
-            Parallel* parallel = find<ParallelFactory>()->parallel();
-            if (_lambdagrid->assigner())
-                parallel->call(this, &PanMonteCarloSimulation::dodustselfabsorptionchunk,
-                               _lambdagrid->assigner(), _Nchunks);
-            else
-                parallel->call(this, &PanMonteCarloSimulation::dodustselfabsorptionchunk, _Nlambda, _Nchunks);
+            size_t Nchunks = initemissionsamplers();
+            parallel->call(this, &PanMonteCarloSimulation::dodustselfabsorptionchunk, Nchunks);
 
             // Wait for the other processes to reach this point
             _comm->wait("this self-absorption cycle");
+            logallocations();
             _pds->sumResults();
 
             // Determine and log the total absorbed luminosity in the vector Labstotv.
@@ -190,39 +189,35 @@ void PanMonteCarloSimulation::rundustselfabsorption()
 
 void PanMonteCarloSimulation::dodustselfabsorptionchunk(size_t index)
 {
-    // Determine the wavelength index for this chunk
-    int ell = index % _Nlambda;
+    // Determine the wavelength index and the chunk index within that wavelength
+    int ell = chunkwavelength(index);
+    quint64 j = index % _Nchunks;
 
-    // Determine the luminosity to be emitted at this wavelength index
-    Array Lv(_Ncells);
-    for (int m=0; m<_Ncells; m++)
-    {
-        double Labsbol = _Labsbolv[m];
-        if (Labsbol>0.0) Lv[m] = Labsbol * _pds->dustluminosity(m,ell);
-    }
-    double Ltot = Lv.sum();
+    // Get the cell luminosity distribution at this wavelength index (shared with the other chunks)
+    const EmissionSampler& sampler = emissionsampler(ell, false);
+    double Ltot = sampler.Ltot;
 
     // Emit photon packages
     if (Ltot > 0)
     {
-        Array Xv;
-        NR::cdf(Xv, Lv);
-
         PhotonPackage pp;
+        reservepathcapacity(&pp);
         double L = Ltot / _Npp;
         double Lthreshold = L / minWeightReduction();
 
         quint64 remaining = _chunksize;
         while (remaining > 0)
         {
-            quint64 count = qMin(remaining, _logchunksize);
+            quint64 count = batchsize(remaining);
+            quint64 allocations = MemoryStatistics::threadAllocationCount();
             for (quint64 i=0; i<count; i++)
             {
-                double X = _random->uniform();
-                int m = NR::locate_clip(Xv,X);
+                startphotonstream(ell, j, _chunksize-remaining+i);
+                int m = sampler.table.sample(_random->uniform());
                 Position bfr = _pds->randomPositionInCell(m);
                 Direction bfk = _random->direction();
                 pp.launch(L,ell,bfr,bfk);
+                pp.setPosition(bfr,m);  // the emitting cell contains the launch position
                 while (true)
                 {
                     _pds->fillOpticalDepth(&pp);
@@ -234,18 +229,24 @@ void PanMonteCarloSimulation::dodustselfabsorptionchunk(size_t index)
                     simulatescattering(&pp);
                 }
             }
+            countallocations(allocations, count);
             logprogress(count);
             remaining -= count;
         }
+        recordpathcapacity(&pp);
+        _random->endStream();
     }
     else logprogress(_chunksize);
+
+    releaseemissionsampler(ell);
 }
 
 ////////////////////////////////////////////////////////////////////
 
 void PanMonteCarloSimulation::rundustemission()
 {
-    TimeLogger logger(_log, "the dust emission phase");
+    Parallel* parallel = find<ParallelFactory>()->parallel();
+    TimeLogger logger(_log, "the dust emission phase", parallel);
 
     // Construct the dust emission spectra
     _log->info("Calculating dust emission spectra...");
@@ -258,11 +259,9 @@ void PanMonteCarloSimulation::rundustemission()
     // Perform the actual dust emission, possibly using more photon packages to obtain decent resolution
     setChunkParams(packages()*_pds->emissionBoost());
     initprogress("dust emission");
-    Parallel* parallel = find<ParallelFactory>()->parallel();
-    if (_lambdagrid->assigner())
-        parallel->call(this, &PanMonteCarloSimulation::dodustemissionchunk, _lambdagrid->assigner(), _Nchunks);
-    else
-        parallel->call(this, &PanMonteCarloSimulation::dodustemissionchunk, _Nlambda, _Nchunks);
+    size_t Nchunks = initemissionsamplers();
+    parallel->call(this, &PanMonteCarloSimulation::dodustemissionchunk, Nchunks);
+    logallocations();
 
     // Wait for the other processes to reach this point
     _comm->wait("the dust emission phase");
@@ -272,58 +271,37 @@ void PanMonteCarloSimulation::rundustemission()
 
 void PanMonteCarloSimulation::dodustemissionchunk(size_t index)
 {
-    // Determine the wavelength index for this chunk
-    int ell = index % _Nlambda;
+    // Determine the wavelength index and the chunk index within that wavelength
+    int ell = chunkwavelength(index);
+    quint64 j = index % _Nchunks;
 
-    // Determine the luminosity to be emitted at this wavelength index
-    Array Lv(_Ncells);
-    for (int m=0; m<_Ncells; m++)
-    {
-        double Labsbol = _Labsbolv[m];
-        if (Labsbol>0.0) Lv[m] = Labsbol * _pds->dustluminosity(m,ell);
-    }
-    double Ltot = Lv.sum();  // the total luminosity to be emitted at this wavelength index
+    // Get the biased cell luminosity distribution at this wavelength index (shared with the other chunks)
+    const EmissionSampler& sampler = emissionsampler(ell, true);
+    double Ltot = sampler.Ltot;  // the total luminosity to be emitted at this wavelength index
 
     // Emit photon packages
     if (Ltot > 0)
     {
-        // We consider biasing in the selection of the cell from which the photon packages are emitted.
-        // A fraction of the cells is selected from the "natural" distribution, in which each cell is
-        // weighted according to its total luminosity (Lv[em]). The other cells are selected from
-        // a uniform distribution in which each cell has a equal probability.
-        double xi = _pds->emissionBias();    // the fraction to be selected from a uniform distribution
-
-        // the cumulative distribution of the natural pdf (Lv does not need to be normalized before)
-        Array cumLv;
-        NR::cdf(cumLv, Lv);
-
         PhotonPackage pp,ppp;
-        double Lmean = Ltot/_Ncells;
+        reservepathcapacity(&pp);
+        reservepathcapacity(&ppp);
         double Lem = Ltot / _Npp;
         double Lthreshold = Lem / minWeightReduction();
 
         quint64 remaining = _chunksize;
         while (remaining > 0)
         {
-            quint64 count = qMin(remaining, _logchunksize);
+            quint64 count = batchsize(remaining);
+            quint64 allocations = MemoryStatistics::threadAllocationCount();
             for (quint64 i=0; i<count; i++)
             {
-                int m;
-                double X = _random->uniform();
-                if (X<xi)
-                {
-                    // rescale the deviate from [0,xi[ to [0,Ncells[
-                    m = max(0,min(_Ncells-1,static_cast<int>(_Ncells*X/xi)));
-                }
-                else
-                {
-                    // rescale the deviate from [xi,1[ to [0,1[
-                    m = NR::locate_clip(cumLv,(X-xi)/(1-xi));
-                }
-                double weight = 1.0/(1-xi+xi*Lmean/Lv[m]);
+                startphotonstream(ell, j, _chunksize-remaining+i);
+                int m = sampler.table.sample(_random->uniform());
+                double weight = sampler.weightv[m];
                 Position bfr = _pds->randomPositionInCell(m);
                 Direction bfk = _random->direction();
                 pp.launch(Lem*weight,ell,bfr,bfk);
+                pp.setPosition(bfr,m);  // the emitting cell contains the launch position
                 peeloffemission(&pp,&ppp);
                 while (true)
                 {
@@ -338,11 +316,100 @@ void PanMonteCarloSimulation::dodustemissionchunk(size_t index)
                     simulatescattering(&pp);
                 }
             }
+            countallocations(allocations, count);
             logprogress(count);
             remaining -= count;
         }
+        recordpathcapacity(&pp);
+        recordpathcapacity(&ppp);
+        _random->endStream();
     }
     else logprogress(_chunksize);
+
+    releaseemissionsampler(ell);
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t PanMonteCarloSimulation::initemissionsamplers()
+{
+    _samplers.clear();
+    _samplers.resize(_Nlambda);
+    for (size_t ell=0; ell<_Nlambda; ell++)
+    {
+        _samplers[ell].reset(new EmissionSampler);
+        _samplers[ell]->remaining = _Nchunks;
+        _samplers[ell]->Ltot = 0.;
+    }
+
+    size_t Nwavelengths = _lambdagrid->assigner() ? _lambdagrid->assigner()->assigned() : _Nlambda;
+    return Nwavelengths * _Nchunks;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int PanMonteCarloSimulation::chunkwavelength(size_t index) const
+{
+    size_t relative = index / _Nchunks;
+    return _lambdagrid->assigner() ? _lambdagrid->assigner()->absoluteIndex(relative) : relative;
+}
+
+////////////////////////////////////////////////////////////////////
+
+const PanMonteCarloSimulation::EmissionSampler& PanMonteCarloSimulation::emissionsampler(int ell, bool biased)
+{
+    EmissionSampler& sampler = *_samplers[ell];
+    std::call_once(sampler.constructed, &PanMonteCarloSimulation::constructemissionsampler, this, ell, biased);
+    return sampler;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanMonteCarloSimulation::releaseemissionsampler(int ell)
+{
+    EmissionSampler& sampler = *_samplers[ell];
+    if (--sampler.remaining == 0)
+    {
+        sampler.table.clear();
+        sampler.weightv.resize(0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PanMonteCarloSimulation::constructemissionsampler(int ell, bool biased)
+{
+    EmissionSampler& sampler = *_samplers[ell];
+
+    // Determine the luminosity to be emitted at this wavelength index
+    Array Lv(_Ncells);
+    for (int m=0; m<_Ncells; m++)
+    {
+        double Labsbol = _Labsbolv[m];
+        if (Labsbol>0.0) Lv[m] = Labsbol * _pds->dustluminosity(m,ell);
+    }
+    sampler.Ltot = Lv.sum();
+    if (sampler.Ltot <= 0) return;
+
+    if (biased)
+    {
+        // We consider biasing in the selection of the cell from which the photon packages are emitted.
+        // A fraction of the cells is selected from the "natural" distribution, in which each cell is
+        // weighted according to its total luminosity (Lv[m]). The other cells are selected from
+        // a uniform distribution in which each cell has a equal probability.
+        double xi = _pds->emissionBias();    // the fraction to be selected from a uniform distribution
+        double Lmean = sampler.Ltot/_Ncells;
+
+        // Replace Lv by the (unnormalized) mixture distribution, and remember the weight correction factors
+        sampler.weightv.resize(_Ncells);
+        for (int m=0; m<_Ncells; m++)
+        {
+            double Lmix = (1-xi)*Lv[m] + xi*Lmean;
+            if (Lmix > 0) sampler.weightv[m] = Lv[m]/Lmix;
+            Lv[m] = Lmix;
+        }
+    }
+    sampler.table.initialize(Lv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -6,6 +6,11 @@
 #ifndef PANMONTECARLOSIMULATION_HPP
 #define PANMONTECARLOSIMULATION_HPP
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AliasTable.hpp"
 #include "Array.hpp"
 #include "MonteCarloSimulation.hpp"
 class PanDustSystem;
@@ -74,6 +79,9 @@ protected:
     void runSelf();
 
 private:
+    // nested class declared below
+    struct EmissionSampler;
+
     /** This function drives the dust self-absorption phase in a panchromatic Monte Carlo
         simulation. This function consists of a big loop, which represents the different cycles of
         the dust self-absorption phase. This outer loop, and the function, terminates when either
@@ -93,8 +101,11 @@ private:
         luminosity, \f[ L_\ell = \sum_{m=0}^{N_{\text{cells}}-1} L_{\ell,m}, \f] and create a
         vector \f$X_m\f$ that describes the normalized cumulative luminosity distribution as a
         function of the cell number \f$m\f$, \f[ X_m = \frac{ \sum_{m'=0}^m L_{\ell,m'} }{ L_\ell
-        }. \f] This vector is used to generate random dust cells from which photon packages can be
-        launched. Now the actual dust self-absorption can start, i.e. we launch \f$N_{\text{pp}}\f$
+        }. \f] This distribution is used to generate random dust cells from which photon packages
+        can be launched. It is represented by an alias table (see the AliasTable class) so that a
+        cell can be selected in constant time; the table for a given wavelength is constructed
+        only once per cycle and shared by all chunks at that wavelength (see emissionsampler()).
+        Now the actual dust self-absorption can start, i.e. we launch \f$N_{\text{pp}}\f$
         different photon packages at wavelength index \f$\ell\f$, with the original position chosen
         as a random position in the cell \f$m\f$ chosen randomly from the cumulative luminosity
         distribution \f$X_m\f$. The remaining life cycle of a photon package in the dust emission
@@ -119,8 +130,11 @@ private:
         calculate the total dust luminosity, \f[ L_\ell = \sum_{m=0}^{N_{\text{cells}}-1}
         L_{\ell,m}, \f] and create a vector \f$X_m\f$ that describes the normalized cumulative
         luminosity distribution as a function of the cell number \f$m\f$, \f[ X_m = \frac{
-        \sum_{m'=0}^m L_{\ell,m'} }{ L_\ell }. \f] This vector is used to generate random dust
-        cells from which photon packages can be launched. Now the actual dust emission can start,
+        \sum_{m'=0}^m L_{\ell,m'} }{ L_\ell }. \f] This distribution, mixed with a uniform
+        distribution according to the emission bias, is used to generate random dust cells from
+        which photon packages can be launched. As for the self-absorption phase, it is represented
+        by an alias table that is constructed only once per wavelength and shared by all chunks at
+        that wavelength. Now the actual dust emission can start,
         i.e. we launch \f$N_{\text{pp}}\f$ different photon packages at wavelength index
         \f$\ell\f$, with the original position chosen as a random position in the cell \f$m\f$
         chosen randomly from the cumulative luminosity distribution \f$X_m\f$. The remaining life
@@ -131,6 +145,54 @@ private:
     /** This function implements the loop body for rundustemission(). */
     void dodustemissionchunk(size_t index);
 
+    /** This function prepares the shooting of the dust photon packages for a dust self-absorption
+        cycle or for the dust emission phase. It determines the number of chunks to be performed by
+        this process and it creates an empty emission sampler for each wavelength. It returns the
+        number of chunks to be handed to the parallel loop. The chunks are ordered so that all
+        chunks for the same wavelength have consecutive indices; the wavelength index for a given
+        chunk index is obtained with the chunkwavelength() function. As a result, only a limited
+        number of emission samplers is in use at any given time. */
+    size_t initemissionsamplers();
+
+    /** This function returns the wavelength index corresponding to the specified chunk index for
+        a parallel loop set up by the initemissionsamplers() function. */
+    int chunkwavelength(size_t index) const;
+
+    /** This function returns the emission sampler for the specified wavelength index, constructing
+        it if this has not yet been done during the current cycle or phase. Construction happens
+        exactly once, even if multiple threads request the same sampler concurrently; the other
+        threads wait until construction has completed. The sampler holds the total luminosity
+        emitted by the dust at the wavelength and, if this luminosity is positive, an alias table
+        for selecting the emitting cell. If the \em biased flag is true, the table represents a
+        mixture of the luminosity distribution and a uniform distribution, weighted with the
+        emission bias of the dust system, and the sampler also holds the corresponding weight
+        correction factor for each cell. */
+    const EmissionSampler& emissionsampler(int ell, bool biased);
+
+    /** This function informs the emission sampler for the specified wavelength index that a chunk
+        has been completed. When all chunks for the wavelength have been completed, the memory held
+        by the sampler is released. */
+    void releaseemissionsampler(int ell);
+
+    /** This function constructs the emission sampler for the specified wavelength index; it is
+        used by emissionsampler(). */
+    void constructemissionsampler(int ell, bool biased);
+
+    //======================== Nested Classes =======================
+
+private:
+    /** An EmissionSampler instance holds the information needed to launch dust photon packages at
+        a particular wavelength. It is constructed once per cycle or phase, and then used read-only
+        by all chunks for that wavelength. */
+    struct EmissionSampler
+    {
+        std::once_flag constructed;     // ensures that the sampler is constructed only once
+        std::atomic<size_t> remaining;  // the number of chunks for this wavelength not yet completed
+        double Ltot;                    // the total luminosity emitted at this wavelength
+        AliasTable table;               // the alias table for selecting the emitting cell
+        Array weightv;                  // the bias weight correction for each cell (only if biased)
+    };
+
     //======================== Data Members ========================
 
 private:
@@ -139,6 +201,7 @@ private:
     // data members used to communicate between rundustXXX() and the corresponding parallel loop
     int _Ncells;           // number of dust cells
     Array _Labsbolv;       // vector that contains the bolometric absorbed luminosity in each cell
+    std::vector<std::unique_ptr<EmissionSampler>> _samplers;  // emission sampler for each wavelength
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -3,6 +3,11 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "ChunkDispatcher.hpp"
 #include "FatalError.hpp"
 #include "Parallel.hpp"
 #include "ParallelFactory.hpp"
@@ -12,7 +17,8 @@
 
 Parallel::Parallel(int threadCount, ParallelFactory* factory)
 {
-    // Cache the number of threads
+    // Cache the factory and the number of threads
+    _factory = factory;
     _threadCount = threadCount;
 
     // Remember the ID of the current thread
@@ -26,11 +32,17 @@ Parallel::Parallel(int threadCount, ParallelFactory* factory)
         // Initialize shared data members
         _target = nullptr;
         _assigner = nullptr;
+        _dispatcher = nullptr;
         _limit = 0;
         _active.assign(threadCount, true);
         _exception = nullptr;
         _terminate = false;
-        _next = 0;
+        _ranges.reset(new WorkRange[threadCount]);
+        for (int index = 0; index < threadCount; index++) _ranges[index].begin = _ranges[index].end = 0;
+        _abort = false;
+        _wallTime = 0;
+        _busyTimes.assign(threadCount, 0.);
+        _steals = 0;
 
         // Create the extra parallel threads with one-based index (parent thread has index zero)
         for (int index = 1; index < threadCount; index++)
@@ -42,6 +54,9 @@ Parallel::Parallel(int threadCount, ParallelFactory* factory)
 
     // Wait until all parallel threads are ready
     waitForThreads();
+
+    // Pin the parent thread only now, so that the parallel threads don't inherit its affinity
+    pinCurrentThread(0);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -73,27 +88,59 @@ int Parallel::threadCount() const
 
 ////////////////////////////////////////////////////////////////////
 
+double Parallel::wallTime() const
+{
+    return _wallTime;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double Parallel::busyTime(int threadIndex) const
+{
+    return _busyTimes[threadIndex];
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t Parallel::stealCount() const
+{
+    return _steals;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void Parallel::call(ParallelTarget* target, const ProcessAssigner* assigner, size_t repetitions)
 {
     size_t assigned = assigner->assigned();
-    call(target, assigner, assigned*repetitions, assigned);
+    call(target, assigner, nullptr, assigned*repetitions, assigned);
 }
 
 ////////////////////////////////////////////////////////////////////
 
 void Parallel::call(ParallelTarget* target, size_t maxIndex, size_t repetitions)
 {
-    call(target, nullptr, maxIndex*repetitions, maxIndex);
+    call(target, nullptr, nullptr, maxIndex*repetitions, maxIndex);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Parallel::call(ParallelTarget* target, ChunkDispatcher* dispatcher)
+{
+    // the thread subranges remain empty; all indices are obtained from the dispatcher
+    call(target, nullptr, dispatcher, 0, 1);
 }
 
 ////////////////////////////////////////////////////////////////////
 
-void Parallel::call(ParallelTarget* target, const ProcessAssigner* assigner, size_t limit, size_t loopRange)
+void Parallel::call(ParallelTarget* target, const ProcessAssigner* assigner, ChunkDispatcher* dispatcher,
+                    size_t limit, size_t loopRange)
 {
     // Verify that we're being called from our parent thread
     if (std::this_thread::get_id() != _parentThread)
         throw FATALERROR("Parallel call not invoked from thread that constructed this object");
 
+    auto start = std::chrono::steady_clock::now();
+
     // Initialize shared data members and activate threads in a critical section
     {
         std::unique_lock<std::mutex> lock(_mutex);
@@ -101,6 +148,7 @@ void Parallel::call(ParallelTarget* target, const ProcessAssigner* assigner, siz
         // Copy the arguments so they can be used from any of the threads
         _target = target;
         _assigner = assigner;
+        _dispatcher = dispatcher;
         _limit = limit;
         _loopRange = loopRange;
 
@@ -110,18 +158,25 @@ void Parallel::call(ParallelTarget* target, const ProcessAssigner* assigner, siz
         // Clear the exception pointer
         _exception = 0;
 
-        // Initialize the loop variable
-        _next = 0;
+        // Divide the index range into contiguous subranges, one for each thread
+        for (int index = 0; index < _threadCount; index++)
+        {
+            std::unique_lock<std::mutex> rangeLock(_ranges[index].mutex);
+            _ranges[index].begin = limit * index / _threadCount;
+            _ranges[index].end = limit * (index+1) / _threadCount;
+        }
+        _abort = false;
 
         // Wake all parallel threads, if multithreading is allowed
         _conditionExtra.notify_all();
     }
 
     // Do some work ourselves as well
-    doWork();
+    doWork(0);
 
     // Wait until all parallel threads are done
     waitForThreads();
+    _wallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
     // Check for and process the exception, if any
     if (_exception)
@@ -134,6 +189,10 @@ void Parallel::call(ParallelTarget* target, const ProcessAssigner* assigner, siz
 
 void Parallel::run(int threadIndex)
 {
+    // Bind this thread to its index so that the factory can return it without a lookup
+    _factory->bindCurrentThread(threadIndex);
+    pinCurrentThread(threadIndex);
+
     while (true)
     {
         // Wait for new work in a critical section
@@ -160,27 +219,36 @@ void Parallel::run(int threadIndex)
         }
 
         // Do work as long as some is available
-        doWork();
+        doWork(threadIndex);
     }
 }
 
 ////////////////////////////////////////////////////////////////////
 
-void Parallel::doWork()
+void Parallel::doWork(int threadIndex)
 {
+    auto start = std::chrono::steady_clock::now();
     try
     {
-        // Do work as long as some is available
-        while (true)
+        // Do work as long as some is available, either from the dispatcher,
+        // or first from our own subrange and then from other threads
+        while (!_abort)
         {
-            size_t index = _next++;                  // get the next index atomically
-            if (index >= _limit) break;              // break if no more are available
+            size_t index;
+            if (_dispatcher)
+            {
+                if (!_dispatcher->next(index)) break;
+            }
+            else
+            {
+                if (!takeWork(threadIndex, index) && !stealWork(threadIndex, index)) break;
 
-            // Repeat the same index range if necessary
-            index = index % _loopRange;
+                // Repeat the same index range if necessary
+                index = index % _loopRange;
 
-            // Convert the index if using an assigner
-            if (_assigner) index = _assigner->absoluteIndex(index);
+                // Convert the index if using an assigner
+                if (_assigner) index = _assigner->absoluteIndex(index);
+            }
 
             // Execute the body
             _target->body(index);
@@ -196,6 +264,81 @@ void Parallel::doWork()
         // Create a fresh exception
         reportException(new FATALERROR("Unhandled exception (not of type FatalError) in a parallel thread"));
     }
+    _busyTimes[threadIndex] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool Parallel::takeWork(int threadIndex, size_t& index)
+{
+    WorkRange& range = _ranges[threadIndex];
+    std::unique_lock<std::mutex> lock(range.mutex);
+    if (range.begin >= range.end) return false;
+    index = range.begin++;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool Parallel::stealWork(int threadIndex, size_t& index)
+{
+    while (true)
+    {
+        // find the thread with the largest remaining subrange
+        int victim = -1;
+        size_t largest = 0;
+        for (int other = 0; other < _threadCount; other++)
+        {
+            if (other == threadIndex) continue;
+            WorkRange& range = _ranges[other];
+            std::unique_lock<std::mutex> lock(range.mutex);
+            size_t remaining = range.end - range.begin;
+            if (remaining > largest)
+            {
+                largest = remaining;
+                victim = other;
+            }
+        }
+        if (victim < 0) return false;
+
+        // take the back half of its subrange (or the single remaining index)
+        size_t begin, end;
+        {
+            WorkRange& range = _ranges[victim];
+            std::unique_lock<std::mutex> lock(range.mutex);
+            if (range.begin >= range.end) continue;   // someone else was faster; look again
+            end = range.end;
+            begin = range.end - (range.end - range.begin + 1) / 2;
+            range.end = begin;
+        }
+        _steals++;
+
+        // keep the first index and put the rest in our own subrange; the victim's lock has been
+        // released to avoid deadlock between threads stealing from each other
+        index = begin;
+        WorkRange& range = _ranges[threadIndex];
+        std::unique_lock<std::mutex> lock(range.mutex);
+        range.begin = begin+1;
+        range.end = end;
+        return true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void Parallel::pinCurrentThread(int threadIndex)
+{
+    int firstCore = _factory->threadPinning();
+    if (firstCore < 0) return;
+    int core = (firstCore + threadIndex) % ParallelFactory::defaultThreadCount();
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#else
+    throw FATALERROR("Cannot pin thread to core " + QString::number(core) + " on this platform");
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -208,8 +351,8 @@ void Parallel::reportException(FatalError* exception)
     {
         _exception = exception;
 
-        // Make the other threads stop by taking away their work
-        _limit = 0;  // this is safe because another thread will see either the old value, or zero
+        // Make the other threads stop after finishing their current loop body
+        _abort = true;
     }
 }
 
@@ -7,11 +7,14 @@
 #define PARALLEL_HPP
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 #include "ParallelTarget.hpp"
+class ChunkDispatcher;
 class FatalError;
 class ParallelFactory;
 class ProcessAssigner;
@@ -59,6 +62,23 @@ class ProcessAssigner;
     scope of the loop body. Recursively invoking the call() function on the same Parallel instance is
     not allowed and results in undefined behavior.
 
+    The work is distributed over the threads by a work-stealing scheduler. When the call()
+    function is invoked, the index range is divided into contiguous subranges, one for each
+    thread, so that consecutive indices (which often refer to related data, such as chunks for the
+    same wavelength or neighboring cells) are handled by the same thread. Each thread takes indices
+    from the front of its own subrange. A thread that runs out of work selects the thread with the
+    largest remaining subrange and steals the back half of it. Thus the remaining work is split
+    adaptively into smaller pieces towards the end of the loop, avoiding a long tail when the
+    execution time differs substantially between indices. Alternatively, the indices can be taken
+    one by one from a ChunkDispatcher shared with the other processes in the simulation, so that
+    the work is also balanced between processes. If so requested by the factory, each
+    thread is pinned to a particular logical core (see ParallelFactory::setThreadPinning()).
+
+    A Parallel instance keeps track of the total wall-clock time spent in the call() function and,
+    for each thread, of the time during which the thread was executing loop bodies. The
+    difference is the idle time of the thread, which can be reported through a TimeLogger
+    instance.
+
     The Parallel class uses C++11 multi-threading capabilities, avoiding the complexities of using
     yet another library (such as OpenMP) and making it possible to properly handle exceptions. It
     is designed to minimize the run-time overhead for loops with many iterations. */
@@ -83,6 +103,19 @@ public:
     /** Returns the number of threads used by this instance. */
     int threadCount() const;
 
+    /** Returns the total wall-clock time, in seconds, spent in the call() function since this
+        instance was constructed. */
+    double wallTime() const;
+
+    /** Returns the total time, in seconds, during which the thread with the specified index was
+        executing loop bodies or looking for work within the call() function since this instance
+        was constructed. The difference with wallTime() is the idle time of the thread. */
+    double busyTime(int threadIndex) const;
+
+    /** Returns the number of times a thread has stolen work from another thread since this
+        instance was constructed. */
+    size_t stealCount() const;
+
     /** Calls the body() function of the specified specified target object a certain number of
         times, with the \em index argument of that function taking values that are determined by
         the \em assigner, which is also passed to this function. While the values assigned to a
@@ -99,6 +132,13 @@ public:
         With every repetition, the index starts from 0 and goes up to \em maxIndex-1. */
     void call(ParallelTarget* target, size_t maxIndex, size_t repetitions = 1);
 
+    /** Calls the body() function of the specified specified target object a certain number of
+        times, with the \em index argument of that function taking the values handed out by the
+        specified \em dispatcher. Each thread asks the dispatcher for a new index whenever it is
+        ready for more work, until all indices have been handed out to the threads of this and
+        other processes. */
+    void call(ParallelTarget* target, ChunkDispatcher* dispatcher);
+
     /** Calls the specified member function for the specified target object a certain number of
         times, with the \em index argument of that function taking values that are determined by
         the \em assigner, which is also passed to this function. While the values assigned to a
@@ -117,16 +157,40 @@ public:
     template<class T> void call(T* targetObject, void (T::*targetMember)(size_t index),
                                 size_t maxIndex, size_t repetitions = 1);
 
+    /** Calls the specified member function for the specified target object a certain number of
+        times, with the \em index argument of that function taking the values handed out by the
+        specified \em dispatcher. Each thread asks the dispatcher for a new index whenever it is
+        ready for more work, until all indices have been handed out to the threads of this and
+        other processes. */
+    template<class T> void call(T* targetObject, void (T::*targetMember)(size_t index),
+                                ChunkDispatcher* dispatcher);
+
 private:
     /** This function gets called by all other versions of the call() function. It sets the data
         members shared by the threads and starts the parallel execution. */
-    void call(ParallelTarget* target, const ProcessAssigner* assigner, size_t limit, size_t loopRange);
+    void call(ParallelTarget* target, const ProcessAssigner* assigner, ChunkDispatcher* dispatcher,
+              size_t limit, size_t loopRange);
 
     /** The function that gets executed inside each of the parallel threads. */
     void run(int threadIndex);
 
-    /** The function to do the actual work; used by call() and run(). */
-    void doWork();
+    /** The function to do the actual work in the thread with the specified index; used by
+        call() and run(). */
+    void doWork(int threadIndex);
+
+    /** This function takes the next index from the subrange of the thread with the specified
+        index, and stores it in \em index. It returns false if the subrange is empty. */
+    bool takeWork(int threadIndex, size_t& index);
+
+    /** This function steals the back half of the largest remaining subrange of the other threads,
+        and assigns it to the thread with the specified index, except for the first index of the
+        stolen range, which is stored in \em index. It returns false if there is no work left to
+        steal. */
+    bool stealWork(int threadIndex, size_t& index);
+
+    /** This function pins the calling thread to a logical core as requested by the factory; used
+        by the constructor and run(). */
+    void pinCurrentThread(int threadIndex);
 
     /** A function to report an exception; used by doWork(). */
     void reportException(FatalError* exception);
@@ -164,10 +228,22 @@ private:
         void (T::*_targetMember)(size_t index);
     };
 
+    /** This structure holds the subrange of indices that remain to be processed by a particular
+        thread. The begin and end indices are protected by the mutex. The padding avoids false
+        sharing between the subranges of different threads. */
+    struct WorkRange
+    {
+        std::mutex mutex;
+        size_t begin;
+        size_t end;
+        char padding[64];
+    };
+
     //======================== Data Members ========================
 
 private:
     // data members keeping track of the threads
+    ParallelFactory* _factory;          // the factory that created this object
     int _threadCount;                   // the total number of threads, including the parent thread
     std::thread::id _parentThread;      // the ID of the thread that invoked our constructor
     std::vector<std::thread> _threads;  // the parallel threads (other than the parent thread)
@@ -180,6 +256,7 @@ private:
     // data members shared by all threads; changes are protected by a mutex
     ParallelTarget* _target;    // the target to be called
     const ProcessAssigner* _assigner; // the process assigner
+    ChunkDispatcher* _dispatcher; // the chunk dispatcher, or null if the work is divided between threads
     size_t _limit;              // the total number of calls to the given function
     size_t _loopRange;          // the number of function calls in one iteration of the for loop
     std::vector<bool> _active;  // flag for each parallel thread (other than the parent thread)
@@ -188,8 +265,14 @@ private:
                                 // ... or zero if no exception was thrown
     bool _terminate;            // becomes true when the parallel threads must exit
 
-    // data member shared by all threads; incrementing is atomic (no need for protection)
-    std::atomic<size_t> _next;   // the current index of the for loop being implemented
+    // data members shared by all threads; the subranges are protected by their own mutex
+    std::unique_ptr<WorkRange[]> _ranges;   // the remaining subrange of indices for each thread
+    std::atomic<bool> _abort;               // becomes true when the threads must stop because of an exception
+
+    // statistics; the busy time for each thread is written only by that thread
+    double _wallTime;                   // the total wall-clock time spent in call()
+    std::vector<double> _busyTimes;     // the total busy time for each thread
+    std::atomic<size_t> _steals;        // the total number of successful steals
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -211,4 +294,13 @@ template<class T> void Parallel::call(T* targetObject, void (T::*targetMember)(s
     call(&target, maxIndex, repetitions);
 }
 
+////////////////////////////////////////////////////////////////////
+
+template<class T> void Parallel::call(T* targetObject, void (T::*targetMember)(size_t index),
+                                      ChunkDispatcher* dispatcher)
+{
+    Target<T> target(targetObject, targetMember);
+    call(&target, dispatcher);
+}
+
 #endif // PARALLEL_HPP
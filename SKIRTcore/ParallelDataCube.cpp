@@ -3,7 +3,10 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include "DataCubeExchange.hpp"
 #include "FatalError.hpp"
+#include "InstrumentSystem.hpp"
+#include "LockFree.hpp"
 #include "Log.hpp"
 #include "ParallelDataCube.hpp"
 #include "PeerToPeerCommunicator.hpp"
@@ -12,8 +15,8 @@
 
 ////////////////////////////////////////////////////////////////////
 
-ParallelDataCube::ParallelDataCube() : _wavelengthAssigner(nullptr), _comm(nullptr), _Nframep(0),
-    _partialCube(std::make_shared<Array>())
+ParallelDataCube::ParallelDataCube() : _wavelengthAssigner(nullptr), _comm(nullptr), _exchange(nullptr),
+    _cubeIndex(-1), _Nframep(0), _partialCube(std::make_shared<Array>())
 {
 }
 
@@ -26,6 +29,7 @@ void ParallelDataCube::initialize(size_t Nframep, SimulationItem* item)
     _comm = item->find<PeerToPeerCommunicator>();
 
     WavelengthGrid* wg = item->find<WavelengthGrid>();
+    InstrumentSystem* is = item->find<InstrumentSystem>();
 
     if(_comm->dataParallel())
     {
@@ -34,6 +38,15 @@ void ParallelDataCube::initialize(size_t Nframep, SimulationItem* item)
         log->info("Data cube is distributed, size on this process is "
                   +QString::number(_Nframep)+"x"+QString::number(_Nlambda));
     }
+    else if (is->cubeExchange())
+    {
+        _wavelengthAssigner = is->cubeAssigner();
+        _exchange = is->cubeExchange();
+        _cubeIndex = _exchange->registerCube(this, _wavelengthAssigner->total()*_Nframep);
+        _Nlambda = _wavelengthAssigner->assigned();
+        log->info("Data cube is distributed across the processes in task parallelization mode, "
+                  "size on this process is "+QString::number(_Nframep)+"x"+QString::number(_Nlambda));
+    }
     else
     {
         _wavelengthAssigner = nullptr;
@@ -92,6 +105,13 @@ double& ParallelDataCube::operator()(int ell, int pixel)
 
 ////////////////////////////////////////////////////////////////////
 
+Array& ParallelDataCube::partialCube()
+{
+    return *_partialCube;
+}
+
+////////////////////////////////////////////////////////////////////
+
 const double& ParallelDataCube::operator()(int ell, int pixel) const
 {
     if(!_wavelengthAssigner) return (*_partialCube)[ell*_Nframep + pixel];
@@ -105,3 +125,24 @@ const double& ParallelDataCube::operator()(int ell, int pixel) const
 }
 
 ////////////////////////////////////////////////////////////////////
+
+bool ParallelDataCube::isLocal(int ell) const
+{
+    return !_exchange || _wavelengthAssigner->validIndex(ell);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelDataCube::ship(int ell, int pixel, double value)
+{
+    _exchange->ship(_wavelengthAssigner->rankForIndex(ell), _cubeIndex, ell*_Nframep + pixel, value);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelDataCube::addReceived(size_t position, double value)
+{
+    LockFree::add((*this)(position/_Nframep, position%_Nframep), value);
+}
+
+////////////////////////////////////////////////////////////////////
@@ -9,6 +9,7 @@
 #include <memory>
 
 class Array;
+class DataCubeExchange;
 class PeerToPeerCommunicator;
 class ProcessAssigner;
 class SimulationItem;
@@ -23,9 +24,20 @@ class SimulationItem;
     gathered at the root process using an MPI communication. When the wavelengths are evenly
     divided across the processes, the memory usage per process is expected to scale as 1/N, with N
     the number of processes. When data parallelization is not active, there will be no wavelength
-    assigner, and this object will store data for all wavelengths. */
+    assigner, and this object will store data for all wavelengths.
+
+    In task parallelization mode, the data cube can nevertheless be distributed across the
+    processes if so requested from the command line (see
+    PeerToPeerCommunicator::distributedCubes()). The wavelengths are then assigned to the
+    processes by an assigner held by the instrument system. Since each process detects photon
+    packages at all wavelengths, an instrument uses isLocal() to determine whether a contribution
+    can be recorded locally, and otherwise ships the contribution to the process storing the
+    wavelength through ship(). The shipped contributions are handled by the DataCubeExchange object
+    of the instrument system, which must be finished before the complete cube is constructed. */
 class ParallelDataCube
 {
+    friend class DataCubeExchange;
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -38,7 +50,9 @@ public:
         hierarchy, allowing it to look for the \c WavelengthGrid and the \c PeerToPeerCommunicator. Via the
         wavelength grid, the wavelength assigner can be obtained. From the wavelength assigner, it
         is determined what size the \c _partialCube data member should be, and the necessary memory
-        is allocated. */
+        is allocated. In task parallelization mode, the wavelength assigner and the exchange for
+        shipping foreign contributions are obtained from the \c InstrumentSystem, if the latter
+        distributes the data cubes. */
     void initialize(size_t Nframep, SimulationItem* item);
 
     //======================== Other Methods =======================
@@ -65,11 +79,34 @@ public:
         assigner, and the correct element is retrieved. */
     const double& operator()(int ell, int pixel) const;
 
+    /** This function returns a writable reference to the partial data cube stored at this
+        process, i.e. the array holding the values for the wavelengths assigned to this process. It
+        allows an instrument to register the storage of the data cube as one of its detector arrays.
+        */
+    Array& partialCube();
+
+    /** This function returns true if the values for the specified wavelength are stored at this
+        process, i.e. if they can be accessed through the ()-operator. This is always the case,
+        except for a data cube that is distributed in task parallelization mode. */
+    bool isLocal(int ell) const;
+
+    /** This function ships the specified contribution for a wavelength that is not stored at this
+        process to the process that stores it, where it is added to the specified pixel. The
+        function may be called concurrently from multiple threads. */
+    void ship(int ell, int pixel, double value);
+
+private:
+    /** This function is used by the DataCubeExchange to add a contribution shipped by another
+        process to the specified position in the complete cube, in a thread-safe manner. */
+    void addReceived(size_t position, double value);
+
     //======================== Data Members ========================
 
 private:
     const ProcessAssigner* _wavelengthAssigner;
     PeerToPeerCommunicator* _comm;
+    DataCubeExchange* _exchange;    // the exchange for foreign contributions, or null if not needed
+    int _cubeIndex;                 // the index of this cube in the exchange
     size_t _Nlambda;
     size_t _Nframep;
 
@@ -3,13 +3,31 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <atomic>
 #include "FatalError.hpp"
 #include "Parallel.hpp"
 #include "ParallelFactory.hpp"
 
 ////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the source of unique factory identifiers; zero is reserved for "not bound"
+    std::atomic<uint64_t> _lastFactoryId(0);
+
+    // the factory to which the current thread is bound, and the index of the thread in that factory
+    struct ThreadBinding
+    {
+        uint64_t factoryId;
+        int index;
+    };
+    thread_local ThreadBinding _binding = { 0, 0 };
+}
+
+////////////////////////////////////////////////////////////////////
+
 ParallelFactory::ParallelFactory()
+    : _id(++_lastFactoryId), _firstCore(-1)
 {
     // Initialize default maximum number of threads
     _maxThreadCount = defaultThreadCount();
@@ -41,6 +59,20 @@ int ParallelFactory::maxThreadCount() const
 
 ////////////////////////////////////////////////////////////////////
 
+void ParallelFactory::setThreadPinning(int firstCore)
+{
+    _firstCore = firstCore;
+}
+
+////////////////////////////////////////////////////////////////////
+
+int ParallelFactory::threadPinning() const
+{
+    return _firstCore;
+}
+
+////////////////////////////////////////////////////////////////////
+
 int ParallelFactory::defaultThreadCount()
 {
     int count = std::thread::hardware_concurrency();
@@ -68,8 +100,13 @@ Parallel* ParallelFactory::parallel(int maxThreadCount)
 
 int ParallelFactory::currentThreadIndex() const
 {
+    // Use the cached binding if the current thread is bound to this factory
+    if (_binding.factoryId == _id) return _binding.index;
+
+    // Otherwise look up the index and bind the current thread
     auto search = _indices.find(std::this_thread::get_id());
     if (search == _indices.end()) throw FATALERROR("Current thread index was not found");
+    bindCurrentThread(search->second);
     return search->second;
 }
 
@@ -81,3 +118,11 @@ void ParallelFactory::addThreadIndex(std::thread::id threadId, int index)
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void ParallelFactory::bindCurrentThread(int index) const
+{
+    _binding.factoryId = _id;
+    _binding.index = index;
+}
+
+////////////////////////////////////////////////////////////////////
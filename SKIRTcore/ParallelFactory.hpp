@@ -6,6 +6,7 @@
 #ifndef PARALLELFACTORY_HPP
 #define PARALLELFACTORY_HPP
 
+#include <cstdint>
 #include <thread>
 #include <unordered_map>
 #include "SimulationItem.hpp"
@@ -53,6 +54,20 @@ public:
         this factory object. */
     int maxThreadCount() const;
 
+    /** Requests that the threads of the Parallel objects manufactured by this factory object are
+        pinned to logical cores, starting at the specified core index: the thread with index
+        \f$i\f$ is pinned to core \f$(c_0+i) \bmod N_\text{cores}\f$. A negative value (the
+        default) disables thread pinning. When multiple processes run on the same computer, each
+        process should specify a different first core, e.g. based on its rank among the processes
+        on that computer (see ProcessManager::localRank()). The setting affects only Parallel
+        objects created after the invocation of this function. Thread pinning is supported on Linux
+        only. */
+    void setThreadPinning(int firstCore);
+
+    /** Returns the index of the logical core to which the first thread is pinned, or a negative
+        value if thread pinning is disabled. */
+    int threadPinning() const;
+
     /** Returns the number of logical cores detected on the computer running the code. */
     static int defaultThreadCount();
 
@@ -66,7 +81,12 @@ public:
         from within a loop body being iterated by one of the factory's Parallel children, the
         function returns an index from zero to the number of threads in the Parallel instance minus
         one. When invoked from a thread that does not belong to any of the factory's children, the
-        function throws a fatal error. */
+        function throws a fatal error.
+
+        Because this function is called very frequently (e.g. for each random number being
+        generated), the index is cached in a thread-local binding. A lookup in the dictionary of
+        thread indices is needed only for the first call from a given thread, or when the thread
+        has been bound to another factory in the mean time. */
     int currentThreadIndex() const;
 
 private:
@@ -75,10 +95,17 @@ private:
         by the currentThreadIndex() function. */
     void addThreadIndex(std::thread::id threadid, int index);
 
+    /** Binds the calling thread to this factory with the specified index, so that subsequent
+        calls to currentThreadIndex() from the same thread avoid the dictionary lookup. This is a
+        private function used from the Parallel::run() function when a worker thread starts. */
+    void bindCurrentThread(int index) const;
+
     //======================== Data Members ========================
 
 private:
+    uint64_t _id;                                       // a unique identifier for the factory (never reused)
     int _maxThreadCount;                                // the maximum thread count for the factory
+    int _firstCore;                                     // the core for the first thread, or -1 if not pinning
     std::thread::id _parentThread;                      // the thread that invoked our constructor
     std::unordered_map<int, std::unique_ptr<Parallel>> _children; // our children, keyed on number of threads
     std::unordered_map<std::thread::id, int> _indices;  // the index for each child thread and the parent thread
@@ -13,7 +13,8 @@ namespace {
 ParallelTable::ParallelTable()
     : _totalCols(0), _totalRows(0), _colAssigner(nullptr), _rowAssigner(nullptr),
       _writeOn(WriteState::COLUMN), _comm(nullptr), _log(nullptr),
-      _initialized(false), _distributed(false), _switched(false), _modified(false)
+      _initialized(false), _distributed(false), _switched(false), _modified(false),
+      _Nblocks(0), _Nfinished(0), _readableRows(0), _waitTime(0)
 {
 }
 
@@ -140,6 +141,112 @@ void ParallelTable::switchScheme()
 
 ////////////////////////////////////////////////////////////////////
 
+void ParallelTable::startSwitchScheme(size_t Nblocks)
+{
+    if (_Nblocks) throw FATALERROR(_name + " says: A pipelined switch is already in progress");
+    if (Nblocks < 1) throw FATALERROR(_name + " says: A pipelined switch needs at least one block");
+
+    // Without distributed storage there is nothing to pipeline; the same holds if there is no data to send
+    if (!_switched && _distributed && _writeOn == WriteState::COLUMN) _comm->or_all(_modified);
+    if (_switched || !_distributed || (_writeOn == WriteState::COLUMN && !_modified))
+    {
+        switchScheme();
+        return;
+    }
+
+    // Cache the rows and columns assigned to each process
+    int Nprocs = _comm->size();
+    _rowIndicesvv.clear();
+    _colIndicesvv.clear();
+    for (int r=0; r<Nprocs; r++)
+    {
+        _rowIndicesvv.push_back(_rowAssigner->indicesForRank(r));
+        _colIndicesvv.push_back(_colAssigner->indicesForRank(r));
+    }
+
+    _Nblocks = Nblocks;
+    _exchangev.clear();
+    _Nfinished = 0;
+    _readableRows = 0;
+    _waitTime = 0;
+
+    // In COLUMN mode, all data is available, so the communication for all blocks can be started right away;
+    // in ROW mode, the data is received in the columns table while the rows table is still being written
+    if (_writeOn == WriteState::COLUMN)
+    {
+        allocateRows();
+        for (size_t block=0; block<_Nblocks; block++) startBlock(block);
+    }
+    else allocateColumns();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelTable::blockRows(size_t block, size_t& begin, size_t& end) const
+{
+    size_t Nrows = _distributed ? _rowAssigner->assigned() : _totalRows;
+    size_t Nblocks = std::max(_Nblocks, static_cast<size_t>(1));
+    begin = Nrows * block / Nblocks;
+    end = Nrows * (block+1) / Nblocks;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelTable::switchBlock(size_t block)
+{
+    if (!_Nblocks || _writeOn == WriteState::COLUMN) return;
+    if (block != _exchangev.size()) throw FATALERROR(_name + " says: The blocks must be switched in order");
+
+    startBlock(block);
+
+    // Give the communication for the earlier blocks an opportunity to make progress
+    while (_Nfinished < block && _comm->testExchange(_exchangev[_Nfinished]))
+    {
+        _comm->finishExchange(_exchangev[_Nfinished]);
+        _Nfinished++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelTable::waitForBlock(size_t block)
+{
+    if (!_Nblocks || _writeOn == WriteState::ROW) return;
+
+    finishBlocks(block);
+
+    size_t begin, end;
+    blockRows(block, begin, end);
+    _readableRows = std::max(_readableRows, end);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelTable::finishSwitchScheme()
+{
+    if (!_Nblocks) return;
+    if (_exchangev.size() != _Nblocks) throw FATALERROR(_name + " says: Not all blocks have been switched");
+
+    finishBlocks(_Nblocks-1);
+    double transferTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - _transferStart).count();
+
+    if (_writeOn == WriteState::COLUMN) destroyColumns();
+    else destroyRows();
+
+    double overlap = transferTime > 0 ? std::max(0., 100.*(transferTime-_waitTime)/transferTime) : 0.;
+    _log->info("Communication of " + _name + " in " + QString::number(_Nblocks) + " blocks took "
+               + QString::number(transferTime, 'f', 3) + " s, of which " + QString::number(overlap, 'f', 1)
+               + "% overlapped with calculations");
+
+    _Nblocks = 0;
+    _rowIndicesvv.clear();
+    _colIndicesvv.clear();
+    _switched = true;
+    _modified = false;
+}
+
+////////////////////////////////////////////////////////////////////
+
 void ParallelTable::reset()
 {
     if (_distributed)
@@ -200,7 +307,8 @@ double& ParallelTable::operator()(size_t i, size_t j)
 
 const double& ParallelTable::operator()(size_t i, size_t j) const
 {
-    if (!_switched) throw FATALERROR(_name + " says: switchScheme() must be called before using the read operator");
+    if (!_switched && !readableRow(i))
+        throw FATALERROR(_name + " says: switchScheme() must be called before using the read operator");
 
     // WORKING DISTRIBUTED: Read from the table opposite to the table we _writeOn.
     if (_distributed)
@@ -258,7 +366,7 @@ double ParallelTable::sumColumn(size_t j) const
 
 double ParallelTable::sumRow(size_t i) const
 {
-    if (!_switched) throw FATALERROR(_name + " says: switchScheme() must be called before using summation functions");
+    if (!_switched && !readableRow(i)) throw FATALERROR(_name + " says: switchScheme() must be called before using summation functions");
     if (_writeOn == WriteState::ROW) throw FATALERROR("Not available in ROW mode.");
 
     double sum = 0;
@@ -459,3 +567,62 @@ void ParallelTable::destroyRows()
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void ParallelTable::startBlock(size_t block)
+{
+    int Nprocs = _comm->size();
+    size_t begin, end;
+    blockRows(block, begin, end);
+
+    // The rows in this block for each process
+    IntTable rowDispvv(Nprocs);
+    for (int r=0; r<Nprocs; r++)
+    {
+        const std::vector<int>& indices = _rowIndicesvv[r];
+        size_t n = indices.size();
+        rowDispvv[r].assign(indices.begin() + n*block/_Nblocks, indices.begin() + n*(block+1)/_Nblocks);
+    }
+
+    // The communication patterns are those of columsToRows() and rowsToColums(), restricted to the rows in the block
+    int handle;
+    if (_writeOn == WriteState::COLUMN)
+    {
+        size_t sendBlockLength = _columns.size(1);
+        double* recvBuffer = end > begin ? &_rows(begin,0) : nullptr;
+        handle = _comm->startDisplacedBlocksAllToAll(&_columns(0,0), 1, sendBlockLength, rowDispvv,
+                                                     _totalRows*sendBlockLength,
+                                                     recvBuffer, end-begin, 1, _colIndicesvv, _totalCols);
+    }
+    else
+    {
+        size_t recvBlockLength = _columns.size(1);
+        double* sendBuffer = end > begin ? &_rows(begin,0) : nullptr;
+        handle = _comm->startDisplacedBlocksAllToAll(sendBuffer, end-begin, 1, _colIndicesvv, _totalCols,
+                                                     &_columns(0,0), 1, recvBlockLength, rowDispvv,
+                                                     _totalRows*recvBlockLength);
+    }
+
+    if (_exchangev.empty()) _transferStart = std::chrono::steady_clock::now();
+    _exchangev.push_back(handle);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void ParallelTable::finishBlocks(size_t block)
+{
+    if (_Nfinished > block) return;
+
+    auto start = std::chrono::steady_clock::now();
+    for (; _Nfinished <= block; _Nfinished++) _comm->finishExchange(_exchangev[_Nfinished]);
+    _waitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool ParallelTable::readableRow(size_t i) const
+{
+    return _switched || (_Nblocks && _writeOn == WriteState::COLUMN && _distributed
+                         && _isValidRowv[i] && _relativeRowIndexv[i] < _readableRows);
+}
+
+////////////////////////////////////////////////////////////////////
@@ -6,6 +6,7 @@
 #ifndef DISTMEMTABLE_HPP
 #define DISTMEMTABLE_HPP
 
+#include <chrono>
 #include <QString>
 
 #include "Log.hpp"
@@ -71,6 +72,16 @@ class PeerToPeerCommunicator;
     - Perform another calculation, where each process reads the data from the ParallelTable.
     - Call \c reset() if the table is to be re-used with the same parameters.
 
+    In distributed mode, the global transposition can also be pipelined with the calculations
+    that produce or consume the data, using the \c startSwitchScheme(), \c switchBlock(), \c
+    waitForBlock() and \c finishSwitchScheme() functions. The rows stored by each process after
+    (in \c COLUMN mode) or before (in \c ROW mode) the switch are divided into a number of
+    consecutive blocks, and the data for each block is exchanged by a separate non-blocking
+    communication. In \c COLUMN mode, all blocks are sent right away, and the rows in a block can
+    be read as soon as that block has arrived, while the following blocks are still in transit.
+    In \c ROW mode, each block is sent as soon as its rows have been written, while the rows in
+    the following blocks are still being calculated.
+
     When the two assigners divide the columns and the rows evenly between the processes, the memory
     usage per process of a \c ParallelTable is expected to scale as 1/N, with N the number of
     processes. During the switch, the memory usage temporarily becomes 2/N. */
@@ -151,6 +162,45 @@ public:
         all cases, this function needs to be called collectively. */
     void switchScheme();
 
+    /** This function starts a pipelined version of \c switchScheme(), exchanging the data in the
+        specified number of blocks. The rows of the table stored by each process are divided into
+        \em Nblocks consecutive blocks; the relative row indices in each block can be obtained with
+        \c blockRows(). In \c COLUMN mode, the communication for all blocks is started
+        immediately. The read operator can be used for the rows of a block after \c waitForBlock()
+        has been called for that block. In \c ROW mode, the writing operator can still be used
+        after this function returns; the communication for a block is started by \c switchBlock()
+        after all rows in that block have been written. In both modes, the switch is completed by
+        \c finishSwitchScheme(). When the table is running in non-distributed mode, or if the
+        scheme has already been switched, this function simply calls \c switchScheme() and the
+        other pipeline functions do nothing. This function must be called collectively. */
+    void startSwitchScheme(size_t Nblocks);
+
+    /** This function stores the range of relative indices of the rows in the specified block of a
+        pipelined switch (see \c startSwitchScheme()) that are stored at this process in \em
+        begin and \em end (exclusive). The blocks cover the rows assigned to the process in order.
+        */
+    void blockRows(size_t block, size_t& begin, size_t& end) const;
+
+    /** In \c ROW mode, this function starts the communication for the specified block of a
+        pipelined switch, after all rows in that block have been written. The blocks must be sent
+        in order. The function also gives the communication for the previous blocks the
+        opportunity to make progress. In \c COLUMN mode, this function does nothing. This function
+        must be called collectively. */
+    void switchBlock(size_t block);
+
+    /** In \c COLUMN mode, this function waits until the rows in the specified block of a
+        pipelined switch have been received, and enables the read operator for those rows. In \c
+        ROW mode, this function does nothing. */
+    void waitForBlock(size_t block);
+
+    /** This function completes a pipelined switch started by \c startSwitchScheme(). It waits
+        for the communication of all blocks, releases the memory used by the table that originally
+        contained the data, and logs the time taken by the communication and the fraction of that
+        time that was overlapped with other work. After this function returns, the table is in the
+        same state as after calling \c switchScheme(). This function must be called collectively.
+        */
+    void finishSwitchScheme();
+
     /** This function resets the ParallelTable, reverting it to the same state as if it was just
         initialized, and setting all data to zero. After resetting, only the writing operator can
         be called. */
@@ -241,6 +291,17 @@ private:
     /** Frees the memory occupied by _rows by resizing it to 0. */
     void destroyRows();
 
+    /** Starts the communication for the specified block of a pipelined switch. */
+    void startBlock(size_t block);
+
+    /** Waits for the communication of the blocks up to and including the specified block of a
+        pipelined switch, and adds the time spent waiting to the exposed communication time. */
+    void finishBlocks(size_t block);
+
+    /** Returns true if the read operator can be used for the specified row, i.e. if the scheme has
+        been switched, or if the row has already been received during a pipelined switch. */
+    bool readableRow(size_t i) const;
+
     //======================== Data Members ========================
 
     // Members to be set during initialization
@@ -263,6 +324,16 @@ private:
     Table<2> _columns;  // the values distributed over processes column wise
     Table<2> _rows;     // the values distributed over processes row wise
 
+    // State of a pipelined switch
+    size_t _Nblocks;                // the number of blocks, or zero if no pipelined switch is in progress
+    std::vector<int> _exchangev;    // the communication handle for each block that has been started
+    size_t _Nfinished;              // the number of blocks for which the communication has completed
+    size_t _readableRows;           // the number of local rows that can be read in COLUMN mode
+    std::chrono::steady_clock::time_point _transferStart;   // the time when the first block was started
+    double _waitTime;               // the time spent waiting for the communication
+    std::vector<std::vector<int>> _rowIndicesvv;    // the absolute row indices assigned to each process
+    std::vector<std::vector<int>> _colIndicesvv;    // the absolute column indices assigned to each process
+
     // Cached function outcomes for optimizing performance under frequent access
     std::vector<size_t> _relativeRowIndexv; // caches the values of _rowAssigner->relativeIndex(i)
     std::vector<size_t> _relativeColIndexv; // caches the values of _colAssigner->relativeindex(j)
@@ -13,6 +13,8 @@
 #include "FatalError.hpp"
 #include "Log.hpp"
 #include "OctTreeNode.hpp"
+#include "Parallel.hpp"
+#include "ParallelFactory.hpp"
 #include "ParticleTreeDustGrid.hpp"
 #include "Random.hpp"
 
@@ -37,37 +39,33 @@ ParticleTreeDustGrid::~ParticleTreeDustGrid()
 
 namespace
 {
-    // private function to add a particle to a node, performing recursive subdivision if needed;
-    // returns the level of the leaf node to which the particle was finally added,
-    // or -1 if the particle is outside the node
-    int addParticleToNode(int newparticle, TreeNode* parent,
-                          DustParticleInterface* dpi, vector<int>& particlev, vector<TreeNode*>& tree)
+    // a parallel target that distributes the particles contained in each of the specified nodes over
+    // the children of that node; the particle lists for the children are indexed on the node ID,
+    // relative to the ID of the first child
+    class ParticleDistributor : public ParallelTarget
     {
-        // find the leaf node that contains this particle
-        TreeNode* node = const_cast<TreeNode*>(parent->whichnode(dpi->particleCenter(newparticle)));
-        if (!node) return -1;
-        int id = node->id();
+    public:
+        ParticleDistributor(DustParticleInterface* dpi, const vector<TreeNode*>& nodev,
+                            const vector<vector<int>>& particlevv, vector<vector<int>>& childvv, int firstchild)
+            : _dpi(dpi), _nodev(nodev), _particlevv(particlevv), _childvv(childvv), _firstchild(firstchild) { }
 
-        // if the leaf node is still empty, just add the particle to it
-        if (particlev[id]<0)
+        void body(size_t index)
         {
-            particlev[id] = newparticle;
-            return node->level();
+            const TreeNode* node = _nodev[index];
+            for (int particle : _particlevv[index])
+            {
+                int id = node->child(_dpi->particleCenter(particle))->id();
+                _childvv[id-_firstchild].push_back(particle);
+            }
         }
 
-        // if the leaf node already contains a particle, subdivide the node,
-        // and add both the old and new particles to the appropriate child
-        node->createchildren(tree.size());
-        const vector<TreeNode*>& children = node->children();
-        int n = children.size();
-        for (int i = 0; i<n; i++)
-        {
-            tree.push_back(children[i]);
-            particlev.push_back(-1);
-        }
-        addParticleToNode(particlev[id], node, dpi, particlev, tree);
-        return addParticleToNode(newparticle, node, dpi, particlev, tree);
-    }
+    private:
+        DustParticleInterface* _dpi;
+        const vector<TreeNode*>& _nodev;
+        const vector<vector<int>>& _particlevv;
+        vector<vector<int>>& _childvv;
+        int _firstchild;
+    };
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -87,12 +85,7 @@ void ParticleTreeDustGrid::setupSelfBefore()
     int numParticles = dpi->numParticles();
     log->info("Constructing tree for " + QString::number(numParticles) + " particles...");
 
-    // Create a list, used only during construction, that contains the index of the particle
-    // contained in each leaf node so far created, or -1 if the node is empty
-    // (the value is undefined for nonleaf nodes)
-    vector<int> particlev;
-
-    // Create the root node (which at this point is an empty leaf) using the requested type
+    // Create the root node using the requested type
     switch (_treeType)
     {
     default:
@@ -103,17 +96,51 @@ void ParticleTreeDustGrid::setupSelfBefore()
         _tree.push_back(new BinTreeNode(0,0,extent()));
         break;
     }
-    particlev.push_back(-1);
-    int maxlevel = 0;
 
-    // Add particles one by one, subdividing if the leaf node containing the new particle
-    // already contains another particle
+    // Create a list, used only during construction, that contains the indices of the particles
+    // contained in each node of the current level; initially the root node contains all particles
+    // inside the domain
+    vector<vector<int>> particlevv(1);
     for (int i=0; i<numParticles; i++)
+        if (root()->contains(dpi->particleCenter(i))) particlevv[0].push_back(i);
+
+    // Subdivide the tree level by level: each node containing more than one particle is subdivided,
+    // and its particles are distributed over its children. The children are created in the order of
+    // the nodes, and the particles are distributed in parallel, each thread handling the particles of
+    // a different node. The resulting tree has the same cells, regardless of the order of the particles.
+    Parallel* parallel = find<ParallelFactory>()->parallel();
+    int maxlevel = 0;
+    size_t begin = 0;
+    while (true)
     {
-        if (i%50000 == 0) log->info("Adding particle number " + QString::number(i) +
-                                    " (" + QString::number(i*100/numParticles) + "%)...");
-        int level = addParticleToNode(i, root(), dpi, particlev, _tree);
-        maxlevel = max(maxlevel, level);
+        // create the children of the nodes that contain more than one particle
+        size_t end = _tree.size();
+        vector<TreeNode*> nodev;
+        vector<vector<int>> nodeparticlevv;
+        for (size_t l=begin; l<end; l++)
+        {
+            vector<int>& particlev = particlevv[l-begin];
+            if (particlev.size() > 1)
+            {
+                TreeNode* node = _tree[l];
+                node->createchildren(_tree.size());
+                _tree.insert(_tree.end(), node->children().begin(), node->children().end());
+                nodev.push_back(node);
+                nodeparticlevv.push_back(vector<int>());
+                nodeparticlevv.back().swap(particlev);
+            }
+        }
+        if (nodev.empty()) break;
+        maxlevel++;
+        log->info("Subdivided " + QString::number(nodev.size()) + " nodes to level " + QString::number(maxlevel)
+                  + " (" + QString::number(_tree.size()) + " nodes in total)...");
+
+        // distribute the particles over the children
+        vector<vector<int>> childvv(_tree.size()-end);
+        ParticleDistributor distributor(dpi, nodev, nodeparticlevv, childvv, end);
+        parallel->call(&distributor, nodev.size());
+        particlevv.swap(childvv);
+        begin = end;
     }
 
     // Perform additional subdivisions as requested
@@ -54,10 +54,12 @@ protected:
     /** This function verifies that all attribute values have been appropriately set and actually
         constructs the tree. The particle locations are retrieved from the dust distribution
         through the DustParticleInterface interface, and the tree nodes are subdivided (using
-        regular subdivision) until each leaf cell contains at most one particle. If requested, each
-        leaf node is further subdivided by a fixed number of levels. When this task is
-        accomplished, the function creates a vector that contains the node IDs of all leaves. This
-        is the actual dust cell vector (only the leaf nodes are the actual dust cells). The
+        regular subdivision) level by level until each leaf cell contains at most one particle; the
+        particles contained in the nodes of a level are distributed over their children in
+        parallel, and the nodes are numbered in breadth-first order. If requested, each leaf node
+        is further subdivided by a fixed number of levels. When this task is accomplished, the
+        function creates a vector that contains the node IDs of all leaves. This is the actual
+        dust cell vector (only the leaf nodes are the actual dust cells). The
         function also creates a vector with the cell numbers of all the nodes, i.e. the rank
         \f$m\f$ of the node in the ID vector if the node is a leaf, and the number -1 if the node
         is not a leaf (and hence not a dust cell). Finally, the function logs some details on the
@@ -4,6 +4,7 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "Array.hpp"
+#include "FatalError.hpp"
 #include "Log.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "ProcessManager.hpp"
@@ -95,6 +96,59 @@ void PeerToPeerCommunicator::displacedBlocksAllToAll(const double* sendBuffer, s
 
 ////////////////////////////////////////////////////////////////////
 
+int PeerToPeerCommunicator::startDisplacedBlocksAllToAll(const double* sendBuffer, size_t sendCount,
+                                                         size_t sendLength,
+                                                         std::vector<std::vector<int>>& sendDisplacements,
+                                                         size_t sendExtent,
+                                                         double* recvBuffer, size_t recvCount, size_t recvLength,
+                                                         std::vector<std::vector<int>>& recvDisplacements,
+                                                         size_t recvExtent)
+{
+    if (!isMultiProc()) return -1;
+
+    return ProcessManager::startDisplacedBlocksAllToAll(sendBuffer, sendCount, sendLength, sendDisplacements,
+                                                        sendExtent, recvBuffer, recvCount, recvLength,
+                                                        recvDisplacements, recvExtent);
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool PeerToPeerCommunicator::testExchange(int handle)
+{
+    if (!isMultiProc()) return true;
+
+    return ProcessManager::testExchange(handle);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PeerToPeerCommunicator::finishExchange(int handle)
+{
+    if (!isMultiProc()) return;
+
+    ProcessManager::finishExchange(handle);
+}
+
+////////////////////////////////////////////////////////////////////
+
+int PeerToPeerCommunicator::startSend(const double* buffer, size_t count, int receiver, int tag)
+{
+    if (!isMultiProc()) throw FATALERROR("Point-to-point communication requires multiple processes");
+
+    return ProcessManager::startSendDoubles(buffer, count, receiver, tag);
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool PeerToPeerCommunicator::receive(std::vector<double>& buffer, int tag, bool wait)
+{
+    if (!isMultiProc()) return false;
+
+    return ProcessManager::receiveDoubles(buffer, tag, wait);
+}
+
+////////////////////////////////////////////////////////////////////
+
 int PeerToPeerCommunicator::root()
 {
     return ROOT;
@@ -109,6 +163,33 @@ bool PeerToPeerCommunicator::isRoot()
 
 ////////////////////////////////////////////////////////////////////
 
+void PeerToPeerCommunicator::createSharedCounter()
+{
+    if (!isMultiProc()) return;
+
+    ProcessManager::createSharedCounter();
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t PeerToPeerCommunicator::fetchAndAddSharedCounter(size_t increment)
+{
+    if (!isMultiProc()) throw FATALERROR("Shared counter is available only for multiple processes");
+
+    return ProcessManager::fetchAndAddSharedCounter(increment);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PeerToPeerCommunicator::freeSharedCounter()
+{
+    if (!isMultiProc()) return;
+
+    ProcessManager::freeSharedCounter();
+}
+
+////////////////////////////////////////////////////////////////////
+
 void PeerToPeerCommunicator::wait(QString scope)
 {
     if (!isMultiProc()) return;
@@ -133,3 +214,31 @@ void PeerToPeerCommunicator::setDataParallel(bool dataParallel)
 }
 
 ////////////////////////////////////////////////////////////////////
+
+bool PeerToPeerCommunicator::dynamicChunks()
+{
+    return _dynamicChunks;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PeerToPeerCommunicator::setDynamicChunks(bool dynamicChunks)
+{
+    _dynamicChunks = dynamicChunks;
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool PeerToPeerCommunicator::distributedCubes()
+{
+    return _distributedCubes;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PeerToPeerCommunicator::setDistributedCubes(bool distributedCubes)
+{
+    _distributedCubes = distributedCubes;
+}
+
+////////////////////////////////////////////////////////////////////
@@ -32,6 +32,14 @@ public:
         _dataParallel member to true if '-d' was specified on the commandline. */
     void setDataParallel(bool dataParallel);
 
+    /** This function should be used just after this object has been set up, to set the
+        _dynamicChunks member to true if '-a' was specified on the commandline. */
+    void setDynamicChunks(bool dynamicChunks);
+
+    /** This function should be used just after this object has been set up, to set the
+        _distributedCubes member to true if '-c' was specified on the commandline. */
+    void setDistributedCubes(bool distributedCubes);
+
     //====================== Other Functions =======================
 
 public:
@@ -77,6 +85,34 @@ public:
                                  size_t recvLength, std::vector<std::vector<int>>& recvDisplacements,
                                  size_t recvExtent);
 
+    /** This function starts the same communication as displacedBlocksAllToAll() without waiting
+        for it to complete, and returns a handle to be passed to testExchange() and
+        finishExchange(). The buffers may not be accessed until the communication has finished. */
+    int startDisplacedBlocksAllToAll(const double* sendBuffer, size_t sendCount,
+                                     size_t sendLength, std::vector<std::vector<int>>& sendDisplacements,
+                                     size_t sendExtent,
+                                     double* recvBuffer, size_t recvCount,
+                                     size_t recvLength, std::vector<std::vector<int>>& recvDisplacements,
+                                     size_t recvExtent);
+
+    /** This function returns true if the communication with the specified handle has completed. */
+    bool testExchange(int handle);
+
+    /** This function waits for the communication with the specified handle to complete. */
+    void finishExchange(int handle);
+
+    /** This function starts sending the specified doubles to the process with the specified rank,
+        and returns a handle to be passed to testExchange() and finishExchange(). The buffer may
+        not be modified until the communication has finished. Only the receiving process needs to
+        participate, by calling receive(). The function may be called from any thread. */
+    int startSend(const double* buffer, size_t count, int receiver, int tag);
+
+    /** This function receives a message with the specified tag sent by any process through
+        startSend(), and stores its contents in the specified vector. If no such message has
+        arrived, the function waits for one if \em wait is true, and returns false otherwise. The
+        function may be called from any thread. */
+    bool receive(std::vector<double>& buffer, int tag, bool wait);
+
     /** This function returns the rank of the root process. */
     int root();
 
@@ -90,8 +126,30 @@ public:
     /** This function indicates whether data parallelization is enabled or not */
     bool dataParallel();
 
+    /** This function indicates whether photon package chunks should be assigned to the processes
+        on demand (see the ChunkDispatcher class) rather than statically. */
+    bool dynamicChunks();
+
+    /** This function indicates whether the instrument data cubes should be distributed across the
+        processes in task parallelization mode (see the ParallelDataCube class). */
+    bool distributedCubes();
+
+    /** This function creates a counter that is shared by all processes in the communicator and
+        initializes it to zero. All processes must call this function. */
+    void createSharedCounter();
+
+    /** This function atomically adds the specified increment to the shared counter, and returns
+        the value of the counter before the addition. It may be called by any process and by any
+        thread, without the participation of the other processes. */
+    size_t fetchAndAddSharedCounter(size_t increment);
+
+    /** This function releases the shared counter. All processes must call this function. */
+    void freeSharedCounter();
+
 private:
     bool _dataParallel;
+    bool _dynamicChunks;
+    bool _distributedCubes;
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -10,7 +10,6 @@
 #include "FilePaths.hpp"
 #include "FITSInOut.hpp"
 #include "Image.hpp"
-#include "LockFree.hpp"
 #include "Log.hpp"
 #include "PhotonPackage.hpp"
 #include "Units.hpp"
@@ -105,6 +104,7 @@ void PerspectiveInstrument::setupSelfBefore()
 
     // the data cube
     _ftotv.initialize(_Nx*_Ny, this);
+    _ftotd = addDetector(_ftotv.partialCube());
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -352,7 +352,7 @@ void PerspectiveInstrument::detect(PhotonPackage* pp)
         // add the adjusted luminosity to the appropriate pixel in the data cube
         int ell = pp->ell();
         int l = i + _Nx*j;
-        LockFree::add(_ftotv(ell,l), L);
+        record(_ftotd, _ftotv, ell, l, L);
     }
 }
 
@@ -223,8 +223,9 @@ private:
     Direction _bfky;        // unit vector along the viewport's y-axis
     HomogeneousTransform _transform;    // transform from world to pixel coordinates
 
-    // data cube
+    // data cube and its detector handle
     ParallelDataCube _ftotv;
+    int _ftotd;
 };
 
 ////////////////////////////////////////////////////////////////////
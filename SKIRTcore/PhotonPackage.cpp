@@ -11,7 +11,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////
 
 PhotonPackage::PhotonPackage()
-    : _L(0), _ell(0), _nscatt(0), _stellar(-1), _ad(0)
+    : _L(0), _ell(0), _nscatt(0), _stellar(-1), _ad(0), _tauinstr(-1)
 {
 }
 
@@ -21,11 +21,12 @@ void PhotonPackage::launch(double L, int ell, Position bfr, Direction bfk)
 {
     _L = L;
     _ell = ell;
-    _bfr = bfr;
+    setPosition(bfr);
     _bfk = bfk;
     _nscatt = 0;
     _stellar = -1;
     _ad = 0;
+    _tauinstr = -1;
     setUnpolarized();
 }
 
@@ -35,11 +36,12 @@ void PhotonPackage::launchEmissionPeelOff(const PhotonPackage* pp, Direction bfk
 {
     _L = pp->_L;
     _ell = pp->_ell;
-    _bfr = pp->_bfr;
+    setPosition(pp->_bfr, pp->initialCell());
     _bfk = bfk;
     _nscatt = 0;
     _stellar = pp->_stellar;
     _ad = 0;
+    _tauinstr = -1;
     setUnpolarized();
 
     // apply emission direction bias if not isotropic
@@ -52,11 +54,12 @@ void PhotonPackage::launchScatteringPeelOff(const PhotonPackage* pp, Direction b
 {
     _L = pp->_L * w;
     _ell = pp->_ell;
-    _bfr = pp->_bfr;
+    setPosition(pp->_bfr, pp->initialCell());
     _bfk = bfk;
     _nscatt = pp->_nscatt + 1;
     _stellar = pp->_stellar;
     _ad = 0;
+    _tauinstr = -1;
     setUnpolarized();
 }
 
@@ -66,11 +69,12 @@ void PhotonPackage::launchScatteringPeelOff(const PhotonPackage* pp, Position bf
 {
     _L = pp->_L * w;
     _ell = pp->_ell;
-    _bfr = bfr;
+    setPosition(bfr);
     _bfk = bfk;
     _nscatt = pp->_nscatt + 1;
     _stellar = pp->_stellar;
     _ad = 0;
+    _tauinstr = -1;
     setUnpolarized();
 }
 
@@ -92,7 +96,8 @@ void PhotonPackage::setAngularDistribution(const AngularDistribution* ad)
 
 void PhotonPackage::propagate(double s)
 {
-    _bfr += s*_bfk;
+    DustGridPath::propagate(s);
+    _tauinstr = -1;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -102,6 +107,7 @@ void PhotonPackage::scatter(Direction bfk)
     _nscatt++;
     _bfk = bfk;
     _ad = 0;
+    _tauinstr = -1;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -112,3 +118,12 @@ void PhotonPackage::setLuminosity(double L)
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void PhotonPackage::setWavelength(int ell, double L)
+{
+    _ell = ell;
+    _L = L;
+    _tauinstr = -1;
+}
+
+////////////////////////////////////////////////////////////////////
@@ -96,7 +96,8 @@ public:
     /** This function causes the propagation of the photon package over a physical distance
         \f$s\f$. It updates the position from \f${\bf{r}}\f$ to \f${\bf{r}}+s\,{\bf{k}}\f$, where
         \f${\bf{k}}\f$ is the propagation direction of the photon package, invalidating the current
-        path. */
+        path. Before invalidating the path, the function uses it to determine the cell containing
+        the new position, so that the next path calculation can start from that cell. */
     void propagate(double s);
 
     /** This function scatters the photon package into the new direction \f${\bf{k}}\f$. It
@@ -108,6 +109,20 @@ public:
     /** This function sets the luminosity of the photon package to a new value. */
     void setLuminosity(double L);
 
+    /** This function sets the wavelength index and the luminosity of the photon package to new
+        values, leaving all other properties unchanged. In particular, the current path remains
+        valid, but the stored optical depth information (which depends on the wavelength) should no
+        longer be used. This function is intended for photon packages that carry a bundle of
+        wavelengths (see WavelengthBundle), which are relabeled to each of the wavelengths in the
+        bundle in turn when they are peeled off towards the instruments. */
+    void setWavelength(int ell, double L);
+
+    /** This function stores the optical depth along the complete path of the photon package, so
+        that it can be retrieved through instrumentOpticalDepth() by multiple instruments detecting
+        the same peel off photon package. The stored value is discarded by any function that
+        invalidates the current path. */
+    void setInstrumentOpticalDepth(double tau) { _tauinstr = tau; }
+
     // ------- Getting trivial properties -------
 
     /** This function returns true if the photon package has a stellar origin, false otherwise. */
@@ -124,10 +139,19 @@ public:
     /** This function returns the wavelength index of the photon package. */
     int ell() const { return _ell; }
 
+    /** This function returns the angular distribution of the emission at the photon package's
+        origin, or null if the emission is isotropic or the photon package has been scattered. */
+    const AngularDistribution* angularDistribution() const { return _ad; }
+
     /** This function returns the number of scattering events the photon package has experienced.
         */
     int nScatt() const { return _nscatt; }
 
+    /** This function returns the optical depth along the complete path of the photon package as
+        stored by setInstrumentOpticalDepth(), or a negative value if no optical depth has been
+        stored since the path was last invalidated. */
+    double instrumentOpticalDepth() const { return _tauinstr; }
+
     // ------- Data members -------
 
 private:
@@ -136,6 +160,7 @@ private:
     int _nscatt;
     int _stellar;
     const AngularDistribution* _ad;
+    double _tauinstr;
 };
 
 ////////////////////////////////////////////////////////////////////
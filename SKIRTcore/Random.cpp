@@ -3,6 +3,7 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <atomic>
 #include <cmath>
 #include "Box.hpp"
 #include "FatalError.hpp"
@@ -17,8 +18,16 @@ using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the source of unique Random instance identifiers; zero is reserved for "not bound"
+    atomic<uint64_t> _lastRandomId(0);
+}
+
+//////////////////////////////////////////////////////////////////////
+
 Random::Random()
-    : _seed(4357), _parfac(0)
+    : _id(++_lastRandomId), _seed(4357), _reproducible(false), _streamSeed(0), _parfac(0)
 {
 }
 
@@ -29,28 +38,28 @@ void Random::setupSelfBefore()
     SimulationItem::setupSelfBefore();
 
     _parfac = find<ParallelFactory>();
-    int Nthreads = _parfac->maxThreadCount();
-    _mtv.resize(Nthreads);
-    _mtiv.resize(Nthreads);
-
-    initialize(Nthreads);
+    _streamSeed = _seed;
+    initialize(_parfac->maxThreadCount());
 }
 
 //////////////////////////////////////////////////////////////////////
 
 void Random::initialize(int Nthreads)
 {
+    // create additional generators if needed, but never replace existing ones,
+    // because their addresses may have been cached by the threads
+    while (static_cast<int>(_generators.size()) < Nthreads) _generators.emplace_back(new Generator);
+
     unsigned long seed = _seed;
     for (int thread=0; thread<Nthreads; thread++)
     {
         find<Log>()->info("Initializing random number generator for thread number "
                           + QString::number(thread) + " with seed " + QString::number(seed) + "... ");
-        vector<unsigned long>& mt = _mtv[thread];
-        int& mti = _mtiv[thread];
-        mt.resize(624);
-        mt[0] = seed & 0xffffffff;
-        for (mti=1; mti<624; mti++)
-            mt[mti] = (69069 * mt[mti-1]) & 0xffffffff;
+        Generator& g = *_generators[thread];
+        g.stream = false;
+        g.mt[0] = seed & 0xffffffff;
+        for (g.mti=1; g.mti<624; g.mti++)
+            g.mt[g.mti] = (69069 * g.mt[g.mti-1]) & 0xffffffff;
         ++seed;
     }
 }
@@ -71,14 +80,27 @@ int Random::seed() const
 
 //////////////////////////////////////////////////////////////////////
 
+void Random::setReproducible(bool value)
+{
+    _reproducible = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool Random::reproducible() const
+{
+    return _reproducible;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void Random::randomize()
 {
     find<Log>()->info("Setting different seeds for each process.");
     PeerToPeerCommunicator* comm = find<PeerToPeerCommunicator>();
 
+    // the number of threads can be different during and after the setup of the simulation
     int Nthreads = _parfac->maxThreadCount();
-    _mtv.resize(Nthreads);      // Because the number of threads can be different during and after the setup
-    _mtiv.resize(Nthreads);     // of the simulation.
 
     _seed = _seed + Nthreads * comm->rank();
 
@@ -87,40 +109,77 @@ void Random::randomize()
 
 //////////////////////////////////////////////////////////////////////
 
+void Random::setStream(uint32_t family, uint32_t stream, uint64_t index)
+{
+    if (_reproducible)
+    {
+        Generator& g = generator();
+        g.stream = true;
+        g.key[0] = _streamSeed;
+        g.key[1] = family;
+        g.ctr[0] = 0;
+        g.ctr[1] = static_cast<uint32_t>(index);
+        g.ctr[2] = static_cast<uint32_t>(index >> 32);
+        g.ctr[3] = stream;
+        g.bufi = 4;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Random::endStream()
+{
+    if (_reproducible) generator().stream = false;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+Random::Generator&
+Random::generator()
+{
+    // the generator cached for the current thread, and the Random instance to which it belongs
+    struct Binding
+    {
+        uint64_t randomId;
+        Generator* generator;
+    };
+    static thread_local Binding binding = { 0, nullptr };
+
+    if (binding.randomId != _id)
+    {
+        binding.generator = _generators[_parfac->currentThreadIndex()].get();
+        binding.randomId = _id;
+    }
+    return *binding.generator;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double
 Random::uniform()
 {
-    int thread = _parfac->currentThreadIndex();
-    vector<unsigned long>& mt = _mtv[thread];
-    int& mti = _mtiv[thread];
+    return uniform(generator());
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void
+Random::uniform(Array& Xv)
+{
+    Generator& g = generator();
+    for (double& X : Xv) X = uniform(g);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double
+Random::uniform(Generator& g)
+{
     double ans = 0.0;
     do
     {
-        unsigned long y;
-        static unsigned long mag01[2]={0x0,0x9908b0df};
-        if (mti >= 624)
-        {
-            int kk;
-            for (kk=0;kk<227;kk++)
-            {
-                y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
-                mt[kk] = mt[kk+397] ^ (y >> 1) ^ mag01[y & 0x1];
-            }
-            for (;kk<624-1;kk++)
-            {
-                y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
-                mt[kk] = mt[kk-227] ^ (y >> 1) ^ mag01[y & 0x1];
-            }
-            y = (mt[623]&0x80000000)|(mt[0]&0x7fffffff);
-            mt[623] = mt[396] ^ (y >> 1) ^ mag01[y & 0x1];
-            mti = 0;
-        }
-        y = mt[mti++];
-        y ^= (y>>11);
-        y ^= (y<<7) & 0x9d2c5680;
-        y ^= (y<<15) & 0xefc60000;
-        y ^= (y>>18);
-        ans = static_cast<double>(y) / static_cast<unsigned long>(0xffffffff);
+        uint32_t y = g.stream ? philox(g) : twister(g);
+        ans = static_cast<double>(y) / static_cast<uint32_t>(0xffffffff);
     }
     while (ans<=0.0 || ans>=1.0);
     return ans;
@@ -128,6 +187,73 @@ Random::uniform()
 
 //////////////////////////////////////////////////////////////////////
 
+uint32_t
+Random::twister(Generator& g)
+{
+    uint32_t* mt = g.mt;
+    int& mti = g.mti;
+    uint32_t y;
+    static const uint32_t mag01[2]={0x0,0x9908b0df};
+    if (mti >= 624)
+    {
+        int kk;
+        for (kk=0;kk<227;kk++)
+        {
+            y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
+            mt[kk] = mt[kk+397] ^ (y >> 1) ^ mag01[y & 0x1];
+        }
+        for (;kk<624-1;kk++)
+        {
+            y = (mt[kk]&0x80000000)|(mt[kk+1]&0x7fffffff);
+            mt[kk] = mt[kk-227] ^ (y >> 1) ^ mag01[y & 0x1];
+        }
+        y = (mt[623]&0x80000000)|(mt[0]&0x7fffffff);
+        mt[623] = mt[396] ^ (y >> 1) ^ mag01[y & 0x1];
+        mti = 0;
+    }
+    y = mt[mti++];
+    y ^= (y>>11);
+    y ^= (y<<7) & 0x9d2c5680;
+    y ^= (y<<15) & 0xefc60000;
+    y ^= (y>>18);
+    return y;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+uint32_t
+Random::philox(Generator& g)
+{
+    if (g.bufi >= 4)
+    {
+        // perform the ten rounds of the Philox4x32 bijection on a copy of the counter and key
+        uint32_t c0 = g.ctr[0], c1 = g.ctr[1], c2 = g.ctr[2], c3 = g.ctr[3];
+        uint32_t k0 = g.key[0], k1 = g.key[1];
+        for (int round=0; round<10; round++)
+        {
+            uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * c0;
+            uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * c2;
+            c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            c1 = static_cast<uint32_t>(p1);
+            c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c3 = static_cast<uint32_t>(p0);
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        g.buf[0] = c0;
+        g.buf[1] = c1;
+        g.buf[2] = c2;
+        g.buf[3] = c3;
+        g.bufi = 0;
+
+        // advance the block counter (the other counter words identify the stream)
+        g.ctr[0]++;
+    }
+    return g.buf[g.bufi++];
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double
 Random::cdf(const Array& xv, const Array& Xv)
 {
@@ -186,6 +312,19 @@ Direction Random::direction()
 
 //////////////////////////////////////////////////////////////////////
 
+void Random::direction(vector<Direction>& kv)
+{
+    Generator& g = generator();
+    for (Direction& k : kv)
+    {
+        double theta = acos(2.0*uniform(g)-1.0);
+        double phi = 2.0*M_PI*uniform(g);
+        k = Direction(theta,phi);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
 Direction Random::direction(Direction bfk, double costheta)
 {
     // generate random phi and get the sine and cosine for both angles
@@ -235,3 +374,17 @@ Position Random::position(const Box& box)
 }
 
 //////////////////////////////////////////////////////////////////////
+
+void Random::position(const Box& box, vector<Position>& rv)
+{
+    Generator& g = generator();
+    for (Position& r : rv)
+    {
+        double x = uniform(g);
+        double y = uniform(g);
+        double z = uniform(g);
+        r = Position(box.fracpos(x,y,z));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -6,6 +6,8 @@
 #ifndef RANDOM_HPP
 #define RANDOM_HPP
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include "Array.hpp"
 #include "SimulationItem.hpp"
@@ -20,7 +22,25 @@ class Position;
     numbers for different probability distributions. Typically, only a single instance of the class
     should be constructed for each simulation. This random number class is adapted from a C library
     known as genrand(), written by Takuji Nishimura. More information can be found at
-    http://www.math.keio.ac.jp/matumoto/emt.html. */
+    http://www.math.keio.ac.jp/matumoto/emt.html.
+
+    The class maintains a separate generator state for each parallel thread. Each state is
+    allocated separately and padded on both sides so that it occupies its own cache lines, avoiding
+    false sharing between threads. A pointer to the state for the calling thread is cached in a
+    thread-local variable, so that generating a random number does not involve a thread index
+    lookup. For loops that consume many random numbers at once, the class offers batched versions
+    of some functions that look up the generator state only once for the complete batch.
+
+    Because the loop indices are handed out to the parallel threads dynamically, the sequence of
+    random numbers used for a particular photon package depends on the scheduling of the threads,
+    and thus on the number of threads and processes. To allow reproducing the results of a
+    simulation with a different parallelization, the class optionally offers a second, counter-based
+    generator (Philox4x32-10, Salmon et al. 2011, SC'11). When this option is enabled, the
+    simulation calls setStream() before launching each photon package, specifying a key that
+    identifies the photon package independently of the thread and process performing the work. The
+    random numbers drawn by that thread until the next call to setStream() or endStream() are then
+    a pure function of the seed and the stream key. Random numbers drawn outside of such a stream
+    (e.g. during setup) are produced by the Mersenne Twister generators as usual. */
 class Random : public SimulationItem
 {
     Q_OBJECT
@@ -31,6 +51,11 @@ class Random : public SimulationItem
     Q_CLASSINFO("MinValue", "1")
     Q_CLASSINFO("Default", "4357")
 
+    Q_CLASSINFO("Property", "reproducible")
+    Q_CLASSINFO("Title", "use counter-based random streams for photon packages")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -62,6 +87,15 @@ public:
     /** This function returns the current value of the seed. */
     Q_INVOKABLE int seed() const;
 
+    /** This function sets the flag indicating whether the counter-based generator is used for the
+        random streams requested through setStream(). If the flag is false (the default), the
+        setStream() and endStream() functions have no effect. */
+    Q_INVOKABLE void setReproducible(bool value);
+
+    /** This function returns the flag indicating whether the counter-based generator is used for
+        the random streams requested through setStream(). */
+    Q_INVOKABLE bool reproducible() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -73,11 +107,32 @@ public:
         \image html randomize.png "The randomize function makes sure that each process ‘reserves’ a unique set of random seeds for its own threads." */
     void randomize();
 
+    /** If the reproducible flag is enabled, this function causes the calling thread to draw
+        subsequent random numbers from the counter-based stream identified by the specified family,
+        stream and index numbers, positioned at the start of the stream. Together with the seed
+        specified at setup time (i.e. before any call to randomize()), these three numbers form the
+        key and counter of the Philox generator, so that each distinct combination yields an
+        independent stream. The simulation uses the family to distinguish its photon shooting
+        phases, the stream for the wavelength index, and the index for the photon package number
+        within that wavelength. If the reproducible flag is disabled, this function does nothing. */
+    void setStream(uint32_t family, uint32_t stream, uint64_t index);
+
+    /** If the reproducible flag is enabled, this function causes the calling thread to revert to
+        its regular Mersenne Twister generator for subsequent random numbers. If the reproducible
+        flag is disabled, this function does nothing. */
+    void endStream();
+
     /** This function generates a random uniform deviate, i.e. a random double precision number in
         the interval [0,1]. For details how this is exactly done, see the information at
         http://www.math.keio.ac.jp/matumoto/emt.html. */
     double uniform();
 
+    /** This function fills the specified array with random uniform deviates, i.e. random double
+        precision numbers in the interval [0,1]. The result is identical to calling the uniform()
+        function for each array element in order, but the generator state is looked up only once.
+        */
+    void uniform(Array& Xv);
+
     /** This function generates a random number drawn from an arbitrary probability distribution
         \f$p(x)\,{\text{d}}x\f$ with corresponding cumulative distribution function \f$P(x)\f$.
         The routine reads in a discretized version \f$P_i\f$ of the cdf sampled at a set of
@@ -115,6 +170,11 @@ public:
         constructed by calling the constructor Direction::Direction(double theta, double phi). */
     Direction direction();
 
+    /** This function fills the specified vector with random directions on the unit sphere, as
+        generated by the direction() function. The size of the vector determines the number of
+        directions being generated. */
+    void direction(std::vector<Direction>& kv);
+
     /** This function generates a new direction on the unit sphere deviating from a given original
         direction \f$\bf{k}\f$ by a given polar angle \f$\theta\f$ (specified through its cosine)
         and a uniformly random azimuth angle \f$\phi\f$. The function can use an arbitrary
@@ -127,17 +187,65 @@ public:
         cuboid lined up with the coordinate axes). */
     Position position(const Box& box);
 
+    /** This function fills the specified vector with uniformly distributed random positions in a
+        given box, as generated by the position() function. The size of the vector determines the
+        number of positions being generated. */
+    void position(const Box& box, std::vector<Position>& rv);
+
+    //======================== Private Functions =======================
+
+private:
+    /** The state of a single Mersenne Twister generator, padded on both sides so that the state
+        of one thread never shares a cache line with data used by another thread. */
+    struct Generator
+    {
+        char before[64];
+        bool stream;        // true if the numbers are drawn from the counter-based stream
+        int bufi;           // the index of the next unused word in the Philox output buffer
+        uint32_t key[2];    // the Philox key
+        uint32_t ctr[4];    // the Philox counter for the next block
+        uint32_t buf[4];    // the Philox output buffer
+        int mti;
+        uint32_t mt[624];
+        char after[64];
+    };
+
+    /** This function returns a reference to the generator state for the calling thread. The
+        pointer to the state is cached in a thread-local variable together with the identifier of
+        this Random instance, so that the thread index is looked up only for the first call from a
+        given thread. */
+    Generator& generator();
+
+    /** This function generates a random uniform deviate using the specified generator state. */
+    static double uniform(Generator& g);
+
+    /** This function returns the next 32-bit word from the Mersenne Twister generator in the
+        specified generator state. */
+    static uint32_t twister(Generator& g);
+
+    /** This function returns the next 32-bit word from the counter-based Philox stream in the
+        specified generator state, generating a new block of four words when needed. */
+    static uint32_t philox(Generator& g);
+
     //======================== Data Members ========================
 
 private:
     // the state of the random generators; one for each concurrent thread in the simulation
-    // (maintaining a separate generator per thread avoids time-consuming data locking)
-    std::vector< std::vector<unsigned long> > _mtv;
-    std::vector<int> _mtiv;
+    // (maintaining a separate generator per thread avoids time-consuming data locking; the
+    // generators are never moved after construction so that threads can cache a pointer)
+    std::vector<std::unique_ptr<Generator>> _generators;
+
+    // a unique identifier for this instance, used to validate the thread-local generator pointers
+    uint64_t _id;
 
     // the seed used to initialize the random generators (the value is incremented between generators)
     int _seed;
 
+    // the counter-based generator flag, and the seed used as part of the Philox key
+    // (copied from _seed during setup so that it is unaffected by randomize())
+    bool _reproducible;
+    uint32_t _streamSeed;
+
     // a cached pointer to the ParallelFactory instance associated with this simulation hierarchy
     ParallelFactory* _parfac;
 };
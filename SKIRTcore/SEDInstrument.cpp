@@ -4,7 +4,6 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "FatalError.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "SEDInstrument.hpp"
 #include "WavelengthGrid.hpp"
@@ -25,6 +24,8 @@ void SEDInstrument::setupSelfBefore()
 
     int Nlambda = find<WavelengthGrid>()->Nlambda();
     _Ftotv.resize(Nlambda);
+
+    _Ftotd = addDetector(_Ftotv);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -38,7 +39,7 @@ SEDInstrument::detect(PhotonPackage* pp)
     double extf = exp(-taupath);
     double Lextf = L*extf;
 
-    LockFree::add(_Ftotv[ell], Lextf);
+    record(_Ftotd, _Ftotv[ell], Lextf);
 }
 
 ////////////////////////////////////////////////////////////////////
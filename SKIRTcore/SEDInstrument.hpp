@@ -43,6 +43,7 @@ protected:
 
 private:
     Array _Ftotv;
+    int _Ftotd;     // detector handle
 };
 
 ////////////////////////////////////////////////////////////////////
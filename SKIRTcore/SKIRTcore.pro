@@ -41,6 +41,7 @@ HEADERS += \
     AdaptiveMesh.hpp \
     AdaptiveMeshAmrvacFile.hpp \
     AdaptiveMeshAsciiFile.hpp \
+    AdaptiveMeshBinaryFile.hpp \
     AdaptiveMeshDustDistribution.hpp \
     AdaptiveMeshDustGrid.hpp \
     AdaptiveMeshFile.hpp \
@@ -58,12 +59,14 @@ HEADERS += \
     Benchmark2DDustMix.hpp \
     BinTreeDustGrid.hpp \
     BinTreeNode.hpp \
+    BinaryInFile.hpp \
     BlackBodySED.hpp \
     BolLuminosityStellarCompNormalization.hpp \
     BoxDustGrid.hpp \
     CartesianDustGrid.hpp \
     BruzualCharlotSED.hpp \
     BruzualCharlotSEDFamily.hpp \
+    ChunkDispatcher.hpp \
     ClumpyGeometryDecorator.hpp \
     CombineGeometryDecorator.hpp \
     CompDustDistribution.hpp \
@@ -74,6 +77,7 @@ HEADERS += \
     CubicSplineSmoothingKernel.hpp \
     Cylinder2DDustGrid.hpp \
     CylinderDustGrid.hpp \
+    DataCubeExchange.hpp \
     Dim1DustLib.hpp \
     Dim2DustLib.hpp \
     Direction.hpp \
@@ -89,9 +93,11 @@ HEADERS += \
     DustEmGrainComposition.hpp \
     DustEmissivity.hpp \
     DustGrid.hpp \
+    DustGridCache.hpp \
     DustGridDensityInterface.hpp \
     DustGridPath.hpp \
     DustGridPlotFile.hpp \
+    DustGridStructureInterface.hpp \
     DustLib.hpp \
     DustMassDustCompNormalization.hpp \
     DustMassInBoxInterface.hpp \
@@ -147,6 +153,7 @@ HEADERS += \
     KuruczSED.hpp \
     LaserGeometry.hpp \
     LinMesh.hpp \
+    LinearTree.hpp \
     Log.hpp \
     LogNormalGrainSizeDistribution.hpp \
     LogWavelengthGrid.hpp \
@@ -283,9 +290,11 @@ HEADERS += \
     VoronoiGeometry.hpp \
     VoronoiMesh.hpp \
     VoronoiMeshAsciiFile.hpp \
+    VoronoiMeshBinaryFile.hpp \
     VoronoiMeshFile.hpp \
     VoronoiMeshInterface.hpp \
     VoronoiStellarComp.hpp \
+    WavelengthBundle.hpp \
     WavelengthGrid.hpp \
     WeingartnerDraineDustMix.hpp \
     XDustCompNormalization.hpp \
@@ -318,6 +327,7 @@ SOURCES += \
     AdaptiveMesh.cpp \
     AdaptiveMeshAmrvacFile.cpp \
     AdaptiveMeshAsciiFile.cpp \
+    AdaptiveMeshBinaryFile.cpp \
     AdaptiveMeshDustDistribution.cpp \
     AdaptiveMeshDustGrid.cpp \
     AdaptiveMeshFile.cpp \
@@ -333,12 +343,14 @@ SOURCES += \
     Benchmark2DDustMix.cpp \
     BinTreeDustGrid.cpp \
     BinTreeNode.cpp \
+    BinaryInFile.cpp \
     BlackBodySED.cpp \
     BolLuminosityStellarCompNormalization.cpp \
     BoxDustGrid.cpp \
     BruzualCharlotSED.cpp \
     BruzualCharlotSEDFamily.cpp \
     CartesianDustGrid.cpp \
+    ChunkDispatcher.cpp \
     ClumpyGeometryDecorator.cpp \
     CombineGeometryDecorator.cpp \
     CompDustDistribution.cpp \
@@ -349,6 +361,7 @@ SOURCES += \
     CubicSplineSmoothingKernel.cpp \
     Cylinder2DDustGrid.cpp \
     CylinderDustGrid.cpp \
+    DataCubeExchange.cpp \
     Dim1DustLib.cpp \
     Dim2DustLib.cpp \
     Direction.cpp \
@@ -364,6 +377,7 @@ SOURCES += \
     DustEmGrainComposition.cpp \
     DustEmissivity.cpp \
     DustGrid.cpp \
+    DustGridCache.cpp \
     DustGridPath.cpp \
     DustGridPlotFile.cpp \
     DustLib.cpp \
@@ -417,6 +431,7 @@ SOURCES += \
     KuruczSED.cpp \
     LaserGeometry.cpp \
     LinMesh.cpp \
+    LinearTree.cpp \
     Log.cpp \
     LogNormalGrainSizeDistribution.cpp \
     LogWavelengthGrid.cpp \
@@ -552,8 +567,10 @@ SOURCES += \
     VoronoiGeometry.cpp \
     VoronoiMesh.cpp \
     VoronoiMeshAsciiFile.cpp \
+    VoronoiMeshBinaryFile.cpp \
     VoronoiMeshFile.cpp \
     VoronoiStellarComp.cpp \
+    WavelengthBundle.cpp \
     WavelengthGrid.cpp \
     WeingartnerDraineDustMix.cpp \
     XDustCompNormalization.cpp \
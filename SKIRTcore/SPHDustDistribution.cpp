@@ -4,6 +4,7 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include <cmath>
+#include "BinaryInFile.hpp"
 #include "DustMix.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
@@ -46,12 +47,10 @@ void SPHDustDistribution::setupSelfBefore()
     const double Msun = Units::Msun();
 
     // load the SPH gas particles
-    TextInFile infile(this, _filename, "SPH gas particles");
     int Nignored = 0;
     double Mtot = 0;
     double Mmetal = 0;
-    double x, y, z, h, M, Z, T;
-    while (infile.readRow(1, x, y, z, h, M, Z, T))
+    auto addParticle = [&] (double x, double y, double z, double h, double M, double Z, double T)
     {
         // ignore particle if the temperature is higher than the maximum (assuming both T and Tmax are valid)
         if (T > 0 && _Tmax > 0 && T > _Tmax)
@@ -68,6 +67,27 @@ void SPHDustDistribution::setupSelfBefore()
             // remember whether there are any negative masses
             if (M<0) _negativeMasses = true;
         }
+    };
+    if (BinaryInFile::isBinary(this, _filename))
+    {
+        // construct the particles directly from the memory-mapped columns, converting to the default units
+        BinaryInFile infile(this, _filename, "SPH gas particles");
+        infile.requireColumns(7, 1);
+        double fr = infile.factor(0, "length", "pc");
+        double fh = infile.factor(3, "length", "pc");
+        double fM = infile.factor(4, "mass", "Msun");
+        double fT = infile.factor(6, "temperature", "K");
+        size_t Np = infile.rows();
+        _pv.reserve(Np);
+        for (size_t i=0; i<Np; i++)
+            addParticle(fr*infile.value(i,0), fr*infile.value(i,1), fr*infile.value(i,2), fh*infile.value(i,3),
+                        fM*infile.value(i,4), infile.value(i,5), fT*infile.value(i,6));
+    }
+    else
+    {
+        TextInFile infile(this, _filename, "SPH gas particles");
+        double x, y, z, h, M, Z, T;
+        while (infile.readRow(1, x, y, z, h, M, Z, T)) addParticle(x, y, z, h, M, Z, T);
     }
 
     // if the total cold and/or metallic gas mass is negative, suppress the complete dust distribution
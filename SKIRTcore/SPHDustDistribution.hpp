@@ -70,7 +70,11 @@ public:
         particle (in \f$M_\odot\f$), and the sixth column is the metallicity \f$Z\f$ of the gas
         (dimensionless fraction). The optional seventh column is the temperature of the gas (in K).
         If this value is provided and it is higher than the maximum temperature the particle is
-        ignored. If the temperature value is missing, the particle is never ignored. */
+        ignored. If the temperature value is missing, the particle is never ignored. Alternatively,
+        the file can be in the binary column format described for the BinaryInFile class, with the
+        same columns in the same order. In that case, the units specified in the file header for
+        the coordinates, smoothing length, mass and temperature override the default units listed
+        above. */
     Q_INVOKABLE void setFilename(QString value);
 
     /** Returns the name of the file containing the information on the SPH gas particles. */
@@ -4,6 +4,7 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "AngularDistribution.hpp"
+#include "BinaryInFile.hpp"
 #include "BruzualCharlotSEDFamily.hpp"
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
@@ -144,7 +145,24 @@ void SPHStellarComp::setupSelfAfter()
     int Nbase = _velocity ? 7 : 4;
     int Nsed = _sedFamily->nparams();
     QString description = "SPH " + _sedFamily->sourceDescription() + " particles";
-    const vector<Array>& particles = TextInFile(this, _filename, description).readAllRows(Nbase+Nsed);
+    vector<Array> particles;
+    if (BinaryInFile::isBinary(this, _filename))
+    {
+        // copy the rows from the memory-mapped columns, converting positions, sizes and velocities to the default units
+        BinaryInFile infile(this, _filename, description);
+        infile.requireColumns(Nbase+Nsed);
+        Array factors(Nbase+Nsed);
+        factors = 1.;
+        for (int k=0; k!=4; ++k) factors[k] = infile.factor(k, "length", "pc");
+        for (int k=4; k!=Nbase; ++k) factors[k] = infile.factor(k, "velocity", "km/s");
+        particles.resize(infile.rows());
+        for (size_t i=0; i!=particles.size(); ++i)
+        {
+            particles[i].resize(Nbase+Nsed);
+            for (int k=0; k!=Nbase+Nsed; ++k) particles[i][k] = factors[k] * infile.value(i,k);
+        }
+    }
+    else particles = TextInFile(this, _filename, description).readAllRows(Nbase+Nsed);
 
     find<Log>()->info("Processing the particle properties... ");
 
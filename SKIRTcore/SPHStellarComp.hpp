@@ -88,7 +88,13 @@ public:
         assumed to be constant over the past 10 Myr (in \f$M_\odot\,{\text{yr}}^{-1}\f$),
         metallicity \f$Z\f$ (as a dimensionless fraction), the logarithm of the compactness \f$\log
         C\f$ (as a dimensionless fraction), the ISM pressure \f$p\f$ (in Pa), and the dimensionless
-        PDR covering factor \f$f_{\text{PDR}}\f$. */
+        PDR covering factor \f$f_{\text{PDR}}\f$.
+
+        Alternatively, the file can be in the binary column format described for the BinaryInFile
+        class, with the same columns in the same order. In that case, the units specified in the
+        file header for the coordinates, smoothing length and velocity components override the
+        default units listed above. The %SED family properties must always be given in the units
+        listed above. */
     Q_INVOKABLE void setFilename(QString value);
 
     /** Returns the name of the file containing the information on the SPH source particles. */
@@ -4,7 +4,6 @@
 ///////////////////////////////////////////////////////////////// */
 
 #include "FatalError.hpp"
-#include "LockFree.hpp"
 #include "PhotonPackage.hpp"
 #include "SimpleInstrument.hpp"
 #include "WavelengthGrid.hpp"
@@ -28,6 +27,9 @@ void SimpleInstrument::setupSelfBefore()
 
     _Ftotv.resize(Nlambda);
     _ftotv.initialize(_Nframep, this);
+
+    _Ftotd = addDetector(_Ftotv);
+    _ftotd = addDetector(_ftotv.partialCube());
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -41,10 +43,10 @@ void SimpleInstrument::detect(PhotonPackage* pp)
     double extf = exp(-taupath);
     double Lextf = L*extf;
 
-    LockFree::add(_Ftotv[ell], Lextf);
+    record(_Ftotd, _Ftotv[ell], Lextf);
     if (l>=0)
     {
-        LockFree::add(_ftotv(ell,l), Lextf);
+        record(_ftotd, _ftotv, ell, l, Lextf);
     }
 }
 
@@ -65,6 +65,7 @@ protected:
 private:
     Array _Ftotv;
     ParallelDataCube _ftotv;
+    int _Ftotd, _ftotd;     // detector handles
 };
 
 ////////////////////////////////////////////////////////////////////
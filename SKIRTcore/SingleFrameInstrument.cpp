@@ -6,7 +6,10 @@
 #include "FatalError.hpp"
 #include "FilePaths.hpp"
 #include "Image.hpp"
+#include "InstrumentSystem.hpp"
 #include "Log.hpp"
+#include "Parallel.hpp"
+#include "ParallelFactory.hpp"
 #include "PhotonPackage.hpp"
 #include "SingleFrameInstrument.hpp"
 #include "Units.hpp"
@@ -150,79 +153,95 @@ int SingleFrameInstrument::pixelondetector(const PhotonPackage* pp) const
 
 void SingleFrameInstrument::calibrateAndWriteDataCubes(QList< Array*> farrays, QStringList fnames)
 {
-    WavelengthGrid* lambdagrid = find<WavelengthGrid>();
-    int Nlambda = lambdagrid->Nlambda();
+    QList< QList<Array*> > fsums;
+    foreach (Array* farr, farrays) fsums << (QList<Array*>() << farr);
+    calibrateAndWriteDataCubes(fsums, fnames);
+}
 
-    // calibration step 1: conversion from bolometric luminosities (units W) to monochromatic luminosities (units W/m)
+////////////////////////////////////////////////////////////////////
 
-    for (int ell=0; ell<Nlambda; ell++)
+namespace
+{
+    // writes each of a list of data cubes to a FITS file, calibrating one frame at a time
+    class DataCubeWriter : public ParallelTarget
     {
-        double dlambda = lambdagrid->dlambda(ell);
-        for (int i=0; i<_Nxp; i++)
+    public:
+        DataCubeWriter(SingleFrameInstrument* instrument, const QList< QList<Array*> >& fsums,
+                       const QStringList& fnames, Image& image, size_t Nframep, double factor, bool compress)
+            : _instrument(instrument), _fsums(fsums), _fnames(fnames), _image(image), _Nframep(Nframep),
+              _factor(factor), _compress(compress),
+              _lambdagrid(instrument->find<WavelengthGrid>()), _units(instrument->find<Units>()) { }
+
+        void body(size_t index)
         {
-            for (int j=0; j<_Nyp; j++)
+            const QList<Array*>& fsum = _fsums[index];
+            auto frame = [this, &fsum] (int ell, Array& values)
             {
-                size_t m = i + _Nxp*j + _Nframep*ell;
-                foreach (Array* farr, farrays)
+                // calibration step 1: conversion from bolometric luminosities (units W) to monochromatic
+                // luminosities (units W/m), correction for the area of the pixels of the images (units W/m/sr),
+                // and conversion to flux density units (W/m3/sr) by taking into account the distance
+                double factor = _factor / _lambdagrid->dlambda(ell);
+
+                // calibration step 2: conversion from program SI units (at this moment W/m3/sr) to the correct
+                // output units; we use lambda*flambda for the surface brightness (in units like W/m2/arcsec2)
+                double lambda = _lambdagrid->lambda(ell);
+                size_t offset = ell*_Nframep;
+                for (size_t l=0; l<_Nframep; l++)
                 {
-                    if (farr->size()) (*farr)[m] /= dlambda;
+                    double f = 0.;
+                    foreach (Array* farr, fsum) if (farr->size()) f += (*farr)[offset+l];
+                    values[l] = _units->osurfacebrightness(lambda, f*factor);
                 }
-            }
+            };
+            _image.saveto(_instrument, frame, _instrument->instrumentName() + "_" + _fnames[index],
+                          _fnames[index] + " flux", _compress);
         }
-    }
 
-    // calibration step 2: correction for the area of the pixels of the images; the units are now W/m/sr
-
-    double xpsizang = 2.0*atan(_xpsiz/(2.0*_distance));
-    double ypsizang = 2.0*atan(_ypsiz/(2.0*_distance));
-    double area = xpsizang*ypsizang;
-    foreach (Array* farr, farrays)
-    {
-        (*farr) /= area;
-    }
-
-    // calibration step 3: conversion of the flux per pixel from monochromatic luminosity units (W/m/sr)
-    // to flux density units (W/m3/sr) by taking into account the distance
-
-    double fourpid2 = 4.0*M_PI*_distance*_distance;
-    foreach (Array* farr, farrays)
-    {
-        (*farr) /= fourpid2;
-    }
+    private:
+        SingleFrameInstrument* _instrument;
+        const QList< QList<Array*> >& _fsums;
+        const QStringList& _fnames;
+        Image& _image;
+        size_t _Nframep;
+        double _factor;
+        bool _compress;
+        WavelengthGrid* _lambdagrid;
+        Units* _units;
+    };
+}
 
-    // conversion from program SI units (at this moment W/m3/sr) to the correct output units;
-    // we use lambda*flambda for the surface brightness (in units like W/m2/arcsec2)
+////////////////////////////////////////////////////////////////////
 
-    Units* units = find<Units>();
-    for (int ell=0; ell<Nlambda; ell++)
+void SingleFrameInstrument::calibrateAndWriteDataCubes(QList< QList<Array*> > fsums, QStringList fnames)
+{
+    // skip the data cubes that have no data (e.g. on processes other than the root)
+    QList< QList<Array*> > nonempty;
+    QStringList names;
+    for (int q = 0; q < fsums.size(); q++)
     {
-        double lambda = lambdagrid->lambda(ell);
-        for (int i=0; i<_Nxp; i++)
+        bool hasData = false;
+        foreach (Array* farr, fsums[q]) if (farr->size()) hasData = true;
+        if (hasData)
         {
-            for (int j=0; j<_Nyp; j++)
-            {
-                size_t m = i + _Nxp*j + _Nframep*ell;
-                foreach (Array* farr, farrays)
-                {
-                    if (farr->size()) (*farr)[m] = units->osurfacebrightness(lambda, (*farr)[m]);
-                }
-            }
+            nonempty << fsums[q];
+            names << fnames[q];
         }
     }
+    if (nonempty.isEmpty()) return;
 
-    // Write a FITS file for each array
-    for (int q = 0; q < farrays.size(); q++)
-    {
-        if (farrays[q]->size())
-        {
-            QString filename = _instrumentname + "_" + fnames[q];
-            QString description = fnames[q] + " flux";
-
-            // Create an image and save it
-            Image image(this, _Nxp, _Nyp, Nlambda, _xpsiz, _ypsiz, _xpc, _ypc, "surfacebrightness");
-            image.saveto(this, *(farrays[q]), filename, description);
-        }
-    }
+    // the calibration factor that does not depend on wavelength
+    double xpsizang = 2.0*atan(_xpsiz/(2.0*_distance));
+    double ypsizang = 2.0*atan(_ypsiz/(2.0*_distance));
+    double area = xpsizang*ypsizang;
+    double fourpid2 = 4.0*M_PI*_distance*_distance;
+    double factor = 1. / (area*fourpid2);
+
+    // write the FITS files in parallel, each from its own thread
+    int Nlambda = find<WavelengthGrid>()->Nlambda();
+    Image image(this, _Nxp, _Nyp, Nlambda, _xpsiz, _ypsiz, _xpc, _ypc, "surfacebrightness");
+    bool compress = find<InstrumentSystem>()->compressDataCubes();
+    DataCubeWriter writer(this, nonempty, names, image, _Nframep, factor, compress);
+    find<ParallelFactory>()->parallel()->call(&writer, nonempty.size());
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -154,10 +154,20 @@ protected:
         if they are empty no output is generated. The calibration performed by this function takes
         care of the conversion from bolometric luminosity units to surface brightness units. The
         unit in which the surface brightness is written depends on the global units choice, but
-        typically it is in \f$\text{W}\,\text{m}^{-2}\,\text{arcsec}^{-2}\f$. The calibration is
-        performed in-place in the arrays, so the incoming data is overwritten. */
+        typically it is in \f$\text{W}\,\text{m}^{-2}\,\text{arcsec}^{-2}\f$. The incoming data
+        is not modified. */
     void calibrateAndWriteDataCubes(QList< Array* > farrays, QStringList fnames);
 
+    /** This function calibrates and outputs one or more luminosity data cubes just like the other
+        version of this function, except that each data cube to be written is given as a list of
+        arrays that are summed element-wise. This allows writing combinations of the luminosity
+        data cubes without first constructing the combined cube in memory. Data cubes for which
+        all arrays are empty are not written. The calibration is performed one wavelength frame at
+        a time while the values are being written (see Image::saveto()), and the FITS files for
+        the different data cubes are written concurrently by the parallel threads. The files are
+        losslessly tile compressed if so requested by the instrument system. */
+    void calibrateAndWriteDataCubes(QList< QList<Array*> > fsums, QStringList fnames);
+
     //======================== Data Members ========================
 
 protected:
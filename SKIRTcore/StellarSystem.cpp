@@ -1,11 +1,14 @@
 ////////////////////////////////////////////////////////////////////
 
+#include "AngularDistribution.hpp"
 #include "FatalError.hpp"
+#include "GeometricStellarComp.hpp"
 #include "NR.hpp"
 #include "PhotonPackage.hpp"
 #include "Random.hpp"
 #include "StellarComp.hpp"
 #include "StellarSystem.hpp"
+#include "WavelengthBundle.hpp"
 #include "WavelengthGrid.hpp"
 
 using namespace std;
@@ -158,3 +161,70 @@ void StellarSystem::launch(PhotonPackage* pp, int ell, double L) const
 }
 
 //////////////////////////////////////////////////////////////////////
+
+bool StellarSystem::supportsWavelengthBundles() const
+{
+    foreach (StellarComp* sc, _scv)
+        if (!dynamic_cast<GeometricStellarComp*>(sc)) return false;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void StellarSystem::launch(PhotonPackage* pp, WavelengthBundle* bundle) const
+{
+    int K = bundle->size();
+    int kref = bundle->reference();
+    int ellref = bundle->ell(kref);
+
+    // select a component; the luminosity-weighted part of the distribution is averaged over the bundle
+    int N = Ncomp();
+    int h = 0;
+    double q = 1.;
+    if (N > 1)
+    {
+        int Kemit = 0;
+        for (int k=0; k<K; k++) if (_Lv[bundle->ell(k)] > 0) Kemit++;
+        auto probability = [this,bundle,K,Kemit,N] (int h)
+        {
+            double f = 0.;
+            for (int k=0; k<K; k++)
+            {
+                int ell = bundle->ell(k);
+                if (_Lv[ell] > 0) f += _scv[h]->luminosity(ell) / _Lv[ell];
+            }
+            return (1.0-_emissionBias)*(Kemit ? f/Kemit : 0.) + _emissionBias/N;
+        };
+        double X = _random->uniform();
+        double cumulative = 0.;
+        for (h=0; h<N-1; h++)
+        {
+            cumulative += probability(h);
+            if (X < cumulative) break;
+        }
+        q = probability(h);
+    }
+    StellarComp* sc = _scv[h];
+
+    // emit the photon package at the reference wavelength; the position does not depend on wavelength
+    sc->launch(pp, ellref, bundle->luminosity(kref));
+    pp->setStellarOrigin(h);
+
+    // adjust the luminosities for the biased component selection and for anisotropic emission
+    const AngularDistribution* ad = pp->angularDistribution();
+    double pref = ad ? ad->probabilityForDirection(ellref, pp->position(), pp->direction()) : 1.;
+    for (int k=0; k<K; k++)
+    {
+        int ell = bundle->ell(k);
+        double weight = 0.;
+        if (_Lv[ell] > 0 && q > 0)
+        {
+            weight = sc->luminosity(ell) / _Lv[ell] / q;
+            if (ad && pref > 0) weight *= ad->probabilityForDirection(ell, pp->position(), pp->direction()) / pref;
+        }
+        bundle->setLuminosity(k, bundle->luminosity(k) * weight);
+    }
+    pp->setWavelength(ellref, bundle->luminosity(kref));
+}
+
+//////////////////////////////////////////////////////////////////////
@@ -11,6 +11,7 @@
 class PhotonPackage;
 class Random;
 class StellarComp;
+class WavelengthBundle;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -93,6 +94,27 @@ public:
         through the corresponding StellarComp::launch() function. */
     void launch(PhotonPackage* pp, int ell, double L) const;
 
+    /** This function returns true if the emission from all stellar components in the system can
+        be simulated with photon packages carrying a bundle of wavelengths (see WavelengthBundle),
+        and false otherwise. This is the case if each component is a GeometricStellarComp, because
+        the spatial distribution of such components does not depend on wavelength. */
+    bool supportsWavelengthBundles() const;
+
+    /** This function simulates the emission of a photon package carrying the wavelength bundle
+        specified as its second argument. On input, the luminosities in the bundle must be set to
+        the luminosity of a monochromatic photon package at each wavelength, as it would be passed
+        to the other launch() function. The function randomly chooses a stellar component from a
+        biased distribution, where the luminosity-weighted part of the distribution is averaged
+        over the wavelengths in the bundle, and simulates the emission at the reference wavelength
+        of the bundle through the corresponding StellarComp::launch() function. It then multiplies
+        the luminosity at each wavelength by the appropriate bias factor, i.e. the ratio of the
+        probability that the component would be selected for that wavelength and the probability
+        used for the actual selection. For anisotropic emission, the luminosities are also weighted
+        by the ratio of the probabilities for the emission direction at each wavelength and at the
+        reference wavelength. Finally, the photon package is set to the reference wavelength. This
+        function should be called only if supportsWavelengthBundles() returns true. */
+    void launch(PhotonPackage* pp, WavelengthBundle* bundle) const;
+
     //======================== Data Members ========================
 
 private:
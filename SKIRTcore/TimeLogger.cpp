@@ -3,20 +3,33 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <algorithm>
 #include <exception>
 #include "Log.hpp"
+#include "Parallel.hpp"
 #include "TimeLogger.hpp"
 
 ////////////////////////////////////////////////////////////////////
 
 TimeLogger::TimeLogger(Log *log, QString scope)
-    :_log(log), _scope(scope), _started(QDateTime::currentDateTime())
+    :_log(log), _scope(scope), _started(QDateTime::currentDateTime()), _parallel(0), _wallTime(0), _steals(0)
 {
     if (log) log->info("Starting " + scope + "...");
 }
 
 ////////////////////////////////////////////////////////////////////
 
+TimeLogger::TimeLogger(Log* log, QString scope, const Parallel* parallel)
+    : TimeLogger(log, scope)
+{
+    _parallel = parallel;
+    _wallTime = parallel->wallTime();
+    for (int t=0; t<parallel->threadCount(); t++) _busyTimes.push_back(parallel->busyTime(t));
+    _steals = parallel->stealCount();
+}
+
+////////////////////////////////////////////////////////////////////
+
 TimeLogger::~TimeLogger()
 {
     // If no Log instance was passed, we don't have to calculate the elapsed time
@@ -26,6 +39,9 @@ TimeLogger::~TimeLogger()
     // then we shouldn't report a success message!
     if (std::uncaught_exception()) return;
 
+    // if a parallel instance was specified, report the idle time of its threads
+    if (_parallel) logIdleTime();
+
     // local constants
     const qint64 msecsInSecond = 1000;
     const qint64 msecsInMinute = 60 * msecsInSecond;
@@ -61,3 +77,27 @@ TimeLogger::~TimeLogger()
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void TimeLogger::logIdleTime()
+{
+    int numThreads = _parallel->threadCount();
+    double wall = _parallel->wallTime() - _wallTime;
+    if (numThreads < 2 || wall <= 0) return;
+
+    double minIdle = 1.;
+    double maxIdle = 0.;
+    double sumIdle = 0.;
+    for (int t=0; t<numThreads; t++)
+    {
+        double idle = std::max(0., 1. - (_parallel->busyTime(t) - _busyTimes[t]) / wall);
+        minIdle = std::min(minIdle, idle);
+        maxIdle = std::max(maxIdle, idle);
+        sumIdle += idle;
+    }
+    _log->info("Thread idle time in " + _scope + ": minimum " + QString::number(100.*minIdle, 'f', 1)
+               + "%, average " + QString::number(100.*sumIdle/numThreads, 'f', 1)
+               + "%, maximum " + QString::number(100.*maxIdle, 'f', 1) + "% ("
+               + QString::number(_parallel->stealCount() - _steals) + " work steals)");
+}
+
+////////////////////////////////////////////////////////////////////
@@ -6,9 +6,11 @@
 #ifndef TIMELOGGER_HPP
 #define TIMELOGGER_HPP
 
+#include <vector>
 #include <QDateTime>
 #include <QString>
 class Log;
+class Parallel;
 
 ////////////////////////////////////////////////////////////////////
 
@@ -18,7 +20,11 @@ class Log;
     respectively. Typical use is to construct an instance at the beginning of a scope; the finish
     message is automatically generated by the destructor when the instance goes out of scope.
     Nested pairs of start/finish messages can easily be obtained by using TimeLogger in different
-    scopes. */
+    scopes.
+
+    If a Parallel instance is passed to the constructor, the destructor also logs statistics on the
+    idle time of the parallel threads during the execution of the scope, i.e. the fraction of the
+    wall-clock time spent in the Parallel::call() function during which each thread had no work. */
 class TimeLogger
 {
 public:
@@ -27,16 +33,32 @@ public:
         the specified scope name with the string "Starting ". */
     TimeLogger(Log* log, QString scope);
 
+    /** This constructor logs a start message as described for the other constructor, and in
+        addition remembers the current execution time statistics of the specified Parallel
+        instance, so that the destructor can log the idle time of its threads during the execution
+        of the scope. */
+    TimeLogger(Log* log, QString scope, const Parallel* parallel);
+
     /** The destructor logs a finish message with level Success to the log instance specified in
         the constructor. The finish message is formed by prefixing the specified scope name with
         the string "Finished " and appending the time elapsed between start and finish in a nice
-        format. */
+        format. If a Parallel instance was specified in the constructor, and it has multiple
+        threads, the destructor first logs an info message with the minimum, average and maximum
+        idle time of its threads, and the number of times work was stolen between threads. */
     ~TimeLogger();
 
 private:
+    /** This function logs the idle time statistics for the Parallel instance specified in the
+        constructor; used by the destructor. */
+    void logIdleTime();
+
     Log* _log;
     QString _scope;
     QDateTime _started;
+    const Parallel* _parallel;
+    double _wallTime;               // the wall time of the parallel instance at the start
+    std::vector<double> _busyTimes; // the busy time of each thread at the start
+    size_t _steals;                 // the steal count at the start
 };
 
 ////////////////////////////////////////////////////////////////////
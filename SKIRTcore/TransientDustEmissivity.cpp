@@ -3,11 +3,25 @@
 ////       © Astronomical Observatory, Ghent University         ////
 ///////////////////////////////////////////////////////////////// */
 
+#include <cstdint>
+#include <cstring>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMultiHash>
+#include <QTemporaryFile>
 #include "DustDistribution.hpp"
+#include "FatalError.hpp"
+#include "FilePaths.hpp"
 #include "MultiGrainDustMix.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
+#include "PeerToPeerCommunicator.hpp"
+#include "Random.hpp"
+#include "ScratchArena.hpp"
+#include "TemperatureDistributionKernel.hpp"
 #include "TransientDustEmissivity.hpp"
 #include "Table.hpp"
 #include "Units.hpp"
@@ -20,26 +34,6 @@ using namespace std;
 // container classes that are highly specialized to optimize the operations in this class
 namespace
 {
-    // square matrix
-    template<typename T> class Square
-    {
-    private:
-        size_t _n;
-        T* _v;
-
-    public:
-        // constructor sets maximum size and logical size
-        Square(size_t n) : _n(n), _v(new T[n*n]) { }
-        ~Square() { delete[] _v; }
-
-        // sets logical size, which must not be larger than maximum size set in constructor (is not checked)
-        // does not clear values; does not resize underlying memory
-        void resize(size_t n) { _n = n; }
-
-        // access to values  (const version currently not needed)
-        T& operator()(size_t i, size_t j) { return _v[i*_n+j]; }
-    };
-
     // square matrix with only items below the diagonal (i>j)
     template<typename T> class Triangle
     {
@@ -55,6 +49,9 @@ namespace
         // access to values; must have i>j (is not checked)
         const T& operator()(size_t i, size_t j) const { return _v[offset(i)+j]; }
         T& operator()(size_t i, size_t j) { return _v[offset(i)+j]; }
+
+        // access to the packed values, row by row
+        const T* data() const { return _v; }
     };
 }
 
@@ -179,56 +176,19 @@ public:
     // calculate the probabilities
     // Pv: the calculated probabilities (out)
     // ioff: the index offset in the temperature grid used for this calculation (out)
-    // Am: scratch memory for the calculation (internal only)
     // Tmin/Tmax: temperature range in which to perform the calculation (in), and
     //            temperature range where the calculated probabilities are above a certain fraction of maximum (out)
     // Jv: the radiation field (in)
-    void calcprobs(Array& Pv, int& ioff, Square<double>& Am, double& Tmin, double& Tmax, const Array& Jv) const
+    void calcprobs(Array& Pv, int& ioff, double& Tmin, double& Tmax, const Array& Jv) const
     {
         ioff = NR::locate_clip(_grid->_Tv, Tmin);
         int NT = NR::locate_clip(_grid->_Tv, Tmax) - ioff + 2;
 
-        // copy/calculate the transition matrix coefficients
-        Am.resize(NT);
-        for (int f=1; f<NT; f++)
-        {
-            const short* ELLv = &_ELLm(f+ioff,ioff);
-            const double* HRv = &_HRm(f+ioff,ioff);
-            for (int i=0; i<f; i++)
-            {
-                int ell = ELLv[i];
-                Am(f,i) = ell>=0 ? HRv[i] * Jv[ell] : 0.;
-            }
-        }
-        for (int i=1; i<NT; i++)
-        {
-            Am(i-1,i) = _CRv[i+ioff];
-        }
-
-        // calculate the cumulative matrix coefficients, in place
-        for (int f=NT-2; f>0; f--)
-        {
-            for (int i=0; i<f; i++)
-            {
-                Am(f,i) += Am(f+1,i);
-            }
-        }
-
-        // calculate the probabilities
+        // calculate the normalized probabilities, using the per-thread scratch memory for the transition matrix
+        size_t size = TemperatureDistributionKernel::workspaceSize(NT);
+        double* Am = ScratchArena::doubles(ScratchArena::TransitionMatrix, size);
         Pv.resize(NT);
-        Pv[0] = 1.;
-        for (int i=1; i<NT; i++)
-        {
-            double sum = 0.;
-            for (int j=0; j<i; j++) sum += Am(i,j) * Pv[j];
-            Pv[i] = sum / Am(i-1,i);
-
-            // rescale if needed to keep infinities from happening
-            if (Pv[i] > 1e10) for (int j=0; j<=i; j++) Pv[j]/=Pv[i];
-        }
-
-        // normalize probabilities to unity
-        Pv /= Pv.sum();
+        TemperatureDistributionKernel::solve(_HRm.data(), _ELLm.data(), &_CRv[0], &Jv[0], ioff, NT, Am, &Pv[0]);
 
         // determine the temperature range where the probabability is above a given fraction of its maximum
         double frac = 1e-20 * Pv.max();
@@ -288,12 +248,226 @@ namespace
     // - the temperature range is smaller than a given delta-T (i.e. it resembles a delta function)
     // - the equilibrium temperature lies outside of the temperature range
     const double deltaTeq = 10.;    // the cutoff width of the temperature range
+
+    // when the emissivity store is enabled, the emissivity is calculated anyway for one in every so many
+    // interpolated results, to estimate the interpolation error
+    const size_t validationInterval = 32;
+
+    // the signature and format version of the file holding the emissivity stores
+    const char storeSignature[8] = { 'S', 'K', 'I', 'R', 'T', 'T', 'D', 'E' };
+    const uint32_t storeVersion = 1;
 }
 
 ////////////////////////////////////////////////////////////////////
 
+// helper class to store the emissivities calculated for a particular dust mix, each together with a compressed
+// signature of the corresponding radiation field, and to interpolate between these emissivities;
+// the functions that access the stored emissivities or the statistics can be called from parallel threads
+class TDE_Store
+{
+public:
+    // the signature of a radiation field: the logarithm of the mean dust temperature and of the mean wavelength
+    // of the absorbed radiation, and the power absorbed by the dust mix (which is not part of the distance metric)
+    struct Signature { double logT, loglambda, power; };
+
+private:
+    // a stored emissivity; the emissivity array is shared so that it can be used outside of the lock
+    // while other threads add emissivities to the store (or clear it)
+    struct Node { Signature sig; std::shared_ptr<const Array> ev; };
+
+    const DustMix* _mix;
+    const WavelengthGrid* _lambdagrid;
+    double _tolerance;
+
+    std::mutex _mutex;                          // guards all data members below
+    vector<Node> _nodev;                        // the stored emissivities
+    QMultiHash<QPair<int,int>,int> _bucketh;    // the indices in _nodev for each bucket of the signature space
+    size_t _Nsaved;                             // the number of stored emissivities that have been saved
+
+    // statistics since the most recent report
+    size_t _Nevals, _Nhits, _Nvalidated;
+    double _sumerror, _maxerror;
+
+    // returns the bucket containing the specified signature, with buckets the size of the tolerance
+    QPair<int,int> bucket(const Signature& sig) const
+    {
+        return qMakePair(static_cast<int>(floor(sig.logT/_tolerance)),
+                         static_cast<int>(floor(sig.loglambda/_tolerance)));
+    }
+
+    // adds the specified emissivity to the store; the caller must hold the lock
+    void insert(const Signature& sig, const Array& ev)
+    {
+        _bucketh.insert(bucket(sig), _nodev.size());
+        _nodev.push_back(Node{sig, std::make_shared<const Array>(ev)});
+    }
+
+public:
+    TDE_Store(const DustMix* mix, const WavelengthGrid* lambdagrid, double tolerance)
+        : _mix(mix), _lambdagrid(lambdagrid), _tolerance(tolerance), _Nsaved(0),
+          _Nevals(0), _Nhits(0), _Nvalidated(0), _sumerror(0), _maxerror(0)
+    {
+    }
+
+    // returns the signature of the specified radiation field, or a signature with zero power if
+    // the dust mix does not absorb any radiation
+    Signature signature(const Array& Jv) const
+    {
+        double sum0 = 0.0;
+        double sum1 = 0.0;
+        int Nlambda = _lambdagrid->Nlambda();
+        for (int ell=0; ell<Nlambda; ell++)
+        {
+            double lambda = _lambdagrid->lambda(ell);
+            double dlambda = _lambdagrid->dlambda(ell);
+            double sigmaJ = _mix->sigmaabs(ell) * Jv[ell];
+            sum0 += sigmaJ * dlambda;
+            sum1 += sigmaJ * lambda * dlambda;
+        }
+        if (sum0 <= 0.0) return Signature{0., 0., 0.};
+        return Signature{log(_mix->invplanckabs(sum0)), log(sum1/sum0), sum0};
+    }
+
+    // interpolates the emissivity for the specified signature from the stored emissivities within the tolerance,
+    // using inverse-distance weights and scaling each emissivity to the specified absorbed power;
+    // returns false if there are no such emissivities; otherwise returns true and sets the validate flag
+    // if the caller should calculate the emissivity anyway to estimate the interpolation error
+    bool interpolate(const Signature& sig, Array& ev, bool& validate)
+    {
+        // while holding the lock, select the stored emissivities within the tolerance and determine their weights
+        vector<std::shared_ptr<const Array>> nodeevv;
+        vector<double> factorv;
+        double sumw = 0.;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _Nevals++;
+
+            QPair<int,int> center = bucket(sig);
+            for (int i=center.first-1; i<=center.first+1; i++)
+            {
+                for (int j=center.second-1; j<=center.second+1; j++)
+                {
+                    foreach (int k, _bucketh.values(qMakePair(i,j)))
+                    {
+                        const Node& node = _nodev[k];
+                        double dlogT = sig.logT - node.sig.logT;
+                        double dloglambda = sig.loglambda - node.sig.loglambda;
+                        double d = sqrt(dlogT*dlogT + dloglambda*dloglambda);
+                        if (d > _tolerance) continue;
+
+                        // a (nearly) identical signature dominates the weights; avoid dividing by zero
+                        double w = 1. / max(d, 1e-6*_tolerance);
+                        nodeevv.push_back(node.ev);
+                        factorv.push_back(w*sig.power/node.sig.power);
+                        sumw += w;
+                    }
+                }
+            }
+            if (!sumw) return false;
+
+            _Nhits++;
+            validate = _Nhits % validationInterval == 0;
+        }
+
+        // accumulate the selected emissivities without holding the lock
+        ev.resize(nodeevv[0]->size());
+        for (size_t k=0; k<nodeevv.size(); k++) ev += *nodeevv[k] * factorv[k];
+        ev /= sumw;
+        return true;
+    }
+
+    // adds a newly calculated emissivity to the store
+    void add(const Signature& sig, const Array& ev)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        insert(sig, ev);
+    }
+
+    // records the interpolation error given an interpolated emissivity and the corresponding calculated emissivity
+    void validate(const Array& ev, const Array& exact)
+    {
+        double error = abs(ev-exact).sum() / exact.sum();
+        std::unique_lock<std::mutex> lock(_mutex);
+        _Nvalidated++;
+        _sumerror += error;
+        _maxerror = max(_maxerror, error);
+    }
+
+    // adds the statistics since the most recent report to the specified values, and resets them
+    void statistics(size_t& Nevals, size_t& Nhits, size_t& Nnodes, size_t& Nvalidated, double& sumerror,
+                    double& maxerror)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        Nevals += _Nevals;
+        Nhits += _Nhits;
+        Nnodes += _nodev.size();
+        Nvalidated += _Nvalidated;
+        sumerror += _sumerror;
+        maxerror = max(maxerror, _maxerror);
+        _Nevals = _Nhits = _Nvalidated = 0;
+        _sumerror = _maxerror = 0.;
+    }
+
+    // removes all stored emissivities
+    void clear()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _nodev.clear();
+        _bucketh.clear();
+        _Nsaved = 0;
+    }
+
+    // returns true if emissivities have been added since the store has been saved or loaded
+    bool modified()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _nodev.size() > _Nsaved;
+    }
+
+    // writes the stored emissivities to the specified file; returns false if an error occurred
+    bool write(QFile& file)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t Nnodes = _nodev.size();
+        bool success = file.write(reinterpret_cast<const char*>(&Nnodes), sizeof(uint64_t)) == sizeof(uint64_t);
+        for (const Node& node : _nodev)
+        {
+            size_t Nlambda = node.ev->size();
+            success = success
+                    && file.write(reinterpret_cast<const char*>(&node.sig), sizeof(Signature)) == sizeof(Signature)
+                    && file.write(reinterpret_cast<const char*>(&(*node.ev)[0]), Nlambda*sizeof(double))
+                                                                        == static_cast<qint64>(Nlambda*sizeof(double));
+        }
+        if (success) _Nsaved = Nnodes;
+        return success;
+    }
+
+    // reads emissivities for the specified number of wavelengths from the specified file; returns false if an
+    // error occurred
+    bool read(QFile& file, int Nlambda)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t Nnodes = 0;
+        if (file.read(reinterpret_cast<char*>(&Nnodes), sizeof(uint64_t)) != sizeof(uint64_t)) return false;
+        for (uint64_t k=0; k<Nnodes; k++)
+        {
+            Signature sig;
+            Array ev(Nlambda);
+            if (file.read(reinterpret_cast<char*>(&sig), sizeof(Signature)) != sizeof(Signature)
+                || file.read(reinterpret_cast<char*>(&ev[0]), Nlambda*sizeof(double))
+                                                                != static_cast<qint64>(Nlambda*sizeof(double)))
+                return false;
+            insert(sig, ev);
+        }
+        _Nsaved = _nodev.size();
+        return true;
+    }
+};
+
+////////////////////////////////////////////////////////////////////
+
 TransientDustEmissivity::TransientDustEmissivity()
-    : _Nlambda(0)
+    : _tolerance(0), _storesEnabled(false), _Nlambda(0)
 {
 }
 
@@ -305,6 +479,7 @@ TransientDustEmissivity::~TransientDustEmissivity()
     foreach (const TDE_Calculator* calculator, _calculatorsB.values()) delete calculator;
     foreach (const TDE_Calculator* calculator, _calculatorsC.values()) delete calculator;
     foreach (const TDE_Grid* grid, _grids) delete grid;
+    foreach (TDE_Store* store, _stores.values()) delete store;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -313,6 +488,18 @@ void TransientDustEmissivity::setupSelfBefore()
 {
     DustEmissivity::setupSelfBefore();
 
+    if (_tolerance < 0) throw FATALERROR("The emulator tolerance should not be negative");
+
+    // the contents of the emissivity stores depend on the order in which the parallel threads calculate the
+    // emissivities, so the emulator is disabled if the simulation's results should be reproducible
+    _storesEnabled = _tolerance > 0;
+    if (_storesEnabled && find<Random>()->reproducible())
+    {
+        find<Log>()->warning("Disabling the transient dust emissivity emulator because the simulation "
+                             "uses reproducible random streams");
+        _storesEnabled = false;
+    }
+
     // ensure that all dust mixes in the dust system are of type MultiGrainDustMix
     // and construct the appropriate grids and calculators for each of the dust mixes
     find<Log>()->info("Precalculating cached values for transient dust emissivity computations...");
@@ -339,12 +526,60 @@ void TransientDustEmissivity::setupSelfBefore()
             _calculatorsB.insert(QPair<const DustMix*,int>(mix,c), new TDE_Calculator(gridB,mix,c));
             _calculatorsC.insert(QPair<const DustMix*,int>(mix,c), new TDE_Calculator(gridC,mix,c));
         }
+
+        // create an emissivity store, if enabled
+        _mixes << mix;
+        if (_storesEnabled) _stores.insert(mix, new TDE_Store(mix, lambdagrid, _tolerance));
+    }
+
+    // load any emissivities stored in the cache directory by earlier simulations
+    if (_storesEnabled && !find<FilePaths>()->cachePath().isEmpty())
+    {
+        _storeFilePath = find<FilePaths>()->cache(storeFileName());
+        loadStores(_storeFilePath);
     }
 }
 
 ////////////////////////////////////////////////////////////////////
 
+void TransientDustEmissivity::setEmulatorTolerance(double value)
+{
+    _tolerance = value;
+}
+
+////////////////////////////////////////////////////////////////////
+
+double TransientDustEmissivity::emulatorTolerance() const
+{
+    return _tolerance;
+}
+
+////////////////////////////////////////////////////////////////////
+
 Array TransientDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) const
+{
+    // without an emissivity store, or if the dust mix does not absorb any radiation, just calculate the emissivity
+    TDE_Store* store = _stores.value(mix);
+    if (!store) return calculateEmissivity(mix, Jv);
+    TDE_Store::Signature sig = store->signature(Jv);
+    if (sig.power <= 0.) return calculateEmissivity(mix, Jv);
+
+    // if the emissivity can be interpolated from the store, return the interpolated result, except
+    // for the occasional validation sample
+    Array ev;
+    bool validate = false;
+    if (store->interpolate(sig, ev, validate) && !validate) return ev;
+
+    // otherwise calculate the emissivity and add it to the store
+    Array exact = calculateEmissivity(mix, Jv);
+    if (validate) store->validate(ev, exact);
+    store->add(sig, exact);
+    return exact;
+}
+
+////////////////////////////////////////////////////////////////////
+
+Array TransientDustEmissivity::calculateEmissivity(const DustMix* mix, const Array& Jv) const
 {
     const MultiGrainDustMix* mgmix = mix->find<MultiGrainDustMix>();
 
@@ -355,7 +590,6 @@ Array TransientDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) c
 
     // provide room for the probabilities calculated over each of the temperature grids
     Array Pv;
-    Square<double> Am(ceil(Tuppermax)+1);
 
     // accumulate the emissivities for all populations in the dust mix
     Array ev(_Nlambda);
@@ -377,7 +611,7 @@ Array TransientDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) c
             double Tmin = 0;
             double Tmax = Tuppermax;
             int ioff = 0;
-            calculatorA->calcprobs(Pv, ioff, Am, Tmin, Tmax, Jv);
+            calculatorA->calcprobs(Pv, ioff, Tmin, Tmax, Jv);
 
             // if the population might be transient...
             if (Tmax-Tmin > deltaTeq && Teq < Tmax)
@@ -388,7 +622,7 @@ Array TransientDustEmissivity::emissivity(const DustMix* mix, const Array& Jv) c
                                                    : _calculatorsC.value(qMakePair(mix,c));
 
                 // calculate the probabilities over the chosen grid, in the range determined by the coarse calculation
-                calculator->calcprobs(Pv, ioff, Am, Tmin, Tmax, Jv);
+                calculator->calcprobs(Pv, ioff, Tmin, Tmax, Jv);
 
                 // if the population indeed is transient...
                 if (Tmax-Tmin > deltaTeq && Teq < Tmax)
@@ -420,3 +654,130 @@ int TransientDustEmissivity::logfrequency() const
 }
 
 ////////////////////////////////////////////////////////////////////
+
+void TransientDustEmissivity::libraryCalculated()
+{
+    if (_stores.isEmpty()) return;
+
+    // report the statistics for all emissivity stores
+    size_t Nevals = 0, Nhits = 0, Nnodes = 0, Nvalidated = 0;
+    double sumerror = 0., maxerror = 0.;
+    foreach (TDE_Store* store, _stores.values())
+        store->statistics(Nevals, Nhits, Nnodes, Nvalidated, sumerror, maxerror);
+    Log* log = find<Log>();
+    log->info("Emissivity store: reused " + QString::number(Nhits) + " out of " + QString::number(Nevals)
+              + " emissivities (" + QString::number(Nevals ? 100.*Nhits/Nevals : 0., 'f', 1) + "%); "
+              + QString::number(Nnodes) + " emissivities stored");
+    if (Nvalidated)
+        log->info("  Estimated interpolation error from " + QString::number(Nvalidated) + " samples: mean "
+                  + QString::number(100.*sumerror/Nvalidated, 'f', 2) + "%, maximum "
+                  + QString::number(100.*maxerror, 'f', 2) + "%");
+
+    // save the stores if they have been modified
+    if (_storeFilePath.isEmpty() || !find<PeerToPeerCommunicator>()->isRoot()) return;
+    bool modified = false;
+    foreach (TDE_Store* store, _stores.values()) if (store->modified()) modified = true;
+    if (modified) saveStores(_storeFilePath);
+}
+
+////////////////////////////////////////////////////////////////////
+
+QString TransientDustEmissivity::storeFileName() const
+{
+    // include the wavelength grid
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(storeSignature, sizeof(storeSignature));
+    hash.addData(reinterpret_cast<const char*>(&storeVersion), sizeof(storeVersion));
+    auto addArray = [&hash] (const Array& v)
+    {
+        if (v.size()) hash.addData(reinterpret_cast<const char*>(&v[0]), v.size()*sizeof(double));
+    };
+    WavelengthGrid* lambdagrid = find<WavelengthGrid>();
+    addArray(lambdagrid->lambdav());
+    addArray(lambdagrid->dlambdav());
+
+    // include the properties of all dust populations that affect the emissivity, and the temperature grids
+    int h = 0;
+    foreach (const DustMix* mix, _mixes)
+    {
+        const MultiGrainDustMix* mgmix = mix->find<MultiGrainDustMix>();
+        double mu = mix->mu();
+        hash.addData(reinterpret_cast<const char*>(&mu), sizeof(double));
+        for (int c=0; c<mix->Npop(); c++)
+        {
+            double meanmass = mgmix->meanmass(c);
+            hash.addData(reinterpret_cast<const char*>(&meanmass), sizeof(double));
+            hash.addData(mgmix->gcname(c).toUtf8());
+            addArray(mix->sigmaabsv(c));
+            for (int g=0; g<3; g++)
+            {
+                const Array& Tv = _grids[3*h+g]->_Tv;
+                addArray(Tv);
+                Array Hv(Tv.size());
+                for (size_t i=0; i<Tv.size(); i++) Hv[i] = mgmix->enthalpy(Tv[i],c);
+                addArray(Hv);
+            }
+        }
+        h++;
+    }
+    return QString::fromLatin1(hash.result().toHex()) + ".tde";
+}
+
+////////////////////////////////////////////////////////////////////
+
+void TransientDustEmissivity::loadStores(QString filepath)
+{
+    Log* log = find<Log>();
+    QFile file(filepath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        log->info("No stored emissivities in file " + filepath);
+        return;
+    }
+
+    // verify the header and read the stores
+    char signature[sizeof(storeSignature)];
+    uint32_t header[4];
+    bool success = file.read(signature, sizeof(signature)) == sizeof(signature)
+            && !memcmp(signature, storeSignature, sizeof(storeSignature))
+            && file.read(reinterpret_cast<char*>(header), sizeof(header)) == sizeof(header)
+            && header[0] == storeVersion
+            && header[1] == static_cast<uint32_t>(_mixes.size())
+            && header[2] == static_cast<uint32_t>(_Nlambda);
+    foreach (const DustMix* mix, _mixes) success = success && _stores.value(mix)->read(file, _Nlambda);
+    if (!success)
+    {
+        log->warning("Ignoring invalid emissivity store file " + filepath);
+        foreach (TDE_Store* store, _stores.values()) store->clear();
+        return;
+    }
+    log->info("Loaded stored emissivities from file " + filepath);
+}
+
+////////////////////////////////////////////////////////////////////
+
+void TransientDustEmissivity::saveStores(QString filepath) const
+{
+    Log* log = find<Log>();
+    log->info("Saving stored emissivities to file " + filepath + "...");
+
+    // write the file under a temporary name in the cache directory
+    QTemporaryFile file(filepath + ".XXXXXX");
+    file.setAutoRemove(false);
+    uint32_t header[4] = { storeVersion, static_cast<uint32_t>(_mixes.size()), static_cast<uint32_t>(_Nlambda), 0 };
+    bool success = file.open()
+            && file.write(storeSignature, sizeof(storeSignature)) == sizeof(storeSignature)
+            && file.write(reinterpret_cast<const char*>(header), sizeof(header)) == sizeof(header);
+    foreach (const DustMix* mix, _mixes) success = success && _stores.value(mix)->write(file);
+    file.close();
+
+    // replace the existing file, if any, by the new file
+    QFile::remove(filepath);
+    if (!success || !file.rename(filepath))
+    {
+        QFile::remove(file.fileName());
+        log->warning("Could not save stored emissivities to file " + filepath);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
@@ -10,6 +10,7 @@
 #include "DustEmissivity.hpp"
 class TDE_Calculator;
 class TDE_Grid;
+class TDE_Store;
 
 //////////////////////////////////////////////////////////////////////
 
@@ -62,6 +63,32 @@ class TDE_Grid;
     B_{f+1,i}+A_{f,i} & f=N-2,\ldots,1;\,i=0,\ldots,f-1 \\ X_0 &= 1 \\ X_i &=
     \frac{\sum_{j=0}^{i-1}B_{i,j}X_j}{A_{i-1,i}} & i=1,\ldots,N-1 \\ P_i &=
     \frac{X_i}{\sum_{j=0}^{N-1}X_j} & i=0,\ldots,N-1 \f}
+
+    Because the above calculation is expensive, the class optionally keeps an emissivity store for
+    each dust mix, which holds the emissivities calculated so far together with a compressed
+    signature of the corresponding radiation field. The signature consists of the mean dust
+    temperature \f$\bar{T}\f$ and the mean wavelength \f$\bar{\lambda}\f$ of the absorbed
+    radiation, as defined for the Dim2DustLib class. When the emissivity is requested for a
+    radiation field whose signature lies within a distance \f$\delta\f$ (the emulator tolerance)
+    of one or more stored signatures, measured as \f$\sqrt{(\Delta\ln\bar{T})^2 +
+    (\Delta\ln\bar{\lambda})^2}\f$, the emissivity is interpolated from the corresponding stored
+    emissivities with inverse-distance weights, after scaling each of these to the absorbed power
+    of the requested radiation field. Otherwise the emissivity is calculated and added to the
+    store. The stores persist across the self-absorption cycles and the dust emission iterations
+    of a simulation. If the dust grid cache is enabled (see FilePaths::setCachePath()), the stores
+    are also saved in the cache directory under a name derived from a hash of the wavelength grid
+    and the dust mix properties, and they are reloaded by later simulations with the same
+    wavelength grid and dust mixes. To estimate the interpolation error, the emissivity is
+    calculated anyway for one in every 32 interpolated results, and the relative difference
+    between the two is recorded. The number of reused results and the interpolation error are
+    logged each time the dust library has been calculated. An emulator tolerance of zero (the
+    default) disables the emissivity store.
+
+    Because the emissivities are added to the store in the order in which the parallel threads
+    happen to request them, the interpolated results, and thus the simulation results, are not
+    reproducible from run to run when using multiple threads or processes, even with the same
+    random seed. For this reason the emissivity store is disabled (with a warning) if the random
+    generator is configured to produce reproducible results (see Random::setReproducible()).
 */
 class TransientDustEmissivity : public DustEmissivity
 {
@@ -69,6 +96,12 @@ class TransientDustEmissivity : public DustEmissivity
     Q_CLASSINFO("Title", "transient heating dust emissivity (with full non-LTE treatment)")
     Q_CLASSINFO("AllowedIf", "MultiGrainDustMix")
 
+    Q_CLASSINFO("Property", "emulatorTolerance")
+    Q_CLASSINFO("Title", "the tolerance for reusing emissivities calculated for similar radiation fields (0 = no reuse)")
+    Q_CLASSINFO("MinValue", "0")
+    Q_CLASSINFO("MaxValue", "1")
+    Q_CLASSINFO("Default", "0")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -79,17 +112,34 @@ public:
     ~TransientDustEmissivity();
 
     /** This function verifies that all dust components in the dust system have a dust mix based on
-        the MultiGrainDustMix class. */
+        the MultiGrainDustMix class. If the emulator tolerance is nonzero and the random generator
+        is not reproducible, it also creates an emissivity store for each dust mix, and loads any
+        stored emissivities from the cache directory. */
     void setupSelfBefore();
 
+    //======== Setters & Getters for Discoverable Attributes =======
+
+public:
+    /** Sets the emulator tolerance, i.e. the maximum distance between the signatures of two
+        radiation fields for which a stored emissivity may be reused. A value of zero (the default)
+        disables the emissivity store. A nonzero value makes the simulation results depend on the
+        order in which the parallel threads calculate the emissivities, so that they are not
+        reproducible; hence the value is ignored if the random generator is reproducible. */
+    Q_INVOKABLE void setEmulatorTolerance(double value);
+
+    /** Returns the emulator tolerance. */
+    Q_INVOKABLE double emulatorTolerance() const;
+
     //======================== Other Functions =======================
 
 public:
     /** This function returns the dust emissivity \f$\varepsilon_\ell\f$ at all wavelength indices
         \f$\ell\f$ for a dust mix of the specified type residing in the specified mean radiation
-        field \f$J_\ell\f$, assuming the simulation's wavelength grid. */
-
+        field \f$J_\ell\f$, assuming the simulation's wavelength grid. If the emissivity store is
+        enabled, the result may be interpolated from stored emissivities for similar radiation
+        fields, as described in the class header. */
     Array emissivity(const DustMix* mix, const Array& Jv) const;
+
     /** The return value of this function indicates a meaningful frequency for console-logging when
         repeatly invoking emissivity(). A value of zero means that the calculation is fast and thus
         there should be no logging. A value of one means that the calculation is slow and thus
@@ -97,9 +147,36 @@ public:
         function returns one, which means every invocation should be logged. */
     virtual int logfrequency() const;
 
+    /** This function logs the number of emissivities reused from the emissivity stores and the
+        estimated interpolation error since the previous invocation, and saves the stores in the
+        cache directory if new emissivities have been added. It does nothing if the emissivity
+        store is disabled. */
+    void libraryCalculated();
+
+private:
+    /** This function calculates the emissivity as described for the emissivity() function,
+        without consulting the emissivity store. */
+    Array calculateEmissivity(const DustMix* mix, const Array& Jv) const;
+
+    /** This function returns the name of the file in the cache directory holding the emissivity
+        stores, which is derived from a hash of the wavelength grid and the properties of all dust
+        populations in the dust system. */
+    QString storeFileName() const;
+
+    /** This function loads the emissivity stores from the specified file, if it exists. */
+    void loadStores(QString filepath);
+
+    /** This function saves the emissivity stores to the specified file. */
+    void saveStores(QString filepath) const;
+
     //========================= Data members =======================
 
 private:
+    // discoverable properties
+    double _tolerance;
+
+    // data members initialized during setup
+    bool _storesEnabled;        // true if the emulator tolerance is nonzero and the random generator is not reproducible
     int _Nlambda;
 
     // setupSelfBefore adds all grids to this list so that they stay around (and can be destructed)
@@ -109,6 +186,11 @@ private:
     QHash< QPair<const DustMix*,int>, const TDE_Calculator* > _calculatorsA;     // coarse grid
     QHash< QPair<const DustMix*,int>, const TDE_Calculator* > _calculatorsB;     // medium grid
     QHash< QPair<const DustMix*,int>, const TDE_Calculator* > _calculatorsC;     // fine grid
+
+    // setupSelfBefore adds an emissivity store for each dust mix, if enabled (indexed on h)
+    QList<const DustMix*> _mixes;
+    QHash<const DustMix*, TDE_Store*> _stores;
+    QString _storeFilePath;     // the path of the file holding the stores, or empty if they are not saved
 };
 
 ////////////////////////////////////////////////////////////////////
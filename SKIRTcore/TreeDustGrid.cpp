@@ -9,12 +9,14 @@
 #include "DustGridPath.hpp"
 #include "DustGridPlotFile.hpp"
 #include "FatalError.hpp"
+#include "LinearTree.hpp"
 #include "Log.hpp"
 #include "NR.hpp"
 #include "Parallel.hpp"
 #include "ParallelFactory.hpp"
 #include "PeerToPeerCommunicator.hpp"
 #include "Random.hpp"
+#include "SequentialAssigner.hpp"
 #include "TreeDustGrid.hpp"
 #include "TreeNode.hpp"
 #include "TreeNodeBoxDensityCalculator.hpp"
@@ -25,13 +27,64 @@ using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 
+namespace
+{
+    // the maximum number of density samples held in memory for a batch of nodes during construction
+    const size_t MAXBATCHSAMPLES = 1 << 22;
+
+    // a parallel target performing the density calculations for a batch of nodes at the same level;
+    // when sampling, each index corresponds to a single (node, sample) pair, so that all threads remain
+    // busy regardless of the number of nodes in the batch
+    class BatchCalculator : public ParallelTarget
+    {
+    public:
+        BatchCalculator(const vector<TreeNodeSampleDensityCalculator*>& samplev, int Nrandom,
+                        const vector<TreeNodeBoxDensityCalculator*>& boxv)
+            : _samplev(samplev), _Nrandom(Nrandom), _boxv(boxv) { }
+
+        // returns the number of indices
+        size_t size() const
+        {
+            return _samplev.empty() ? _boxv.size() : _samplev.size()*_Nrandom;
+        }
+
+        // performs the calculation for the specified index
+        void body(size_t index)
+        {
+            if (_samplev.empty()) _boxv[index]->mass();
+            else _samplev[index/_Nrandom]->body(index%_Nrandom);
+        }
+
+        // returns the result of the calculation for the specified index
+        double result(size_t index) const
+        {
+            if (_samplev.empty()) return _boxv[index]->mass();
+            else return _samplev[index/_Nrandom]->density(index%_Nrandom);
+        }
+
+        // stores a result calculated elsewhere for the specified index
+        void setResult(size_t index, double value)
+        {
+            if (_samplev.empty()) _boxv[index]->setMass(value);
+            else _samplev[index/_Nrandom]->setDensity(index%_Nrandom, value);
+        }
+
+    private:
+        const vector<TreeNodeSampleDensityCalculator*>& _samplev;
+        size_t _Nrandom;
+        const vector<TreeNodeBoxDensityCalculator*>& _boxv;
+    };
+}
+
+//////////////////////////////////////////////////////////////////////
+
 TreeDustGrid::TreeDustGrid()
     : _minlevel(0), _maxlevel(0),
       _search(TopDown), _Nrandom(100),
       _maxOpticalDepth(0), _maxMassFraction(0), _maxDensDispFraction(0),
-      _assigner(0), _random(0), _parallel(0), _dd(0), _dmib(0),
+      _assigner(0), _random(0), _parallel(0), _comm(0), _dd(0), _dmib(0),
       _totalmass(0), _eps(0),
-      _Nnodes(0), _highestWriteLevel(0),
+      _Nnodes(0), _lineartree(0), _highestWriteLevel(0),
       _useDmibForSubdivide(false)
 {
 }
@@ -40,8 +93,10 @@ TreeDustGrid::TreeDustGrid()
 
 TreeDustGrid::~TreeDustGrid()
 {
-    for (int l=0; l<_Nnodes; l++)
+    int n = _tree.size();
+    for (int l=0; l<n; l++)
         delete _tree[l];
+    delete _lineartree;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -62,41 +117,79 @@ void TreeDustGrid::setupSelfBefore()
     if (_maxDensDispFraction < 0.0) throw FATALERROR("The maximum density dispersion fraction should be positive");
 
     // Cache some often used values
-    // A Parallel instance is created with a limited amount of threads (4) for performance reasons
-    // or with a single thread in case of multiprocessing, to ensure consistency.
-    size_t nthreads = find<PeerToPeerCommunicator>()->isMultiProc() ? 1 : 4;
     _random = find<Random>();
-    _parallel = find<ParallelFactory>()->parallel(nthreads);
+    _parallel = find<ParallelFactory>()->parallel();
+    _comm = find<PeerToPeerCommunicator>();
     _dd = find<DustDistribution>();
     _dmib = _dd->interface<DustMassInBoxInterface>();
     _useDmibForSubdivide = _dmib && !_maxDensDispFraction;
     _totalmass = _dd->mass();
     _eps = 1e-12 * extent().widths().norm();
 
+    // Construct the tree, unless its structure has been restored from the dust grid cache
+
+    if (_lineartree)
+    {
+        log->info("Using the tree structure restored from the dust grid cache.");
+        log->info("  Total number of nodes: " + QString::number(_lineartree->numNodes()));
+        log->info("  Total number of leaves: " + QString::number(_lineartree->numCells()));
+    }
+    else constructTree();
+
+    // Log the number of cells at each level
+
+    int Ncells = _lineartree->numCells();
+    vector<int> countv(_maxlevel+1);
+    for (int m=0; m<Ncells; m++) countv[_lineartree->cellLevel(m)]++;
+    log->info("  Number of leaf cells of each level:");
+    for (int level=0; level<=_maxlevel; level++)
+        log->info("    Level " + QString::number(level) + ": " + QString::number(countv[level]) + " cells");
+
+    // Determine the number of levels to be included in 3D grid output (if such output is requested)
+
+    if (writeGrid())
+    {
+        int cumulativeCells = 0;
+        for (_highestWriteLevel=0; _highestWriteLevel<=_maxlevel; _highestWriteLevel++)
+        {
+            cumulativeCells += countv[_highestWriteLevel];
+            if (cumulativeCells > 1500) break;          // experimental number
+        }
+        if (_highestWriteLevel<_maxlevel)
+            log->info("Will be outputting 3D grid data up to level " + QString::number(_highestWriteLevel) +
+                      ", i.e. " + QString::number(cumulativeCells) + " cells.");
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TreeDustGrid::constructTree()
+{
+    Log* log = find<Log>();
+
     // Create the root node
 
     _tree.push_back(createRoot(extent()));
 
-    // Recursively subdivide the root node until all nodes satisfy the
-    // necessary criteria. When finished, set the number _Nnodes.
+    // Subdivide the tree level by level until all nodes satisfy the necessary
+    // criteria. Because the children of a node are added at the end of the tree
+    // vector, the nodes of each level occupy a contiguous range in the vector.
+    // Each level is handled in batches of nodes, limiting the memory used for
+    // the density samples. When finished, set the number _Nnodes.
 
-    int currentlevel = -1;
-    unsigned int l = 0;
-    while (true)
+    size_t batchsize = max(static_cast<size_t>(1), MAXBATCHSAMPLES/_Nrandom);
+    size_t begin = 0;
+    while (begin < _tree.size())
     {
-        TreeNode* node = _tree[l];
-        int level = node->level();
-        if (level>currentlevel)
+        size_t end = _tree.size();
+        log->info("Starting subdivision of level " + QString::number(_tree[begin]->level())
+                  + " (" + QString::number(end-begin) + " nodes)...");
+        for (size_t l=begin; l<end; l+=batchsize)
         {
-            log->info("Starting subdivision of level " + QString::number(level) + "...");
-            currentlevel = level;
+            if (l>begin) log->info("Subdividing node number " + QString::number(l) + "...");
+            subdivide(l, min(end, l+batchsize));
         }
-        if (l%50000 == 0)
-            log->info("Subdividing node number " + QString::number(l) + "...");
-        if (node->ynchildless())
-            subdivide(node);
-        l++;
-        if (l>=_tree.size()) break;
+        begin = end;
     }
     _Nnodes = _tree.size();
 
@@ -125,72 +218,90 @@ void TreeDustGrid::setupSelfBefore()
     log->info("Construction of the tree finished.");
     log->info("  Total number of nodes: " + QString::number(_Nnodes));
     log->info("  Total number of leaves: " + QString::number(Ncells));
-    vector<int> countv(_maxlevel+1);
-    for (int m=0; m<Ncells; m++)
-    {
-        TreeNode* node = _tree[_idv[m]];
-        int level = node->level();
-        countv[level]++;
-    }
-    log->info("  Number of leaf cells of each level:");
-    for (int level=0; level<=_maxlevel; level++)
-        log->info("    Level " + QString::number(level) + ": " + QString::number(countv[level]) + " cells");
-
-    // Determine the number of levels to be included in 3D grid output (if such output is requested)
-
-    if (writeGrid())
-    {
-        int cumulativeCells = 0;
-        for (_highestWriteLevel=0; _highestWriteLevel<=_maxlevel; _highestWriteLevel++)
-        {
-            cumulativeCells += countv[_highestWriteLevel];
-            if (cumulativeCells > 1500) break;          // experimental number
-        }
-        if (_highestWriteLevel<_maxlevel)
-            log->info("Will be outputting 3D grid data up to level " + QString::number(_highestWriteLevel) +
-                      ", i.e. " + QString::number(cumulativeCells) + " cells.");
-    }
 
-    // Add neighbors to the tree structure (but only if required for the search method)
+    // Convert the tree to its linear representation (including the neighbor ropes),
+    // and release the memory held by the tree nodes and the construction vectors
 
-    if (_search == Neighbor)
-    {
-        log->info("Adding neighbors to the tree nodes...");
-        for (int l=0; l<_Nnodes; l++) _tree[l]->addneighbors();
-        for (int l=0; l<_Nnodes; l++) _tree[l]->sortneighbors();
-    }
+    log->info("Converting the tree to its linear representation...");
+    _lineartree = new LinearTree(_tree[0], _cellnumberv);
+    for (int l=0; l<_Nnodes; l++) delete _tree[l];
+    vector<TreeNode*>().swap(_tree);
+    vector<int>().swap(_cellnumberv);
+    vector<int>().swap(_idv);
+    log->info("  Linear tree memory usage: "
+              + QString::number(_lineartree->memoryUsage()/1048576., 'f', 1) + " MB");
 }
 
 //////////////////////////////////////////////////////////////////////
 
-void TreeDustGrid::subdivide(TreeNode* node)
+void TreeDustGrid::subdivide(size_t begin, size_t end)
 {
-    // If level is below or at minlevel, there is always subdivision, and the subdivision is "regular"
-    int level = node->level();
+    // all nodes in the batch are at the same level
+    int level = _tree[begin]->level();
+
+    // if level is below or at minlevel, there is always subdivision, and the subdivision is "regular"
     if (level <= _minlevel)
     {
-        node->createchildren(_tree.size());
-        _tree.insert(_tree.end(), node->children().begin(), node->children().end());
+        for (size_t l=begin; l<end; l++)
+        {
+            TreeNode* node = _tree[l];
+            node->createchildren(_tree.size());
+            _tree.insert(_tree.end(), node->children().begin(), node->children().end());
+        }
+        return;
     }
 
-    // if level is below maxlevel, there may be subdivision depending on various stopping criteria
-    else if (level < _maxlevel)
+    // if level is at maxlevel, there is no subdivision
+    if (level >= _maxlevel) return;
+
+    // construct an appropriate density calculator for each node to estimate properties for stopping criteria
+    // and division; the calculators are constructed in the order of the nodes, so that the random sample
+    // positions are drawn in the same sequence as when the nodes are handled one by one
+    size_t Nnodes = end-begin;
+    vector<TreeNodeDensityCalculator*> calcv(Nnodes);
+    vector<TreeNodeSampleDensityCalculator*> samplev;
+    vector<TreeNodeBoxDensityCalculator*> boxv;
+    for (size_t i=0; i<Nnodes; i++)
     {
-        // construct an appropriate density calculator to estimate properties for stopping criteria and division
-        TreeNodeDensityCalculator* calc;
         if (_useDmibForSubdivide)
         {
             // use the DustMassInBox interface
-            calc = new TreeNodeBoxDensityCalculator(_dmib, node);
+            boxv.push_back(new TreeNodeBoxDensityCalculator(_dmib, _tree[begin+i]));
+            calcv[i] = boxv.back();
         }
         else
         {
             // sample the density in the cell
-            TreeNodeSampleDensityCalculator* sampleCalc =
-                    new TreeNodeSampleDensityCalculator(_random, _Nrandom, _dd, node);
-            _parallel->call(sampleCalc, _Nrandom);
-            calc = sampleCalc;
+            samplev.push_back(new TreeNodeSampleDensityCalculator(_random, _Nrandom, _dd, _tree[begin+i]));
+            calcv[i] = samplev.back();
         }
+    }
+
+    // perform the calculations for all nodes in the batch, distributed over the threads and processes
+    BatchCalculator batch(samplev, _Nrandom, boxv);
+    size_t size = batch.size();
+    if (_comm->isMultiProc())
+    {
+        SequentialAssigner* assigner = new SequentialAssigner(size, this);
+        _parallel->call(&batch, assigner);
+
+        // share the results; each result is calculated by a single process, so the sum reproduces it exactly
+        Array resultv(size);
+        for (size_t k=0; k<size; k++) if (assigner->validIndex(k)) resultv[k] = batch.result(k);
+        _comm->sum_all(resultv);
+        for (size_t k=0; k<size; k++) if (!assigner->validIndex(k)) batch.setResult(k, resultv[k]);
+        delete assigner;
+    }
+    else
+    {
+        _parallel->call(&batch, size);
+    }
+
+    // evaluate the stopping criteria and subdivide the nodes in order
+    for (size_t i=0; i<Nnodes; i++)
+    {
+        TreeNode* node = _tree[begin+i];
+        TreeNodeDensityCalculator* calc = calcv[i];
 
         // if no stopping criteria are enabled, we keep subdividing indefinitely
         bool needDivision = (_maxOpticalDepth == 0 && _maxMassFraction == 0 && _maxDensDispFraction == 0);
@@ -333,37 +444,35 @@ double TreeDustGrid::volume(int m) const
 {
     if (m<0 || m>numCells())
         throw FATALERROR("Invalid cell number: " + QString::number(m));
-    TreeNode* node = getnode(m);
-    return node->xwidth() * node->ywidth() * node->zwidth();
+    return _lineartree->cellExtent(m).volume();
 }
 
 //////////////////////////////////////////////////////////////////////
 
 int TreeDustGrid::numCells() const
 {
-    return _idv.size();
+    return _lineartree->numCells();
 }
 
 //////////////////////////////////////////////////////////////////////
 
 int TreeDustGrid::whichcell(Position bfr) const
 {
-    const TreeNode* node = root()->whichnode(bfr);
-    return node ? cellnumber(node) : -1;
+    return _lineartree->cellIndex(bfr);
 }
 
 //////////////////////////////////////////////////////////////////////
 
 Position TreeDustGrid::centralPositionInCell(int m) const
 {
-    return Position(getnode(m)->extent().center());
+    return Position(_lineartree->cellExtent(m).center());
 }
 
 //////////////////////////////////////////////////////////////////////
 
 Position TreeDustGrid::randomPositionInCell(int m) const
 {
-    return _random->position(getnode(m)->extent());
+    return _random->position(_lineartree->cellExtent(m));
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -376,270 +485,78 @@ void TreeDustGrid::path(DustGridPath* path) const
     // If the photon package starts outside the dust grid, move it into the first grid cell that it will pass
     Position bfr = path->moveInside(extent(), _eps);
 
-    // Get the node containing the current location;
-    // if the position is not inside the grid, return an empty path
-    const TreeNode* node = root()->whichnode(bfr);
-    if (!node) return path->clear();
+    // Get the cell containing the current location, starting from the cell recorded in the path if it is known
+    // and it indeed contains the location; if the position is not inside the grid, return an empty path
+    int m = path->initialCell();
+    if (m < 0 || !_lineartree->cellExtent(m).contains(bfr)) m = _lineartree->cellIndex(bfr);
+    if (m < 0) return path->clear();
 
-    // Start the loop over nodes/path segments until we leave the grid.
-    // Use a different code segment depending on the search method.
+    // Start the loop over cells/path segments until we leave the grid.
+    // For the top-down search method, the next cell is always located starting from the root node;
+    // for the other search methods, it is located by following the rope for the wall being crossed.
     double x,y,z;
     bfr.cartesian(x,y,z);
     double kx,ky,kz;
     path->direction().cartesian(kx,ky,kz);
+    bool useRopes = _search != TopDown;
 
-    // ----------- Top-down -----------
-
-    if (_search == TopDown)
+    while (m >= 0)
     {
-        while (node)
+        const Box& cell = _lineartree->cellExtent(m);
+        double xnext = (kx<0.0) ? cell.xmin() : cell.xmax();
+        double ynext = (ky<0.0) ? cell.ymin() : cell.ymax();
+        double znext = (kz<0.0) ? cell.zmin() : cell.zmax();
+        double dsx = (fabs(kx)>1e-15) ? (xnext-x)/kx : DBL_MAX;
+        double dsy = (fabs(ky)>1e-15) ? (ynext-y)/ky : DBL_MAX;
+        double dsz = (fabs(kz)>1e-15) ? (znext-z)/kz : DBL_MAX;
+
+        double ds;
+        TreeNode::Wall wall;
+        if (dsx<=dsy && dsx<=dsz)
         {
-            double xnext = (kx<0.0) ? node->xmin() : node->xmax();
-            double ynext = (ky<0.0) ? node->ymin() : node->ymax();
-            double znext = (kz<0.0) ? node->zmin() : node->zmax();
-            double dsx = (fabs(kx)>1e-15) ? (xnext-x)/kx : DBL_MAX;
-            double dsy = (fabs(ky)>1e-15) ? (ynext-y)/ky : DBL_MAX;
-            double dsz = (fabs(kz)>1e-15) ? (znext-z)/kz : DBL_MAX;
-
-            double ds;
-            if (dsx<=dsy && dsx<=dsz) ds = dsx;
-            else if (dsy<=dsx && dsy<=dsz) ds = dsy;
-            else ds = dsz;
-            path->addSegment(cellnumber(node), ds);
-            x += (ds+_eps)*kx;
-            y += (ds+_eps)*ky;
-            z += (ds+_eps)*kz;
-
-            // always search from the root node down
-            const TreeNode* oldnode = node;
-            node = root()->whichnode(Vec(x,y,z));
-
-            // if we're stuck in the same node...
-            if (node==oldnode)
-            {
-                // try to escape by advancing the position to the next representable coordinates
-                find<Log>()->warning("Photon package seems stuck in dust cell "
-                                     + QString::number(node->id()) + " -- escaping");
-                x = nextafter(x, (kx<0.0) ? -DBL_MAX : DBL_MAX);
-                y = nextafter(y, (ky<0.0) ? -DBL_MAX : DBL_MAX);
-                z = nextafter(z, (kz<0.0) ? -DBL_MAX : DBL_MAX);
-                node = root()->whichnode(Vec(x,y,z));
-
-                // if that didn't work, terminate the path
-                if (node==oldnode)
-                {
-                    find<Log>()->warning("Photon package is stuck in dust cell "
-                                         + QString::number(node->id()) + " -- terminating this path");
-                    break;
-                }
-            }
+            ds = dsx;
+            wall = (kx<0.0) ? TreeNode::BACK : TreeNode::FRONT;
         }
-    }
-
-    // ----------- Neighbor -----------
-
-    else if (_search == Neighbor)
-    {
-        while (node)
+        else if (dsy<=dsx && dsy<=dsz)
         {
-            double xnext = (kx<0.0) ? node->xmin() : node->xmax();
-            double ynext = (ky<0.0) ? node->ymin() : node->ymax();
-            double znext = (kz<0.0) ? node->zmin() : node->zmax();
-            double dsx = (fabs(kx)>1e-15) ? (xnext-x)/kx : DBL_MAX;
-            double dsy = (fabs(ky)>1e-15) ? (ynext-y)/ky : DBL_MAX;
-            double dsz = (fabs(kz)>1e-15) ? (znext-z)/kz : DBL_MAX;
-
-            double ds;
-            TreeNode::Wall wall;
-            if (dsx<=dsy && dsx<=dsz)
-            {
-                ds = dsx;
-                wall = (kx<0.0) ? TreeNode::BACK : TreeNode::FRONT;
-            }
-            else if (dsy<=dsx && dsy<=dsz)
-            {
-                ds = dsy;
-                wall = (ky<0.0) ? TreeNode::LEFT : TreeNode::RIGHT;
-            }
-            else
-            {
-                ds = dsz;
-                wall = (kz<0.0) ? TreeNode::BOTTOM : TreeNode::TOP;
-            }
-            path->addSegment(cellnumber(node), ds);
-            x += (ds+_eps)*kx;
-            y += (ds+_eps)*ky;
-            z += (ds+_eps)*kz;
-
-            // attempt to find the new node among the neighbors of the current node;
-            // this should not fail unless the new location is outside the grid,
-            // however on rare occasions it fails due to rounding errors (e.g. in a corner),
-            // thus we use top-down search as a fall-back
-            const TreeNode* oldnode = node;
-            node = node->whichnode(wall, Vec(x,y,z));
-            if (!node) node = root()->whichnode(Vec(x,y,z));
-
-            // if we're stuck in the same node...
-            if (node==oldnode)
-            {
-                // try to escape by advancing the position to the next representable coordinates
-                find<Log>()->warning("Photon package seems stuck in dust cell "
-                                     + QString::number(node->id()) + " -- escaping");
-                x = nextafter(x, (kx<0.0) ? -DBL_MAX : DBL_MAX);
-                y = nextafter(y, (ky<0.0) ? -DBL_MAX : DBL_MAX);
-                z = nextafter(z, (kz<0.0) ? -DBL_MAX : DBL_MAX);
-                node = root()->whichnode(Vec(x,y,z));
-
-                // if that didn't work, terminate the path
-                if (node==oldnode)
-                {
-                    find<Log>()->warning("Photon package is stuck in dust cell "
-                                         + QString::number(node->id()) + " -- terminating this path");
-                    break;
-                }
-            }
+            ds = dsy;
+            wall = (ky<0.0) ? TreeNode::LEFT : TreeNode::RIGHT;
         }
-    }
-
-    // ----------- Bookkeeping -----------
-
-    // !! This code section relies on the fact that an octtree node is used !!
-
-    else if (_search == Bookkeeping)
-    {
-        int l = node->id();  // node index in the tree
-        while (true)
+        else
         {
-            double xnext = (kx<0.0) ? _tree[l]->xmin() : _tree[l]->xmax();
-            double ynext = (ky<0.0) ? _tree[l]->ymin() : _tree[l]->ymax();
-            double znext = (kz<0.0) ? _tree[l]->zmin() : _tree[l]->zmax();
-            double dsx = (fabs(kx)>1e-15) ? (xnext-x)/kx : DBL_MAX;
-            double dsy = (fabs(ky)>1e-15) ? (ynext-y)/ky : DBL_MAX;
-            double dsz = (fabs(kz)>1e-15) ? (znext-z)/kz : DBL_MAX;
-
-            // First option: the x-wall is hit first. After moving
-            // towards the boundary, we have to find the next cell. First we
-            // check whether the node is on the right or left side of his
-            // father node. If the movement is towards positive x (i.e. if
-            // kx>0) we move up in the tree until we find a node on the left
-            // side. The next cell will then be the corresponding right node
-            // (if it is a leaf) or one of its children. If we have to move
-            // up until we hit the root node, this means our path has ended.
-
-            if (dsx<=dsy && dsx<=dsz)
-            {
-                path->addSegment(_cellnumberv[l], dsx);
-                x = xnext;
-                y += ky*dsx;
-                z += kz*dsx;
-                while (true)
-                {
-                    int oct = ((l - 1) % 8) + 1;
-                    bool place = (kx<0.0) ? (oct % 2 == 1) : (oct % 2 == 0);
-                    if (!place) break;
-                    l = _tree[l]->father()->id();
-                    if (l == 0) return;
-                }
-                l += (kx<0.0) ? -1 : 1;
-                while (_cellnumberv[l] == -1)
-                {
-                    double yM = _tree[l]->child(0)->ymax();
-                    double zM = _tree[l]->child(0)->zmax();
-                    if (kx<0.0)
-                    {
-                        if (y<=yM)
-                            l = (z<=zM) ? _tree[l]->child(1)->id() : _tree[l]->child(5)->id();
-                        else
-                            l = (z<=zM) ? _tree[l]->child(3)->id() : _tree[l]->child(7)->id();
-                    }
-                    else
-                    {
-                        if (y<=yM)
-                            l = (z<=zM) ? _tree[l]->child(0)->id() : _tree[l]->child(4)->id();
-                        else
-                            l = (z<=zM) ? _tree[l]->child(2)->id() : _tree[l]->child(6)->id();
-                    }
-                }
-            }
-
-            // Repeat the same exercise, but now the y-wall is hit first...
-
-            else if (dsy<dsx && dsy<=dsz)
-            {
-                path->addSegment(_cellnumberv[l], dsy);
-                x += kx*dsy;
-                y  = ynext;
-                z += kz*dsy;
-                while (true)
-                {
-                    bool place = (ky<0.0) ? ((l-1) % 4 < 2) : ((l-1) % 4 > 1);
-                    if (!place) break;
-                    l = _tree[l]->father()->id();
-                    if (l == 0) return;
-                }
-                l += (ky<0.0) ? -2 : 2;
-                while (_cellnumberv[l] == -1)
-                {
-                    double xM = _tree[l]->child(0)->xmax();
-                    double zM = _tree[l]->child(0)->zmax();
-                    if (ky<0.0)
-                    {
-                        if (x<=xM)
-                            l = (z<=zM) ? _tree[l]->child(2)->id() : _tree[l]->child(6)->id();
-                        else
-                            l = (z<=zM) ? _tree[l]->child(3)->id() : _tree[l]->child(7)->id();
-                    }
-                    else
-                    {
-                        if (x<=xM)
-                            l = (z<=zM) ? _tree[l]->child(0)->id() : _tree[l]->child(4)->id();
-                        else
-                            l = (z<=zM) ? _tree[l]->child(1)->id() : _tree[l]->child(5)->id();
-                    }
-                }
-            }
-
-            // Finally, repeat the same exercise, but now the z-wall is hit first...
-
-            else if (dsz< dsx && dsz< dsy)
+            ds = dsz;
+            wall = (kz<0.0) ? TreeNode::BOTTOM : TreeNode::TOP;
+        }
+        path->addSegment(m, ds);
+        x += (ds+_eps)*kx;
+        y += (ds+_eps)*ky;
+        z += (ds+_eps)*kz;
+
+        // locate the new cell; the rope search falls back to a top-down search if the new position is
+        // not inside the rope's target, which may happen on rare occasions due to rounding errors
+        int oldm = m;
+        m = useRopes ? _lineartree->neighborCellIndex(m, wall, Vec(x,y,z)) : _lineartree->cellIndex(Vec(x,y,z));
+
+        // if we're stuck in the same cell...
+        if (m==oldm)
+        {
+            // try to escape by advancing the position to the next representable coordinates
+            find<Log>()->warning("Photon package seems stuck in dust cell "
+                                 + QString::number(m) + " -- escaping");
+            x = nextafter(x, (kx<0.0) ? -DBL_MAX : DBL_MAX);
+            y = nextafter(y, (ky<0.0) ? -DBL_MAX : DBL_MAX);
+            z = nextafter(z, (kz<0.0) ? -DBL_MAX : DBL_MAX);
+            m = _lineartree->cellIndex(Vec(x,y,z));
+
+            // if that didn't work, terminate the path
+            if (m==oldm)
             {
-                path->addSegment(_cellnumberv[l], dsz);
-                x += kx*dsz;
-                y += ky*dsz;
-                z  = znext;
-                while (true)
-                {
-                    int oct = ((l-1) % 8) + 1;
-                    bool place = (kz<0.0) ? (oct < 5) : (oct > 4);
-                    if (!place) break;
-                    l = _tree[l]->father()->id();
-                    if (l == 0) return;
-                }
-                l += (kz<0.0) ? -4 : 4;
-                while (_cellnumberv[l] == -1)
-                {
-                    double xM = _tree[l]->child(0)->xmax();
-                    double yM = _tree[l]->child(0)->ymax();
-                    if (kz<0.0)
-                    {
-                        if (x<=xM)
-                            l = (y<=yM) ? _tree[l]->child(4)->id() : _tree[l]->child(6)->id();
-                        else
-                            l = (y<=yM) ? _tree[l]->child(5)->id() : _tree[l]->child(7)->id();
-                    }
-                    else
-                    {
-                        if (x<=xM)
-                            l = (y<=yM) ? _tree[l]->child(0)->id() : _tree[l]->child(2)->id();
-                        else
-                            l = (y<=yM) ? _tree[l]->child(1)->id() : _tree[l]->child(3)->id();
-                    }
-                }
+                find<Log>()->warning("Photon package is stuck in dust cell "
+                                     + QString::number(m) + " -- terminating this path");
+                break;
             }
         }
     }
-
-    // ------------------------------
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -655,8 +572,24 @@ QList<SimulationItem*> TreeDustGrid::interfaceCandidates(const type_info &interf
 
 double TreeDustGrid::density(int h, int m) const
 {
-    TreeNode* node = getnode(m);
-    return _dmib->massInBox(h, node->extent()) / node->volume();
+    const Box& box = _lineartree->cellExtent(m);
+    return _dmib->massInBox(h, box) / box.volume();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TreeDustGrid::saveStructure(vector<char>& data) const
+{
+    _lineartree->serialize(data);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TreeDustGrid::loadStructure(const char* data, size_t size)
+{
+    delete _lineartree;
+    _lineartree = new LinearTree(data, size);
+    _Nnodes = _lineartree->numNodes();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -668,10 +601,10 @@ void TreeDustGrid::write_xy(DustGridPlotFile* outfile) const
     int Ncells = numCells();
     for (int m=0; m<Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (fabs(node->zmin()) < 1e-8*extent().zwidth())
+        const Box& node = _lineartree->cellExtent(m);
+        if (fabs(node.zmin()) < 1e-8*extent().zwidth())
         {
-            outfile->writeRectangle(node->xmin(), node->ymin(), node->xmax(), node->ymax());
+            outfile->writeRectangle(node.xmin(), node.ymin(), node.xmax(), node.ymax());
         }
     }
 }
@@ -685,10 +618,10 @@ void TreeDustGrid::write_xz(DustGridPlotFile* outfile) const
     int Ncells = numCells();
     for (int m=0; m<Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (fabs(node->ymin()) < 1e-8*extent().ywidth())
+        const Box& node = _lineartree->cellExtent(m);
+        if (fabs(node.ymin()) < 1e-8*extent().ywidth())
         {
-            outfile->writeRectangle(node->xmin(), node->zmin(), node->xmax(), node->zmax());
+            outfile->writeRectangle(node.xmin(), node.zmin(), node.xmax(), node.zmax());
         }
     }
 }
@@ -702,10 +635,10 @@ void TreeDustGrid::write_yz(DustGridPlotFile* outfile) const
     int Ncells = numCells();
     for (int m=0; m<Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (fabs(node->xmin()) < 1e-8*extent().xwidth())
+        const Box& node = _lineartree->cellExtent(m);
+        if (fabs(node.xmin()) < 1e-8*extent().xwidth())
         {
-            outfile->writeRectangle(node->ymin(), node->zmin(), node->ymax(), node->zmax());
+            outfile->writeRectangle(node.ymin(), node.zmin(), node.ymax(), node.zmax());
         }
     }
 }
@@ -718,31 +651,12 @@ void TreeDustGrid::write_xyz(DustGridPlotFile* outfile) const
     int Ncells = numCells();
     for (int m=0; m<Ncells; m++)
     {
-        TreeNode* node = getnode(m);
-        if (node->level() <= _highestWriteLevel)
-            outfile->writeCube(node->xmin(), node->ymin(), node->zmin(), node->xmax(), node->ymax(), node->zmax());
+        if (_lineartree->cellLevel(m) <= _highestWriteLevel)
+        {
+            const Box& node = _lineartree->cellExtent(m);
+            outfile->writeCube(node.xmin(), node.ymin(), node.zmin(), node.xmax(), node.ymax(), node.zmax());
+        }
     }
 }
 
 //////////////////////////////////////////////////////////////////////
-
-TreeNode* TreeDustGrid::root() const
-{
-    return _tree[0];
-}
-
-//////////////////////////////////////////////////////////////////////
-
-TreeNode* TreeDustGrid::getnode(int m) const
-{
-    return _tree[_idv[m]];
-}
-
-//////////////////////////////////////////////////////////////////////
-
-int TreeDustGrid::cellnumber(const TreeNode* node) const
-{
-    return _cellnumberv[node->id()];
-}
-
-//////////////////////////////////////////////////////////////////////
@@ -8,11 +8,14 @@
 
 #include "BoxDustGrid.hpp"
 #include "DustGridDensityInterface.hpp"
+#include "DustGridStructureInterface.hpp"
 #include "DustMassInBoxInterface.hpp"
 #include "Random.hpp"
 class DustDistribution;
+class LinearTree;
 class TreeNode;
 class Parallel;
+class PeerToPeerCommunicator;
 class ProcessAssigner;
 
 //////////////////////////////////////////////////////////////////////
@@ -24,8 +27,12 @@ class ProcessAssigner;
     subdivided) are the actual dust cells. The type of TreeNode used by the TreeDustGrid
     is decided in each subclass through a factory method. Depending on the type of TreeNode, the
     tree can become an octtree (8 children per node) or a kd-tree (2 children per node). Other node
-    types could be implemented, as long as they are cuboids lined up with the axes. */
-class TreeDustGrid : public BoxDustGrid, public DustGridDensityInterface
+    types could be implemented, as long as they are cuboids lined up with the axes. Once the tree
+    has been constructed, it is converted to a compact LinearTree representation, which is used for
+    all further operations, and the TreeNode objects are deleted. The linear representation can be
+    saved to and restored from the dust grid cache through the DustGridStructureInterface, in which
+    case the construction is skipped altogether. */
+class TreeDustGrid : public BoxDustGrid, public DustGridDensityInterface, public DustGridStructureInterface
 {
     Q_OBJECT
     Q_CLASSINFO("Title", "a tree dust grid")
@@ -45,8 +52,8 @@ class TreeDustGrid : public BoxDustGrid, public DustGridDensityInterface
     Q_CLASSINFO("Property", "searchMethod")
     Q_CLASSINFO("Title", "the search method used for traversing the tree grid")
     Q_CLASSINFO("TopDown", "top-down (start at root and recursively find appropriate child node)")
-    Q_CLASSINFO("Neighbor", "neighbor (construct and use neighbor list for each node wall) ")
-    Q_CLASSINFO("Bookkeeping", "bookkeeping (derive appropriate neighbor through node indices)")
+    Q_CLASSINFO("Neighbor", "neighbor (follow the rope for the node wall through which the path leaves)")
+    Q_CLASSINFO("Bookkeeping", "bookkeeping (same as neighbor; retained for existing configurations)")
     Q_CLASSINFO("Default", "Neighbor")
 
     Q_CLASSINFO("Property", "sampleCount")
@@ -80,27 +87,37 @@ protected:
     TreeDustGrid();
 
 public:
-    /** The destructor deletes all nodes from the tree vector created during setup. */
+    /** The destructor deletes the linear tree representation created during setup, and any nodes
+        that may remain in the tree vector if setup was interrupted. */
     ~TreeDustGrid();
 
 protected:
     /** This function verifies that all attribute values have been appropriately set and actually
         constructs the tree. The first step is to create the root node (through the factory method
         createRoot() to be implemented in each subclass), and store it in the tree vector, which is
-        just a list of pointers to nodes). The second phase is to recursively subdivide the root
-        node and add the children at the end of the tree vector, until all nodes satisfy the
-        criteria for no further subdivision. When this task is accomplished, the function creates a
+        just a list of pointers to nodes). The second phase is to subdivide the nodes level by level
+        and add the children at the end of the tree vector, until all nodes satisfy the criteria
+        for no further subdivision. When this task is accomplished, the function creates a
         vector that contains the node IDs of all leaves. This is the actual dust cell vector (only
         the leaf nodes are the actual dust cells). The function also creates a vector with the cell
         numbers of all the nodes, i.e. the rank \f$m\f$ of the node in the ID vector if the node is
-        a leaf, and the number -1 if the node is not a leaf (and hence not a dust cell). Finally,
-        the function logs some details on the number of nodes and the number of cells, and if
-        writeFlag() returns true, it writes the distribution of the grid cells to a file. */
+        a leaf, and the number -1 if the node is not a leaf (and hence not a dust cell). The
+        function then logs some details on the number of nodes and the number of cells. Finally,
+        it converts the tree to a LinearTree, which stores the nodes in a single array together
+        with precomputed neighbor ropes, and deletes the TreeNode objects to release their
+        memory. If the linear tree has already been restored through the loadStructure()
+        function, the construction is skipped and only the cell statistics are logged. */
     void setupSelfBefore();
 
 private:
-    /** This function, only to be called during the construction phase, investigates whether a node
-        should be further subdivided and also takes care of the actual subdivision. There are
+    /** This function, only to be called from setupSelfBefore(), performs the actual construction
+        of the tree as described for that function, ending with the conversion to a LinearTree. */
+    void constructTree();
+
+private:
+    /** This function, only to be called during the construction phase, investigates whether the
+        nodes in the specified range of the tree vector should be further subdivided and also takes
+        care of the actual subdivision. All nodes in the range must be at the same level. There are
         several criteria for subdivision. The simplest criterion is the level of subdivision of the
         node: if it is less then a minimum level, the node is always subdivided, if it higher then
         a maximum level, there is no subdivision (these levels are input parameters). In the
@@ -120,8 +137,14 @@ private:
         \f] In the latter case the division point is the centre of mass, which we estimate using
         the \f$N_{\text{random}}\f$ points generated before, \f[ {\bf{r}}_c = \frac{ \sum_n
         \rho({\bf{r}}_n)\, {\bf{r}}_n}{ \sum_n \rho({\bf{r}}_n) }. \f] The last task is to actually
-        create the eight child nodes of the node and add them to the tree. */
-    void subdivide(TreeNode* node);
+        create the eight child nodes of the node and add them to the tree.
+
+        The density calculations for all nodes in the range are performed before any of the nodes
+        is subdivided, distributing the work over all parallel threads and, in multiprocessing
+        mode, over all processes. The random positions are generated in the order of the nodes,
+        and the nodes are subdivided in that same order, so that the resulting tree does not
+        depend on the number of nodes in a range, nor on the number of threads or processes. */
+    void subdivide(size_t begin, size_t end);
 
     //======== Setters & Getters for Discoverable Attributes =======
 
@@ -139,12 +162,13 @@ public:
     Q_INVOKABLE int maxLevel() const;
 
     /** The enumeration type indicating the search method to be used for finding the subsequent
-        node while traversing the tree grid. The TopDown method (the default) always starts at the
-        root node and recursively finds the child node containing the new position. The Neighbor
-        method constructs a neighbor list for each node (at each of the six walls) during setup,
-        and then uses this list to locate the neighboring node containing the new position. The
-        Bookkeeping method relies on the order in which the occtree nodes are created and stored to
-        derive the appropriate neighbor solely through the respective node indices. */
+        node while traversing the tree grid. The TopDown method always starts at the root node and
+        descends to the child node containing the new position. The Neighbor method (the default)
+        follows the rope stored for the wall through which the path leaves the current node, and
+        descends from the rope's target node to the node containing the new position (see
+        LinearTree). The Bookkeeping method originally derived the appropriate neighbor from the
+        order in which the octree nodes were created; since the ropes offer the same information
+        for any type of tree, it is now equivalent to the Neighbor method. */
     Q_ENUMS(SearchMethod)
     enum SearchMethod { TopDown, Neighbor, Bookkeeping };
 
@@ -202,7 +226,8 @@ public:
     /** This function returns the number of the dust cell that contains the position
         \f${\bf{r}}\f$. For a tree dust grid, the search algorithm starts at the root node and
         selects the child node that contains the position. This procedure is repeated until the
-        node is childless, i.e. until it is a leaf node that corresponds to an actual dust cell. */
+        node is childless, i.e. until it is a leaf node that corresponds to an actual dust cell.
+        The search operates on the linear tree representation, so it doesn't chase pointers. */
     int whichcell(Position bfr) const;
 
     /** This function returns the central location of the dust cell with cell number \f$m\f$. For a
@@ -234,7 +259,13 @@ public:
         small extra bit, we ensure that the new position is now within the next cell, and we can
         repeat this exercise. This loop is terminated when the next position is outside the dust
         grid. To determine the cell numbers in this algorithm, the function uses the method
-        configured with setSearchMethod(). */
+        configured with setSearchMethod(): for the TopDown method it searches the linear tree from
+        the root node, and for the other methods it follows the rope for the wall being crossed.
+        If the path knows the cell containing the starting position (see
+        DustGridPath::initialCell()), for example because the starting position was obtained by
+        propagating a photon package along a previous path, the function verifies that the
+        corresponding node indeed contains the starting position and then skips the top-down
+        search for the initial node. */
     void path(DustGridPath* path) const;
 
     /** This function is used by the interface() template function in the SimulationItem class. It
@@ -251,6 +282,15 @@ public:
         on the DustMassInBoxInterface interface in the dust distribution for this simulation. */
     double density(int h, int m) const;
 
+    /** This function implements the DustGridStructureInterface interface. It appends the binary
+        representation of the linear tree to the specified vector. */
+    void saveStructure(std::vector<char>& data) const;
+
+    /** This function implements the DustGridStructureInterface interface. It restores the linear
+        tree from the specified binary representation, so that the subsequent setup does not need
+        to construct the tree. */
+    void loadStructure(const char* data, size_t size);
+
 protected:
     /** This function writes the intersection of the dust grid with the xy plane to the specified
         DustGridPlotFile object. */
@@ -270,20 +310,6 @@ protected:
         */
     void write_xyz(DustGridPlotFile* outfile) const;
 
-private:
-    /** This function returns a pointer to the root node of the tree. */
-    TreeNode* root() const;
-
-    /** This function returns a pointer to the node corresponding to cell number \f$m\f$. It just
-        reads the node ID number of the \f$m\f$'th leave cell and returns the corresponding pointer
-        of the tree vector. */
-    TreeNode* getnode(int m) const;
-
-    /** This function returns the cell number \f$m\f$ of a node in the tree. It just reads the ID
-        of the node and determines the corresponding cell number from the internal cell number
-        vector. */
-    int cellnumber(const TreeNode* node) const;
-
 protected:
     /** This pure virtual function, to be implemented in each subclass, creates a root node of the
         appropriate type, using a node identifier of zero and the specified spatial extent, and
@@ -307,6 +333,7 @@ private:
     // data members initialized during setup
     Random* _random;
     Parallel* _parallel;
+    PeerToPeerCommunicator* _comm;
     DustDistribution* _dd;
     DustMassInBoxInterface* _dmib;
     double _totalmass;
@@ -315,6 +342,7 @@ private:
     std::vector<TreeNode*> _tree;
     std::vector<int> _cellnumberv;
     std::vector<int> _idv;
+    LinearTree* _lineartree;
     int _highestWriteLevel;
 
 protected:
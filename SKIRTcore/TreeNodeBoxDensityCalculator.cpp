@@ -39,6 +39,13 @@ double TreeNodeBoxDensityCalculator::mass() const
 
 //////////////////////////////////////////////////////////////////////
 
+void TreeNodeBoxDensityCalculator::setMass(double mass)
+{
+    _mass = mass;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 Vec TreeNodeBoxDensityCalculator::barycenter() const
 {
     throw FATALERROR("Calculation is not supported");
@@ -32,6 +32,11 @@ public:
     /** This function returns the dust mass in the cell. */
     double mass() const;
 
+    /** This function stores the specified value as the dust mass in the cell, so that it is not
+        recalculated by the mass() function. It allows the mass of the cell to be calculated by
+        another process. */
+    void setMass(double mass);
+
     /** This function throws a fatal error since the barycenter can't be calculated. */
     Vec barycenter() const;
 
@@ -19,18 +19,32 @@ TreeNodeSampleDensityCalculator::TreeNodeSampleDensityCalculator(
     : _rv(Nrandom), _rhov(Nrandom),
       _extent(node->extent()), _Nrandom(Nrandom), _random(random), _dd(dd)
 {
+    _random->position(_extent, _rv);
 }
 
 //////////////////////////////////////////////////////////////////////
 
 void TreeNodeSampleDensityCalculator::body(size_t n)
 {
-    _rv[n] = _random->position(_extent);
     _rhov[n] = _dd->density(_rv[n]);
 }
 
 //////////////////////////////////////////////////////////////////////
 
+double TreeNodeSampleDensityCalculator::density(size_t n) const
+{
+    return _rhov[n];
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TreeNodeSampleDensityCalculator::setDensity(size_t n, double rho)
+{
+    _rhov[n] = rho;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double TreeNodeSampleDensityCalculator::volume() const
 {
     return _extent.volume();
@@ -29,10 +29,10 @@ public:
     /** The arguments to this constructor are: the simulation's random generator; the number of
         density samples to be taken, the dust distribution object from which to obtain the dust
         density information, and the tree node for which to calculate the density-related
-        properties. This constructor does not perform any calculations; it just copies a reference
-        to the provided arguments and caches some additional information. The actual density
-        sampling happens in the function body() which is designed for use as the body in a parallel
-        loop. */
+        properties. This constructor copies a reference to the provided arguments, caches some
+        additional information, and generates all random sample positions in a single batch. The
+        actual density sampling happens in the function body() which is designed for use as the body
+        in a parallel loop. */
     TreeNodeSampleDensityCalculator(Random* random, int Nrandom, DustDistribution* dd, TreeNode* node);
 
     /** This function calculates and stores the density in the random point with index n. The
@@ -41,6 +41,15 @@ public:
         the other functions in this class. */
     void body(size_t n);
 
+    /** This function returns the density in the random point with index n, as calculated by the
+        body() function. */
+    double density(size_t n) const;
+
+    /** This function stores the specified value as the density in the random point with index n,
+        replacing the invocation of the body() function for that index. It allows the density
+        samples to be calculated by another process. */
+    void setDensity(size_t n, double rho);
+
     /** This function calculates and returns the volume of the cell. */
     double volume() const;
 
@@ -6,6 +6,7 @@
 #include "DustDistribution.hpp"
 #include "DustGridPlotFile.hpp"
 #include "DustParticleInterface.hpp"
+#include "FaceIntersection.hpp"
 #include "FatalError.hpp"
 #include "Log.hpp"
 #include "Random.hpp"
@@ -21,7 +22,8 @@ using namespace std;
 //////////////////////////////////////////////////////////////////////
 
 VoronoiDustGrid::VoronoiDustGrid()
-    : _numParticles(0), _distribution(DustDensity), _meshfile(0), _random(0), _mesh(0), _meshOwned(true)
+    : _numParticles(0), _distribution(DustDensity), _meshfile(0), _storeFacePlanes(false),
+      _random(0), _mesh(0), _meshOwned(true)
 {
 }
 
@@ -136,6 +138,15 @@ void VoronoiDustGrid::setupSelfBefore()
         throw FATALERROR("Unknown distribution type");
     }
 
+    // If requested, precompute the face planes for use by the path() function
+    if (_storeFacePlanes)
+    {
+        log->info("Precomputing the face planes for the Voronoi cells...");
+        _mesh->calculateFacePlanes();
+        log->info("Using the " + QString(FaceIntersection::name(FaceIntersection::instructionSet()))
+                  + " kernel for the face intersections");
+    }
+
     int Ncells = _mesh->Ncells();
 
     // Log statistics on the cell neighbors
@@ -171,6 +182,10 @@ void VoronoiDustGrid::setupSelfBefore()
     log->info("  Minimum number of cells per tree : " + QString::number(minRefsPerTree));
     log->info("  Maximum number of cells per tree : " + QString::number(maxRefsPerTree));
 
+    // Log the memory usage of the mesh
+    log->info("Voronoi mesh memory usage: " + QString::number(_mesh->memoryUsage()/1e6,'f',1) + " MB"
+              + (_storeFacePlanes ? " (including face planes)" : ""));
+
     // If requested, output the plot files (we have to reconstruct the Voronoi tesselation...)
     if (writeGrid())
     {
@@ -264,6 +279,20 @@ VoronoiMeshFile* VoronoiDustGrid::voronoiMeshFile() const
 
 //////////////////////////////////////////////////////////////////////
 
+void VoronoiDustGrid::setStoreFacePlanes(bool value)
+{
+    _storeFacePlanes = value;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool VoronoiDustGrid::storeFacePlanes() const
+{
+    return _storeFacePlanes;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 double VoronoiDustGrid::volume(int m) const
 {
     return _mesh->volume(m);
@@ -50,6 +50,11 @@ class VoronoiDustGrid : public BoxDustGrid
     Q_CLASSINFO("Default", "VoronoiMeshAsciiFile")
     Q_CLASSINFO("RelevantIf", "distribution")
 
+    Q_CLASSINFO("Property", "storeFacePlanes")
+    Q_CLASSINFO("Title", "precompute the cell face planes (faster paths, but more memory)")
+    Q_CLASSINFO("Default", "no")
+    Q_CLASSINFO("Silent", "true")
+
     //============= Construction - Setup - Destruction =============
 
 public:
@@ -68,7 +73,9 @@ protected:
         domain using a three-dimensional cuboidal cell structure, called the foam. The distribution
         of the foam cells is determined automatically from the dust density distribution. The foam
         allows to efficiently generate random points drawn from this probability distribution. Once
-        the particles have been generated, the foam is discarded. */
+        the particles have been generated, the foam is discarded. If requested, the function asks
+        the mesh to precompute the face planes used for path calculation. Finally, it logs
+        statistics on the mesh, including an estimate of its memory usage. */
     void setupSelfBefore();
 
     //======== Setters & Getters for Discoverable Attributes =======
@@ -101,6 +108,16 @@ public:
         value \em File. */
     Q_INVOKABLE VoronoiMeshFile* voronoiMeshFile() const;
 
+    /** Sets the flag indicating whether the bisecting planes for the faces of the Voronoi cells are
+        precomputed and stored (see VoronoiMesh::calculateFacePlanes()). This accelerates the
+        calculation of paths through the grid at the cost of some 32 bytes of memory per face. The
+        default value is false. */
+    Q_INVOKABLE void setStoreFacePlanes(bool value);
+
+    /** Returns the flag indicating whether the bisecting planes for the faces of the Voronoi cells
+        are precomputed and stored. */
+    Q_INVOKABLE bool storeFacePlanes() const;
+
     //======================== Other Functions =======================
 
 public:
@@ -134,6 +151,7 @@ private:
     int _numParticles;
     Distribution _distribution;
     VoronoiMeshFile* _meshfile;
+    bool _storeFacePlanes;
 
     // data members initialized during setup
     Random* _random;
@@ -7,6 +7,7 @@
 #include <cmath>
 #include "DustGridPath.hpp"
 #include "DustParticleInterface.hpp"
+#include "FaceIntersection.hpp"
 #include "Log.hpp"
 #include "VoronoiMesh.hpp"
 #include "VoronoiMeshFile.hpp"
@@ -20,58 +21,30 @@ using namespace std;
 
 namespace VoronoiMesh_Private
 {
-    // class to hold the information about a Voronoi cell that is relevant for calculating paths and densities
-    class VoronoiCell : public Box  // enclosing box
+    // class to access the particle coordinates, which are stored by the mesh in separate arrays
+    class Particles
     {
     private:
-        Vec _r;                     // particle position
-        Vec _c;                     // centroid position
-        double _volume;             // volume
-        vector<int> _neighbors;     // list of neighbor indices in cells vector
+        const double* _x;
+        const double* _y;
+        const double* _z;
 
     public:
-        // constructor stores the specified particle position; the other data members are set to zero
-        VoronoiCell(Vec r) : _r(r), _volume(0) { }
+        // constructor copies pointers to the coordinate arrays
+        Particles(const vector<double>& x, const vector<double>& y, const vector<double>& z)
+            : _x(x.data()), _y(y.data()), _z(z.data()) { }
 
-        // initializes the receiver with information taken from the specified fully computed Voronoi cell
-        void init(voro::voronoicell_neighbor& cell)
-        {
-            // copy basic geometric info
-            double cx, cy, cz;
-            cell.centroid(cx,cy,cz);
-            _c = Vec(cx,cy,cz) + _r;
-            _volume = cell.volume();
-
-            // get the minimal and maximal coordinates of the box enclosing the cell
-            vector<double> coords;
-            cell.vertices(_r.x(),_r.y(),_r.z(), coords);
-            _xmin = DBL_MAX;  _ymin = DBL_MAX;  _zmin = DBL_MAX;
-            _xmax = -DBL_MAX; _ymax = -DBL_MAX; _zmax = -DBL_MAX;
-            int n = coords.size();
-            for (int i=0; i<n; i+=3)
-            {
-                _xmin = min(_xmin,coords[i]); _ymin = min(_ymin,coords[i+1]); _zmin = min(_zmin,coords[i+2]);
-                _xmax = max(_xmax,coords[i]); _ymax = max(_ymax,coords[i+1]); _zmax = max(_zmax,coords[i+2]);
-            }
+        // returns the position of the particle with index m
+        Vec operator[](int m) const { return Vec(_x[m],_y[m],_z[m]); }
 
-            // copy a list of neighboring cell/particle ids
-            cell.neighbors(_neighbors);
+        // returns the squared distance from the particle with index m to the specified point
+        double squaredDistanceTo(int m, Vec r) const
+        {
+            double dx = r.x()-_x[m];
+            double dy = r.y()-_y[m];
+            double dz = r.z()-_z[m];
+            return dx*dx + dy*dy + dz*dz;
         }
-
-        // returns the cell's particle position
-        Vec particle() const { return _r; }
-
-        // returns the squared distance from the cell's particle to the specified point
-        double squaredDistanceTo(Vec r) const { return (r-_r).norm2(); }
-
-        // returns the central position in the cell
-        Vec centroid() const { return _c; }
-
-        // returns the volume of the cell; overriding volume() function of Box bas class
-        double volume() const { return _volume; }
-
-        // returns a list of neighboring cell/particle ids
-        const vector<int>& neighbors() { return _neighbors; }
     };
 
     // function to compare two points according to the specified axis (0,1,2)
@@ -109,7 +82,7 @@ namespace VoronoiMesh_Private
     class Node
     {
     private:
-        int _m;         // index in _cells to the particle defining the split at this node
+        int _m;         // index of the particle defining the split at this node
         int _axis;      // split axis for this node (0,1,2)
         Node* _up;      // ptr to the parent node
         Node* _left;    // ptr to the left child node
@@ -139,44 +112,44 @@ namespace VoronoiMesh_Private
         Node* right() const { return _right; }
 
         // returns the apropriate child for the specified query point
-        Node* child(Vec bfr, const vector<VoronoiCell*>& cells) const
-            { return lessthan(bfr, cells[_m]->particle(), _axis) ? _left : _right; }
+        Node* child(Vec bfr, const Particles& particles) const
+            { return lessthan(bfr, particles[_m], _axis) ? _left : _right; }
 
         // returns the other child than the one that would be apropriate for the specified query point
-        Node* otherChild(Vec bfr, const vector<VoronoiCell*>& cells) const
-            { return lessthan(bfr, cells[_m]->particle(), _axis) ? _right : _left; }
+        Node* otherChild(Vec bfr, const Particles& particles) const
+            { return lessthan(bfr, particles[_m], _axis) ? _right : _left; }
 
         // returns the squared distance from the query point to the split plane
-        double squaredDistanceToSplitPlane(Vec bfr, const vector<VoronoiCell*>& cells) const
+        double squaredDistanceToSplitPlane(Vec bfr, const Particles& particles) const
         {
             switch (_axis)
             {
             case 0:  // split on x
-                return sqr(cells[_m]->particle().x() - bfr.x());
+                return sqr(particles[_m].x() - bfr.x());
             case 1:  // split on y
-                return sqr(cells[_m]->particle().y() - bfr.y());
+                return sqr(particles[_m].y() - bfr.y());
             case 2:  // split on z
-                return sqr(cells[_m]->particle().z() - bfr.z());
+                return sqr(particles[_m].z() - bfr.z());
             default: // this should never happen
                 return 0;
             }
         }
 
         // returns the node in this subtree that represents the particle nearest to the query point
-        Node* nearest(Vec bfr, const vector<VoronoiCell*>& cells)
+        Node* nearest(Vec bfr, const Particles& particles)
         {
             // recursively descend the tree until a leaf node is reached, going left or right depending on
             // whether the specified point is less than or greater than the current node in the split dimension
             Node* current = this;
-            while (Node* child = current->child(bfr, cells)) current = child;
+            while (Node* child = current->child(bfr, particles)) current = child;
 
             // unwind the recursion, looking for the nearest node while climbing up
             Node* best = current;
-            double bestSD = cells[best->m()]->squaredDistanceTo(bfr);
+            double bestSD = particles.squaredDistanceTo(best->m(), bfr);
             while (true)
             {
                 // if the current node is closer than the current best, then it becomes the current best
-                double currentSD = cells[current->m()]->squaredDistanceTo(bfr);
+                double currentSD = particles.squaredDistanceTo(current->m(), bfr);
                 if (currentSD < bestSD)
                 {
                     best = current;
@@ -185,16 +158,16 @@ namespace VoronoiMesh_Private
 
                 // if there could be points on the other side of the splitting plane for the current node
                 // that are closer to the search point than the current best, then ...
-                double splitSD = current->squaredDistanceToSplitPlane(bfr, cells);
+                double splitSD = current->squaredDistanceToSplitPlane(bfr, particles);
                 if (splitSD < bestSD)
                 {
                     // move down the other branch of the tree from the current node looking for closer points,
                     // following the same recursive process as the entire search
-                    Node* other = current->otherChild(bfr, cells);
+                    Node* other = current->otherChild(bfr, particles);
                     if (other)
                     {
-                        Node* otherBest = other->nearest(bfr, cells);
-                        double otherBestSD = cells[otherBest->m()]->squaredDistanceTo(bfr);
+                        Node* otherBest = other->nearest(bfr, particles);
+                        double otherBestSD = particles.squaredDistanceTo(otherBest->m(), bfr);
                         if (otherBestSD < bestSD)
                         {
                             best = otherBest;
@@ -335,11 +308,16 @@ void VoronoiMesh::buildMesh(const std::vector<Vec>& particles, bool removeNearby
     _nb2 = _nb*_nb;
     _nb3 = _nb*_nb*_nb;
 
-    // Initialize the vector that will hold pointers to the cell objects that will stay around,
-    // using the serial number of the cell as index in the vector
-    _cells.resize(_Ncells);
+    // Initialize the arrays that will hold the cell information that will stay around,
+    // using the serial number of the cell as index in the arrays
+    _px.resize(_Ncells);
+    _py.resize(_Ncells);
+    _pz.resize(_Ncells);
+    _boxes.resize(_Ncells);
+    _centroids.resize(_Ncells);
+    _volumes.resize(_Ncells);
 
-    // Add the specified particles to our cell vector AND to a temporary Voronoi container,
+    // Add the specified particles to our particle arrays AND to a temporary Voronoi container,
     // using the serial number of the cell as particle ID
     voro::container con(_extent.xmin(), _extent.xmax(), _extent.ymin(), _extent.ymax(), _extent.zmin(), _extent.zmax(),
                         _nb, _nb, _nb, false,false,false, 8);
@@ -349,12 +327,17 @@ void VoronoiMesh::buildMesh(const std::vector<Vec>& particles, bool removeNearby
         if (indices[i]>=0)                               // skip particles that were tagged for removal
         {
             Vec r = particles[indices[i]];
-            _cells[m] = new VoronoiCell(r);     // these objects will be deleted by the destructor
+            _px[m] = r.x();
+            _py[m] = r.y();
+            _pz[m] = r.z();
             con.put(m, r.x(),r.y(),r.z());
             m++;
         }
     }
 
+    // The neighbor lists are temporarily stored per cell because Voro++ computes the cells in arbitrary order
+    vector< vector<int> > neighborsv(_Ncells);
+
     // Initialize a vector of nb x nb x nb lists, each containing the cells overlapping a certain block in the domain
     _blocklists.resize(_nb3);
 
@@ -374,15 +357,37 @@ void VoronoiMesh::buildMesh(const std::vector<Vec>& particles, bool removeNearby
         bool ok = con.compute_cell(fullcell, loop);
         if (!ok) throw FATALERROR("Can't compute Voronoi cell");
 
-        // Copy all relevant information to the cell object that will stay around
-        VoronoiCell* cell = _cells[loop.pid()];
-        cell->init(fullcell);
+        // Copy all relevant information to the arrays that will stay around
+        int m = loop.pid();
+        Vec r(_px[m],_py[m],_pz[m]);
+
+        // --> basic geometric info
+        double cx, cy, cz;
+        fullcell.centroid(cx,cy,cz);
+        _centroids[m] = Vec(cx,cy,cz) + r;
+        _volumes[m] = fullcell.volume();
+
+        // --> the minimal and maximal coordinates of the box enclosing the cell
+        vector<double> coords;
+        fullcell.vertices(r.x(),r.y(),r.z(), coords);
+        double xmin = DBL_MAX;  double ymin = DBL_MAX;  double zmin = DBL_MAX;
+        double xmax = -DBL_MAX; double ymax = -DBL_MAX; double zmax = -DBL_MAX;
+        int n = coords.size();
+        for (int i=0; i<n; i+=3)
+        {
+            xmin = min(xmin,coords[i]); ymin = min(ymin,coords[i+1]); zmin = min(zmin,coords[i+2]);
+            xmax = max(xmax,coords[i]); ymax = max(ymax,coords[i+1]); zmax = max(zmax,coords[i+2]);
+        }
+        _boxes[m] = Box(xmin,ymin,zmin, xmax,ymax,zmax);
+
+        // --> the list of neighboring cell/particle ids
+        fullcell.neighbors(neighborsv[m]);
 
-        // Add the cell object to the lists for all blocks it may overlap
+        // Add the cell to the lists for all blocks it may overlap
         // --> a precise intersection test is really slow and doesn't substantially accelerate whichcell()
         int i1,j1,k1, i2,j2,k2;
-        _extent.cellindices(i1,j1,k1, cell->rmin()-Vec(_eps,_eps,_eps), _nb,_nb,_nb);
-        _extent.cellindices(i2,j2,k2, cell->rmax()+Vec(_eps,_eps,_eps), _nb,_nb,_nb);
+        _extent.cellindices(i1,j1,k1, _boxes[m].rmin()-Vec(_eps,_eps,_eps), _nb,_nb,_nb);
+        _extent.cellindices(i2,j2,k2, _boxes[m].rmax()+Vec(_eps,_eps,_eps), _nb,_nb,_nb);
         for (int i=i1; i<=i2; i++)
             for (int j=j1; j<=j2; j++)
                 for (int k=k1; k<=k2; k++)
@@ -391,6 +396,20 @@ void VoronoiMesh::buildMesh(const std::vector<Vec>& particles, bool removeNearby
     }
     while (loop.inc());
 
+    // Concatenate the neighbor lists into a single array in compressed row storage format,
+    // releasing the temporary per-cell lists as we go
+    _firstNeighbors.resize(_Ncells+1);
+    size_t totalNeighbors = 0;
+    for (int m=0; m<_Ncells; m++) totalNeighbors += neighborsv[m].size();
+    _neighbors.reserve(totalNeighbors);
+    for (int m=0; m<_Ncells; m++)
+    {
+        _firstNeighbors[m] = _neighbors.size();
+        _neighbors.insert(_neighbors.end(), neighborsv[m].begin(), neighborsv[m].end());
+        vector<int>().swap(neighborsv[m]);
+    }
+    _firstNeighbors[_Ncells] = _neighbors.size();
+
     // for each block that contains more than a predefined number of cells,
     // construct a search tree on the particle locations of the cells
     _blocktrees.resize(_nb3);
@@ -412,8 +431,9 @@ Node* VoronoiMesh::buildTree(vector<int>::iterator first, vector<int>::iterator
     if (length>0)
     {
         auto median = length >> 1;
-        std::nth_element(first, first+median, last, [this, depth] (int m1, int m2)
-                            { return m1!=m2 && lessthan(_cells[m1]->particle(), _cells[m2]->particle(), depth%3); });
+        Particles particles(_px,_py,_pz);
+        std::nth_element(first, first+median, last, [&particles, depth] (int m1, int m2)
+                            { return m1!=m2 && lessthan(particles[m1], particles[m2], depth%3); });
         return new Node(*(first+median), depth,
                         buildTree(first, first+median, depth+1),
                         buildTree(first+median+1, last, depth+1));
@@ -447,7 +467,7 @@ void VoronoiMesh::addDensityDistribution(int densityField, int densityMultiplier
     {
         double density = _fieldvalues[densityField][m] * densityFraction;
         if (densityMultiplierField >= 0) density *= _fieldvalues[densityMultiplierField][m];
-        if (density > 0) integratedDensity += density*_cells[m]->volume();
+        if (density > 0) integratedDensity += density*_volumes[m];
     }
     _integratedDensityv.push_back(integratedDensity);
     _integratedDensity += integratedDensity;
@@ -457,7 +477,6 @@ void VoronoiMesh::addDensityDistribution(int densityField, int densityMultiplier
 
 VoronoiMesh::~VoronoiMesh()
 {
-    for (int m=0; m<_Ncells; m++) delete _cells[m];
     for (int b=0; b<_nb3; b++) delete _blocktrees[b];
 }
 
@@ -477,7 +496,7 @@ void VoronoiMesh::neighborStatistics(double &average, int &minimum, int &maximum
     qint64 totalNeighbors = 0;
     for (int m=0; m<_Ncells; m++)
     {
-        int ns = _cells[m]->neighbors().size();
+        int ns = _firstNeighbors[m+1] - _firstNeighbors[m];
         totalNeighbors += ns;
         minNeighbors = min(minNeighbors, ns);
         maxNeighbors = max(maxNeighbors, ns);
@@ -489,6 +508,82 @@ void VoronoiMesh::neighborStatistics(double &average, int &minimum, int &maximum
 
 ////////////////////////////////////////////////////////////////////
 
+void VoronoiMesh::calculateFacePlanes()
+{
+    if (!_fd.empty()) return;
+
+    size_t totalNeighbors = _neighbors.size();
+    _fnx.resize(totalNeighbors);
+    _fny.resize(totalNeighbors);
+    _fnz.resize(totalNeighbors);
+    _fd.resize(totalNeighbors);
+
+    for (int mr=0; mr<_Ncells; mr++)
+    {
+        Vec pr(_px[mr],_py[mr],_pz[mr]);
+        for (int i=_firstNeighbors[mr]; i<_firstNeighbors[mr+1]; i++)
+        {
+            int mi = _neighbors[i];
+            Vec n;
+            double d = 0;
+
+            // --- bisecting plane with neighboring cell
+            if (mi>=0)
+            {
+                Vec pi(_px[mi],_py[mi],_pz[mi]);
+                n = pi - pr;
+                d = Vec::dot(n, 0.5 * (pi + pr));
+            }
+
+            // --- domain wall
+            else
+            {
+                switch (mi)
+                {
+                case -1: n = Vec(-1,0,0); d = -_extent.xmin(); break;
+                case -2: n = Vec( 1,0,0); d =  _extent.xmax(); break;
+                case -3: n = Vec(0,-1,0); d = -_extent.ymin(); break;
+                case -4: n = Vec(0, 1,0); d =  _extent.ymax(); break;
+                case -5: n = Vec(0,0,-1); d = -_extent.zmin(); break;
+                case -6: n = Vec(0,0, 1); d =  _extent.zmax(); break;
+                default: throw FATALERROR("Invalid neighbor ID");
+                }
+            }
+
+            _fnx[i] = n.x();
+            _fny[i] = n.y();
+            _fnz[i] = n.z();
+            _fd[i] = d;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t VoronoiMesh::memoryUsage() const
+{
+    // cell information
+    size_t bytes = 0;
+    bytes += (_px.size() + _py.size() + _pz.size() + _volumes.size()) * sizeof(double);
+    bytes += _boxes.size() * sizeof(Box) + _centroids.size() * sizeof(Vec);
+    bytes += (_firstNeighbors.size() + _neighbors.size()) * sizeof(int);
+    bytes += (_fnx.size() + _fny.size() + _fnz.size() + _fd.size()) * sizeof(double);
+
+    // field values
+    for (const vector<double>& values : _fieldvalues) bytes += values.size() * sizeof(double);
+
+    // block lists and search trees (one node per cell reference in a block with a tree)
+    for (int b = 0; b<_nb3; b++)
+    {
+        size_t refs = _blocklists[b].size();
+        bytes += sizeof(vector<int>) + refs * sizeof(int);
+        if (_blocktrees[b]) bytes += refs * sizeof(Node);
+    }
+    return bytes;
+}
+
+////////////////////////////////////////////////////////////////////
+
 int VoronoiMesh::Nblocks() const
 {
     return _nb;
@@ -550,7 +645,7 @@ int VoronoiMesh::cellIndex(Position bfr) const
 
     // look for the closest particle in this block, using the search tree if there is one
     Node* tree = _blocktrees[b];
-    if (tree) return tree->nearest(bfr,_cells)->m();
+    if (tree) return tree->nearest(bfr, Particles(_px,_py,_pz))->m();
 
     // if there is no search tree, simply loop over the index list
     const vector<int>& ids = _blocklists[b];
@@ -559,7 +654,7 @@ int VoronoiMesh::cellIndex(Position bfr) const
     int n = ids.size();
     for (int i=0; i<n; i++)
     {
-        double idist = _cells[ids[i]]->squaredDistanceTo(bfr);
+        double idist = squaredDistanceToParticle(ids[i], bfr);
         if (idist < mdist)
         {
             m = ids[i];
@@ -581,7 +676,7 @@ double VoronoiMesh::volume() const
 double VoronoiMesh::volume(int m) const
 {
     if (m < 0 || m >= _Ncells) throw FATALERROR("Cell index out of range: " + QString::number(m));
-    return _cells[m]->volume();
+    return _volumes[m];
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -596,7 +691,7 @@ Box VoronoiMesh::extent() const
 Box VoronoiMesh::extent(int m) const
 {
     if (m < 0 || m >= _Ncells) throw FATALERROR("Cell index out of range: " + QString::number(m));
-    return _cells[m]->extent();
+    return _boxes[m];
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -604,7 +699,7 @@ Box VoronoiMesh::extent(int m) const
 Position VoronoiMesh::particlePosition(int m) const
 {
     if (m < 0 || m >= _Ncells) throw FATALERROR("Cell index out of range: " + QString::number(m));
-    return Position(_cells[m]->particle());
+    return Position(_px[m],_py[m],_pz[m]);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -612,7 +707,7 @@ Position VoronoiMesh::particlePosition(int m) const
 Position VoronoiMesh::centralPosition(int m) const
 {
     if (m < 0 || m >= _Ncells) throw FATALERROR("Cell index out of range: " + QString::number(m));
-    return Position(_cells[m]->centroid());
+    return Position(_centroids[m]);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -622,30 +717,37 @@ Position VoronoiMesh::randomPosition(Random* random, int m) const
     if (m < 0 || m >= _Ncells) throw FATALERROR("Cell index out of range: " + QString::number(m));
 
     // get loop-invariant information about the cell
-    const Box& box = _cells[m]->extent();
-    const vector<int>& neighbors = _cells[m]->neighbors();
+    const Box& box = _boxes[m];
 
     // generate random points in the enclosing box until one happens to be inside the cell
     for (int i=0; i<10000; i++)
     {
         Vec r = random->position(box);
-        if (isPointClosestTo(r, m, neighbors)) return Position(r);
+        if (isPointInCell(r, m)) return Position(r);
     }
     throw FATALERROR("Can't find random position in cell");
 }
 
 //////////////////////////////////////////////////////////////////////
 
-bool VoronoiMesh::isPointClosestTo(Vec r, int m, const vector<int>& ids) const
+bool VoronoiMesh::isPointInCell(Vec r, int m) const
 {
-    double target = _cells[m]->squaredDistanceTo(r);
-    foreach (int id, ids)
+    double target = squaredDistanceToParticle(m, r);
+    for (int i=_firstNeighbors[m]; i<_firstNeighbors[m+1]; i++)
     {
-        if (id>=0 && _cells[id]->squaredDistanceTo(r) < target) return false;
+        int id = _neighbors[i];
+        if (id>=0 && squaredDistanceToParticle(id, r) < target) return false;
     }
     return true;
 }
 
+//////////////////////////////////////////////////////////////////////
+
+double VoronoiMesh::squaredDistanceToParticle(int m, Vec r) const
+{
+    return Particles(_px,_py,_pz).squaredDistanceTo(m, r);
+}
+
 ////////////////////////////////////////////////////////////////////
 
 double VoronoiMesh::value(int g, int m) const
@@ -784,75 +886,106 @@ void VoronoiMesh::path(DustGridPath* path) const
     // If the photon package starts outside the dust grid, move it into the first grid cell that it will pass
     Position r = path->moveInside(_extent, _eps);
 
-    // Get the index of the cell containing the current position;
-    // if the position is not inside the grid, return an empty path
-    int mr = cellIndex(r);
+    // Get the index of the cell containing the current position, starting from the cell recorded in the path
+    // if it is known and it indeed contains the position; if the position is not inside the grid, return an empty path
+    int mr = path->initialCell();
+    if (mr<0 || !_extent.contains(r) || !isPointInCell(r, mr)) mr = cellIndex(r);
     if (mr<0) return path->clear();
 
+    // Cache the direction components, and determine whether the face planes have been precomputed
+    double kx = bfk.x();
+    double ky = bfk.y();
+    double kz = bfk.z();
+    bool havePlanes = !_fd.empty();
+
     // Start the loop over cells/path segments until we leave the grid
     while (mr>=0)
     {
-        // get the particle position for this cell
-        Vec pr = _cells[mr]->particle();
+        // get the current position and the range of neighbor indices for this cell
+        double rx = r.x();
+        double ry = r.y();
+        double rz = r.z();
+        int first = _firstNeighbors[mr];
+        int last = _firstNeighbors[mr+1];
 
         // initialize the smallest nonnegative intersection distance and corresponding index
         double sq = DBL_MAX;          // very large, but not infinity (so that infinite si values are discarded)
         const int NO_INDEX = -99;     // meaningless cell index
         int mq = NO_INDEX;
 
-        // loop over the list of neighbor indices
-        const vector<int>& mv = _cells[mr]->neighbors();
-        int n = mv.size();
-        for (int i=0; i<n; i++)
+        // --- use the precomputed face planes (domain walls are included as regular planes);
+        //     the vectorized kernel evaluates all faces of the cell in a single pass
+        if (havePlanes)
         {
-            int mi = mv[i];
+            int i = FaceIntersection::nearest(&_fnx[first], &_fny[first], &_fnz[first], &_fd[first], last-first,
+                                              rx, ry, rz, kx, ky, kz, sq);
+            if (i >= 0) mq = _neighbors[first+i];
+        }
 
-            // declare the intersection distance for this neighbor (init to a value that will be rejected)
-            double si = 0;
+        // --- calculate the face planes from the particle positions
+        else
+        {
+            // get the particle position for this cell
+            double prx = _px[mr];
+            double pry = _py[mr];
+            double prz = _pz[mr];
 
-            // --- intersection with neighboring cell
-            if (mi>=0)
+            // loop over the list of neighbor indices
+            for (int i=first; i<last; i++)
             {
-                // get the particle position for this neighbor
-                Vec pi = _cells[mi]->particle();
+                int mi = _neighbors[i];
 
-                // calculate the (unnormalized) normal on the bisecting plane
-                Vec n = pi - pr;
+                // declare the intersection distance for this neighbor (init to a value that will be rejected)
+                double si = 0;
 
-                // calculate the denominator of the intersection quotient
-                double ndotk = Vec::dot(n,bfk);
-
-                // if the denominator is negative the intersection distance is negative, so don't calculate it
-                if (ndotk > 0)
+                // --- intersection with neighboring cell
+                if (mi>=0)
                 {
-                    // calculate a point on the bisecting plane
-                    Vec p = 0.5 * (pi + pr);
+                    // get the particle position for this neighbor
+                    double pix = _px[mi];
+                    double piy = _py[mi];
+                    double piz = _pz[mi];
+
+                    // calculate the (unnormalized) normal on the bisecting plane
+                    double nx = pix - prx;
+                    double ny = piy - pry;
+                    double nz = piz - prz;
 
-                    // calculate the intersection distance
-                    si = Vec::dot(n,p-r) / ndotk;
+                    // calculate the denominator of the intersection quotient
+                    double ndotk = nx*kx + ny*ky + nz*kz;
+
+                    // if the denominator is negative the intersection distance is negative, so don't calculate it
+                    if (ndotk > 0)
+                    {
+                        // calculate the intersection distance using a point on the bisecting plane
+                        double px = 0.5 * (pix + prx);
+                        double py = 0.5 * (piy + pry);
+                        double pz = 0.5 * (piz + prz);
+                        si = (nx*(px-rx) + ny*(py-ry) + nz*(pz-rz)) / ndotk;
+                    }
                 }
-            }
 
-            // --- intersection with domain wall
-            else
-            {
-                switch (mi)
+                // --- intersection with domain wall
+                else
                 {
-                case -1: si = (extent().xmin()-r.x())/bfk.x(); break;
-                case -2: si = (extent().xmax()-r.x())/bfk.x(); break;
-                case -3: si = (extent().ymin()-r.y())/bfk.y(); break;
-                case -4: si = (extent().ymax()-r.y())/bfk.y(); break;
-                case -5: si = (extent().zmin()-r.z())/bfk.z(); break;
-                case -6: si = (extent().zmax()-r.z())/bfk.z(); break;
-                default: throw FATALERROR("Invalid neighbor ID");
+                    switch (mi)
+                    {
+                    case -1: si = (_extent.xmin()-rx)/kx; break;
+                    case -2: si = (_extent.xmax()-rx)/kx; break;
+                    case -3: si = (_extent.ymin()-ry)/ky; break;
+                    case -4: si = (_extent.ymax()-ry)/ky; break;
+                    case -5: si = (_extent.zmin()-rz)/kz; break;
+                    case -6: si = (_extent.zmax()-rz)/kz; break;
+                    default: throw FATALERROR("Invalid neighbor ID");
+                    }
                 }
-            }
 
-            // remember the smallest nonnegative intersection point
-            if (si > 0 && si < sq)
-            {
-                sq = si;
-                mq = mi;
+                // remember the smallest nonnegative intersection point
+                if (si > 0 && si < sq)
+                {
+                    sq = si;
+                    mq = mi;
+                }
             }
         }
 
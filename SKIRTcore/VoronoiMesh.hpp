@@ -16,7 +16,7 @@ class DustParticleInterface;
 class Log;
 class Random;
 class VoronoiMeshFile;
-namespace VoronoiMesh_Private { class VoronoiCell; class Node; }
+namespace VoronoiMesh_Private { class Node; }
 
 ////////////////////////////////////////////////////////////////////
 
@@ -46,6 +46,17 @@ namespace VoronoiMesh_Private { class VoronoiCell; class Node; }
 
     This class uses the Voro++ code written by Chris H. Rycroft (LBL / UC Berkeley) to build the
     Voronoi tesselation.
+
+    Because the path() function is called extremely often for large meshes, the cell information is
+    stored in a compact structure-of-arrays layout rather than as a separate object per cell. The
+    particle coordinates are kept in three flat arrays, one per coordinate, and the neighbor lists
+    for all cells are concatenated into a single index array in compressed row storage (CSR)
+    format, with a second array holding the offset of the first neighbor for each cell. Optionally
+    (see calculateFacePlanes()), the bisecting plane between each cell and each of its neighbors,
+    or the domain wall for cells on the border of the domain, can be precomputed and stored in a
+    set of arrays parallel to the neighbor index array. This allows the path() function to
+    calculate the intersection distances for all faces of a cell in a tight loop over contiguous
+    memory, at the cost of 32 bytes of memory per face.
 */
 class VoronoiMesh
 {
@@ -90,7 +101,8 @@ private:
          - if requested, remove particles that are too close to another particle
          - add the particles to a Voro++ container, and compute the Voronoi cells one by one;
          - copy the relevant cell information (such as the list of neighboring cells) from the
-           Voro++ data structures into our own;
+           Voro++ data structures into our own, using the structure-of-arrays layout described
+           in the class header;
          - build a data structure that allows fast retrieval of a list of the Voronoi cells
            possibly overlapping a given point in the domain (see below).
 
@@ -142,6 +154,25 @@ public:
         its arguments. */
     void neighborStatistics(double& average, int& minimum, int& maximum) const;
 
+    /** This function calculates and stores the bisecting plane for each face of each Voronoi cell,
+        so that the path() function doesn't need to recalculate these planes from the particle
+        positions of the cell and its neighbors every time the cell is crossed. The plane between
+        cell \f$m_r\f$ with particle position \f$\mathbf{p}(m_r)\f$ and neighbor \f$m_i\f$ is
+        stored as its (unnormalized) normal \f$\mathbf{n}=\mathbf{p}(m_i)-\mathbf{p}(m_r)\f$ and
+        offset \f$d=\mathbf{n}\cdot\frac12(\mathbf{p}(m_i)+\mathbf{p}(m_r))\f$; the domain walls
+        are stored in the same form. This requires an additional 32 bytes of memory per face, which
+        amounts to several hundred bytes per cell. Because the planes for the faces of a cell are
+        stored contiguously, the path() function can then evaluate all faces of a cell in a single
+        pass using the vectorized kernel offered by the FaceIntersection namespace. The function
+        modifies the mesh, so it should be called before the mesh is used from multiple threads.
+        Calling it more than once has no further effect. */
+    void calculateFacePlanes();
+
+    /** This function returns an estimate of the memory (in bytes) occupied by the data structures
+        held by the mesh, including the cell information, the field values, the block lists and the
+        search trees. */
+    size_t memoryUsage() const;
+
     /** This function returns the number of blocks \f$N_\text{blocks}\f$ in each spatial direction
         of the regular grid used to accelerate operation of the cellIndex() function. The total
         number of cells in the grid is \f$N_\text{blocks}^3\f$. */
@@ -208,11 +239,14 @@ public:
     Position randomPosition(Random* random, int m) const;
 
 private:
-    /** This function returns true if the specified point is closer to the particle
-        defining the cell with index \em m than to all of the particles defining the cells with the
-        indices in the list \em ids; otherwise it returns false. If the list \em ids contains the
-        neighbors of \em m then this function returns true if the point is inside cell \em m. */
-    bool isPointClosestTo(Vec r, int m, const std::vector<int> &ids) const;
+    /** This function returns true if the specified point is closer to the particle defining the
+        cell with index \em m than to all of the particles defining its neighboring cells, i.e. if
+        the point is inside cell \em m; otherwise it returns false. */
+    bool isPointInCell(Vec r, int m) const;
+
+    /** This function returns the squared distance between the specified point and the particle
+        defining the cell with index \em m. */
+    double squaredDistanceToParticle(int m, Vec r) const;
 
 public:
     /** This function returns the value \f$F_g(m)\f$ of the specified field in the cell with given
@@ -292,7 +326,11 @@ public:
         so, the current point is simply initialized to the start point. If not, the function
         computes the path segment to the first intersection with one of the domain walls and moves
         the current point inside the domain. Finally the function determines the current cell, i.e.
-        the cell containing the current point.
+        the cell containing the current point. If the path knows the cell containing the start point
+        (see DustGridPath::initialCell()), for example because the start point was obtained by
+        propagating a photon package along a previous path, the function verifies that the start
+        point is closer to the particle of that cell than to the particles of its neighbors, in
+        which case the search through the block data structures is skipped.
 
         In the second stage, the function loops over the algorithm that computes the exit point
         from the current cell, i.e. the intersection of the ray formed by the current point and
@@ -386,7 +424,16 @@ private:
     int _nb;                                    // number of blocks in each dimension (limit for indices i,j,k)
     int _nb2;                                   // nb*nb
     int _nb3;                                   // nb*nb*nb
-    std::vector<VoronoiMesh_Private::VoronoiCell*> _cells;  // cell objects, indexed on m
+    std::vector<double> _px, _py, _pz;                      // particle coordinates, indexed on m
+    std::vector<Box> _boxes;                                // enclosing cuboid for each cell, indexed on m
+    std::vector<Vec> _centroids;                            // centroid for each cell, indexed on m
+    std::vector<double> _volumes;                           // volume of each cell, indexed on m
+    std::vector<int> _firstNeighbors;                       // index in _neighbors of first neighbor, indexed on m
+                                                            // (with an extra entry at the end)
+    std::vector<int> _neighbors;                            // neighbor cell indices (or wall IDs) for all cells,
+                                                            // indexed on _firstNeighbors[m]+i
+    std::vector<double> _fnx, _fny, _fnz, _fd;              // face plane normal and offset, indexed as _neighbors
+                                                            // (empty unless calculateFacePlanes() was called)
     std::vector< std::vector<int> > _blocklists;            // list of cell indices per block, indexed on i*_nb2+j*_nb+k
     std::vector< VoronoiMesh_Private::Node* > _blocktrees;  // root node of search tree or null for each block,
                                                             // indexed on i*_nb2+j*_nb+k
@@ -0,0 +1,71 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "BinaryInFile.hpp"
+#include "FatalError.hpp"
+#include "Units.hpp"
+#include "VoronoiMeshBinaryFile.hpp"
+
+////////////////////////////////////////////////////////////////////
+
+VoronoiMeshBinaryFile::VoronoiMeshBinaryFile()
+    : _coordinateUnits(0), _row(0), _current(false)
+{
+}
+
+//////////////////////////////////////////////////////////////////////
+
+VoronoiMeshBinaryFile::~VoronoiMeshBinaryFile()
+{
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void VoronoiMeshBinaryFile::open()
+{
+    _infile.reset(new BinaryInFile(this, _filename, "Voronoi mesh data"));
+    _infile->requireColumns(3);
+    _coordinateUnits = _infile->factor(0, "length", "pc") * Units::pc();
+    _row = 0;
+    _current = false;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void VoronoiMeshBinaryFile::close()
+{
+    _infile.reset();
+    _current = false;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool VoronoiMeshBinaryFile::read()
+{
+    _current = _infile && _row < _infile->rows();
+    if (_current) _row++;
+    return _current;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+Vec VoronoiMeshBinaryFile::particle() const
+{
+    if (!_current) throw FATALERROR("No current record in Voronoi mesh data");
+    return Vec(_infile->value(_row-1,0), _infile->value(_row-1,1), _infile->value(_row-1,2)) * _coordinateUnits;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+double VoronoiMeshBinaryFile::value(int g) const
+{
+    if (!_current) throw FATALERROR("No current record in Voronoi mesh data");
+    if (g < 0) throw FATALERROR("Field index out of range");
+    if (static_cast<size_t>(g+3) >= _infile->columns())
+        throw FATALERROR("Insufficient number of field values in Voronoi mesh data");
+    return _infile->value(_row-1, g+3);
+}
+
+//////////////////////////////////////////////////////////////////////
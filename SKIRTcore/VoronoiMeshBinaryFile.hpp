@@ -0,0 +1,76 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef VORONOIMESHBINARYFILE_HPP
+#define VORONOIMESHBINARYFILE_HPP
+
+#include <memory>
+#include "VoronoiMeshFile.hpp"
+class BinaryInFile;
+
+////////////////////////////////////////////////////////////////////
+
+/** The VoronoiMeshBinaryFile class can read the relevant information on a cartesian
+    three-dimensional Voronoi mesh from a file in the binary column format described for the
+    BinaryInFile class. The file is memory-mapped, so that large meshes can be imported without
+    parsing text. Each row in the file represents a particle record. The first three columns
+    provide the x,y,z coordinates of the particle for this record, and the subsequent columns
+    provide the \f$N_{fields}\f$ values of the fields, i.e. the fourth column provides the value
+    for field \f$F_0\f$, the fifth for \f$F_1\f$, and so on. The units of the particle coordinates
+    are taken from the file header entry for the first column; if the header does not specify
+    units for this column, the coordinates are assumed to be given in pc. A binary file can be
+    produced from a file in the format described for the VoronoiMeshAsciiFile class with the \c
+    skirtconvert utility. */
+class VoronoiMeshBinaryFile : public VoronoiMeshFile
+{
+    Q_OBJECT
+    Q_CLASSINFO("Title", "a Voronoi mesh data file in binary column format")
+
+    //================= Construction - Destruction =================
+
+public:
+    /** The default constructor. */
+    Q_INVOKABLE VoronoiMeshBinaryFile();
+
+    /** The destructor closes the file, if it is still open. */
+    ~VoronoiMeshBinaryFile();
+
+    //======================== Other Functions =======================
+
+public:
+    /** This function opens and memory-maps the Voronoi mesh data file, or throws a fatal error if
+        the file can't be opened or is not in binary column format. It does not yet read any
+        records. */
+    void open();
+
+    /** This function closes the Voronoi mesh data file. */
+    void close();
+
+    /** This function advances to the next record in the file, and holds its information ready for
+        inspection through the other functions of this class. The function returns true if there
+        is a next record, or false if the end of the file was reached. */
+    bool read();
+
+    /** This function returns the coordinates of the particle (in SI units) for the current record.
+        If there is no current record, a fatal error is thrown. */
+    Vec particle() const;
+
+    /** This function returns the value \f$F_g\f$ of the field (in data file units) with given
+        zero-based index \f$0\le g \le N_{fields}-1\f$ for the current record. If there is no
+        current record, or if the index is out of range, a fatal error is thrown. */
+    double value(int g) const;
+
+    //========================= Data members =======================
+
+private:
+    std::unique_ptr<BinaryInFile> _infile;  // the input file, or null if the file is not open
+    double _coordinateUnits;                // the factor converting the particle coordinates to SI units
+    size_t _row;                            // the index of the next record
+    bool _current;                          // true if there is a current record
+};
+
+////////////////////////////////////////////////////////////////////
+
+#endif // VORONOIMESHBINARYFILE_HPP
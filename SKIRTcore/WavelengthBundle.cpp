@@ -0,0 +1,165 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#include "DustGridPath.hpp"
+#include "DustMix.hpp"
+#include "DustSystem.hpp"
+#include "WavelengthBundle.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////
+
+WavelengthBundle::WavelengthBundle(const DustSystem* ds, const vector<int>& ellv)
+    : _ds(ds), _K(ellv.size()), _Ncomp(ds ? ds->Ncomp() : 0), _kref(_K/2), _ellv(ellv),
+      _Lv(_K), _kappaextv(_Ncomp*_K), _kappascav(_Ncomp*_K), _taupathv(_K), _kextv(_K), _kscav(_K)
+{
+    for (int h=0; h<_Ncomp; h++)
+    {
+        DustMix* mix = _ds->mix(h);
+        for (int k=0; k<_K; k++)
+        {
+            _kappaextv[h*_K+k] = mix->kappaext(_ellv[k]);
+            _kappascav[h*_K+k] = mix->kappasca(_ellv[k]);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool WavelengthBundle::selectReference()
+{
+    // look outward from the middle of the bundle
+    int middle = _K/2;
+    for (int d=0; d<_K; d++)
+    {
+        int k = middle + ((d%2) ? -(d+1)/2 : d/2);
+        if (k>=0 && k<_K && _Lv[k]>0)
+        {
+            _kref = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void WavelengthBundle::fillOpticalDepth(const DustGridPath* path)
+{
+    int N = path->size();
+    size_t size = N*_K;
+    if (_dtauv.size() < size)
+    {
+        _dtauv.resize(size);
+        _albedov.resize(size);
+        _tauv.resize(size);
+    }
+
+    double* kext = &_kextv[0];
+    double* ksca = &_kscav[0];
+    double* taupath = &_taupathv[0];
+    for (int k=0; k<_K; k++) taupath[k] = 0.;
+
+    for (int n=0; n<N; n++)
+    {
+        // accumulate the extinction and scattering coefficients over the dust components,
+        // retrieving the density of each component only once for all wavelengths
+        int m = path->m(n);
+        for (int k=0; k<_K; k++) kext[k] = ksca[k] = 0.;
+        if (m >= 0 && _ds->hasOpacityTables())
+        {
+            for (int k=0; k<_K; k++)
+            {
+                kext[k] = _ds->extinction(m,_ellv[k]);
+                ksca[k] = _ds->albedo(m,_ellv[k]) * kext[k];
+            }
+        }
+        else if (m >= 0)
+        {
+            for (int h=0; h<_Ncomp; h++)
+            {
+                double rho = _ds->density(m,h);
+                if (rho > 0)
+                {
+                    const double* kappaext = &_kappaextv[h*_K];
+                    const double* kappasca = &_kappascav[h*_K];
+                    for (int k=0; k<_K; k++)
+                    {
+                        kext[k] += rho*kappaext[k];
+                        ksca[k] += rho*kappasca[k];
+                    }
+                }
+            }
+        }
+
+        // store the optical depths and albedos for this segment
+        double ds = path->ds(n);
+        double* dtau = &_dtauv[n*_K];
+        double* albedo = &_albedov[n*_K];
+        double* tau = &_tauv[n*_K];
+        for (int k=0; k<_K; k++)
+        {
+            dtau[k] = kext[k]*ds;
+            albedo[k] = kext[k]>0 ? ksca[k]/kext[k] : 0.;
+            taupath[k] += dtau[k];
+            tau[k] = taupath[k];
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void WavelengthBundle::opticalDepth(const DustGridPath* path, Array& tauv) const
+{
+    if (static_cast<int>(tauv.size()) != _K) tauv.resize(_K);
+    else tauv = 0.;
+
+    int N = path->size();
+    for (int n=0; n<N; n++)
+    {
+        int m = path->m(n);
+        if (m >= 0)
+        {
+            double ds = path->ds(n);
+            for (int h=0; h<_Ncomp; h++)
+            {
+                double rhods = _ds->density(m,h) * ds;
+                if (rhods > 0)
+                {
+                    const double* kappaext = &_kappaextv[h*_K];
+                    for (int k=0; k<_K; k++) tauv[k] += rhods*kappaext[k];
+                }
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+int WavelengthBundle::locate(const DustGridPath* path, int k, double tau, double& s) const
+{
+    // find the first segment for which the cumulative optical depth reaches the specified value
+    int N = path->size();
+    int lo = 0;
+    int hi = N-1;
+    while (lo < hi)
+    {
+        int mid = (lo+hi)/2;
+        if (_tauv[mid*_K+k] < tau) lo = mid+1;
+        else hi = mid;
+    }
+
+    // skip any empty segments, and interpolate within the segment
+    int n = lo;
+    while (n < N-1 && _dtauv[n*_K+k] <= 0) n++;
+    double s0 = n>0 ? path->s(n-1) : 0.;
+    double tau0 = n>0 ? _tauv[(n-1)*_K+k] : 0.;
+    double dtau = _dtauv[n*_K+k];
+    s = dtau>0 ? s0 + path->ds(n) * min(1., max(0., (tau-tau0)/dtau)) : s0;
+    return n;
+}
+
+//////////////////////////////////////////////////////////////////////
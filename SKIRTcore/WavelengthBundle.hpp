@@ -0,0 +1,134 @@
+/*//////////////////////////////////////////////////////////////////
+////       SKIRT -- an advanced radiative transfer code         ////
+////       © Astronomical Observatory, Ghent University         ////
+///////////////////////////////////////////////////////////////// */
+
+#ifndef WAVELENGTHBUNDLE_HPP
+#define WAVELENGTHBUNDLE_HPP
+
+#include <vector>
+#include "Array.hpp"
+class DustGridPath;
+class DustSystem;
+
+//////////////////////////////////////////////////////////////////////
+
+/** A WavelengthBundle object holds the wavelength-dependent state of a photon package that
+    carries luminosity at a block of \f$K\f$ wavelengths at the same time (a "wavelength bundle").
+    All wavelengths in the bundle share the launch position and direction, the scattering
+    positions and directions, and thus the geometric path through the dust grid. The object keeps
+    track of the wavelength indices \f$\ell_k\f$ and the luminosities \f$L_k\f$ for
+    \f$k=0,\dots,K-1\f$, and one of the wavelengths is designated as the reference wavelength,
+    which is used to generate random interaction locations and scattering directions. The
+    luminosities at the other wavelengths are corrected with the appropriate weight factors.
+
+    Given the geometric details of a path through the dust grid (stored in a DustGridPath
+    object), the fillOpticalDepth() function calculates the extinction and scattering optical
+    depths along the path for all wavelengths in the bundle. This happens in a single pass over
+    the path segments: the dust densities in each cell are retrieved only once, and the inner loop
+    over the wavelengths in the bundle operates on contiguous arrays so that it can be vectorized
+    by the compiler. The results are stored in the bundle with the wavelength index varying
+    fastest.
+
+    A WavelengthBundle object is intended to be used by a single execution thread; it is usually
+    constructed once for a chunk of photon packages so that its arrays remain allocated. */
+class WavelengthBundle
+{
+    //================= Construction - Destruction =================
+
+public:
+    /** The constructor creates a bundle for the wavelength indices in the specified list, using
+        the dust mixes and densities of the specified dust system to calculate optical depths. The
+        extinction and scattering coefficients of all dust components at the wavelengths in the
+        bundle are cached during construction. The luminosities are initialized to zero and the
+        reference wavelength is set to the middle of the bundle. */
+    WavelengthBundle(const DustSystem* ds, const std::vector<int>& ellv);
+
+    //======================== Other Functions =======================
+
+public:
+    /** This function returns the number of wavelengths \f$K\f$ in the bundle. */
+    int size() const { return _K; }
+
+    /** This function returns the wavelength index \f$\ell_k\f$ for the \f$k\f$'th wavelength in
+        the bundle. */
+    int ell(int k) const { return _ellv[k]; }
+
+    /** This function returns the list of wavelength indices in the bundle. */
+    const std::vector<int>& ellv() const { return _ellv; }
+
+    /** This function returns the luminosity \f$L_k\f$ for the \f$k\f$'th wavelength in the
+        bundle. */
+    double luminosity(int k) const { return _Lv[k]; }
+
+    /** This function sets the luminosity \f$L_k\f$ for the \f$k\f$'th wavelength in the bundle.
+        */
+    void setLuminosity(int k, double L) { _Lv[k] = L; }
+
+    /** This function returns the index \f$k\f$ in the bundle of the reference wavelength. */
+    int reference() const { return _kref; }
+
+    /** This function selects the reference wavelength for the bundle as the wavelength with
+        nonzero luminosity closest to the middle of the bundle. It returns false if all
+        luminosities are zero, and true otherwise. */
+    bool selectReference();
+
+    /** This function calculates the extinction and scattering optical depths for all wavelengths
+        in the bundle along the path with the specified geometric details, and stores the results
+        in the bundle. */
+    void fillOpticalDepth(const DustGridPath* path);
+
+    /** This function returns the extinction optical depth \f$\Delta\tau_{\ell_k,n}\f$ along the
+        \f$n\f$'th segment of the path most recently passed to fillOpticalDepth() at the \f$k\f$'th
+        wavelength in the bundle. */
+    double dtau(int n, int k) const { return _dtauv[n*_K+k]; }
+
+    /** This function returns the scattering albedo in the cell crossed by the \f$n\f$'th segment
+        of the path most recently passed to fillOpticalDepth() at the \f$k\f$'th wavelength in the
+        bundle, or zero if there is no dust in that cell. */
+    double albedo(int n, int k) const { return _albedov[n*_K+k]; }
+
+    /** This function returns the cumulative extinction optical depth \f$\tau_{\ell_k,n}\f$ from
+        the start of the path most recently passed to fillOpticalDepth() to the end of its
+        \f$n\f$'th segment at the \f$k\f$'th wavelength in the bundle. */
+    double tau(int n, int k) const { return _tauv[n*_K+k]; }
+
+    /** This function returns the total extinction optical depth along the path most recently
+        passed to fillOpticalDepth() at the \f$k\f$'th wavelength in the bundle. */
+    double tau(int k) const { return _taupathv[k]; }
+
+    /** This function calculates the total extinction optical depth along the specified path for
+        all wavelengths in the bundle, and stores the results in the specified array, which is
+        resized to the size of the bundle if needed. In contrast to fillOpticalDepth(), the function
+        does not store any information in the bundle. */
+    void opticalDepth(const DustGridPath* path, Array& tauv) const;
+
+    /** This function returns the index of the segment of the path most recently passed to
+        fillOpticalDepth() in which the cumulative optical depth at the \f$k\f$'th wavelength
+        reaches the specified value, and stores the corresponding physical path length in \em s.
+        The specified optical depth must be between zero and the total optical depth along the
+        path at the \f$k\f$'th wavelength. */
+    int locate(const DustGridPath* path, int k, double tau, double& s) const;
+
+    //======================== Data Members ========================
+
+private:
+    const DustSystem* _ds;
+    int _K;                     // the number of wavelengths in the bundle
+    int _Ncomp;                 // the number of dust components
+    int _kref;                  // the index of the reference wavelength
+    std::vector<int> _ellv;     // the wavelength indices, indexed on k
+    Array _Lv;                  // the luminosities, indexed on k
+    Array _kappaextv;           // the extinction coefficients, indexed on h*K+k
+    Array _kappascav;           // the scattering coefficients, indexed on h*K+k
+    Array _taupathv;            // the total optical depth along the path, indexed on k
+    std::vector<double> _dtauv;     // the extinction optical depth of each segment, indexed on n*K+k
+    std::vector<double> _albedov;   // the albedo in the cell of each segment, indexed on n*K+k
+    std::vector<double> _tauv;      // the cumulative optical depth at the end of each segment, indexed on n*K+k
+    std::vector<double> _kextv;     // scratch arrays used during the calculation, indexed on k
+    std::vector<double> _kscav;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif // WAVELENGTHBUNDLE_HPP
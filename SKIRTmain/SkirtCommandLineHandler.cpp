@@ -39,7 +39,7 @@
 namespace
 {
     // the allowed options list, in the format consumed by the CommandLineArguments constructor
-    static const char* allowedOptions = "-t* -s* -d -b -v -m -l* -e -k -i* -o* -r -x";
+    static const char* allowedOptions = "-t* -s* -d -a -c -p -b -v -m -l* -e -k -i* -o* -g* -r -x";
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -295,6 +295,8 @@ void SkirtCommandLineHandler::doSimulation(size_t index)
     QString base = _args.isPresent("-k") ? skiinfo.absolutePath() : QDir::currentPath();
     simulation->filePaths()->setInputPath((_args.value("-i").startsWith('/') ? "" : base + "/") + _args.value("-i"));
     simulation->filePaths()->setOutputPath((_args.value("-o").startsWith('/') ? "" : base + "/") + _args.value("-o"));
+    if (_args.isPresent("-g"))
+        simulation->filePaths()->setCachePath((_args.value("-g").startsWith('/') ? "" : base + "/") + _args.value("-g"));
 
     //  - the number of parallel threads
     if (_args.intValue("-t") > 0) simulation->parallelFactory()->setMaxThreadCount(_args.intValue("-t"));
@@ -310,6 +312,15 @@ void SkirtCommandLineHandler::doSimulation(size_t index)
     PeerToPeerCommunicator* comm = simulation->communicator();
     comm->setup();
 
+    //  - the pinning of threads to cores; multiple processes on the same computer use consecutive sets of cores,
+    //    based on the rank of the process among the processes on that computer
+    if (_args.isPresent("-p"))
+    {
+        if (_parallelSims > 1) throw FATALERROR("Thread pinning (-p) cannot be combined with parallel simulations (-s)");
+        ParallelFactory* factory = simulation->parallelFactory();
+        factory->setThreadPinning(ProcessManager::localRank() * factory->maxThreadCount());
+    }
+
     //  - the activation of data parallelization
     if (_args.isPresent("-d") && comm->isMultiProc())
     {
@@ -331,6 +342,28 @@ void SkirtCommandLineHandler::doSimulation(size_t index)
         comm->setDataParallel(true);
     }
 
+    //  - the assignment of chunks to processes on demand (ignored in data parallelization mode)
+    //    (requires an MPI library that supports calls from parallel threads)
+    if (_args.isPresent("-a") && comm->isMultiProc())
+    {
+        if (comm->dataParallel())
+            simulation->log()->warning("Chunks cannot be assigned on demand (-a) in data parallelization mode (-d)");
+        else if (!ProcessManager::isThreadSerialized())
+            simulation->log()->warning("Chunks cannot be assigned on demand (-a) because the MPI library "
+                                       "does not support calls from parallel threads");
+        else comm->setDynamicChunks(true);
+    }
+
+    //  - the distribution of the instrument data cubes (implied in data parallelization mode)
+    //    (requires an MPI library that supports calls from parallel threads)
+    if (_args.isPresent("-c") && comm->isMultiProc() && !comm->dataParallel())
+    {
+        if (!ProcessManager::isThreadSerialized())
+            simulation->log()->warning("Instrument data cubes cannot be distributed (-c) because the MPI library "
+                                       "does not support calls from parallel threads");
+        else comm->setDistributedCubes(true);
+    }
+
     //  - the console and the file log (and memory (de)allocation logging)
     FileLog* log = new FileLog();
     simulation->log()->setLinkedLog(log);
@@ -391,14 +424,17 @@ void SkirtCommandLineHandler::printHelp()
     _console.warning("To create a new ski file interactively:    skirt");
     _console.warning("To run a simulation with default options:  skirt <ski-filename>");
     _console.warning("");
-    _console.warning("  skirt [-t <threads>] [-s <simulations>] [-d]");
+    _console.warning("  skirt [-t <threads>] [-s <simulations>] [-d] [-a] [-c] [-p]");
     _console.warning("        [-b] [-v] [-m] [-l <limit>] [-e]");
-    _console.warning("        [-k] [-i <dirpath>] [-o <dirpath>]");
+    _console.warning("        [-k] [-i <dirpath>] [-o <dirpath>] [-g <dirpath>]");
     _console.warning("        [-r] {<filepath>}*");
     _console.warning("");
     _console.warning("  -t <threads> : the number of parallel threads for each simulation");
     _console.warning("  -s <simulations> : the number of parallel simulations per process");
     _console.warning("  -d : enable data parallelization mode for multiple processes");
+    _console.warning("  -a : assign chunks of photon packages to processes on demand");
+    _console.warning("  -c : distribute the instrument data cubes across processes in task parallelization mode");
+    _console.warning("  -p : pin the parallel threads to consecutive logical cores");
     _console.warning("  -b : force brief console logging");
     _console.warning("  -v : force verbose logging for multiple processes");
     _console.warning("  -m : state the amount of used memory at the start of each log message");
@@ -407,6 +443,7 @@ void SkirtCommandLineHandler::printHelp()
     _console.warning("  -k : make the input/output paths relative to the ski file being processed");
     _console.warning("  -i <dirpath> : the relative or absolute path for simulation input files");
     _console.warning("  -o <dirpath> : the relative or absolute path for simulation output files");
+    _console.warning("  -g <dirpath> : enable the dust grid cache in the relative or absolute path");
     _console.warning("  -r : cause recursive directory descent for all specified ski file paths");
     _console.warning("  <filepath> : the relative or absolute file path for a ski file");
     _console.warning("               (the filename may contain ? and * wildcards)");
@@ -23,7 +23,7 @@ simulations in the ski files specified on the command line according to the foll
 
 \verbatim
     skirt [-b] [-s <simulations>] [-t <threads>]
-          [-k] [-i <dirpath>] [-o <dirpath>]
+          [-k] [-i <dirpath>] [-o <dirpath>] [-g <dirpath>]
           [-r] {<filepath>}*
 \endverbatim
 
@@ -37,7 +37,10 @@ each simulation; the default value is the number of logical cores on the compute
 SKIRT. The -k option causes the simulation input/output paths to be relative to the ski file
 being processed, rather than to the current directory. The -i option specifies the absolute or
 relative path for simulation input files. The -o option specifies the absolute or relative path
-for simulation output files. The -r option causes recursive directory descent for all specified
+for simulation output files. The -g option enables the dust grid cache and specifies the absolute
+or relative path for its files; simulations that share the same dust distribution and dust grid
+then reuse the dust grid and the cell densities calculated by an earlier run (see the
+DustGridCache class). The -r option causes recursive directory descent for all specified
 \<filepath\> arguments, in other words all directories inside the specified base paths are
 searched for the specified filename (or filename pattern).
 